@@ -67,7 +67,7 @@ namespace ip2 {
 	constexpr int user_alert_id = 10000;
 
 	// this constant represents "max_alert_index" + 1
-	constexpr int num_alert_types = 68;
+	constexpr int num_alert_types = 69;
 
 	// internal
 	constexpr int abi_alert_count = 128;
@@ -1776,6 +1776,29 @@ namespace ip2 {
         std::vector<char> msg;
 	};
 
+	// this alert is posted when a session_handle::dht_get_items() lookup is
+	// done, after the dht_mutable_item_alert of every item it found.
+	struct TORRENT_EXPORT dht_get_items_alert final : alert
+	{
+		// internal
+		TORRENT_UNEXPORT dht_get_items_alert(aux::stack_allocator& alloc
+			, sha256_hash const& p, int len, bool m);
+
+		TORRENT_DEFINE_ALERT_PRIO(dht_get_items_alert, 68, alert_priority::critical)
+
+		static inline constexpr alert_category_t static_category = alert_category::dht;
+		std::string message() const override;
+
+		// the prefix that was looked up, and the number of its bytes that
+		// were matched
+		sha256_hash prefix;
+		int prefix_len;
+
+		// true if any node had more items than fit in its response. Query
+		// again with ``after`` set to the greatest target seen to get them
+		bool more;
+	};
+
 #undef TORRENT_DEFINE_ALERT_IMPL
 #undef TORRENT_DEFINE_ALERT
 #undef TORRENT_DEFINE_ALERT_PRIO
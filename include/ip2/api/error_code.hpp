@@ -30,6 +30,7 @@ enum error_code
 	RELAY_RESPONSE_ZERO,
 	EMPTY_BLOB_INDEX,
 	ABORT_ERROR,
+	RELAY_NOT_ACKNOWLEDGED,
 };
 
 } // namespace api
@@ -0,0 +1,73 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef IP2_API_SHARED_BLOB_HPP
+#define IP2_API_SHARED_BLOB_HPP
+
+#include "ip2/config.hpp"
+#include "ip2/span.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ip2 {
+namespace api {
+
+// immutable blob data shared between user and ip2 without copying.
+// Copying a shared_blob only copies the handle, the data is released
+// (or the release callback is invoked) when the last handle goes away.
+struct TORRENT_EXPORT shared_blob
+{
+	shared_blob() = default;
+
+	// take over a buffer owned by user
+	explicit shared_blob(std::vector<char>&& data)
+	{
+		auto buf = std::make_shared<std::vector<char> const>(std::move(data));
+		m_data = buf->data();
+		m_size = buf->size();
+		m_owner = std::move(buf);
+	}
+
+	// share a refcounted buffer, it must not be modified afterwards
+	explicit shared_blob(std::shared_ptr<std::vector<char> const> data)
+		: m_data(data ? data->data() : nullptr)
+		, m_size(data ? data->size() : 0)
+		, m_owner(std::move(data))
+	{}
+
+	// memory owned by user, which must stay valid and unmodified until
+	// release is called
+	shared_blob(char const* data, std::size_t size, std::function<void()> release)
+		: m_data(data)
+		, m_size(size)
+		, m_owner(data, [r = std::move(release)](char const*) { if (r) r(); })
+	{}
+
+	char const* data() const { return m_data; }
+	std::size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	span<char const> buf() const { return {m_data, static_cast<std::ptrdiff_t>(m_size)}; }
+
+private:
+
+	char const* m_data = nullptr;
+	std::size_t m_size = 0;
+
+	// keep data alive
+	std::shared_ptr<void const> m_owner;
+};
+
+} // namespace api
+} // namespace ip2
+
+#endif // IP2_API_SHARED_BLOB_HPP
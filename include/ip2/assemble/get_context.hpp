@@ -58,8 +58,40 @@ public:
 
 	void start_getting_hash(sha1_hash const& h, bool is_seg);
 
+	// whether a get for h was started already, speculatively or not
+	bool is_invoked(sha1_hash const& h) const
+	{
+		return m_invoked_hashes.find(h) != m_invoked_hashes.end();
+	}
+
+	// whether a get for h is flying, or h has been got
+	bool is_flying_or_got(sha1_hash const& h) const
+	{
+		return m_flying_segments.find(h) != m_flying_segments.end()
+			|| m_segments.find(h) != m_segments.end();
+	}
+
+	// whether the segment h is still of use. Before the index arrives,
+	// every segment is
+	bool is_wanted(sha1_hash const& h) const;
+
+	// until then, segments are only got from the hints
+	bool is_index_got() const { return m_index_got; }
+
 	bool is_getting_allowed(sha1_hash const& h);
 
+	// the sender is asked for h once, after the storing nodes failed it
+	bool is_origin_asked(sha1_hash const& h) const
+	{
+		return m_origin_asked.find(h) != m_origin_asked.end();
+	}
+
+	void start_getting_from_origin(sha1_hash const& h)
+	{
+		m_origin_asked.insert(h);
+		m_flying_segments.insert(h);
+	}
+
 	void on_arrived(sha1_hash const& hash)
 	{
 		m_flying_segments.erase(hash);
@@ -93,6 +125,9 @@ private:
 
 	std::set<sha1_hash> m_flying_segments;
 
+	std::set<sha1_hash> m_origin_asked;
+
+	bool m_index_got = false;
 	std::vector<sha1_hash> m_root_index;
 	std::map<sha1_hash, std::string> m_segments;
 	std::size_t m_segments_total_size = 0;
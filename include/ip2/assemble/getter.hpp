@@ -26,7 +26,9 @@ see LICENSE file.
 #include <ip2/kademlia/item.hpp>
 #include <ip2/kademlia/node_entry.hpp>
 
+#include <deque>
 #include <functional>
+#include <map>
 #include <queue>
 #include <set>
 #include <string>
@@ -48,6 +50,9 @@ namespace assemble {
 
 static constexpr int get_tasks_limit = 50;
 
+// how many index hints from relayed uris are kept for the gets they announce
+static constexpr int index_hints_limit = 128;
+
 class TORRENT_EXTRA_EXPORT getter final
 	: public std::enable_shared_from_this<getter>
 {
@@ -68,18 +73,43 @@ public:
 	api::error_code get_blob(dht::public_key const& sender
 		, aux::uri blob_uri, dht::timestamp ts);
 
+	// seg_hashes are the leading segment hashes the sender put in the
+	// notification, if any. They're kept for a get of that blob, which
+	// then gets those segments right away, along with the index. An
+	// inlined blob is kept for a get of it to return right away
 	void on_incoming_relay_uri(dht::public_key const& sender
-		, aux::uri blob_uri, dht::timestamp ts);
+		, aux::uri blob_uri, dht::timestamp ts
+		, std::vector<sha1_hash> const& seg_hashes
+		, std::string const& blob);
 
 	void update_node_id();
 
 private:
 
+	struct index_hint
+	{
+		dht::timestamp ts;
+		std::vector<sha1_hash> seg_hashes;
+		std::string blob;
+	};
+
+	using index_hints_t = std::map<std::pair<dht::public_key, aux::uri>, index_hint>;
+
 	void get_callback(dht::item const& it, bool auth
 		, std::shared_ptr<get_context> ctx, sha1_hash hash, bool is_seg);
 
 	void post_alert(std::shared_ptr<get_context> ctx);
 
+	// when the storing nodes failed h too many times, the sender published
+	// it and may still serve it. returns false if it was asked already
+	bool get_from_origin(std::shared_ptr<get_context> ctx
+		, sha1_hash const& h, bool is_seg);
+
+	void get_hinted_segments(std::shared_ptr<get_context> ctx
+		, std::vector<sha1_hash> const& seg_hashes);
+
+	void forget_index_hint(index_hints_t::iterator hint);
+
 	io_context& m_ios;
 	aux::session_interface& m_session;
 	aux::session_settings const& m_settings;
@@ -90,6 +120,11 @@ private:
 	dht::public_key m_self_pubkey;
 
 	std::set<std::shared_ptr<get_context> > m_running_tasks;
+
+	// (sender, uri) -> leading segment hashes or the blob itself from
+	// relayed uris, oldest first in m_index_hints_order
+	index_hints_t m_index_hints;
+	std::deque<std::pair<dht::public_key, aux::uri>> m_index_hints_order;
 };
 
 } // namespace assemble
@@ -17,6 +17,7 @@ see LICENSE file.
 #include "ip2/entry.hpp"
 #include "ip2/uri.hpp"
 #include "ip2/sha1_hash.hpp"
+#include "ip2/span.hpp"
 
 #include "ip2/kademlia/types.hpp"
 
@@ -57,6 +58,8 @@ namespace protocol {
 				's': <uri sender public key>
 				'u': <uri>
 				'ts': <timestamp>
+				'h': <leading segment hashes of the blob index, optional>
+				'b': <the whole blob, optional, instead of 'h' for small blobs>
 			}
 		}
 
@@ -66,6 +69,16 @@ namespace protocol {
 			'n': 'm' // message
 			'a': {
 				'm': <message content>
+				'i': <message id, optional, the sender wants a receipt>
+			}
+		}
+
+		relay receipt protcol:
+		{
+			'v': <version number with 4 bytes>
+			'n': 'k' // receipt
+			'a': {
+				'i': <ids of the messages received, 4 bytes each>
 			}
 		}
  */
@@ -82,6 +95,15 @@ namespace protocol {
 	static const std::int32_t index_hash_count = 45;
 	static const std::int32_t relay_msg_mtu = 950;
 
+	// how many segment hashes a relayed uri may carry, so that it stays
+	// within relay_msg_mtu. Blobs of up to this many segments have their
+	// whole index in the notification
+	static const std::int32_t relay_uri_hint_count = 42;
+
+	// blobs up to this size are put in the relayed uri itself, the sender
+	// key, uri and timestamp take the rest of relay_msg_mtu
+	static const std::int32_t relay_uri_inline_size = relay_msg_mtu - 100;
+
 	struct basic_protocol
 	{
 	public:
@@ -95,7 +117,10 @@ namespace protocol {
 
 		virtual ~basic_protocol() {}
 
-		entry to_entry();
+		entry to_entry() const&;
+
+		// move protocol fields into entry, avoid copying payload
+		entry to_entry() &&;
 
 		std::string get_version() { return m_version; }
 		std::string get_name() { return m_name; }
@@ -129,11 +154,10 @@ namespace protocol {
 
 		blob_seg_protocol(std::string const& seg_value);
 
-		std::string seg_value() { return m_seg_value; }
+		// construct segment from blob slice, payload is copied once into entry
+		explicit blob_seg_protocol(span<char const> seg_value);
 
-	protected:
-
-		std::string m_seg_value;
+		std::string seg_value() { return m_arg["v"].string(); }
 
 	private:
 
@@ -184,20 +208,37 @@ namespace protocol {
 
 		relay_uri_protocol(std::string const& ver, std::string const& n
 			, dht::public_key const& pk, aux::uri const& blob_uri
-			, dht::timestamp ts);
+			, dht::timestamp ts
+			, std::vector<sha1_hash> const& seg_hashes = std::vector<sha1_hash>());
 
 		relay_uri_protocol(dht::public_key const& pk, aux::uri const& blob_uri
-			, dht::timestamp ts);
+			, dht::timestamp ts
+			, std::vector<sha1_hash> const& seg_hashes = std::vector<sha1_hash>());
 
 		dht::public_key pk() { return m_pk; }
 		aux::uri blob_uri() { return m_uri; }
 		dht::timestamp ts() { return m_ts; }
 
+		// the segment hashes the sender put in, unverified. They're only a
+		// hint, the signed blob index is what the segments are checked against
+		std::vector<sha1_hash> const& seg_hashes() { return m_seg_hashes; }
+
+		// puts the blob itself in the notification, at most
+		// relay_uri_inline_size bytes
+		void inline_blob(std::string blob);
+
+		// the inlined blob, empty if the receiver has to get it
+		std::string const& blob() { return m_blob; }
+
 	protected:
 
+		void set_arg();
+
 		dht::public_key m_pk;
 		aux::uri m_uri;
 		dht::timestamp m_ts;
+		std::vector<sha1_hash> m_seg_hashes;
+		std::string m_blob;
 
 	private:
 
@@ -221,9 +262,46 @@ namespace protocol {
 
 		std::string msg() { return m_msg; }
 
+		// asks the receiver to acknowledge the message by this id
+		void set_id(std::uint32_t id);
+
+		bool has_id() { return m_has_id; }
+		std::uint32_t id() { return m_id; }
+
 	protected:
 
 		std::string m_msg;
+		std::uint32_t m_id = 0;
+		bool m_has_id = false;
+
+	private:
+
+		static const int major = 0;
+		static const int minor = 0;
+		static const int tiny = 0;
+		static char const ver[];
+	};
+
+	// how many message ids one receipt carries at most
+	static const std::int32_t receipt_id_count = 64;
+
+	struct relay_receipt_protocol : public basic_protocol
+	{
+	public:
+
+		static std::string version;
+		static std::string name;
+
+		relay_receipt_protocol(std::string const& ver, std::string const& n
+			, std::vector<std::uint32_t> const& ids);
+
+		relay_receipt_protocol(std::vector<std::uint32_t> const& ids);
+
+		std::vector<std::uint32_t> const& ids() { return m_ids; }
+
+	protected:
+
+		std::vector<std::uint32_t> m_ids;
 
 	private:
 
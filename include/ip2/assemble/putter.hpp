@@ -26,7 +26,9 @@ see LICENSE file.
 #include <ip2/kademlia/item.hpp>
 #include <ip2/kademlia/node_entry.hpp>
 
+#include <deque>
 #include <functional>
+#include <map>
 #include <set>
 #include <string>
 #include <tuple>
@@ -45,6 +47,9 @@ namespace aux {
 
 namespace assemble {
 
+// how many blob indexes are remembered for relaying their uris
+static constexpr int recent_blobs_limit = 64;
+
 class TORRENT_EXTRA_EXPORT putter final
 	: public std::enable_shared_from_this<putter>
 {
@@ -62,17 +67,24 @@ public:
 
 	std::shared_ptr<putter> self() { return shared_from_this(); }
 
+	// blob is only referenced during this call, each segment is copied
+	// once into the dht item, so a shared blob is never copied as a whole.
 	api::error_code put_blob(span<char const> blob, aux::uri const& blob_uri);
 
 	void put_callback(dht::item const& it, int responses
 		, std::shared_ptr<put_context> ctx, sha1_hash hash, bool is_seg);
 
+	// what to relay along with the uri of a blob recently put: the blob
+	// itself if it's at most protocol::relay_uri_inline_size bytes,
+	// otherwise its leading segment hashes, at most
+	// protocol::relay_uri_hint_count of them
+	bool relay_hint(aux::uri const& blob_uri, std::vector<sha1_hash>& hashes
+		, std::string& blob) const;
+
 	void update_node_id();
 
 private:
 
-	sha1_hash hash(std::string const& value, std::size_t value_size);
-
 	sha1_hash hash(std::vector<sha1_hash> const& hl);
 
 	sha1_hash hash(span<char const> blob, aux::uri const& blob_uri);
@@ -87,6 +99,16 @@ private:
 	dht::public_key m_self_pubkey;
 
 	std::set<std::shared_ptr<put_context> > m_running_tasks;
+
+	struct recent_blob
+	{
+		std::vector<sha1_hash> hashes;
+		std::string blob;
+	};
+
+	// uri -> the blobs put last, oldest first in m_recent_uris
+	std::map<aux::uri, recent_blob> m_recent_blobs;
+	std::deque<aux::uri> m_recent_uris;
 };
 
 } // namespace assemble
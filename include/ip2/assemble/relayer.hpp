@@ -19,6 +19,9 @@ see LICENSE file.
 #include "ip2/api/error_code.hpp"
 #include "ip2/aux_/common.h"
 #include "ip2/aux_/deadline_timer.hpp"
+#include "ip2/error_code.hpp"
+#include "ip2/time.hpp"
+#include "ip2/sha1_hash.hpp"
 #include "ip2/span.hpp"
 #include "ip2/uri.hpp"
 
@@ -26,7 +29,9 @@ see LICENSE file.
 #include <ip2/kademlia/item.hpp>
 #include <ip2/kademlia/node_entry.hpp>
 
+#include <deque>
 #include <functional>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -44,6 +49,13 @@ namespace aux {
 
 namespace assemble {
 
+// a message that isn't acknowledged is sent this many times at most
+static constexpr int relay_send_limit = 4;
+
+// how many received message ids are remembered per relayer, to not report
+// a message sent again twice
+static constexpr int received_ids_limit = 1024;
+
 class TORRENT_EXTRA_EXPORT relayer final
 	: public std::enable_shared_from_this<relayer>
 {
@@ -56,6 +68,8 @@ public:
 		, counters& cnt
 		, assemble_logger& logger);
 
+	~relayer();
+
 	relayer(relayer const&) = delete;
 	relayer& operator=(relayer const&) = delete;
 	relayer(relayer&&) = delete;
@@ -66,10 +80,22 @@ public:
 	api::error_code relay_message(dht::public_key const& receiver
 		, span<char const> message);
 
-	void on_incoming_relay_message(dht::public_key const& pk, std::string const& msg);
+	// a message with an id is acknowledged to its sender, in a receipt
+	// together with the others received around the same time
+	void on_incoming_relay_message(dht::public_key const& pk, std::string const& msg
+		, bool has_id = false, std::uint32_t id = 0);
 
+	void on_incoming_relay_receipt(dht::public_key const& pk
+		, std::vector<std::uint32_t> const& ids);
+
+	// seg_hashes, if not empty, are relayed along with the uri, for the
+	// receiver to get those segments in parallel with the index. A blob,
+	// if not empty, is relayed inline and the receiver doesn't have to get
+	// it at all
 	api::error_code relay_uri(dht::public_key const& receiver
-		, aux::uri const& data_uri, dht::timestamp ts);
+		, aux::uri const& data_uri, dht::timestamp ts
+		, std::vector<sha1_hash> const& seg_hashes = std::vector<sha1_hash>()
+		, std::string const& blob = std::string());
 
 	void update_node_id();
 
@@ -84,6 +110,24 @@ private:
         , std::shared_ptr<relay_context> ctx
 		, dht::public_key receiver, aux::uri data_uri, dht::timestamp ts);
 
+	api::error_code send_tracked(std::uint32_t id);
+
+	void send_receipts(dht::public_key const& pk);
+
+	void start_timer();
+	void on_timer(ip2::error_code const& ec);
+
+	// a message sent with relay_receipts set, until the receiver
+	// acknowledges it or we give up
+	struct unacked_message
+	{
+		dht::public_key receiver;
+		std::string msg;
+		std::shared_ptr<relay_context> ctx;
+		int sends = 0;
+		time_point next_send;
+	};
+
 	io_context& m_ios;
 	aux::session_interface& m_session;
 	aux::session_settings const& m_settings;
@@ -95,6 +139,19 @@ private:
 
 	std::set<std::shared_ptr<relay_context> > m_running_tasks;
 
+	// message id -> messages waiting for a receipt
+	std::map<std::uint32_t, unacked_message> m_unacked;
+
+	// sender -> ids of the messages to acknowledge
+	std::map<dht::public_key, std::vector<std::uint32_t>> m_receipts;
+
+	// the messages received last, oldest first in m_received_order
+	std::set<std::pair<dht::public_key, std::uint32_t>> m_received;
+	std::deque<std::pair<dht::public_key, std::uint32_t>> m_received_order;
+
+	// sends the receipts and the messages due again
+	aux::deadline_timer m_timer;
+	bool m_timer_active = false;
 };
 
 } // namespace assemble
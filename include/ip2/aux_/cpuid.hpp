@@ -19,6 +19,8 @@ namespace ip2 { namespace aux {
 	TORRENT_EXTRA_EXPORT extern bool const mmx_support;
 	TORRENT_EXTRA_EXPORT extern bool const arm_neon_support;
 	TORRENT_EXTRA_EXPORT extern bool const arm_crc32c_support;
+	TORRENT_EXTRA_EXPORT extern bool const avx2_support;
+	TORRENT_EXTRA_EXPORT extern bool const sha_ni_support;
 } }
 
 #endif // TORRENT_CPUID_HPP_INCLUDED
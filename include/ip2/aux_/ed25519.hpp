@@ -13,6 +13,12 @@ int TORRENT_EXPORT ed25519_verify(const unsigned char *signature, const unsigned
 void TORRENT_EXPORT ed25519_add_scalar(unsigned char *public_key, unsigned char *private_key, const unsigned char *scalar);
 void TORRENT_EXPORT ed25519_key_exchange(unsigned char *shared_secret, const unsigned char *public_key, const unsigned char *private_key);
 
+// ed25519_sign() and ed25519_key_exchange() use 64 bit field arithmetic where
+// the compiler has a 128 bit integer type. These are the portable 32 bit
+// versions, with identical output, kept for tests and benchmarks.
+void TORRENT_EXTRA_EXPORT ed25519_sign_ref10(unsigned char *signature, const unsigned char *message, std::ptrdiff_t message_len, const unsigned char *public_key, const unsigned char *private_key);
+void TORRENT_EXTRA_EXPORT ed25519_key_exchange_ref10(unsigned char *shared_secret, const unsigned char *public_key, const unsigned char *private_key);
+
 } }
 
 #endif // ED25519_HPP
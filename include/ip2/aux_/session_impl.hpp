@@ -73,6 +73,7 @@ see LICENSE file.
 
 #include "ip2/blockchain/account.hpp"
 #include "ip2/blockchain/blockchain.hpp"
+#include "ip2/blockchain/chain_reader.hpp"
 #include "ip2/blockchain/block.hpp"
 #include "ip2/blockchain/transaction.hpp"
 
@@ -417,6 +418,8 @@ namespace aux {
 
 			leveldb::DB* kvdb() override {return m_kvdb;}
 			sqlite3* sqldb() override {return m_sqldb;}
+			std::shared_ptr<blockchain::chain_reader> chain_reader() const override
+			{ return std::atomic_load(&m_chain_reader); }
 
 			std::int64_t timer_coe() override {return m_timer_coe;}
 
@@ -480,6 +483,11 @@ namespace aux {
 			void dht_get_mutable_item(std::array<char, 32> key
 				, std::string salt = std::string());
 
+			void get_items_callback(sha256_hash const& prefix, int prefix_len
+				, dht::item const& i, bool, bool more);
+			void dht_get_items(sha256_hash const& prefix, int prefix_len
+				, sha256_hash const& after);
+
 			void dht_put_immutable_item(entry const& data, sha256_hash target);
 
 			void dht_put_mutable_item(std::array<char, 32> key
@@ -704,6 +712,7 @@ namespace aux {
 			bool add_new_friend(const dht::public_key& pubkey);
 			bool delete_friend(const dht::public_key& pubkey);
             bool add_new_message(const communication::message& msg);
+            std::vector<bool> add_new_messages(const std::vector<communication::message>& msgs);
 		    bool publish_data(const aux::bytes& key, const aux::bytes& value);
 		    bool subscribe_from_peer(const dht::public_key& pubkey, const aux::bytes& data);
 		    bool send_to_peer(const dht::public_key& pubkey, const aux::bytes& data);
@@ -717,7 +726,9 @@ namespace aux {
         	bool unfollow_chain(const aux::bytes &chain_id);
         	bool start_chain(const aux::bytes &chain_id);
         	bool submit_transaction(const blockchain::transaction & tx);
+        	std::vector<bool> submit_transactions(const std::vector<blockchain::transaction>& txs);
         	bool get_account_info(const aux::bytes &chain_id, dht::public_key publicKey, blockchain::account* act);
+        	blockchain::account query_account_info(const aux::bytes &chain_id, dht::public_key publicKey);
         	bool get_top_tip_block(const aux::bytes &chain_id, int topNum, std::vector<blockchain::block>* blks);
         	bool get_access_list(const aux::bytes &chain_id, std::set<dht::public_key>* keys);
         	bool get_ban_list(const aux::bytes &chain_id, std::set<dht::public_key>* keys);
@@ -749,6 +760,10 @@ namespace aux {
 		ip2::api::error_code put_data_into_swarm(std::vector<char> const& blob
 			, std::array<char, 20> const& uri);
 
+		// put data shared by handle, without copying blob
+		ip2::api::error_code put_shared_blob_into_swarm(ip2::api::shared_blob const& blob
+			, std::array<char, 20> const& uri);
+
 		// send data uri to other peer by 'relay' protocol.
 		// the receiver can get the corresponding data by this uri & uri_sender.
 		// The "relay_data_uri_alert" alert will be posted to user to indicate
@@ -865,6 +880,10 @@ namespace aux {
             leveldb::DB* m_kvdb;
             sqlite3* m_sqldb;
 
+            // read-only connections on sqldb for queries from user threads,
+            // accessed by std::atomic_load/std::atomic_store only
+            std::shared_ptr<blockchain::chain_reader> m_chain_reader;
+
             std::int64_t m_timer_coe = 1;
 			
 	 		std::tuple<dht::public_key, dht::secret_key> m_keypair;
@@ -1036,7 +1055,10 @@ namespace aux {
 				, udp_send_flags_t const flags);
 
 #ifdef TORRENT_ENABLE_UDP_COMPRESS
-			bool compress_udp_packet(span<char const> p, std::string& out);
+			// writes a one byte encoding header followed by the packet, snappy
+			// compressed if try_compress is set and that makes it smaller
+			bool compress_udp_packet(span<char const> p, std::string& out
+				, bool try_compress);
 
 			bool uncompress_udp_packet(const std::string& in, std::string& out);
 #endif
@@ -69,6 +69,11 @@ namespace dht {
 
 		struct dht_tracker;
 	}
+
+namespace blockchain {
+
+		class chain_reader;
+	}
 }
 
 namespace ip2::aux {
@@ -208,6 +213,8 @@ namespace ip2::aux {
 
 		virtual leveldb::DB* kvdb() = 0;
 		virtual sqlite3* sqldb() = 0;
+		// read-only query path on sqldb, may be null
+		virtual std::shared_ptr<blockchain::chain_reader> chain_reader() const = 0;
 
 		virtual std::int64_t timer_coe() = 0;
 
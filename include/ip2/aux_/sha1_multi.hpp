@@ -0,0 +1,47 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef TORRENT_SHA1_MULTI_HPP_INCLUDED
+#define TORRENT_SHA1_MULTI_HPP_INCLUDED
+
+#include "ip2/config.hpp"
+#include "ip2/sha1_hash.hpp"
+#include "ip2/span.hpp"
+
+#include <cstdint>
+
+namespace ip2::aux {
+
+	enum class sha1_multi_impl : std::uint8_t
+	{
+		// one message at a time, through ip2::hasher
+		scalar,
+
+		// 8 messages in parallel, one per 32 bit lane of the ymm registers
+		avx2,
+
+		// one message at a time, with the SHA extension instructions
+		sha_ni
+	};
+
+	// the fastest implementation supported by the CPU we're running on
+	TORRENT_EXTRA_EXPORT sha1_multi_impl sha1_multi_best();
+
+	TORRENT_EXTRA_EXPORT bool sha1_multi_supported(sha1_multi_impl impl);
+
+	// sets out[i] to the SHA-1 digest of msgs[i], for every message. This is
+	// meant for many short independent messages, like the segments of a
+	// blob, where a context per message leaves most of the SIMD width
+	// unused. ``out`` must be at least as long as ``msgs``. An impl the CPU
+	// doesn't support falls back to scalar.
+	TORRENT_EXTRA_EXPORT void sha1_multi(span<span<char const> const> msgs
+		, span<sha1_hash> out, sha1_multi_impl impl = sha1_multi_best());
+}
+
+#endif // TORRENT_SHA1_MULTI_HPP_INCLUDED
@@ -45,6 +45,10 @@ namespace ip2::aux {
 		static inline constexpr udp_send_flags_t dont_queue = 2_bit;
 		static inline constexpr udp_send_flags_t dont_fragment = 3_bit;
 
+		// the payload doesn't compress (encrypted or random bytes), don't
+		// spend time trying when UDP compression is enabled
+		static inline constexpr udp_send_flags_t dont_compress = 4_bit;
+
 		bool is_open() const { return m_abort == false; }
 		udp::socket::executor_type get_executor() { return m_socket.get_executor(); }
 
@@ -11,6 +11,7 @@ see LICENSE file.
 
 #include <utility>
 #include <ostream>
+#include <vector>
 
 #include "ip2/address.hpp"
 #include "ip2/aux_/common.h"
@@ -29,6 +30,8 @@ namespace blockchain {
     enum block_version {
         block_version1,
         block_unknown_version,
+        // a batch of txs with a tx merkle root in header
+        block_version2,
     };
 
     class TORRENT_EXPORT block {
@@ -49,7 +52,11 @@ namespace blockchain {
                                                m_previous_block_hash(mPreviousBlockHash), m_base_target(mBaseTarget),
                                                m_cumulative_difficulty(mCumulativeDifficulty),
                                                m_generation_signature(mGenerationSignature), m_multiplex_hash(mMultiplexHash),
-                                               m_tx(std::move(mTx)), m_miner(mMiner) {}
+                                               m_miner(mMiner) {
+            if (!mTx.empty()) {
+                m_txs.push_back(std::move(mTx));
+            }
+        }
 
         block(aux::bytes mChainId, block_version mVersion, int64_t mTimestamp, int64_t mBlockNumber,
               const sha1_hash &mPreviousBlockHash, uint64_t mBaseTarget, uint64_t mCumulativeDifficulty,
@@ -58,8 +65,35 @@ namespace blockchain {
                 m_chain_id(std::move(mChainId)), m_version(mVersion), m_timestamp(mTimestamp),
                 m_block_number(mBlockNumber), m_previous_block_hash(mPreviousBlockHash), m_base_target(mBaseTarget),
                 m_cumulative_difficulty(mCumulativeDifficulty), m_generation_signature(mGenerationSignature),
-                m_multiplex_hash(mMultiplexHash), m_tx(std::move(mTx)), m_miner(mMiner), m_signature(mSignature),
-                m_hash(mHash) {}
+                m_multiplex_hash(mMultiplexHash), m_miner(mMiner), m_signature(mSignature), m_hash(mHash) {
+            if (!mTx.empty()) {
+                m_txs.push_back(std::move(mTx));
+            }
+        }
+
+        block(aux::bytes mChainId, block_version mVersion, int64_t mTimestamp, int64_t mBlockNumber,
+              const sha1_hash &mPreviousBlockHash, uint64_t mBaseTarget, uint64_t mCumulativeDifficulty,
+              const sha1_hash &mGenerationSignature, const sha1_hash &mMultiplexHash, std::vector<transaction> mTxs,
+              const dht::public_key &mMiner) : m_chain_id(std::move(mChainId)), m_version(mVersion),
+                                               m_timestamp(mTimestamp), m_block_number(mBlockNumber),
+                                               m_previous_block_hash(mPreviousBlockHash), m_base_target(mBaseTarget),
+                                               m_cumulative_difficulty(mCumulativeDifficulty),
+                                               m_generation_signature(mGenerationSignature), m_multiplex_hash(mMultiplexHash),
+                                               m_txs(std::move(mTxs)), m_miner(mMiner) {
+            m_tx_merkle_root = calculate_tx_merkle_root(m_txs);
+        }
+
+        block(aux::bytes mChainId, block_version mVersion, int64_t mTimestamp, int64_t mBlockNumber,
+              const sha1_hash &mPreviousBlockHash, uint64_t mBaseTarget, uint64_t mCumulativeDifficulty,
+              const sha1_hash &mGenerationSignature, const sha1_hash &mMultiplexHash, std::vector<transaction> mTxs,
+              const dht::public_key &mMiner, const dht::signature &mSignature, const sha1_hash &mHash) :
+                m_chain_id(std::move(mChainId)), m_version(mVersion), m_timestamp(mTimestamp),
+                m_block_number(mBlockNumber), m_previous_block_hash(mPreviousBlockHash), m_base_target(mBaseTarget),
+                m_cumulative_difficulty(mCumulativeDifficulty), m_generation_signature(mGenerationSignature),
+                m_multiplex_hash(mMultiplexHash), m_txs(std::move(mTxs)), m_miner(mMiner), m_signature(mSignature),
+                m_hash(mHash) {
+            m_tx_merkle_root = calculate_tx_merkle_root(m_txs);
+        }
 
 //        block(aux::bytes mChainId, block_version mVersion, int64_t mTimestamp, int64_t mBlockNumber,
 //              const sha1_hash &mPreviousBlockHash, uint64_t mBaseTarget, uint64_t mCumulativeDifficulty,
@@ -92,7 +126,25 @@ namespace blockchain {
 
         const sha1_hash &genesis_block_hash() const;
 
-        const transaction &tx() const { return m_tx; }
+        // the first tx of block, or an empty tx
+        const transaction &tx() const;
+
+        // all txs packed in block, at most one for version 1 block
+        const std::vector<transaction> &txs() const { return m_txs; }
+
+        const sha1_hash &tx_merkle_root() const { return m_tx_merkle_root; }
+
+        // check if tx merkle root in header matches txs
+        bool verify_tx_merkle_root() const;
+
+        // merkle root of tx hashes, odd node is paired with itself
+        static sha1_hash calculate_tx_merkle_root(const std::vector<transaction> &txs);
+
+        // encode of txs that stored in db, single tx for version 1 block, tx list for version 2 block
+        std::string get_txs_encode() const;
+
+        // decode txs encoded by get_txs_encode
+        static std::vector<transaction> txs_from_encode(block_version version, const std::string &encode);
 
         const dht::public_key &miner() const { return m_miner; }
 
@@ -180,8 +232,11 @@ namespace blockchain {
         // state root/genesis block hash
         sha1_hash m_multiplex_hash;
 
-        // tx
-        transaction m_tx;
+        // txs
+        std::vector<transaction> m_txs;
+
+        // merkle root of txs(version 2)
+        sha1_hash m_tx_merkle_root;
 
         // miner
         dht::public_key m_miner{};
@@ -10,8 +10,13 @@ see LICENSE file.
 #define IP2_BLOCKCHAIN_HPP
 
 
+#include <deque>
 #include <map>
+#include <memory>
+#include <optional>
 #include <set>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <queue>
@@ -65,6 +70,15 @@ namespace blockchain {
     // blockchain last put time(5min)
     constexpr std::int64_t blockchain_min_put_interval = 5 * 60 * 1000;
 
+    // min interval to republish the state arrays of the same epoch snapshot(30min)
+    constexpr std::int64_t blockchain_snapshot_republish_interval = 30 * 60 * 1000;
+
+    // max state arrays getting in parallel while syncing an epoch snapshot
+    constexpr std::size_t blockchain_state_sync_window = 8;
+
+    // max getting times of one state array before the whole snapshot is requested again
+    constexpr int blockchain_state_array_max_getting_times = 3;
+
     // blockchain min ban time(5min)
 //    constexpr std::int64_t blockchain_min_ban_time = 5 * 60 * 1000;
 
@@ -109,6 +123,78 @@ namespace blockchain {
         DHT_UNKNOWN,
     };
 
+    // progress of getting the state arrays listed by an epoch state hash array
+    struct state_sync {
+        state_sync() = default;
+
+        state_sync(const dht::public_key &mPeer, state_hash_array mHashArray) :
+            m_peer(mPeer), m_hash_array(std::move(mHashArray)) {}
+
+        bool done() const { return m_queued.empty() && m_getting.empty(); }
+
+        // peer who published the snapshot
+        dht::public_key m_peer;
+
+        // snapshot manifest, its hash is the state root of the epoch block
+        state_hash_array m_hash_array;
+
+        // state arrays not requested yet
+        std::deque<sha1_hash> m_queued;
+
+        // state arrays being got <--> getting times
+        std::map<sha1_hash, int> m_getting;
+    };
+
+    // index of a chain's context in blockchain, valid until the chain is removed
+    using chain_handle = std::uint32_t;
+
+    struct chain_id_hash {
+        std::size_t operator()(const aux::bytes &chain_id) const {
+            return std::hash<std::string_view>()(std::string_view(
+                    reinterpret_cast<const char *>(chain_id.data()), chain_id.size()));
+        }
+    };
+
+    // everything kept in memory for a chain, so that it's looked up once per call
+    struct chain_context {
+        chain_context(io_context &ioc, aux::bytes mChainId) : m_chain_id(std::move(mChainId)), m_timer(ioc) {}
+
+        aux::bytes m_chain_id;
+
+        // a context also exists for chains only heard about, until it's removed
+        bool m_followed = false;
+
+        // chain connected flag
+        bool m_connected = false;
+
+        int m_getting_times = 0;
+
+        // mining timer
+        aux::deadline_timer m_timer;
+
+        tx_pool m_tx_pool;
+
+        // Forwarding list
+        std::map<dht::public_key, peer_info> m_access_list;
+
+        block m_head_block;
+
+        std::int64_t m_all_data_last_put_time = 0;
+
+        std::int64_t m_all_blocks_last_put_time = 0;
+
+        std::int64_t m_all_state_last_put_time = 0;
+
+        // epoch snapshot being synced from peer
+        std::optional<state_sync> m_state_sync;
+
+        // state hash array of the current epoch, its state arrays are kept in state array db
+        std::optional<state_hash_array> m_state_snapshot;
+
+        // last put time of state arrays (state root <--> last put time)
+        std::pair<sha1_hash, std::int64_t> m_snapshot_last_put_time;
+    };
+
     struct dht_item {
         // send
         dht_item(const dht::public_key &mPeer, entry mData) : m_peer(mPeer), m_data(std::move(mData)) {
@@ -406,11 +492,30 @@ namespace blockchain {
         // initialize member variables
         bool init();
 
+        // the context of chain_id, nullptr if there is none
+        chain_context *find_chain(const aux::bytes &chain_id);
+
+        // the context of chain_id, created if there is none
+        chain_context &chain(const aux::bytes &chain_id);
+
+        chain_context *chain_at(chain_handle handle);
+
+        void remove_chain(const aux::bytes &chain_id);
+
         // init chain
         bool init_chain(const aux::bytes &chain_id);
 
         bool create_chain_db(const aux::bytes &chain_id);
 
+        // update head block in cache, and publish it to read-only query path
+        void set_head_block(const aux::bytes &chain_id, const block &blk);
+
+        void remove_head_block(const aux::bytes &chain_id);
+
+        // the read-only query path serves the head of followed and connected chains only, like
+        // getTopTipBlocks, called whenever one of those changes
+        void publish_head_block(chain_context const& ctx);
+
         // get current time(ms)
         static std::int64_t get_total_milliseconds();
 
@@ -458,12 +563,18 @@ namespace blockchain {
 
 //        void add_and_access_peers_in_acl(const aux::bytes &chain_id);
 
-        // verify block
-        RESULT verify_block(const aux::bytes &chain_id, const block &b, const block &previous_block);
+        // verify block, against the ancestors and the miner's state in repo
+        RESULT verify_block(const aux::bytes &chain_id, const block &b, const block &previous_block, repository &repo);
 
         // process block
         RESULT process_genesis_block(const aux::bytes &chain_id, const block &blk, const std::vector<state_array> &arrays);
 
+        // process genesis block, state arrays listed in hash array are read from state array db one by one
+        RESULT process_genesis_block(const aux::bytes &chain_id, const block &blk, const state_hash_array &hashArray);
+
+        // save accounts of all state arrays listed in hash array into state db
+        bool save_state_arrays(const aux::bytes &chain_id, const state_hash_array &hashArray);
+
         // process block
         RESULT process_block(const aux::bytes &chain_id, const block &blk);
 
@@ -471,6 +582,18 @@ namespace blockchain {
 
         void state_reception_event(const aux::bytes &chain_id, const dht::public_key& peer);
 
+        // start to get the state arrays of an epoch snapshot from peer
+        void start_state_sync(const aux::bytes &chain_id, const dht::public_key& peer, const state_hash_array &hashArray);
+
+        // keep up to blockchain_state_sync_window state arrays getting
+        void get_next_state_arrays(const aux::bytes &chain_id);
+
+        // get a missing state array again, or request all state when out of getting times
+        void state_array_missing(const aux::bytes &chain_id, const dht::public_key& peer, const sha1_hash &hash);
+
+        // replace current epoch snapshot, state arrays only referenced by the old one are removed
+        void set_state_snapshot(const aux::bytes &chain_id, const state_hash_array &hashArray);
+
         // check if a chain is empty, true if has no info, false otherwise
         bool is_empty_chain(const aux::bytes &chain_id);
 
@@ -525,6 +648,9 @@ namespace blockchain {
 
         void get_genesis_state(const aux::bytes &chain_id, sha1_hash &stateRoot, std::vector<state_array> &arrays);
 
+        // state hash array committed by the state root of epoch block, state arrays are saved in state array db
+        state_hash_array get_state_snapshot(const aux::bytes &chain_id, const block &blk);
+
         // make a salt on mutable channel
 //        static std::string make_salt(const aux::bytes &chain_id, std::int64_t data_type_id);
 
@@ -582,7 +708,7 @@ namespace blockchain {
 
         void put_head_block(const aux::bytes &chain_id, const block &blk);
 
-        void put_genesis_head_block(const aux::bytes &chain_id, const block &blk, const std::vector<state_array> &arrays);
+        void put_genesis_head_block(const aux::bytes &chain_id, const block &blk, const state_hash_array &hashArray);
 
         void get_pool_from_peer(const aux::bytes &chain_id, const dht::public_key& peer, std::int64_t timestamp = 0);
 
@@ -618,7 +744,7 @@ namespace blockchain {
 
         void put_block(const aux::bytes &chain_id, const block &blk);
 
-        void put_block_with_all_state(const aux::bytes &chain_id, const block &blk, const std::vector<state_array> &arrays);
+        void put_block_with_all_state(const aux::bytes &chain_id, const block &blk, const state_hash_array &hashArray);
 
 //        void get_transaction_wrapper(const aux::bytes &chain_id, const dht::public_key& peer, const sha1_hash &hash, int times = 1);
 
@@ -710,9 +836,6 @@ namespace blockchain {
 
         bool m_pause = false;
 
-        // chain timers
-        std::map<aux::bytes, aux::deadline_timer> m_chain_timers;
-
 //        std::map<GET_ITEM, GET_INFO> m_get_item_info;
 
         // chain status timers
@@ -721,25 +844,22 @@ namespace blockchain {
         // blockchain db
         std::shared_ptr<repository> m_repository;
 
-        // tx pool
-        std::map<aux::bytes, tx_pool> m_tx_pools;
-
         // note tx wrapper
 //        std::map<aux::bytes, transaction_wrapper> m_current_tx_wrapper;
 
         // chain status
         bool m_stop = false;
 
-        // all chains
-        std::set<aux::bytes> m_chains;
+        // chain contexts, indexed by handle. A removed chain leaves an empty slot
+        std::vector<std::unique_ptr<chain_context>> m_chain_contexts;
 
-        // short chain id table<short chain id, chain id>
-        std::map<aux::bytes, aux::bytes> m_short_chain_id_table;
+        std::vector<chain_handle> m_free_chain_handles;
 
-        // chain connected flag
-        std::map<aux::bytes, bool> m_chain_connected;
+        // chain id <--> handle
+        std::unordered_map<aux::bytes, chain_handle, chain_id_hash> m_chain_handles;
 
-        std::map<aux::bytes, int> m_chain_getting_times;
+        // short chain id table<short chain id, chain handle>
+        std::map<aux::bytes, chain_handle> m_short_chain_id_table;
 
         // all tasks
         std::queue<dht_item> m_tasks;
@@ -747,21 +867,6 @@ namespace blockchain {
         std::int64_t m_last_dht_time{};
 
 //        std::map<aux::bytes, CHAIN_STATUS> m_chain_status;
-
-        // Forwarding list
-        std::map<aux::bytes, std::map<dht::public_key, peer_info>> m_access_list;
-
-        // last get time(chain id <--> (peer <--> (salt <-->last get time)))
-        std::map<aux::bytes, std::map<dht::public_key, std::map<std::string, std::int64_t>>> m_last_get_time;
-
-        // head blocks
-        std::map<aux::bytes, block> m_head_blocks;
-
-        std::map<aux::bytes, std::int64_t> m_all_data_last_put_time;
-
-        std::map<aux::bytes, std::int64_t> m_all_blocks_last_put_time;
-
-        std::map<aux::bytes, std::int64_t> m_all_state_last_put_time;
     };
 }
 }
@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2021, TaiXiang Cui
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef IP2_CHAIN_READER_HPP
+#define IP2_CHAIN_READER_HPP
+
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "ip2/aux_/common.h"
+#include "ip2/aux_/export.hpp"
+#include "ip2/blockchain/account.hpp"
+#include "ip2/blockchain/block.hpp"
+#include "ip2/blockchain/repository_impl.hpp"
+
+namespace ip2::blockchain {
+
+    // max read-only connections kept open
+    constexpr std::size_t chain_reader_max_idle_connections = 4;
+
+    // read-only query path of chain data, used from any thread without going through network thread.
+    // Queries are served by read-only sqlite connections on the same db file (WAL journal allows
+    // readers concurrently with the writer connection), head blocks are published by blockchain as
+    // an immutable snapshot and swapped atomically.
+    class TORRENT_EXPORT chain_reader {
+    public:
+
+        explicit chain_reader(std::string mDbPath) : m_db_path(std::move(mDbPath)) {}
+
+        ~chain_reader();
+
+        chain_reader(chain_reader const&) = delete;
+        chain_reader& operator=(chain_reader const&) = delete;
+
+        // publish head block of chain, called by blockchain on network thread. Only chains that are
+        // followed and connected are published
+        void publish_head_block(const aux::bytes &chain_id, const block &blk);
+
+        void remove_head_block(const aux::bytes &chain_id);
+
+        void clear_head_blocks();
+
+        block get_head_block(const aux::bytes &chain_id) const;
+
+        account get_account(const aux::bytes &chain_id, const dht::public_key &pubKey);
+
+        block get_block_by_number(const aux::bytes &chain_id, std::int64_t block_number);
+
+        block get_block_by_hash(const aux::bytes &chain_id, const sha1_hash &hash);
+
+        // head block first, then its ancestors, empty if chain head is not published (unfollowed or
+        // unconnected chain)
+        std::vector<block> get_top_tip_blocks(const aux::bytes &chain_id, int topNum);
+
+    private:
+
+        using head_blocks = std::map<aux::bytes, block>;
+
+        // take an idle read-only connection, or open a new one
+        sqlite3 *acquire();
+
+        // give back connection, close it if too many idle
+        void release(sqlite3 *db);
+
+        std::shared_ptr<const head_blocks> snapshot() const;
+
+        // db file
+        std::string m_db_path;
+
+        // guard idle connections
+        std::mutex m_mutex;
+
+        // idle read-only connections
+        std::vector<sqlite3*> m_idle_connections;
+
+        // head blocks snapshot, accessed by std::atomic_load/std::atomic_store only
+        std::shared_ptr<const head_blocks> m_head_blocks = std::make_shared<const head_blocks>();
+    };
+}
+
+
+#endif //IP2_CHAIN_READER_HPP
@@ -48,6 +48,28 @@ namespace ip2::blockchain {
     // block time
     constexpr int DEFAULT_BLOCK_TIME = 300;
 
+    // a block travels as one dht item(1000 bytes)
+    constexpr std::size_t MAX_BLOCK_ENCODE_SIZE = 1000;
+
+    // encode size of a version 2 block without txs, with the longest chain id
+    constexpr std::size_t MAX_BLOCK_HEADER_ENCODE_SIZE = 300;
+
+    // encode size of a transfer tx without payload, with the longest chain id
+    constexpr std::size_t TRANSFER_TX_ENCODE_SIZE = 230;
+
+    // max tx number in a version 2 block, as many transfer txs as the block can carry
+    constexpr int MAX_BLOCK_TX_NUM = (MAX_BLOCK_ENCODE_SIZE - MAX_BLOCK_HEADER_ENCODE_SIZE) / TRANSFER_TX_ENCODE_SIZE;
+
+    // max encode size of all txs in a version 2 block, the batch above
+    constexpr std::size_t MAX_BLOCK_TXS_ENCODE_SIZE = MAX_BLOCK_TX_NUM * TRANSFER_TX_ENCODE_SIZE;
+
+    static_assert(MAX_BLOCK_HEADER_ENCODE_SIZE + MAX_BLOCK_TXS_ENCODE_SIZE <= MAX_BLOCK_ENCODE_SIZE
+        , "a version 2 block must fit a dht item");
+
+    // miners produce version 2 blocks from this block number on, older nodes can't decode them,
+    // a version 2 block before it is invalid
+    constexpr int64_t BLOCK_VERSION2_ACTIVATION_HEIGHT = 100000;
+
     constexpr int MIN_VALID_BLOCK_TIME = 60; // 1min
     constexpr int MAX_VALID_BLOCK_TIME = 10 * 60; // 10min
 
@@ -54,6 +54,13 @@ namespace ip2::blockchain {
 
         static std::string acl_db_name(const aux::bytes &chain_id);
 
+        // apply state changes of all txs in block: tx state, fee and bonus to miner,
+        // miner power increases if block has no transfer tx
+        bool apply_block_state(const block &blk);
+
+        // undo state changes made by apply_block_state
+        bool rollback_block_state(const block &blk);
+
         // init db, create chains table
         virtual bool init() = 0;
 
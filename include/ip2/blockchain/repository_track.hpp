@@ -11,10 +11,16 @@ see LICENSE file.
 
 #include <utility>
 #include <map>
+#include <set>
+#include <vector>
 #include "ip2/blockchain/repository.hpp"
 
 namespace ip2::blockchain {
 
+    // repository_track: 在另一个repository之上的内存写缓冲，用于区块验证和切换分支等投机执行。
+    // 账户、状态数组以及区块的写入都缓存在内存中，读取时先查缓存，再回落到底层repository；
+    // commit()在底层repository的一个事务里一次性写入全部缓存，rollback()则直接丢弃缓存，
+    // 底层数据库不会被改动。建表删表、peer和acl以及区块清理不属于区块状态，直接写到底层repository。
     struct repository_track final : repository {
 
         explicit repository_track(repository *mRepository) : m_repository(mRepository) {}
@@ -255,9 +261,39 @@ namespace ip2::blockchain {
 
     private:
 
+        using account_key = std::pair<aux::bytes, dht::public_key>;
+        using hash_key = std::pair<aux::bytes, sha1_hash>;
+
+        // nothing is buffered
+        bool empty() const;
+
+        void clear();
+
+        // a block written or re-flagged in the track, nullptr if the track
+        // doesn't know it
+        const block *find_block(const aux::bytes &chain_id, const sha1_hash &hash) const;
+
+        bool is_discarded(const aux::bytes &chain_id, const sha1_hash &hash) const;
+
+        bool flush();
+
         repository *m_repository;
 
-        std::map<std::string, std::string> m_cache;
+        // chains whose state was cleared, accounts not in m_accounts read as empty
+        std::set<aux::bytes> m_cleared_chains;
+
+        // accounts written in the track
+        std::map<account_key, account> m_accounts;
+
+        // accounts deleted in the track
+        std::set<account_key> m_deleted_accounts;
+
+        std::map<hash_key, state_array> m_state_arrays;
+
+        std::set<hash_key> m_deleted_state_arrays;
+
+        // blocks saved off the main chain, which weren't in the repository
+        std::vector<block> m_saved_blocks;
 
         // main chain connected blocks
         std::vector<block> m_connected_blocks;
@@ -10,12 +10,15 @@ see LICENSE file.
 #define IP2_TX_ENTRY_WITH_FEE_HPP
 
 
+#include <cstdint>
+
 #include <ip2/sha1_hash.hpp>
 
 namespace ip2::blockchain {
     class tx_entry_with_fee {
     public:
-        tx_entry_with_fee(const sha1_hash &mTxid, int64_t mFee) : m_txid(mTxid), m_fee(mFee) {}
+        tx_entry_with_fee(const sha1_hash &mTxid, int64_t mFee, std::uint32_t mHandle = 0) :
+                m_txid(mTxid), m_fee(mFee), m_handle(mHandle) {}
 
         const sha1_hash &txid() const { return m_txid; }
 
@@ -23,6 +26,9 @@ namespace ip2::blockchain {
 
         int64_t fee() const { return m_fee; }
 
+        // handle of tx in pool, not used for ordering
+        std::uint32_t handle() const { return m_handle; }
+
         void set_fee(int64_t mFee) { m_fee = mFee; }
 
         bool operator==(const tx_entry_with_fee &rhs) const {
@@ -58,6 +64,8 @@ namespace ip2::blockchain {
         sha1_hash m_txid;
 
         std::int64_t m_fee;
+
+        std::uint32_t m_handle;
     };
 }
 
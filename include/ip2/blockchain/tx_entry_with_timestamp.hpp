@@ -10,12 +10,15 @@ see LICENSE file.
 #define IP2_TX_ENTRY_WITH_TIMESTAMP_HPP
 
 
+#include <cstdint>
+
 #include <ip2/sha1_hash.hpp>
 
 namespace ip2::blockchain {
     class tx_entry_with_timestamp {
     public:
-        tx_entry_with_timestamp(const sha1_hash &mTxid, int64_t mTimestamp) : m_txid(mTxid), m_timestamp(mTimestamp) {}
+        tx_entry_with_timestamp(const sha1_hash &mTxid, int64_t mTimestamp, std::uint32_t mHandle = 0) :
+                m_txid(mTxid), m_timestamp(mTimestamp), m_handle(mHandle) {}
 
         const sha1_hash &txid() const { return m_txid; }
 
@@ -23,6 +26,9 @@ namespace ip2::blockchain {
 
         int64_t timestamp() const { return m_timestamp; }
 
+        // handle of tx in pool, not used for ordering
+        std::uint32_t handle() const { return m_handle; }
+
         void set_timestamp(int64_t mTimestamp) { m_timestamp = mTimestamp; }
 
         bool operator==(const tx_entry_with_timestamp &rhs) const {
@@ -58,6 +64,8 @@ namespace ip2::blockchain {
         sha1_hash m_txid;
 
         std::int64_t m_timestamp;
+
+        std::uint32_t m_handle;
     };
 }
 
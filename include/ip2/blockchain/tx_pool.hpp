@@ -12,7 +12,9 @@ see LICENSE file.
 
 #include <set>
 #include <map>
+#include <limits>
 #include <queue>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -32,35 +34,65 @@ namespace ip2::blockchain {
 
 //    constexpr int tx_pool_max_active_friends_size = 10;
 
+    // stable handle of a tx in pool arena, valid until the tx is removed from pool
+    using tx_handle = std::uint32_t;
+
+    constexpr tx_handle invalid_tx_handle = std::numeric_limits<tx_handle>::max();
+
+    // tx pool: all txs are stored once in an arena, and indexed by txid, by fee(transfer tx),
+    // by timestamp(note tx) and by sender. Indices refer to txs by handle, so no tx is copied
+    // when pool is queried or re-ordered, and eviction is O(log n).
     class tx_pool {
     public:
 
         tx_pool() = default;
 
-        explicit tx_pool(repository *mRepository) : m_repository(mRepository) {}
+        explicit tx_pool(repository *mRepository, int mMaxSizeByFee = tx_pool_max_size_by_fee,
+                         int mMaxSizeByTimestamp = tx_pool_max_size_by_timestamp)
+                         : m_repository(mRepository), m_max_size_by_fee(mMaxSizeByFee),
+                         m_max_size_by_timestamp(mMaxSizeByTimestamp) {}
+
+        // set capacity of fee pool and time pool, evict txs if over capacity
+        void set_capacity(int max_size_by_fee, int max_size_by_timestamp);
+
+        int max_size_by_fee() const { return m_max_size_by_fee; }
+
+        int max_size_by_timestamp() const { return m_max_size_by_timestamp; }
+
+        // tx number in pool
+        std::size_t size() const { return m_txid_index.size(); }
+
+        // arena slots holding a tx, equal to size() unless a tx is orphaned
+        std::size_t arena_size() const { return m_arena.size() - m_free_slots.size(); }
+
+        // @return handle of tx, invalid_tx_handle if not in pool
+        tx_handle find(const sha1_hash &txid) const;
+
+        // @param handle must be valid
+        const transaction &get(tx_handle handle) const { return m_arena[handle]; }
 
         transaction get_best_fee_transaction() const;
 
         transaction get_latest_note_transaction() const;
 
+        // select txs to be packed into a block, transfer txs ordered by fee first, then the latest note txs,
+        // bounded by tx number and total encode size
+        std::vector<transaction> get_block_transactions(std::size_t max_num, std::size_t max_encode_size) const;
+
         aux::bytes get_hash_prefix_array_by_fee() const;
 
-        std::vector<transaction> get_top_ten_fee_transactions();
+        std::vector<transaction> get_top_ten_fee_transactions() const;
 
         aux::bytes get_hash_prefix_array_by_timestamp() const;
 
-        std::vector<transaction> get_top_ten_timestamp_transactions();
+        std::vector<transaction> get_top_ten_timestamp_transactions() const;
 
-        std::set<sha1_hash> get_top_40_note_txid();
+        std::set<sha1_hash> get_top_40_note_txid() const;
 
-        std::set<sha1_hash> get_all_note_txid();
+        std::set<sha1_hash> get_all_note_txid() const;
 
         bool add_tx(const transaction& tx);
 
-//        bool rollback_block(const block& blk);
-
-//        bool connect_block(const block& blk);
-
         void delete_tx_from_time_pool(const transaction& tx);
 
         transaction get_transaction_by_account(const dht::public_key& pubKey) const;
@@ -75,9 +107,9 @@ namespace ip2::blockchain {
 
         bool is_transaction_in_pool(const sha1_hash &txid) const;
 
-        std::int64_t get_min_allowed_fee();
+        std::int64_t get_min_allowed_fee() const;
 
-        std::int64_t get_oldest_allowed_timestamp();
+        std::int64_t get_oldest_allowed_timestamp() const;
 
         void clear();
 
@@ -85,7 +117,7 @@ namespace ip2::blockchain {
 
         void recheck_all_transactions();
 
-        std::set<transaction> get_all_transactions();
+        std::set<transaction> get_all_transactions() const;
 
         bool add_tx_to_fee_pool(const transaction& tx);
 
@@ -93,6 +125,12 @@ namespace ip2::blockchain {
 
     private:
 
+        // store tx in arena, and index it by txid
+        tx_handle insert(const transaction& tx);
+
+        // remove tx from all indices and release its slot
+        void erase(tx_handle handle);
+
         void remove_min_fee_tx();
 
         void remove_oldest_tx();
@@ -100,23 +138,31 @@ namespace ip2::blockchain {
         // blockchain db
         repository* m_repository{};
 
-        // tx set
-        std::map<sha1_hash, transaction> m_all_txs_by_fee;
+        // capacity
+        int m_max_size_by_fee = tx_pool_max_size_by_fee;
+
+        int m_max_size_by_timestamp = tx_pool_max_size_by_timestamp;
+
+        // tx arena, slot of removed tx is reused
+        std::vector<transaction> m_arena;
+
+        // free slots in arena
+        std::vector<tx_handle> m_free_slots;
 
-        // ordered by fee
-        std::set<tx_entry_with_fee> m_ordered_txs_by_fee;
+        // txid -> handle
+        std::unordered_map<sha1_hash, tx_handle> m_txid_index;
 
-        // one account one tx
-        std::map<dht::public_key, sha1_hash> m_account_tx_by_fee;
+        // transfer txs ordered by fee
+        std::set<tx_entry_with_fee> m_fee_index;
 
-        // tx set
-        std::map<sha1_hash, transaction> m_all_txs_by_timestamp;
+        // one account one transfer tx
+        std::map<dht::public_key, tx_handle> m_account_fee_index;
 
-        // ordered by timestamp
-        std::set<tx_entry_with_timestamp> m_ordered_txs_by_timestamp;
+        // note txs ordered by timestamp
+        std::set<tx_entry_with_timestamp> m_timestamp_index;
 
-        // account tx
-        std::map<dht::public_key, std::set<sha1_hash>> m_account_tx_by_timestamp;
+        // note txs of an account ordered by timestamp
+        std::map<dht::public_key, std::set<tx_entry_with_timestamp>> m_account_timestamp_index;
     };
 }
 
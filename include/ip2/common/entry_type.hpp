@@ -47,6 +47,7 @@ namespace ip2::common {
         COMMUNICATION_PUT_DONE, // 9
         COMMUNICATION_CONFIRMATION, // 10
         COMMUNICATION_ATTENTION, // 11
+        COMMUNICATION_BATCH, // 12, the sender accepts batched relay payloads
     };
 
     struct TORRENT_EXPORT signal_entry {
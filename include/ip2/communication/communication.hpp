@@ -22,6 +22,7 @@ see LICENSE file.
 #include <list>
 #include <queue>
 #include <unordered_set>
+#include <set>
 
 #include "ip2/time.hpp"
 #include "ip2/aux_/deadline_timer.hpp"
@@ -66,6 +67,14 @@ namespace ip2 {
         // max message list size(used in Levenshtein Distance)
         constexpr int communication_max_message_list_size = 10;
 
+        // signals and small messages to the same peer within this window (ms)
+        // are coalesced into one relay payload
+        constexpr int communication_batch_window = 100;
+
+        // messages whose wrapper encodes to at most this many bytes are also
+        // carried inline in the relay payload, next to their signal
+        constexpr int communication_max_inline_message_size = 400;
+
         // max entry cache time(ms)
 //        constexpr int communication_max_entry_cache_time = 2 * 60 * 60 * 1000;
 
@@ -93,7 +102,7 @@ namespace ip2 {
         public:
 
             communication(aux::bytes device_id, aux::session_interface &mSes, io_context &mIoc, counters &mCounters) :
-                    m_device_id(std::move(device_id)), m_ioc(mIoc), m_ses(mSes), m_counters(mCounters)/*, m_refresh_timer(mIoc)*/ {
+                    m_device_id(std::move(device_id)), m_ioc(mIoc), m_ses(mSes), m_counters(mCounters), m_batch_timer(mIoc)/*, m_refresh_timer(mIoc)*/ {
                 m_message_db = std::make_shared<message_db_impl>(m_ses.sqldb());
             }
 
@@ -165,6 +174,21 @@ namespace ip2 {
             // send data to peer
             void send_to(const dht::public_key &peer, entry const& data);
 
+            // queue a signal or an inline message for the next batch to peer
+            void send_batched(const dht::public_key &peer, entry data);
+
+            void on_batch_timeout(error_code const& e);
+
+            // send all queued payloads, each peer's packed into as few relay
+            // payloads of up to relay_msg_mtu bytes as possible. Peers not
+            // known to accept batches get their signals one by one, as
+            // before, and no inline messages
+            void flush_batches();
+
+            void on_signal(dht::public_key const& peer, entry const& payload);
+
+            void on_message_wrapper(dht::public_key const& peer, const message_wrapper &messageWrapper, int times = 1);
+
             // send new message signal
             void send_new_message_signal(const dht::public_key &peer, const sha1_hash &hash);
 
@@ -284,6 +308,20 @@ namespace ip2 {
 
             std::map<dht::public_key, std::int64_t> m_all_messages_last_put_time;
 
+            // outbound payloads waiting for the batch timer, per peer
+            std::map<dht::public_key, std::vector<entry>> m_outbound_batches;
+
+            aux::deadline_timer m_batch_timer;
+
+            bool m_batch_timer_armed = false;
+
+            // peers that sent us a batch or a COMMUNICATION_BATCH signal, and
+            // so parse list payloads. Older versions drop those whole
+            std::set<dht::public_key> m_batch_peers;
+
+            // peers we've sent COMMUNICATION_BATCH to in this session
+            std::set<dht::public_key> m_batch_announced;
+
             // message wrapper
 //            std::map<dht::public_key, message_wrapper> m_message_wrapper;
 
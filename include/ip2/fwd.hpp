@@ -53,6 +53,7 @@ struct session_error_alert;
 struct dht_live_nodes_alert;
 struct session_stats_header_alert;
 struct dht_sample_infohashes_alert;
+struct dht_get_items_alert;
 struct alerts_dropped_alert;
 struct socks5_alert;
 struct communication_new_device_id_alert;
@@ -20,13 +20,13 @@ see LICENSE file.
 #include <ip2/kademlia/node_entry.hpp>
 #include <ip2/kademlia/relay.hpp>
 
+#include <ip2/entry.hpp>
 #include <ip2/socket.hpp>
 #include <ip2/address.hpp>
 #include <ip2/span.hpp>
 #include <ip2/string_view.hpp>
 
 namespace ip2 {
-	struct entry;
 	struct settings_interface;
 }
 
@@ -120,6 +120,26 @@ namespace dht {
 		virtual bool get_mutable_item_target(sha256_hash const& prefix
 			, sha256_hash& target) const = 0;
 
+		// This function retrieves the mutable items whose targets start with
+		// the first ``prefix_len`` bytes of ``prefix``, in target order. If
+		// ``after`` isn't null, the scan starts after that target. Each item
+		// is appended to ``items`` as a dictionary with the keys ``k``,
+		// ``salt``, ``ts``, ``v`` and ``sig``, until their bencoded size
+		// would exceed ``max_bytes``. At least one item is returned if any
+		// match.
+		//
+		// returns true if there are more matching items than were returned.
+		//
+		// For implementers:
+		// The default implementation doesn't find anything.
+		//
+		virtual bool get_mutable_items(sha256_hash const& /*prefix*/
+			, int /*prefix_len*/
+			, sha256_hash const* /*after*/
+			, int /*max_bytes*/
+			, entry::list_type& /*items*/) const
+		{ return false; }
+
 		// Store the item's data. This layer is only for storage.
 		// The authentication of the item is performed by the upper layer.
 		//
@@ -138,6 +158,38 @@ namespace dht {
 
 		virtual void remove_mutable_item(sha256_hash const& target) = 0;
 
+		// Store a blob's root index published by this node into the local
+		// content store. Unlike put_mutable_item(), these items are kept apart
+		// from the ones stored for others, so the publisher can keep serving
+		// and republishing them after the storing nodes have evicted them.
+		// When the store is full, the item put least recently is dropped.
+		//
+		// For implementers:
+		// The default implementation doesn't keep anything.
+		//
+		virtual void put_origin_item(sha256_hash const& /*target*/
+			, span<char const> /*buf*/
+			, signature const& /*sig*/
+			, timestamp /*ts*/
+			, public_key const& /*pk*/
+			, span<char const> /*salt*/)
+		{}
+
+		// Store a blob segment published by this node into the local content
+		// store, under its segment_target_id().
+		virtual void put_origin_item(sha256_hash const& /*target*/
+			, span<char const> /*buf*/)
+		{}
+
+		// Get an item from the local content store. For a root index the
+		// whole item (``k``, ``salt``, ``ts``, ``v``, ``sig``) is filled in,
+		// for a segment only ``v``.
+		//
+		// returns true if the item is found.
+		virtual bool get_origin_item(sha256_hash const& /*target*/
+			, entry& /*item*/) const
+		{ return false; }
+
 		// Store relay endpoints.
 		virtual void relay_referred(node_id const& peer
 			, node_entry const& ne) = 0;
@@ -19,6 +19,7 @@ see LICENSE file.
 #include <ip2/kademlia/node.hpp>
 #include <ip2/kademlia/node_entry.hpp>
 #include <ip2/kademlia/dos_blocker.hpp>
+#include <ip2/kademlia/egress_shaper.hpp>
 #include <ip2/kademlia/dht_state.hpp>
 #include <ip2/kademlia/bs_nodes_storage.hpp>
 #include <ip2/kademlia/bs_nodes_manager.hpp>
@@ -100,6 +101,13 @@ namespace ip2::dht {
 
 		dht_state state() const;
 
+		// keep the current routing table (or the last non-empty one) so that
+		// the next start() re-validates the nodes with a burst of pings and
+		// bootstraps from them, along with the routers and bootstrap nodes
+		// in case they've all gone. used when sockets are reopened on
+		// network change.
+		void save_routing_table();
+
 		void get_item(sha256_hash const& target
 			, std::function<void(item const&)> cb);
 
@@ -124,6 +132,15 @@ namespace ip2::dht {
 			, std::string salt = std::string()
 			, std::int64_t timestamp = -1);
 
+		// gets the mutable items whose targets start with the first
+		// prefix_len bytes of prefix, with targets greater than after if
+		// it's not null. Every item is passed to cb once, an empty item
+		// with authoritative set marks the end. The last argument is set
+		// then if any node had more items than it returned
+		void get_items(sha256_hash const& prefix, int prefix_len
+			, std::function<void(item const&, bool, bool)> cb
+			, sha256_hash const* after = nullptr);
+
 		// for immutable_item.
 		// the callback function will be called when put operation is done.
 		// the int parameter indicates the success numbers of put operation.
@@ -197,6 +214,44 @@ namespace ip2::dht {
 			, std::int8_t invoke_limit
 			, std::string salt = std::string());
 
+		// blob root index, a mutable item of this node. It's also kept in
+		// local storage, so we can serve it when the storing nodes lost it.
+		void put_index(entry const& data
+			, std::function<void(item const&, int)> cb
+			, std::int8_t alpha
+			, std::int8_t beta
+			, std::int8_t invoke_limit
+			, std::string salt);
+
+		// get a root index from the node that published it, the origin, for
+		// when the storing nodes lost it.
+		void get_item_from_origin(public_key const& key
+			, std::function<void(item const&, bool)> cb
+			, std::string salt
+			, std::int64_t timestamp);
+
+		// blob segment, an immutable item named by the SHA-1 of its value.
+		// the callback is called once, authoritative, with the segment
+		// or an empty item.
+		void get_segment(sha1_hash const& seg_hash
+			, std::function<void(item const&, bool)> cb
+			, std::int8_t alpha
+			, std::int8_t invoke_window
+			, std::int8_t invoke_limit);
+
+		// get blob segment from the node that published it.
+		void get_segment_from_origin(public_key const& origin
+			, sha1_hash const& seg_hash
+			, std::function<void(item const&, bool)> cb);
+
+		// put blob segment, data must be a string. it's also kept in
+		// local storage, so we can serve it ourselves.
+		void put_segment(entry const& data
+			, std::function<void(item const&, int)> cb
+			, std::int8_t alpha
+			, std::int8_t invoke_window
+			, std::int8_t invoke_limit);
+
 		// relay protocol
 		void send(public_key const& to
 			, entry const& payload
@@ -226,6 +281,7 @@ namespace ip2::dht {
 
 		// store mutable item into local storage
 		void store_mutable_item(item const& it);
+		void store_origin_item(item const& it);
 
 		// get immutable item from local dht storage.
 		// returns true if the item is found.
@@ -275,12 +331,22 @@ namespace ip2::dht {
 		void refresh_timeout(error_code const& e);
 		void refresh_key(error_code const& e);
 		void update_storage_node_ids();
+
+		// the nodes of all the routing tables
+		std::vector<node_entry> routing_table_nodes() const;
 		node* get_node(node_id const& id, string_view family_name);
 
 		// implements socket_manager
 		bool has_quota() override;
 		bool send_packet(aux::listen_socket_handle const& s, entry& e
-			, udp::endpoint const& addr, sha256_hash const& pk) override;
+			, udp::endpoint const& addr, sha256_hash const& pk
+			, egress_class tc) override;
+
+		bool send_buffer(aux::listen_socket_handle const& s
+			, udp::endpoint const& addr, sha256_hash const& pk
+			, span<char const> buf, aux::udp_send_flags_t flags);
+		void update_shaper_rate();
+		void drain_shaper(error_code const& e);
 
 		// this is the bdecode_node DHT messages are parsed into. It's a member
 		// in order to avoid having to deallocate and re-allocate it for every
@@ -290,6 +356,12 @@ namespace ip2::dht {
 		counters& m_counters;
 		dht_storage_interface& m_storage;
 		dht_state m_state; // to be used only once
+
+		// routing table nodes from when the tables last started losing
+		// live nodes, used for recovering after network change
+		std::vector<node_entry> m_last_good_nodes;
+		// the number of live nodes at the last refresh
+		int m_live_nodes = 0;
 		tracker_nodes_t m_nodes;
 		send_fun_t m_send_fun;
 		dht_observer* m_log;
@@ -306,9 +378,11 @@ namespace ip2::dht {
 		// used to resolve hostnames for nodes
 		udp::resolver m_host_resolver;
 
-		// state for the send rate limit
-		int m_send_quota;
-		time_point m_last_tick;
+		// paces outgoing packets to dht_upload_rate_limit, when
+		// dht_egress_shaping is set
+		egress_shaper m_shaper;
+		aux::deadline_timer m_shaper_timer;
+		bool m_shaper_timer_armed = false;
 
 		io_context& m_ioc;
 
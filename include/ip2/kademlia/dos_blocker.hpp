@@ -15,14 +15,40 @@ see LICENSE file.
 #include "ip2/time.hpp"
 #include "ip2/address.hpp"
 #include "ip2/assert.hpp"
+#include "ip2/aux_/array.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
 
 namespace ip2 {
 namespace dht {
 
 	struct dht_logger;
 
+	// the kinds of incoming DHT traffic, each has its own budget per source
+	enum class dos_class : std::uint8_t
+	{
+		// queries and responses
+		query,
+
+		// relays, "y":"h" messages. A node relaying for many others is
+		// expected to send a lot of these
+		relay,
+
+		num_classes
+	};
+
 	// this is a class that maintains a list of abusive DHT nodes,
 	// blocking their access to our DHT node.
+	//
+	// the packets of every source are counted in a count-min sketch, one per
+	// traffic class, over a sliding window of 10 seconds. That's fixed memory
+	// and constant time per packet, however many sources there are. Hash
+	// collisions can only make a source look busier than it is, the sketch
+	// is wide enough for that to take tens of thousands of sources. A source
+	// going over the limit is blocked for the block timeout.
 	struct TORRENT_EXTRA_EXPORT dos_blocker
 	{
 		dos_blocker();
@@ -30,11 +56,26 @@ namespace dht {
 		// called every time we receive an incoming packet. Returns
 		// true if we should let the packet through, and false if
 		// it's blocked
-		bool incoming(address const& addr, time_point now, dht_logger* logger);
+		bool incoming(address const& addr, time_point now, dht_logger* logger)
+		{
+			return incoming(addr, dos_class::query, now, logger);
+		}
+
+		bool incoming(address const& addr, dos_class c, time_point now
+			, dht_logger* logger);
+
+		// whether the source is blocked for the class. Doesn't count the
+		// packet, it's for dropping packets before they're decoded
+		bool is_blocked(address const& addr, dos_class c, time_point now) const;
 
 		void set_rate_limit(int l)
 		{
-			m_message_rate_limit = std::max(1, l);
+			m_classes[int(dos_class::query)].rate_limit = std::max(1, l);
+		}
+
+		void set_relay_rate_limit(int l)
+		{
+			m_classes[int(dos_class::relay)].rate_limit = std::max(1, l);
 		}
 
 		void set_block_timer(int t)
@@ -42,28 +83,50 @@ namespace dht {
 			m_block_timeout = std::max(1, t);
 		}
 
+		// the number of sources currently blocked, for any class
+		int num_blocked() const;
+
 	private:
 
-		// used to ignore abusive dht nodes
-		struct node_ban_entry
+		static constexpr int num_classes = int(dos_class::num_classes);
+
+		// the sketch has sketch_rows rows of sketch_width counters each. A
+		// source maps to one counter per row, its count is the smallest of
+		// them
+		static constexpr int sketch_rows = 4;
+		static constexpr int sketch_width = 4096;
+
+		// blocked sources kept track of, per class. When the table is full, a
+		// source over the limit is still dropped, it's just not held off for
+		// the block timeout
+		static constexpr int max_blocked = 4096;
+
+		struct counters
 		{
-			node_ban_entry(): count(0) {}
-			address src;
-			time_point limit;
-			int count;
+			// the counts of the current window, and the one before it
+			std::vector<std::uint16_t> current;
+			std::vector<std::uint16_t> previous;
+			time_point window_start;
+
+			// the max number of packets per second from a source
+			int rate_limit;
+
+			// hash of the source -> when it's let through again
+			std::map<std::uint64_t, time_point> blocked;
+			time_point last_purge;
 		};
 
-		static constexpr int num_ban_nodes = 20;
+		std::uint64_t hash(address const& addr) const;
+		void advance(counters& c, time_point now) const;
 
-		// the max number of packets we can receive per second from a node before
-		// we block it.
-		int m_message_rate_limit;
+		aux::array<counters, num_classes> m_classes;
 
 		// the number of seconds a node gets blocked for when it exceeds the rate
 		// limit
 		int m_block_timeout;
 
-		node_ban_entry m_ban_nodes[num_ban_nodes];
+		// makes the counters a source maps to unpredictable to it
+		std::uint64_t m_seed;
 	};
 }
 }
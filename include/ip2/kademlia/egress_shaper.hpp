@@ -0,0 +1,106 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef TORRENT_DHT_EGRESS_SHAPER
+#define TORRENT_DHT_EGRESS_SHAPER
+
+#include "ip2/config.hpp"
+#include "ip2/time.hpp"
+#include "ip2/aux_/array.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace ip2 {
+namespace dht {
+
+	// the kinds of outgoing DHT packets, in strict priority order
+	enum class egress_class : std::uint8_t
+	{
+		// our own lookups. Latency critical, never held back
+		request,
+
+		// replies to incoming queries. Never held back either
+		response,
+
+		// our own puts and relays. A traversal sends these in bursts
+		bulk,
+
+		// items and relay entries pushed to the nodes they're addressed to
+		push,
+
+		// relays forwarded on behalf of other nodes
+		relay_forward,
+
+		num_classes
+	};
+
+	// a token bucket shared by all outgoing DHT traffic. requests and
+	// responses are always sent right away, they only use up tokens. The
+	// other classes are sent while there are tokens left and are otherwise
+	// queued, per class, and sent later, highest priority first. A class only
+	// gets to send when all classes before it have nothing queued.
+	struct TORRENT_EXTRA_EXPORT egress_shaper
+	{
+		using send_fun = std::function<void()>;
+
+		enum class admission : std::uint8_t { send_now, queue, drop };
+
+		explicit egress_shaper(time_point now);
+
+		// bytes per second. 0 means no limit, everything is sent right away
+		void set_rate(int rate);
+		int rate() const { return m_rate; }
+
+		// whether there are tokens left
+		bool has_quota(time_point now);
+
+		// decides what to do with a packet of the given size. send_now takes
+		// the tokens for it, queue means it's to be passed to enqueue()
+		admission admit(egress_class tc, int bytes, time_point now);
+
+		void enqueue(egress_class tc, int bytes, send_fun f);
+
+		// sends the queued packets the tokens allow. Returns how long until
+		// it should be called again, or a zero duration if nothing is queued
+		time_duration drain(time_point now);
+
+		int queued_bytes(egress_class tc) const;
+		void clear();
+
+	private:
+
+		void refill(time_point now);
+
+		struct packet
+		{
+			int bytes;
+			send_fun send;
+		};
+
+		struct class_queue
+		{
+			std::deque<packet> packets;
+			int bytes = 0;
+		};
+
+		static constexpr int num_classes = int(egress_class::num_classes);
+
+		aux::array<class_queue, num_classes> m_queues;
+
+		// may go negative, since requests and responses are never held back
+		std::int64_t m_tokens = 0;
+		time_point m_last_refill;
+		int m_rate = 0;
+	};
+}
+}
+
+#endif
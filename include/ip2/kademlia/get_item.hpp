@@ -16,6 +16,7 @@ see LICENSE file.
 #include <ip2/kademlia/find_data.hpp>
 #include <ip2/kademlia/item.hpp>
 
+#include <map>
 #include <memory>
 
 namespace ip2 {
@@ -31,11 +32,19 @@ public:
 
 	using data_callback = std::function<void(item const&, bool)>;
 
+	// for prefix gets. The last argument is set at the end, when a node
+	// said it has more items than fit in its response
+	using items_callback = std::function<void(item const&, bool, bool)>;
+
 	void got_data(bdecode_node const& v,
 		public_key const& pk,
 		timestamp ts,
 		signature const& sig);
 
+	// the items list of a prefix get response. more is the response's
+	// "more" flag
+	void got_items(bdecode_node const& items, bool more);
+
 	// for immutable items
 	get_item(node& dht_node
 		, node_id const& target
@@ -49,6 +58,18 @@ public:
 		, data_callback dcallback
 		, nodes_callback ncallback);
 
+	// for all the mutable items whose targets start with the first
+	// prefix_len bytes of prefix. Every verified item is passed to the
+	// callback once, as not authoritative, an empty item marks the end.
+	// If after isn't null, only items with greater targets are asked for,
+	// to page through more items than the nodes return at once
+	get_item(node& dht_node
+		, sha256_hash const& prefix
+		, int prefix_len
+		, sha256_hash const* after
+		, items_callback icallback
+		, nodes_callback ncallback);
+
 	char const* name() const override;
 
 	virtual void start();
@@ -57,6 +78,9 @@ public:
 
 	void set_timestamp(std::int64_t timestamp) { m_timestamp = timestamp; }
 
+	// the target is a segment_target_id(), the value is checked against it
+	void set_segment(bool segment) { m_segment = segment; }
+
 protected:
 	observer_ptr new_observer(udp::endpoint const& ep
 		, node_id const& id) override;
@@ -70,6 +94,19 @@ protected:
 
 	std::int64_t m_timestamp = -1;
 	int m_got_items_count = 0;
+	bool m_segment = false;
+
+	// for prefix gets, the number of target bytes to match. 0 otherwise
+	int m_prefix_len = 0;
+	sha256_hash m_after;
+	bool m_has_after = false;
+	items_callback m_items_callback;
+
+	// whether any node had more items than it returned
+	bool m_more = false;
+
+	// the latest timestamp passed to the callback, by target
+	std::map<sha256_hash, timestamp> m_prefix_items;
 };
 
 class get_item_observer : public find_data_observer
@@ -30,6 +30,13 @@ TORRENT_EXTRA_EXPORT sha256_hash item_target_id(span<char const> salt
 
 TORRENT_EXTRA_EXPORT sha256_hash item_target_id(public_key const& pk);
 
+// calculate the target hash for a blob segment: the SHA-1 of the segment
+// value in the first 160 bits, zeros in the rest. Segments are named by
+// their content, so they need no signature.
+TORRENT_EXTRA_EXPORT sha256_hash segment_target_id(sha1_hash const& h);
+
+TORRENT_EXTRA_EXPORT sha256_hash segment_target_id(span<char const> v);
+
 TORRENT_EXTRA_EXPORT bool verify_mutable_item(
 	span<char const> v
 	, span<char const> salt
@@ -0,0 +1,149 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef TORRENT_DHT_ITEM_LOG_HPP
+#define TORRENT_DHT_ITEM_LOG_HPP
+
+#include <ip2/config.hpp>
+#include <ip2/error_code.hpp>
+#include <ip2/span.hpp>
+#include <ip2/kademlia/types.hpp>
+#include <ip2/sha1_hash.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ip2 {
+namespace dht {
+
+	// an append-only file of the items a storage node keeps, so that it can
+	// serve them again right after a restart. Items are verified before
+	// they're stored, the log is trusted as it is: on open, the file is
+	// mapped and only the record headers are read, to index each item's
+	// latest record. Values are read out of the mapping when they're looked
+	// up, and their checksum is checked then. A record that fails it is
+	// treated as missing, the ones after it are still read. A torn record
+	// at the end (from a crash) is cut off.
+	//
+	// a record is:
+	//   uint32 body length, uint32 crc32 of the body, then the body:
+	//   uint8 kind, 32 bytes target, and for mutable items int64 ts,
+	//   32 bytes public key, 64 bytes signature, uint16 salt length and
+	//   the salt. The rest is the bencoded value. A removed record is just
+	//   the kind and the target.
+	struct TORRENT_EXTRA_EXPORT item_log
+	{
+		enum class kind : std::uint8_t { immutable_item, mutable_item, removed };
+
+		struct record
+		{
+			kind type = kind::immutable_item;
+			sha256_hash target;
+			timestamp ts{};
+			public_key pk{};
+			signature sig{};
+			span<char const> salt;
+			span<char const> value;
+		};
+
+		item_log() = default;
+		~item_log();
+		item_log(item_log const&) = delete;
+		item_log& operator=(item_log const&) = delete;
+
+		// opens the log at path, creating it if it doesn't exist
+		void open(std::string const& path, error_code& ec);
+		void close();
+		bool is_open() const { return m_file != nullptr; }
+
+		// the latest record of target in the file as it was opened, if its
+		// checksum matches. The spans point into the mapping and stay valid
+		// until the log is closed or compacted
+		bool find(sha256_hash const& target, record& r) const;
+
+		// the indexed targets starting with the first prefix_len bytes of
+		// prefix
+		void targets_with_prefix(sha256_hash const& prefix, int prefix_len
+			, std::vector<sha256_hash>& out) const;
+
+		// drops target from the index, once the storage keeps it in memory
+		// or has removed it
+		void forget(sha256_hash const& target);
+
+		int num_indexed() const { return int(m_index.size()); }
+
+		void append_immutable(sha256_hash const& target, span<char const> value);
+		void append_mutable(sha256_hash const& target, span<char const> value
+			, signature const& sig, timestamp ts, public_key const& pk
+			, span<char const> salt);
+		void append_removed(sha256_hash const& target);
+
+		// bytes a compaction would drop: the superseded and removed records
+		// in the file when it was opened, and everything appended since
+		std::int64_t stale_bytes() const { return m_stale; }
+
+		// starts rewriting the log with only the live records, next to it,
+		// a few at a time. Until it's done, removals appended to this log
+		// are appended to the new one as well
+		void start_compact(error_code& ec);
+
+		// copies the indexed records keep_indexed wants to the new log,
+		// reading up to max_bytes of records per call. Once all are copied,
+		// write_live appends the items the storage keeps in memory, the new
+		// log replaces this one and is opened, with everything in the index,
+		// and true is returned
+		bool compact_step(std::function<bool(record const&)> const& keep_indexed
+			, std::function<void(item_log&)> const& write_live
+			, std::int64_t max_bytes, error_code& ec);
+
+		bool is_compacting() const { return m_compact != nullptr; }
+
+		// drops a compaction in progress, this log is left as it is
+		void abort_compact();
+
+		// a whole compaction at once
+		void compact(std::function<bool(record const&)> const& keep_indexed
+			, std::function<void(item_log&)> const& write_live, error_code& ec);
+
+	private:
+
+		void map_file(error_code& ec);
+		void unmap_file();
+		void append(std::vector<char> const& body);
+		bool parse(std::int64_t offset, record& r) const;
+
+		std::string m_path;
+		std::FILE* m_file = nullptr;
+
+		// the contents of the file when it was opened
+		char const* m_data = nullptr;
+		std::int64_t m_size = 0;
+#if !TORRENT_HAVE_MMAP || defined TORRENT_WINDOWS
+		std::vector<char> m_buffer;
+#endif
+
+		// target -> offset of its latest record in the mapping
+		std::map<sha256_hash, std::int64_t> m_index;
+
+		std::int64_t m_stale = 0;
+
+		// the log being written by a compaction, and the first target
+		// still to be copied to it
+		std::unique_ptr<item_log> m_compact;
+		sha256_hash m_compact_next;
+	};
+}
+}
+
+#endif // TORRENT_DHT_ITEM_LOG_HPP
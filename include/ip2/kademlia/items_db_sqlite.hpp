@@ -34,6 +34,11 @@ namespace dht {
 	static const std::string select_item_by_target =
 		"SELECT * FROM mutable_items WHERE target=?";
 
+	// the items from a target on, for prefix scans. The primary key index
+	// keeps them in target order
+	static const std::string select_items_from_target =
+		"SELECT target, item FROM mutable_items WHERE target>=? ORDER BY target;";
+
 	static const std::string insert_or_replace_items =
 		"INSERT OR REPLACE INTO mutable_items (target, ts, item) VALUES (?, ?, ?);";
 
@@ -56,6 +61,53 @@ namespace dht {
 	static const std::string select_ts_threshold =
 		"SELECT ts FROM mutable_items ORDER BY ts ASC LIMIT ?, 1;";
 
+	// blob segments and root indices published by this node, kept apart
+	// from the items stored for others so that they survive the trimming of
+	// those. ts is the last time the item was put, the least recently put
+	// ones are trimmed first
+	static const std::string create_origin_items_table =
+		"CREATE TABLE IF NOT EXISTS origin_items ("
+			 "target VARCHAR(32) NOT NULL PRIMARY KEY,"
+			 "ts INT,"
+			 "item VARCHAR(2000) NOT NULL);";
+
+	static const std::string create_origin_ts_index =
+		"CREATE INDEX IF NOT EXISTS index_origin_ts ON origin_items (ts);";
+
+	static const std::string select_origin_item_by_target =
+		"SELECT * FROM origin_items WHERE target=?";
+
+	static const std::string insert_or_replace_origin_items =
+		"INSERT OR REPLACE INTO origin_items (target, ts, item) VALUES (?, ?, ?);";
+
+	static const std::string delete_origin_items =
+		"DELETE FROM origin_items WHERE target IN "
+			 "(SELECT target FROM origin_items ORDER BY ts DESC LIMIT -1 OFFSET ?);";
+
+	// the max number of origin items kept in the database
+	constexpr int origin_items_max_count = 100000;
+
+	// immutable items are named by their content, ts is the last time
+	// the item was put and is only used for trimming
+	static const std::string create_immutable_items_table =
+		"CREATE TABLE IF NOT EXISTS immutable_items ("
+			 "target VARCHAR(32) NOT NULL PRIMARY KEY,"
+			 "ts INT,"
+			 "item VARCHAR(2000) NOT NULL);";
+
+	static const std::string select_immutable_item_by_target =
+		"SELECT item FROM immutable_items WHERE target=?";
+
+	static const std::string insert_or_replace_immutable_items =
+		"INSERT OR REPLACE INTO immutable_items (target, ts, item) VALUES (?, ?, ?);";
+
+	static const std::string delete_immutable_items =
+		"DELETE FROM immutable_items WHERE target IN "
+			 "(SELECT target FROM immutable_items ORDER BY ts DESC LIMIT -1 OFFSET ?);";
+
+	// the max number of immutable items kept in the database
+	constexpr int immutable_items_max_count = 100000;
+
 	struct TORRENT_EXPORT items_db_sqlite : public dht_storage_interface
 	{
 		explicit items_db_sqlite(settings_interface const& settings
@@ -71,11 +123,11 @@ namespace dht {
 		void set_backend(std::shared_ptr<dht_storage_interface> backend) override {}
 
 		bool get_immutable_item(sha256_hash const& target
-			, entry& item) const override {}
+			, entry& item) const override;
 
 		void put_immutable_item(sha256_hash const& target
 			, span<char const> buf
-			, address const& addr) override {};
+			, address const& addr) override;
 
 		virtual bool get_mutable_item_timestamp(sha256_hash const& target
 			, timestamp& ts) const override;
@@ -88,6 +140,12 @@ namespace dht {
 		virtual bool get_mutable_item_target(sha256_hash const& prefix
 			, sha256_hash& target) const override;
 
+		bool get_mutable_items(sha256_hash const& prefix
+			, int prefix_len
+			, sha256_hash const* after
+			, int max_bytes
+			, entry::list_type& items) const override;
+
 		virtual void put_mutable_item(sha256_hash const& target
 			, span<char const> buf
 			, signature const& sig
@@ -98,6 +156,19 @@ namespace dht {
 
 		virtual void remove_mutable_item(sha256_hash const& target) override;
 
+		void put_origin_item(sha256_hash const& target
+			, span<char const> buf
+			, signature const& sig
+			, timestamp ts
+			, public_key const& pk
+			, span<char const> salt) override;
+
+		void put_origin_item(sha256_hash const& target
+			, span<char const> buf) override;
+
+		bool get_origin_item(sha256_hash const& target
+			, entry& item) const override;
+
 		void relay_referred(node_id const& peer
 			, node_entry const& ne) override {};
 
@@ -130,6 +201,9 @@ namespace dht {
 
 		void init();
 		void prepare_statements();
+		void put_origin_entry(sha256_hash const& target, entry const& e);
+		void trim_origin_items();
+		void trim_immutable_items();
 
 		void sql_error(int err_code, const char* err_str) const;
 		void sql_log(int code, const char* msg) const;
@@ -141,10 +215,17 @@ namespace dht {
 		// sql statements
 		sqlite3_stmt* m_select_ts_by_target_stmt = NULL;
 		sqlite3_stmt* m_select_item_by_target_stmt = NULL;
+		sqlite3_stmt* m_select_items_from_target_stmt = NULL;
 		sqlite3_stmt* m_insert_or_replace_items_stmt = NULL;
 		sqlite3_stmt* m_items_count_stmt = NULL;
 		sqlite3_stmt* m_delete_items_stmt = NULL;
 		sqlite3_stmt* m_select_ts_threshold_stmt = NULL;
+		sqlite3_stmt* m_select_origin_item_by_target_stmt = NULL;
+		sqlite3_stmt* m_insert_or_replace_origin_items_stmt = NULL;
+		sqlite3_stmt* m_delete_origin_items_stmt = NULL;
+		sqlite3_stmt* m_select_immutable_item_by_target_stmt = NULL;
+		sqlite3_stmt* m_insert_or_replace_immutable_items_stmt = NULL;
+		sqlite3_stmt* m_delete_immutable_items_stmt = NULL;
 
 		// put item cache
 		std::string m_mutable_item;
@@ -23,6 +23,7 @@ see LICENSE file.
 #include <ip2/config.hpp>
 #include <ip2/kademlia/dht_storage.hpp>
 #include <ip2/kademlia/incoming_table.hpp>
+#include <ip2/kademlia/peer_endpoints.hpp>
 #include <ip2/kademlia/routing_table.hpp>
 #include <ip2/kademlia/rpc_manager.hpp>
 #include <ip2/kademlia/node_id.hpp>
@@ -56,6 +57,7 @@ namespace ip2 {
 namespace dht {
 
 struct traversal_algorithm;
+struct put_data;
 struct dht_observer;
 struct msg;
 struct settings;
@@ -78,7 +80,7 @@ struct socket_manager
 {
 	virtual bool has_quota() = 0;
 	virtual bool send_packet(aux::listen_socket_handle const& s, entry& e
-		, udp::endpoint const& addr, sha256_hash const& pk) = 0;
+		, udp::endpoint const& addr, sha256_hash const& pk, egress_class tc) = 0;
 protected:
 	~socket_manager() = default;
 };
@@ -226,6 +228,12 @@ public:
 		, std::int8_t invoke_limit
 		, std::function<void(item const&, bool)> f);
 
+	// gets the mutable items whose targets start with the first prefix_len
+	// bytes of prefix. See get_item
+	void get_items(sha256_hash const& prefix, int prefix_len
+		, sha256_hash const* after
+		, std::function<void(item const&, bool, bool)> f);
+
 	void put_item(sha256_hash const& target
 		, entry const& data
 		, public_key const& to
@@ -270,6 +278,32 @@ public:
 		, std::int8_t invoke_limit
 		, std::function<void(item const&, int)> f);
 
+	// blob segments are immutable items stored under segment_target_id()
+	// of their value, a string. They are neither signed nor verified.
+	void get_segment(sha1_hash const& seg_hash
+		, std::int8_t alpha
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit
+		, std::function<void(item const&, bool)> f);
+
+	void put_segment(entry const& data
+		, std::int8_t alpha
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit
+		, std::function<void(item const&, int)> f);
+
+	// ask the publisher of a segment or a root index directly, for when
+	// the storing nodes have lost it. The publisher is only reached if
+	// its endpoint is known, otherwise f gets an empty item right away.
+	void get_segment_from_origin(public_key const& origin
+		, sha1_hash const& seg_hash
+		, std::function<void(item const&, bool)> f);
+
+	void get_item_from_origin(public_key const& origin
+		, std::string const& salt
+		, std::int64_t timestamp
+		, std::function<void(item const&, bool)> f);
+
 	// relay protocol
 	void send(public_key const& to
 		, entry const& payload
@@ -365,6 +399,12 @@ private:
 	bool lookup_peers(sha256_hash const& info_hash, entry& reply
 		, bool noseed, bool scrape, address const& requester) const;
 
+	// start a put directly, or behind a put_lookup when two phase puts
+	// are enabled
+	void start_put(std::shared_ptr<put_data> const& ta
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit);
+
 	aux::session_settings const& m_settings;
 
 	mutable std::mutex m_mutex;
@@ -399,6 +439,14 @@ private:
 	void write_nodes_entries(sha256_hash const& info_hash
 		, bdecode_node const& want, entry& r, int min_distance_exp = -1);
 
+	// answer a get from the items this node published itself, when
+	// the storing nodes have lost them.
+	bool get_origin_item(sha256_hash const& target, timestamp ts, entry& reply);
+	void republish_origin_item(sha256_hash const& target, entry const& e);
+
+	// the endpoints the node with this public key was last seen at
+	std::vector<node_entry> origin_endpoints(public_key const& origin);
+
 	bool encrypt(dht::public_key const& dht_pk, const std::string& in
 		, std::string& out, std::string& err_str);
 
@@ -410,6 +458,7 @@ private:
 public:
 	routing_table m_table;
 	incoming_table m_incoming_table;
+	peer_endpoints m_peer_endpoints;
 	rpc_manager m_rpc;
 	bs_nodes_learner m_bs_nodes_learner;
 	aux::listen_socket_handle const m_sock;
@@ -446,6 +495,10 @@ private:
 
 	time_point m_last_keep;
 
+	// origin items republished recently, to put each of them at most
+	// once per origin_republish_interval however often it's asked for.
+	std::map<sha256_hash, time_point> m_origin_republished;
+
 	// secret random numbers used to create write tokens
 	std::array<char, 4> m_secret[2];
 
@@ -55,7 +55,7 @@ struct TORRENT_EXTRA_EXPORT observer
 
 	// this is called if no response has been received after
 	// a few seconds, before the request has timed out
-	void short_timeout();
+	virtual void short_timeout();
 
 	bool has_short_timeout() const { return bool(flags & flag_short_timeout); }
 
@@ -0,0 +1,61 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef TORRENT_DHT_PEER_ENDPOINTS_HPP
+#define TORRENT_DHT_PEER_ENDPOINTS_HPP
+
+#include "ip2/config.hpp"
+#include "ip2/socket.hpp"
+#include "ip2/time.hpp"
+#include "ip2/kademlia/node_id.hpp"
+
+#include <map>
+
+namespace ip2 {
+namespace dht {
+
+	// the endpoints of the peers we exchanged relays with lately, learned
+	// from relays they sent us directly, if they acknowledge relays, and
+	// from their own replies to the relays we sent them. A relay to one of
+	// these is first sent straight to its endpoint, ahead of the traversal.
+	// Entries expire after a while, NAT mappings don't last forever.
+	struct TORRENT_EXTRA_EXPORT peer_endpoints
+	{
+		static constexpr int max_size = 1024;
+
+		explicit peer_endpoints(time_duration lifetime = seconds(60));
+
+		void seen(node_id const& id, udp::endpoint const& ep, time_point now);
+
+		// the endpoint id was last seen at, unless it's expired
+		bool find(node_id const& id, udp::endpoint& ep, time_point now) const;
+
+		// forgets id, after a direct relay to it went unanswered
+		void erase(node_id const& id);
+
+		// drops the expired entries
+		void tick(time_point now);
+
+		int size() const { return int(m_endpoints.size()); }
+
+	private:
+
+		struct entry
+		{
+			udp::endpoint ep;
+			time_point last_seen;
+		};
+
+		time_duration const m_lifetime;
+		std::map<node_id, entry> m_endpoints;
+	};
+}
+}
+
+#endif // TORRENT_DHT_PEER_ENDPOINTS_HPP
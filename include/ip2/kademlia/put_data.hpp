@@ -38,6 +38,16 @@ struct put_data: traversal_algorithm
 	void set_data(item&& data) { m_data = std::move(data); }
 	void set_data(item const& data) = delete;
 
+	// the data is a blob segment stored under its segment_target_id()
+	void set_segment(bool segment) { m_segment = segment; }
+
+	item const& data() const { return m_data; }
+	bool segment() const { return m_segment; }
+
+	// bytes a put_lookup spent finding the nodes to store on, they're
+	// part of the cost of this put
+	void add_lookup_bytes(std::int64_t bytes) { m_bytes_sent += bytes; }
+
 protected:
 
 	void done() override;
@@ -48,7 +58,17 @@ protected:
 
 	put_callback m_put_callback;
 	item m_data;
+
+	// m_data's value, bencoded once in start(). It's the same for every
+	// node we invoke, so each put message only copies these bytes.
+	entry::preformatted_type m_encoded_value;
+
+	// the size of one put message and the bytes sent by this put so far
+	int m_message_size = 0;
+	std::int64_t m_bytes_sent = 0;
+
 	bool m_done = false;
+	bool m_segment = false;
 };
 
 struct put_data_observer : traversal_observer
@@ -0,0 +1,46 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#ifndef IP2_PUT_LOOKUP_HPP
+#define IP2_PUT_LOOKUP_HPP
+
+#include <ip2/kademlia/find_data.hpp>
+#include <ip2/kademlia/put_data.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace ip2 {
+namespace dht {
+
+// the first phase of a two phase put. It looks up the nodes closest to
+// the put's target with gets that don't ask for the value, then starts the
+// put on just those nodes, all at once.
+struct put_lookup : find_data
+{
+	put_lookup(node& dht_node, std::shared_ptr<put_data> put);
+
+	char const* name() const override;
+
+protected:
+
+	void done() override;
+	bool invoke(observer_ptr o) override;
+
+	std::shared_ptr<put_data> m_put;
+
+	// the size of one lookup message and the bytes sent so far
+	int m_message_size = 0;
+	std::int64_t m_bytes_sent = 0;
+};
+
+} // namespace dht
+} // namespace ip2
+
+#endif // IP2_PUT_LOOKUP_HPP
@@ -67,8 +67,15 @@ struct relay: traversal_algorithm
 
 	void set_hit_limit(int hit_limit) { m_hit_limit = hit_limit; }
 
+	// the receiver's last known endpoint. start() sends the relay straight
+	// there first, then traverses once that's answered or timed out
+	void set_direct_endpoint(udp::endpoint const& ep);
+
 	void on_put_success(node_id const& nid, udp::endpoint const& ep, bool hit);
 
+	void on_direct_reply(node_id const& nid, udp::endpoint const& ep, bool hit);
+	void on_direct_failed();
+
 	std::string& encrypted_payload() { return m_encrypted_payload; }
 
 protected:
@@ -79,6 +86,9 @@ protected:
 	observer_ptr new_observer(udp::endpoint const& ep
 		, node_id const& id) override;
 
+	entry relay_message() const;
+	void invoke_direct();
+
 	completed_callback m_completed_callback;
 	std::vector<std::pair<node_entry, bool>> m_success_nodes;
 
@@ -88,9 +98,20 @@ protected:
 	entry m_aux_nodes;
 	relay_hmac m_hmac;
 
+	// the payload and relay nodes, bencoded once in start() and copied
+	// into every relay message
+	entry::preformatted_type m_encoded_payload;
+	entry::preformatted_type m_encoded_aux_nodes;
+
 	int m_hits = 0;
 	int m_hit_limit = 0;
 	bool m_done = false;
+
+	udp::endpoint m_direct_ep;
+	bool m_has_direct_ep = false;
+	// set once the direct send was answered or went unanswered, and we're
+	// traversing
+	bool m_direct_done = false;
 };
 
 struct relay_observer : traversal_observer
@@ -105,6 +126,28 @@ struct relay_observer : traversal_observer
 	void reply(msg const&, node_id const&) override;
 };
 
+// the relay sent straight to the receiver. Its algorithm is a placeholder,
+// replies and timeouts go to the relay it was sent for
+struct direct_relay_observer : observer
+{
+	direct_relay_observer(
+		std::shared_ptr<traversal_algorithm> algorithm
+		, udp::endpoint const& ep, node_id const& id
+		, std::shared_ptr<relay> r)
+		: observer(std::move(algorithm), ep, id)
+		, m_relay(std::move(r))
+	{
+	}
+
+	void reply(msg const&, node_id const&) override;
+	void short_timeout() override;
+	void timeout() override;
+
+private:
+
+	std::shared_ptr<relay> m_relay;
+};
+
 } // namespace dht
 } // namespace ip2
 
@@ -19,6 +19,7 @@ see LICENSE file.
 #include <ip2/socket.hpp>
 #include <ip2/time.hpp>
 #include <ip2/kademlia/node_id.hpp>
+#include <ip2/kademlia/egress_shaper.hpp>
 #include <ip2/kademlia/observer.hpp>
 #include <ip2/aux_/listen_socket_handle.hpp>
 #include <ip2/aux_/pool.hpp>
@@ -69,7 +70,8 @@ public:
 	time_duration tick();
 
 	bool invoke(entry& e, udp::endpoint const& target
-		, observer_ptr o, bool discard_response = false);
+		, observer_ptr o, bool discard_response = false
+		, egress_class tc = egress_class::request);
 
 #if TORRENT_USE_ASSERTS
 	size_t allocation_size() const;
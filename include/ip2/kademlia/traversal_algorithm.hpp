@@ -79,6 +79,10 @@ struct TORRENT_EXTRA_EXPORT traversal_algorithm
 	// Discard corresponding responses and rpc manager don't store these requests.
 	void set_discard_response(bool discard_response);
 
+	// Invoke all the direct endpoints at once instead of one at a time,
+	// and wait for their responses.
+	void set_parallel_invoking(bool parallel) { m_parallel_invoking = parallel; }
+
 	void set_fixed_distance(int distance) { m_fixed_distance = distance; }
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -134,6 +138,10 @@ protected:
 	// and discard corresponding responses.
 	bool m_discard_response = false;
 
+	// This flag indicates traversal algorithm invokes all the direct
+	// endpoints in one burst, see set_parallel_invoking().
+	bool m_parallel_invoking = false;
+
 	int m_fixed_distance = -1;
 
 	int num_sorted_results() const { return m_sorted_results; }
@@ -44,6 +44,9 @@ namespace ip2 {
 			recv_ip_overhead_bytes,
 			recv_tracker_bytes,
 
+			udp_compressed_packets,
+			udp_compress_saved_bytes,
+
 			recv_failed_bytes,
 			recv_redundant_bytes,
 
@@ -51,6 +54,7 @@ namespace ip2 {
 			dht_messages_in_dropped,
 			dht_messages_out,
 			dht_messages_out_dropped,
+			dht_messages_out_delayed,
 			dht_bytes_in,
 			dht_bytes_out,
 
@@ -69,6 +73,9 @@ namespace ip2 {
 			dht_sample_infohashes_in,
 			dht_sample_infohashes_out,
 			dht_invoked_requests,
+			dht_origin_item_served,
+			dht_put_bytes_out,
+			dht_put_stored,
 
 			dht_invalid_announce,
 			dht_invalid_get_peers,
@@ -37,6 +37,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #define TORRENT_SESSION_HANDLE_HPP_INCLUDED
 
 #include <memory> // for shared_ptr
+#include <functional>
 
 #include "ip2/config.hpp"
 #include "ip2/fwd.hpp"
@@ -53,6 +54,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "ip2/aux_/common.h" // for aux::bytes
 
 #include "ip2/api/error_code.hpp"
+#include "ip2/api/shared_blob.hpp"
 
 #include "ip2/kademlia/dht_storage.hpp"
 #include "ip2/kademlia/announce_flags.hpp"
@@ -68,6 +70,10 @@ POSSIBILITY OF SUCH DAMAGE.
 
 namespace ip2 {
 
+namespace blockchain {
+	class chain_reader;
+}
+
 	// this class provides a non-owning handle to a session and a subset of the
 	// interface of the session class. If the underlying session is destructed
 	// any handle to it will no longer be valid. is_valid() will return false and
@@ -171,6 +177,20 @@ namespace ip2 {
 		void dht_get_item(std::array<char, 32> key
 			, std::string salt = std::string());
 
+		// query the DHT for all mutable items whose targets start with the
+		// first ``prefix_len`` bytes of ``prefix``. The first 12 bytes of a
+		// target are the first 12 bytes of the public key, so this lists
+		// the items a key has published. Each item found is posted as a
+		// dht_mutable_item_alert, with ``authoritative`` false.
+		//
+		// A node returns as many items as fit in one packet. To get the rest,
+		// query again with ``after`` set to the greatest target seen so far,
+		// only items with greater targets are returned then. When the lookup
+		// is done a dht_get_items_alert is posted, its ``more`` field says
+		// whether there are items left.
+		void dht_get_items(sha256_hash const& prefix, int prefix_len
+			, sha256_hash const& after = sha256_hash());
+
 		// store the given bencoded data as an immutable item in the DHT.
 		// the returned hash is the key that is to be used to look the item
 		// up again. It's just the SHA-1 hash of the bencoded form of the
@@ -379,7 +399,10 @@ namespace ip2 {
 
 		// submit transaction
         bool submit_transaction(const blockchain::transaction & tx);
-		// get account info
+		// get account info.
+		// account, block and top/tip block queries are served on the calling
+		// thread from read-only database connections and the latest published
+		// head blocks, they do not wait for the network thread.
         blockchain::account get_account_info(std::vector<char> chain_id, dht::public_key publicKey);
 		// get top and tip blocks
         std::vector<blockchain::block> get_top_tip_block(std::vector<char> chain_id, int num);
@@ -452,6 +475,12 @@ namespace ip2 {
 		ip2::api::error_code put_data_into_swarm(std::vector<char> const& blob
 			, std::array<char, 20> const& uri);
 
+		// same as above, but the blob is shared with ip2 by handle instead of
+		// being copied to the network thread. The blob data must not be
+		// modified while any handle to it is alive.
+		ip2::api::error_code put_data_into_swarm(ip2::api::shared_blob const& blob
+			, std::array<char, 20> const& uri);
+
 		// send data uri to other peer by 'relay' protocol.
 		// the receiver can get the corresponding data by this uri & uri_sender.
 		// The "relay_data_uri_alert" alert will be posted to user to indicate
@@ -474,6 +503,50 @@ namespace ip2 {
 		ip2::api::error_code relay_message(std::array<char, 32> const& receiver
 			, std::vector<char> const& message);
 
+		// asynchronous variants of the calls above. They only post the call to
+		// the network thread and return immediately, the result is passed to
+		// ``handler`` once the call has run. The handler is invoked from the
+		// network thread, it must not block and must not make synchronous
+		// calls on this session_handle from another thread while waiting on it.
+		// If the call throws, a session_error_alert is posted and the handler
+		// receives the failure value (``ABORT_ERROR``, ``false`` or an empty
+		// account).
+		void async_put_data_into_swarm(std::vector<char> const& blob
+			, std::array<char, 20> const& uri
+			, std::function<void(ip2::api::error_code)> handler);
+
+		void async_put_data_into_swarm(ip2::api::shared_blob const& blob
+			, std::array<char, 20> const& uri
+			, std::function<void(ip2::api::error_code)> handler);
+
+		void async_get_data_from_swarm(std::array<char, 32> const& sender
+			, std::array<char, 20> const& uri
+			, std::int64_t timestamp
+			, std::function<void(ip2::api::error_code)> handler);
+
+		void async_relay_message(std::array<char, 32> const& receiver
+			, std::vector<char> const& message
+			, std::function<void(ip2::api::error_code)> handler);
+
+		void async_submit_transaction(blockchain::transaction const& tx
+			, std::function<void(bool)> handler);
+
+		void async_add_new_message(communication::message const& msg
+			, std::function<void(bool)> handler);
+
+		void async_get_account_info(std::vector<char> chain_id
+			, dht::public_key const& publicKey
+			, std::function<void(blockchain::account)> handler);
+
+		// batch submission. All transactions (or messages) are handed to the
+		// network thread in a single dispatch and processed in order. The
+		// handler receives one result per item, in the same order.
+		void async_submit_transactions(std::vector<blockchain::transaction> txs
+			, std::function<void(std::vector<bool>)> handler);
+
+		void async_add_new_messages(std::vector<communication::message> msgs
+			, std::function<void(std::vector<bool>)> handler);
+
 		// This call dereferences the reference count of the specified peer
 		// class. When creating a peer class it's automatically referenced by 1.
 		// If you want to recycle a peer class, you may call this function. You
@@ -675,6 +748,14 @@ namespace ip2 {
 		template <typename Ret, typename Fun, typename... Args>
 		Ret sync_call_ret(Fun f, Args&&... a) const;
 
+		// read-only query path, served on the calling thread. null if the
+		// session has no database open
+		std::shared_ptr<blockchain::chain_reader> read_only_path() const;
+
+		template <typename Ret, typename Fun, typename... Args>
+		void async_call_ret(std::function<void(Ret)> handler, Ret failed
+			, Fun f, Args&&... a) const;
+
 		explicit session_handle(std::weak_ptr<aux::session_impl> impl)
 			: m_impl(std::move(impl))
 		{}
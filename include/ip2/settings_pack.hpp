@@ -370,6 +370,14 @@ namespace aux {
 			// effect until the DHT is restarted.
 			dht_bootstrap_nodes,
 
+			// the file the DHT storage appends the items it stores to, and
+			// loads them from when the DHT starts. When set, stored items are
+			// kept there instead of in the sqlite items database, and are
+			// served again right after a restart. Empty disables it.
+			//
+			// Takes effect the next time the DHT is started.
+			dht_item_log_path,
+
 			max_string_setting_internal
 		};
 
@@ -921,6 +929,19 @@ namespace aux {
 			// It means this node behind NAT.
 			dht_non_referrable,
 
+			// when set, mutable items and blob segments are put in two
+			// phases: a lookup without the value finds the closest nodes,
+			// then the value is sent to just those nodes at once. When off,
+			// the value is sent in every put of the traversal.
+			dht_two_phase_put,
+
+			// when set, outgoing DHT traffic is kept within
+			// ``dht_upload_rate_limit``. Our own requests and responses are
+			// always sent right away. Our own puts and relays, pushes and
+			// relays forwarded for other nodes are paced, in that order of
+			// priority, and queued while the budget is used up.
+			dht_egress_shaping,
+
 			auto_relay,
 
             //start communication module
@@ -929,6 +950,12 @@ namespace aux {
             //start blockchain module
             enable_blockchain,
 
+			// when set, relayed messages ask the receiver for a receipt and
+			// are sent to fewer relay nodes. Messages that aren't
+			// acknowledged are sent again, with backoff, and reported as
+			// failed after a few tries.
+			relay_receipts,
+
 			max_bool_setting_internal
 		};
 
@@ -1505,6 +1532,8 @@ namespace aux {
 			// the number of bytes per second (on average) the DHT is allowed to send.
 			// If the incoming requests causes to many bytes to be sent in responses,
 			// incoming requests will be dropped until the quota has been replenished.
+			// With ``dht_egress_shaping`` it is the budget all DHT traffic is
+			// paced to.
 			dht_upload_rate_limit,
 
 			// ``unchoke_slots_limit`` is the max number of unchoked peers in the
@@ -1959,6 +1988,11 @@ namespace aux {
 			// transport layer default invoking queue max size
 			transport_invoking_queue_max_size,
 
+			// the max number of relays per second a DHT node is allowed to
+			// send without getting banned. Relays are counted apart from the
+			// other traffic ``dht_block_ratelimit`` limits.
+			dht_relay_block_ratelimit,
+
 			max_int_setting_internal
 		};
 
@@ -78,13 +78,43 @@ public:
 		, std::int8_t invoke_window
 		, std::int8_t invoke_limit);
 
-	api::error_code put(entry const& data
+	// puts the blob root index under this node's key, it's also kept by
+	// this node to serve when the storing nodes lost it.
+	// data is moved into the queued request and shared with the dht call,
+	// pass an rvalue to avoid copying it.
+	api::error_code put(entry data
 		, std::string salt
 		, std::function<void(dht::item const&, int)> cb
 		, std::int8_t invoke_branch
 		, std::int8_t invoke_window
 		, std::int8_t invoke_limit);
 
+	// blob segments are immutable and named by their SHA-1, there is no key
+	// or salt. The segment hash is kept in the context's salt for logging.
+	api::error_code get_segment(sha1_hash const& seg_hash
+		, std::function<void(dht::item const&, bool)> cb
+		, std::int8_t invoke_branch
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit);
+
+	// ask the node that published a root index or a segment directly, for
+	// when the storing nodes lost it.
+	api::error_code get_from_origin(dht::public_key const& key
+		, std::string salt
+		, std::int64_t timestamp
+		, std::function<void(dht::item const&, bool)> cb);
+
+	api::error_code get_segment_from_origin(dht::public_key const& origin
+		, sha1_hash const& seg_hash
+		, std::function<void(dht::item const&, bool)> cb);
+
+	// data is the raw segment as a string entry
+	api::error_code put_segment(entry data
+		, std::function<void(dht::item const&, int)> cb
+		, std::int8_t invoke_branch
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit);
+
 	api::error_code send(dht::public_key const& to
 		, entry const& payload
 		, std::function<void(entry const& payload
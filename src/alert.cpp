@@ -2100,4 +2100,22 @@ namespace {
 #endif
 	}
 
+	dht_get_items_alert::dht_get_items_alert(aux::stack_allocator&
+		, sha256_hash const& p, int const len, bool const m)
+		: prefix(p), prefix_len(len), more(m)
+	{}
+
+	std::string dht_get_items_alert::message() const
+	{
+#ifdef TORRENT_DISABLE_ALERT_MSG
+		return {};
+#else
+		char msg[150];
+		std::snprintf(msg, sizeof(msg), "DHT get items done (prefix=%s len=%d%s)"
+			, aux::to_hex(prefix).c_str(), prefix_len
+			, more ? " more" : "");
+		return msg;
+#endif
+	}
+
 } // namespace ip2
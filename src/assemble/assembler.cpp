@@ -108,7 +108,14 @@ api::error_code assembler::relay_message(dht::public_key const& receiver
 api::error_code assembler::relay_uri(dht::public_key const& receiver
 	, aux::uri const& data_uri, dht::timestamp ts)
 {
-	return m_relayer.relay_uri(receiver, data_uri, ts);
+	// if we put this blob, send it along if it's small, otherwise tell the
+	// receiver its first segment hashes. The put goes on in the background,
+	// for whoever gets the blob later
+	std::vector<sha1_hash> seg_hashes;
+	std::string blob;
+	m_putter.relay_hint(data_uri, seg_hashes, blob);
+
+	return m_relayer.relay_uri(receiver, data_uri, ts, seg_hashes, blob);
 }
 
 } // namespace assemble
@@ -9,6 +9,9 @@ see LICENSE file.
 
 #include "ip2/assemble/get_context.hpp"
 #include "ip2/assemble/protocol.hpp"
+#include "ip2/aux_/sha1_multi.hpp"
+
+#include <algorithm>
 
 #ifndef TORRENT_DISABLE_LOGGING
 #include <ip2/hex.hpp> // to_hex
@@ -103,6 +106,12 @@ bool get_context::is_getting_allowed(sha1_hash const& h)
 	return times < reget_times_limit;
 }
 
+bool get_context::is_wanted(sha1_hash const& h) const
+{
+	if (!m_index_got) return true;
+	return std::find(m_root_index.begin(), m_root_index.end(), h) != m_root_index.end();
+}
+
 api::error_code get_context::on_root_index_got(dht::item const& it)
 {
 #ifndef TORRENT_DISABLE_LOGGING
@@ -137,6 +146,7 @@ api::error_code get_context::on_root_index_got(dht::item const& it)
 	std::shared_ptr<protocol::blob_index_protocol> index_proto
 		= std::dynamic_pointer_cast<protocol::blob_index_protocol>(bp);
 	index_proto->seg_hashes(m_root_index);
+	m_index_got = true;
 
 	return api::NO_ERROR;
 }
@@ -149,33 +159,19 @@ api::error_code get_context::on_segment_got(dht::item const& it
 	aux::to_hex(seg_hash, hex_hash);
 #endif
 
-	entry const& proto = it.value();
-	std::shared_ptr<protocol::basic_protocol> bp;
-	api::error_code err;
-	std::tie(bp, err) = protocol::construct_protocol(proto, m_logger);
-	if (err != api::NO_ERROR)
+	// segments are put as the raw bytes, no protocol envelope. A missing
+	// segment comes back as an empty item.
+	if (it.value().type() != entry::string_t)
 	{
 #ifndef TORRENT_DISABLE_LOGGING 
-		m_logger.log(aux::LOG_ERR, "[%u] parse segment[%s] error:%d"
-			, id(), hex_hash, err);
+		m_logger.log(aux::LOG_ERR, "[%u] segment[%s] is not a string"
+			, id(), hex_hash);
 #endif
 
-		return err;
+		return api::ASSEMBLE_PROTOCOL_FORMAT_ERROR;
 	}
 
-	if (bp->get_name() != protocol::blob_seg_protocol::name)
-	{
-#ifndef TORRENT_DISABLE_LOGGING 
-		m_logger.log(aux::LOG_ERR, "[%u] parse segment error:%s, name:%s"
-			, id(), hex_hash, bp->get_name().c_str());
-#endif
-
-		return api::ASSEMBLE_NAME_ERROR;
-	}
-
-	std::shared_ptr<protocol::blob_seg_protocol> seg_proto
-		= std::dynamic_pointer_cast<protocol::blob_seg_protocol>(bp);
-	std::string value = seg_proto->seg_value();
+	std::string value = it.value().string();
 
 #ifndef TORRENT_DISABLE_LOGGING
 	m_logger.log(aux::LOG_INFO, "[%u] blob seg[%s] got with the size:%d"
@@ -190,20 +186,35 @@ api::error_code get_context::on_segment_got(dht::item const& it
 
 bool get_context::get_segments_blob(std::vector<char>& value)
 {
-	// ignore broken blob
-	if (m_root_index.size() != m_segments.size()) return false;
-
-	//value.reserve(m_segments_total_size);
+	// ignore broken blob. There may be more segments than in the index, if
+	// the hints they were got for were wrong
+	if (m_root_index.size() > m_segments.size()) return false;
 
+	std::vector<span<char const>> segs;
+	segs.reserve(m_root_index.size());
 	for (auto& i : m_root_index)
 	{
 		auto it = m_segments.find(i);
 		if (it == m_segments.end()) return false;
+		segs.emplace_back(it->second);
+	}
 
-		//value.append(it->second, it->second.size());
-		std::copy(it->second.begin(), it->second.end(), std::back_inserter(value));
+	// every segment must match its hash in the index. They are checked
+	// together, once the whole blob is there.
+	std::vector<sha1_hash> seg_hashes(segs.size());
+	aux::sha1_multi(segs, seg_hashes);
+	if (seg_hashes != m_root_index)
+	{
+#ifndef TORRENT_DISABLE_LOGGING
+		m_logger.log(aux::LOG_ERR, "[%u] segments don't match the blob index", id());
+#endif
+		return false;
 	}
 
+	value.reserve(m_segments_total_size);
+	for (auto const& s : segs)
+		value.insert(value.end(), s.begin(), s.end());
+
 	return true;
 }
 
@@ -18,6 +18,8 @@ see LICENSE file.
 #include "ip2/hex.hpp" // to_hex
 #endif
 
+#include <algorithm>
+
 #include <ip2/time.hpp>
 #include <ip2/aux_/time.hpp>
 #include <ip2/api/dht_rpc_params.hpp>
@@ -58,6 +60,30 @@ api::error_code getter::get_blob(dht::public_key const& sender
 	aux::to_hex(blob_uri.bytes, hex_uri);
 #endif
 
+	auto const key = std::make_pair(sender, blob_uri);
+	auto hint = m_index_hints.find(key);
+
+	// a small blob relayed to us inline doesn't need getting
+	if (hint != m_index_hints.end() && !hint->second.blob.empty()
+		&& hint->second.ts == ts)
+	{
+#ifndef TORRENT_DISABLE_LOGGING
+		m_logger.log(aux::LOG_INFO, "get req:%s/%s, relayed inline, size:%d"
+			, hex_sender, hex_uri, (int)hint->second.blob.size());
+#endif
+
+		std::array<char, 32> from;
+		std::array<char, 20> uri;
+		std::copy(sender.bytes.begin(), sender.bytes.end(), from.begin());
+		std::copy(blob_uri.bytes.begin(), blob_uri.bytes.end(), uri.begin());
+		std::vector<char> data(hint->second.blob.begin(), hint->second.blob.end());
+		m_session.alerts().emplace_alert<get_data_alert>(from, uri, ts.value
+			, data, api::NO_ERROR);
+
+		forget_index_hint(hint);
+		return api::NO_ERROR;
+	}
+
 	// check network, if dht live nodes is 0, return error.
 	if (m_session.dht_nodes() == 0)
 	{
@@ -96,6 +122,15 @@ api::error_code getter::get_blob(dht::public_key const& sender
 	{
 		ctx->start_getting_hash(index_hash, false);
 		m_running_tasks.insert(ctx);
+
+		// if the uri was relayed to us with the first segment hashes, get
+		// those segments now rather than after the index traversal
+		if (hint != m_index_hints.end())
+		{
+			if (!hint->second.seg_hashes.empty())
+				get_hinted_segments(ctx, hint->second.seg_hashes);
+			forget_index_hint(hint);
+		}
 	}
     else
     {
@@ -106,8 +141,47 @@ api::error_code getter::get_blob(dht::public_key const& sender
 	return result;
 }
 
+void getter::forget_index_hint(index_hints_t::iterator hint)
+{
+	m_index_hints_order.erase(std::find(m_index_hints_order.begin()
+		, m_index_hints_order.end(), hint->first));
+	m_index_hints.erase(hint);
+}
+
+void getter::get_hinted_segments(std::shared_ptr<get_context> ctx
+	, std::vector<sha1_hash> const& seg_hashes)
+{
+	// these are a bonus, the index get can do without them. Don't use up the
+	// buffer the segments from the index will need
+	if (!m_session.transporter()->has_enough_buffer(seg_hashes.size() + 1))
+		return;
+
+#ifndef TORRENT_DISABLE_LOGGING
+	m_logger.log(aux::LOG_INFO, "[%u] get %d hinted segments along with the index"
+		, ctx->id(), (int)seg_hashes.size());
+#endif
+
+	api::dht_rpc_params config = get_rpc_parmas(api::GET);
+
+	for (auto& s : seg_hashes)
+	{
+		if (ctx->is_invoked(s)) continue;
+
+		api::error_code ok = m_session.transporter()->get_segment(s
+			, std::bind(&getter::get_callback, this, _1, _2, ctx, s, true)
+			, config.invoke_branch, config.invoke_window
+			, config.invoke_limit);
+
+		if (ok != api::NO_ERROR) break;
+
+		ctx->start_getting_hash(s, true);
+	}
+}
+
 void getter::on_incoming_relay_uri(dht::public_key const& sender
-	, aux::uri blob_uri, dht::timestamp ts)
+	, aux::uri blob_uri, dht::timestamp ts
+	, std::vector<sha1_hash> const& seg_hashes
+	, std::string const& blob)
 {
 #ifndef TORRENT_DISABLE_LOGGING
 	char hex_sender[65];
@@ -118,10 +192,30 @@ void getter::on_incoming_relay_uri(dht::public_key const& sender
 
 #ifndef TORRENT_DISABLE_LOGGING
 	m_logger.log(aux::LOG_INFO
-		, "incoming relay uri: sender: %s, uri:%s"
-		, hex_sender, hex_uri);
+		, "incoming relay uri: sender: %s, uri:%s, hinted segments:%d, inline size:%d"
+		, hex_sender, hex_uri, (int)seg_hashes.size(), (int)blob.size());
 #endif
 
+	if (!seg_hashes.empty() || !blob.empty())
+	{
+		auto const key = std::make_pair(sender, blob_uri);
+		auto const ret = m_index_hints.insert({key, index_hint()});
+		if (ret.second)
+		{
+			m_index_hints_order.push_back(key);
+			if (int(m_index_hints_order.size()) > index_hints_limit)
+			{
+				m_index_hints.erase(m_index_hints_order.front());
+				m_index_hints_order.pop_front();
+			}
+		}
+
+		index_hint& hint = ret.first->second;
+		hint.ts = ts;
+		hint.seg_hashes = seg_hashes;
+		hint.blob = blob;
+	}
+
 	// post "incoming_relay_data_uri_alert"
 	m_session.alerts().emplace_alert<incoming_relay_data_uri_alert>(sender.bytes.data()
 		, blob_uri.bytes.data(), ts.value);
@@ -130,6 +224,9 @@ void getter::on_incoming_relay_uri(dht::public_key const& sender
 void getter::get_callback(dht::item const& it, bool auth
 	, std::shared_ptr<get_context> ctx, sha1_hash h, bool is_seg)
 {
+	// the task may be over already, with hinted segment gets still flying
+	if (m_running_tasks.find(ctx) == m_running_tasks.end()) return;
+
 	if (!auth) return;
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -175,6 +272,13 @@ void getter::get_callback(dht::item const& it, bool auth
 					return;
 				}
 			}
+			else if (get_from_origin(ctx, h, false))
+			{
+#ifndef TORRENT_DISABLE_LOGGING
+				m_logger.log(aux::LOG_WARNING, "[%u] get index from origin:%s"
+					, ctx->id(), hex_hash);
+#endif
+			}
 			else
 			{
 #ifndef TORRENT_DISABLE_LOGGING
@@ -248,10 +352,11 @@ void getter::get_callback(dht::item const& it, bool auth
 
 				for (auto& s : seg_hashes)
 				{
-					std::string seg_salt(s.data(), 20);
+					// got or being got already, from the hints. A hinted
+					// get that failed is tried again, now it's confirmed
+					if (ctx->is_flying_or_got(s)) continue;
 
-					api::error_code ok = m_session.transporter()->get(ctx->get_sender()
-						, seg_salt, ctx->get_timestamp()
+					api::error_code ok = m_session.transporter()->get_segment(s
 						, std::bind(&getter::get_callback, this, _1, _2, ctx, s, true)
 						, config.invoke_branch, config.invoke_window
 						, config.invoke_limit);
@@ -277,7 +382,24 @@ void getter::get_callback(dht::item const& it, bool auth
 		// this item is blob segment
 		api::error_code err = ctx->on_segment_got(it, h);
 
-		if (err != api::NO_ERROR)
+		if (err != api::NO_ERROR && !ctx->is_wanted(h))
+		{
+			// a hinted segment that isn't in the index after all
+#ifndef TORRENT_DISABLE_LOGGING
+			m_logger.log(aux::LOG_INFO, "[%u] drop unwanted segment:%s"
+				, ctx->id(), hex_hash);
+#endif
+		}
+		else if (err != api::NO_ERROR && !ctx->is_index_got())
+		{
+			// a hinted segment the index hasn't confirmed yet. It's got
+			// again when the index lists it, it can't fail the blob before
+#ifndef TORRENT_DISABLE_LOGGING
+			m_logger.log(aux::LOG_INFO, "[%u] hinted segment not got, waiting for index:%s"
+				, ctx->id(), hex_hash);
+#endif
+		}
+		else if (err != api::NO_ERROR)
 		{
 			if (ctx->is_getting_allowed(h))
 			{
@@ -286,11 +408,9 @@ void getter::get_callback(dht::item const& it, bool auth
 					, ctx->id(), hex_hash);
 #endif
 
-				std::string salt(h.data(), 20);
 				api::dht_rpc_params config = get_rpc_parmas(api::GET);
 
-				api::error_code ok = m_session.transporter()->get(ctx->get_sender()
-					, salt, ctx->get_timestamp()
+				api::error_code ok = m_session.transporter()->get_segment(h
 					, std::bind(&getter::get_callback, this, _1, _2, ctx, h, true)
 					, config.invoke_branch, config.invoke_window, config.invoke_limit);
 
@@ -303,6 +423,13 @@ void getter::get_callback(dht::item const& it, bool auth
 					ctx->set_error(ok);
 				}
 			}
+			else if (get_from_origin(ctx, h, true))
+			{
+#ifndef TORRENT_DISABLE_LOGGING
+				m_logger.log(aux::LOG_WARNING, "[%u] get segment from origin:%s"
+					, ctx->id(), hex_hash);
+#endif
+			}
 			else
 			{
 #ifndef TORRENT_DISABLE_LOGGING
@@ -322,6 +449,23 @@ void getter::get_callback(dht::item const& it, bool auth
 	}
 }
 
+bool getter::get_from_origin(std::shared_ptr<get_context> ctx
+	, sha1_hash const& h, bool const is_seg)
+{
+	if (ctx->is_origin_asked(h)) return false;
+
+	api::error_code const ok = is_seg
+		? m_session.transporter()->get_segment_from_origin(ctx->get_sender(), h
+			, std::bind(&getter::get_callback, this, _1, _2, ctx, h, true))
+		: m_session.transporter()->get_from_origin(ctx->get_sender()
+			, std::string(h.data(), 20), ctx->get_timestamp()
+			, std::bind(&getter::get_callback, this, _1, _2, ctx, h, false));
+	if (ok != api::NO_ERROR) return false;
+
+	ctx->start_getting_from_origin(h);
+	return true;
+}
+
 void getter::post_alert(std::shared_ptr<get_context> ctx)
 {
 	dht::public_key sender = ctx->get_sender();
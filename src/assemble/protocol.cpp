@@ -8,6 +8,10 @@ see LICENSE file.
 */
 
 #include "ip2/assemble/protocol.hpp"
+#include "ip2/assert.hpp"
+#include "ip2/aux_/io_bytes.hpp"
+
+#include <iterator>
 
 #ifndef TORRENT_DISABLE_LOGGING
 #include "ip2/hex.hpp" // to_hex
@@ -34,7 +38,7 @@ basic_protocol::basic_protocol(std::string const& ver, std::string const& n)
 	: m_version(ver), m_name(n)
 {}
 
-entry basic_protocol::to_entry()
+entry basic_protocol::to_entry() const&
 {
 	entry proto;
 
@@ -45,6 +49,17 @@ entry basic_protocol::to_entry()
 	return proto;
 }
 
+entry basic_protocol::to_entry() &&
+{
+	entry proto;
+
+	proto["v"] = std::move(m_version);
+	proto["n"] = std::move(m_name);
+	proto["a"] = std::move(m_arg);
+
+	return proto;
+}
+
 char const blob_seg_protocol::ver[] = { 'S'
 	, blob_seg_protocol::major, blob_seg_protocol::minor, blob_seg_protocol::tiny };
 
@@ -56,16 +71,20 @@ std::string blob_seg_protocol::name = "s";
 blob_seg_protocol::blob_seg_protocol(std::string const& ver, std::string const& n
 	, std::string const& seg_value)
 	: basic_protocol(ver, n)
-	, m_seg_value(seg_value)
 {
-	m_arg["v"] = m_seg_value;
+	m_arg["v"] = seg_value;
 }
 
 blob_seg_protocol::blob_seg_protocol(std::string const& seg_value)
 	: basic_protocol(version, name)
-	, m_seg_value(seg_value)
 {
-	m_arg["v"] = m_seg_value;
+	m_arg["v"] = seg_value;
+}
+
+blob_seg_protocol::blob_seg_protocol(span<char const> seg_value)
+	: basic_protocol(version, name)
+{
+	m_arg["v"] = seg_value;
 }
 
 char const blob_index_protocol::ver[] = { 'I'
@@ -114,28 +133,50 @@ std::string relay_uri_protocol::version = std::string(relay_uri_protocol::ver
 std::string relay_uri_protocol::name = "u";
 
 relay_uri_protocol::relay_uri_protocol(dht::public_key const& pk, aux::uri const& blob_uri
-	, dht::timestamp ts)
+	, dht::timestamp ts, std::vector<sha1_hash> const& seg_hashes)
 	: basic_protocol(version, name)
 	, m_pk(pk)
 	, m_uri(blob_uri)
 	, m_ts(ts)
+	, m_seg_hashes(seg_hashes)
 {
-	m_arg["s"] = m_pk.bytes;
-	m_arg["u"] = m_uri.bytes;
-	m_arg["ts"] = m_ts.value;
+	set_arg();
 }
 
 relay_uri_protocol::relay_uri_protocol(std::string const& ver, std::string const& n
 	, dht::public_key const& pk, aux::uri const& blob_uri
-	, dht::timestamp ts) 
+	, dht::timestamp ts, std::vector<sha1_hash> const& seg_hashes)
 	: basic_protocol(ver, n)
 	, m_pk(pk)
 	, m_uri(blob_uri)
 	, m_ts(ts)
+	, m_seg_hashes(seg_hashes)
+{
+	set_arg();
+}
+
+void relay_uri_protocol::set_arg()
 {
 	m_arg["s"] = m_pk.bytes;
 	m_arg["u"] = m_uri.bytes;
 	m_arg["ts"] = m_ts.value;
+
+	if (m_seg_hashes.empty()) return;
+
+	std::string hashes_str;
+	for (auto& h : m_seg_hashes)
+	{
+		hashes_str.append(h.data(), 20);
+	}
+
+	m_arg["h"] = hashes_str;
+}
+
+void relay_uri_protocol::inline_blob(std::string blob)
+{
+	TORRENT_ASSERT(int(blob.size()) <= relay_uri_inline_size);
+	m_blob = std::move(blob);
+	m_arg["b"] = m_blob;
 }
 
 char const relay_msg_protocol::ver[] = { 'M'
@@ -161,6 +202,41 @@ relay_msg_protocol::relay_msg_protocol(std::string const& ver, std::string const
 	m_arg["m"] = m_msg;
 }
 
+void relay_msg_protocol::set_id(std::uint32_t const id)
+{
+	m_id = id;
+	m_has_id = true;
+	m_arg["i"] = m_id;
+}
+
+char const relay_receipt_protocol::ver[] = { 'K'
+	, relay_receipt_protocol::major, relay_receipt_protocol::minor
+	, relay_receipt_protocol::tiny };
+
+std::string relay_receipt_protocol::version = std::string(relay_receipt_protocol::ver
+	, relay_receipt_protocol::ver + version_length);
+
+std::string relay_receipt_protocol::name = "k";
+
+relay_receipt_protocol::relay_receipt_protocol(std::vector<std::uint32_t> const& ids)
+	: relay_receipt_protocol(version, name, ids)
+{}
+
+relay_receipt_protocol::relay_receipt_protocol(std::string const& ver
+	, std::string const& n, std::vector<std::uint32_t> const& ids)
+	: basic_protocol(ver, n)
+	, m_ids(ids)
+{
+	std::string ids_str;
+	auto out = std::back_inserter(ids_str);
+	for (auto const i : m_ids)
+	{
+		aux::write_uint32(i, out);
+	}
+
+	m_arg["i"] = ids_str;
+}
+
 // basic protocol factory method
 std::tuple<std::shared_ptr<basic_protocol>, api::error_code>
 		construct_protocol(entry const& proto, assemble_logger& logger)
@@ -305,9 +381,43 @@ std::tuple<std::shared_ptr<basic_protocol>, api::error_code>
 			ts = ip2::dht::timestamp(te->integer());
 		}
 
-		return std::make_tuple(
-			std::make_shared<relay_uri_protocol>(version_str, name_str, sender, blob_uri, ts)
-			, api::NO_ERROR);
+		// senders that don't know the index, or older ones, leave it out
+		std::vector<sha1_hash> hashes;
+		entry const* he = a->find_key("h");
+		if (he)
+		{
+			if (he->type() != entry::string_t
+				|| he->string().size() % 20 != 0
+				|| he->string().size() > relay_uri_hint_count * 20)
+			{
+				return std::make_tuple(std::make_shared<basic_protocol>()
+					, api::ASSEMBLE_PROTOCOL_FORMAT_ERROR);
+			}
+
+			int count = he->string().size() / 20;
+			for (int i = 0; i != count; i++)
+			{
+				hashes.emplace_back(he->string().data() + i * 20);
+			}
+		}
+
+		auto rup = std::make_shared<relay_uri_protocol>(version_str, name_str
+			, sender, blob_uri, ts, hashes);
+
+		entry const* be = a->find_key("b");
+		if (be)
+		{
+			if (be->type() != entry::string_t
+				|| int(be->string().size()) > relay_uri_inline_size)
+			{
+				return std::make_tuple(std::make_shared<basic_protocol>()
+					, api::ASSEMBLE_PROTOCOL_FORMAT_ERROR);
+			}
+
+			rup->inline_blob(be->string());
+		}
+
+		return std::make_tuple(rup, api::NO_ERROR);
 	}
 	else if (strncmp(name_str.c_str(), relay_msg_protocol::name.c_str(), 1) == 0)
 	{
@@ -331,7 +441,52 @@ std::tuple<std::shared_ptr<basic_protocol>, api::error_code>
 				, api::ASSEMBLE_PROTOCOL_FORMAT_ERROR);
 		}
 
-		return std::make_tuple(std::make_shared<relay_msg_protocol>(version_str, name_str, msg)
+		auto rmp = std::make_shared<relay_msg_protocol>(version_str, name_str, msg);
+
+		entry const* ie = a->find_key("i");
+		if (ie)
+		{
+			if (ie->type() != entry::int_t)
+			{
+				return std::make_tuple(std::make_shared<basic_protocol>()
+					, api::ASSEMBLE_PROTOCOL_FORMAT_ERROR);
+			}
+
+			rmp->set_id(std::uint32_t(ie->integer()));
+		}
+
+		return std::make_tuple(rmp, api::NO_ERROR);
+	}
+	else if (strncmp(name_str.c_str(), relay_receipt_protocol::name.c_str(), 1) == 0)
+	{
+		if (!version_match(version_str, relay_receipt_protocol::version))
+		{
+			return std::make_tuple(std::make_shared<basic_protocol>()
+				, api::ASSEMBLE_PROTOCOL_VER_MISMATCH);
+		}
+
+		std::vector<std::uint32_t> ids;
+
+		entry const* ie = a->find_key("i");
+		if (ie && ie->type() == entry::string_t
+			&& ie->string().size() % 4 == 0
+			&& int(ie->string().size()) <= receipt_id_count * 4)
+		{
+			char const* ptr = ie->string().data();
+			char const* const end = ptr + ie->string().size();
+			while (ptr < end)
+			{
+				ids.push_back(aux::read_uint32(ptr));
+			}
+		}
+		else
+		{
+			return std::make_tuple(std::make_shared<basic_protocol>()
+				, api::ASSEMBLE_PROTOCOL_FORMAT_ERROR);
+		}
+
+		return std::make_tuple(
+			std::make_shared<relay_receipt_protocol>(version_str, name_str, ids)
 			, api::NO_ERROR);
 	}
 	else
@@ -12,6 +12,7 @@ see LICENSE file.
 
 #include "ip2/aux_/session_interface.hpp"
 #include "ip2/aux_/alert_manager.hpp" // for alert_manager
+#include "ip2/aux_/sha1_multi.hpp"
 
 #include "ip2/kademlia/node_id.hpp"
 
@@ -88,16 +89,24 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 		, m_self_pubkey, blob_uri, seg_count);
 	std::vector<sha1_hash> blob_seg_hashes;
 
-	// start putting the last blob segment
-	std::uint32_t begin = (seg_count - 1) * blob_seg_mtu;
-	std::uint32_t end = static_cast<std::uint32_t>(blob.size() - 1);
+	// the segments are independent messages, hash them all in one go in
+	// place. The payload is copied once into the entry.
+	std::vector<span<char const>> segs(seg_count);
+	for (std::uint32_t i = 0; i < seg_count; ++i)
+	{
+		std::ptrdiff_t const offset = std::ptrdiff_t(i) * blob_seg_mtu;
+		segs[i] = blob.subspan(offset, std::min(std::ptrdiff_t(blob_seg_mtu), blob.size() - offset));
+	}
+	std::vector<sha1_hash> seg_hashes(seg_count);
+	aux::sha1_multi(segs, seg_hashes);
 
-	std::string last_seg;
-	last_seg.append(blob.data() + begin, end - begin + 1);
-	sha1_hash last_seg_hash = hash(last_seg, end - begin + 1);
+	// start putting the last blob segment
+	span<char const> last_seg = segs[seg_count - 1];
+	sha1_hash last_seg_hash = seg_hashes[seg_count - 1];
 
-	protocol::blob_seg_protocol p(last_seg);
-	entry pl = p.to_entry();
+	// segments are content addressed, they are put unsigned as the raw
+	// bytes. Only the root index below is signed.
+	entry pl(std::string(last_seg.data(), std::size_t(last_seg.size())));
 	api::dht_rpc_params config = get_rpc_parmas(api::PUT);
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -105,8 +114,7 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 		, ctx->id(), hex_uri);
 #endif
 
-	api::error_code ok = m_session.transporter()->put(pl
-		, std::string(last_seg_hash.data(), 20)
+	api::error_code ok = m_session.transporter()->put_segment(std::move(pl)
 		, std::bind(&putter::put_callback, this, _1, _2, ctx, last_seg_hash, true)
 		, config.invoke_branch, config.invoke_window, config.invoke_limit);
 
@@ -129,18 +137,12 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 	// put left segments
 	while (seg_count > 0)
 	{
-		begin = (seg_count - 1) * blob_seg_mtu;
-		end = seg_count * blob_seg_mtu;
-
-		std::string seg;
-		seg.append(blob.data() + begin, blob_seg_mtu);
-		sha1_hash seg_hash = hash(seg, blob_seg_mtu);
+		span<char const> seg = segs[seg_count - 1];
+		sha1_hash seg_hash = seg_hashes[seg_count - 1];
 
-		protocol::blob_seg_protocol proto(seg);
-		entry e = proto.to_entry();
+		entry e(std::string(seg.data(), std::size_t(seg.size())));
 
-		api::error_code err = m_session.transporter()->put(e
-			, std::string(seg_hash.data(), 20) 
+		api::error_code err = m_session.transporter()->put_segment(std::move(e)
 			, std::bind(&putter::put_callback, this, _1, _2, ctx, seg_hash, true)
 			, config.invoke_branch, config.invoke_window, config.invoke_limit);
 
@@ -170,10 +172,10 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 		std::vector<sha1_hash> root_hashes;
 		ctx->get_root_index(root_hashes);
 		protocol::blob_index_protocol rip(root_hashes);
-		entry ripe = rip.to_entry();
+		entry ripe = std::move(rip).to_entry();
 		sha1_hash uri_hash(blob_uri.bytes.data());
 
-		api::error_code err = m_session.transporter()->put(ripe
+		api::error_code err = m_session.transporter()->put(std::move(ripe)
 			, std::string(uri_hash.data(), 20)
 			, std::bind(&putter::put_callback, this, _1, _2, ctx, uri_hash, false)
 			, config.invoke_branch, config.invoke_window, config.invoke_limit);
@@ -181,6 +183,27 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 		if (err == api::NO_ERROR)
 		{
 			ctx->add_invoked_hash(uri_hash, false);
+
+			// a relayed uri can carry a small blob itself, or the first
+			// hashes, for the receiver to start getting segments before the
+			// index arrives
+			if (m_recent_blobs.find(blob_uri) == m_recent_blobs.end())
+			{
+				m_recent_uris.push_back(blob_uri);
+				if (int(m_recent_uris.size()) > recent_blobs_limit)
+				{
+					m_recent_blobs.erase(m_recent_uris.front());
+					m_recent_uris.pop_front();
+				}
+			}
+			recent_blob& rb = m_recent_blobs[blob_uri];
+			std::size_t const hint_count = std::min(root_hashes.size()
+				, std::size_t(protocol::relay_uri_hint_count));
+			rb.hashes.assign(root_hashes.begin(), root_hashes.begin() + hint_count);
+			if (blob.size() <= protocol::relay_uri_inline_size)
+				rb.blob.assign(blob.data(), std::size_t(blob.size()));
+			else
+				rb.blob.clear();
         }
 		else
 		{
@@ -201,6 +224,19 @@ api::error_code putter::put_blob(span<char const> blob, aux::uri const& blob_uri
 	return api::NO_ERROR;
 }
 
+bool putter::relay_hint(aux::uri const& blob_uri, std::vector<sha1_hash>& hashes
+	, std::string& blob) const
+{
+	auto const it = m_recent_blobs.find(blob_uri);
+	if (it == m_recent_blobs.end()) return false;
+
+	if (it->second.blob.empty() && !it->second.hashes.empty())
+		hashes = it->second.hashes;
+	else
+		blob = it->second.blob;
+	return true;
+}
+
 void putter::update_node_id()
 {
 	sha256_hash node_id = dht::get_node_id(m_settings);
@@ -217,10 +253,14 @@ void putter::put_callback(dht::item const& it, int responses
 		{
 			api::dht_rpc_params config = get_rpc_parmas(api::PUT);
 
-			api::error_code err = m_session.transporter()->put(it.value()
-				, std::string(h.data(), 20)
-				, std::bind(&putter::put_callback, this, _1, _2, ctx, h, is_seg)
-				, config.invoke_branch, config.invoke_window, config.invoke_limit);
+			api::error_code err = is_seg
+				? m_session.transporter()->put_segment(it.value()
+					, std::bind(&putter::put_callback, this, _1, _2, ctx, h, is_seg)
+					, config.invoke_branch, config.invoke_window, config.invoke_limit)
+				: m_session.transporter()->put(it.value()
+					, std::string(h.data(), 20)
+					, std::bind(&putter::put_callback, this, _1, _2, ctx, h, is_seg)
+					, config.invoke_branch, config.invoke_window, config.invoke_limit);
 
 			if (err == api::NO_ERROR)
 			{
@@ -248,12 +288,6 @@ void putter::put_callback(dht::item const& it, int responses
 	}
 }
 
-sha1_hash putter::hash(std::string const& value, std::size_t value_size)
-{
-	hasher h(value.data(), value_size);
-	return h.final();
-}
-
 sha1_hash putter::hash(std::vector<sha1_hash> const& hl)
 {
 	hasher h;
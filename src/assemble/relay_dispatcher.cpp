@@ -41,8 +41,12 @@ void relay_dispatcher::on_dht_relay(dht::public_key const& from, entry const& pa
 		std::shared_ptr<protocol::relay_uri_protocol> rup
 			= std::dynamic_pointer_cast<protocol::relay_uri_protocol>(bp);
 
+		// an inlined blob is only taken from the sender of the uri itself,
+		// nobody else can vouch for it
+		static std::string const no_blob;
 		m_getter.on_incoming_relay_uri(rup->pk()
-			, rup->blob_uri(), rup->ts());
+			, rup->blob_uri(), rup->ts(), rup->seg_hashes()
+			, from == rup->pk() ? rup->blob() : no_blob);
 	}
 	else if (strncmp(bp->get_name().c_str(), protocol::relay_msg_protocol::name.c_str()
 			, 1) == 0)
@@ -50,7 +54,15 @@ void relay_dispatcher::on_dht_relay(dht::public_key const& from, entry const& pa
 		std::shared_ptr<protocol::relay_msg_protocol> rmp
 			= std::dynamic_pointer_cast<protocol::relay_msg_protocol>(bp);
 
-		m_relayer.on_incoming_relay_message(from, rmp->msg());
+		m_relayer.on_incoming_relay_message(from, rmp->msg(), rmp->has_id(), rmp->id());
+	}
+	else if (strncmp(bp->get_name().c_str(), protocol::relay_receipt_protocol::name.c_str()
+			, 1) == 0)
+	{
+		std::shared_ptr<protocol::relay_receipt_protocol> rrp
+			= std::dynamic_pointer_cast<protocol::relay_receipt_protocol>(bp);
+
+		m_relayer.on_incoming_relay_receipt(from, rrp->ids());
 	}
 	else
 	{
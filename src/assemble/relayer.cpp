@@ -20,6 +20,10 @@ see LICENSE file.
 #endif
 
 #include "ip2/hasher.hpp"
+#include "ip2/settings_pack.hpp"
+#include "ip2/aux_/random.hpp"
+#include "ip2/aux_/session_settings.hpp"
+#include "ip2/aux_/time.hpp"
 
 using namespace std::placeholders;
 using namespace ip2::assemble::protocol;
@@ -38,10 +42,16 @@ relayer::relayer(io_context& ios
 	, m_settings(settings)
 	, m_counters(cnt)
 	, m_logger(logger)
+	, m_timer(ios)
 {
 	update_node_id();
 }
 
+relayer::~relayer()
+{
+	m_timer.cancel();
+}
+
 void relayer::update_node_id()
 {
 	sha256_hash node_id = dht::get_node_id(m_settings);
@@ -92,6 +102,32 @@ api::error_code relayer::relay_message(dht::public_key const& receiver
 
 	std::shared_ptr<relay_context> ctx = std::make_shared<relay_context>(m_logger, receiver);
 
+	if (m_settings.get_bool(settings_pack::relay_receipts))
+	{
+		std::uint32_t id = aux::random(0xffffffff);
+		while (m_unacked.find(id) != m_unacked.end()) id = aux::random(0xffffffff);
+
+		unacked_message& um = m_unacked[id];
+		um.receiver = receiver;
+		um.msg.assign(message.data(), std::size_t(message.size()));
+		um.ctx = ctx;
+
+		api::error_code ok = send_tracked(id);
+		if (ok != api::NO_ERROR)
+		{
+			m_unacked.erase(id);
+			ctx->set_error(ok);
+			ctx->done();
+
+			return ok;
+		}
+
+		ctx->start_relay();
+		start_timer();
+
+		return api::NO_ERROR;
+	}
+
 	protocol::relay_msg_protocol p(std::string(message.data(), message.size()));
 	entry pl = p.to_entry();
 	api::dht_rpc_params config = get_rpc_parmas(api::RELAY);
@@ -118,7 +154,8 @@ api::error_code relayer::relay_message(dht::public_key const& receiver
 }
 
 api::error_code relayer::relay_uri(dht::public_key const& receiver
-	, aux::uri const& data_uri, dht::timestamp ts)
+	, aux::uri const& data_uri, dht::timestamp ts
+	, std::vector<sha1_hash> const& seg_hashes, std::string const& blob)
 {
 #ifndef TORRENT_DISABLE_LOGGING
 	char hex_uri[41];
@@ -153,7 +190,9 @@ api::error_code relayer::relay_uri(dht::public_key const& receiver
 	std::shared_ptr<relay_context> ctx = std::make_shared<relay_context>(m_logger
 		, receiver, data_uri, ts);
 
-	protocol::relay_uri_protocol p(m_self_pubkey, data_uri, ts);
+	protocol::relay_uri_protocol p(m_self_pubkey, data_uri, ts
+		, blob.empty() ? seg_hashes : std::vector<sha1_hash>());
+	if (!blob.empty()) p.inline_blob(blob);
 	entry pl = p.to_entry();
 	api::dht_rpc_params config = get_rpc_parmas(api::RELAY);
 
@@ -179,12 +218,148 @@ api::error_code relayer::relay_uri(dht::public_key const& receiver
 	}
 }
 
-void relayer::on_incoming_relay_message(dht::public_key const& pk, std::string const& msg)
+api::error_code relayer::send_tracked(std::uint32_t const id)
+{
+	unacked_message& um = m_unacked[id];
+
+	protocol::relay_msg_protocol p(um.msg);
+	p.set_id(id);
+	entry pl = std::move(p).to_entry();
+	api::dht_rpc_params config = get_rpc_parmas(api::RELAY);
+
+	// the receipt tells whether the message arrived, one relay node taking
+	// it is enough. Whatever the traversal reports is of no interest
+	api::error_code ok = m_session.transporter()->send(um.receiver, pl
+		, [](entry const&, std::vector<std::pair<dht::node_entry, bool>> const&) {}
+		, config.invoke_branch, config.invoke_window
+		, config.invoke_limit, 1);
+
+	// a failed send counts as well, it's tried again like a lost one
+	++um.sends;
+	um.next_send = aux::time_now() + seconds(2 << (um.sends - 1));
+
+#ifndef TORRENT_DISABLE_LOGGING
+	m_logger.log(aux::LOG_INFO, "[%u] send message %u, times:%d, err:%d"
+		, um.ctx->id(), id, um.sends, ok);
+#endif
+
+	return ok;
+}
+
+void relayer::on_incoming_relay_message(dht::public_key const& pk, std::string const& msg
+	, bool const has_id, std::uint32_t const id)
 {
+	if (has_id)
+	{
+		// acknowledge it even if we had it already, the receipt may have
+		// been lost
+		auto& ids = m_receipts[pk];
+		ids.push_back(id);
+		if (int(ids.size()) >= protocol::receipt_id_count)
+			send_receipts(pk);
+		else
+			start_timer();
+
+		auto const key = std::make_pair(pk, id);
+		if (!m_received.insert(key).second) return;
+
+		m_received_order.push_back(key);
+		if (int(m_received_order.size()) > received_ids_limit)
+		{
+			m_received.erase(m_received_order.front());
+			m_received_order.pop_front();
+		}
+	}
+
 	// post 'incoming_relay_alert'
 	m_session.alerts().emplace_alert<incoming_relay_message_alert>(pk.bytes.data(), msg);
 }
 
+void relayer::on_incoming_relay_receipt(dht::public_key const& pk
+	, std::vector<std::uint32_t> const& ids)
+{
+	for (auto const id : ids)
+	{
+		auto const it = m_unacked.find(id);
+		if (it == m_unacked.end() || !(it->second.receiver == pk)) continue;
+
+		std::shared_ptr<relay_context> ctx = it->second.ctx;
+		ctx->done();
+
+		// post 'relay_message_alert'
+		dht::public_key receiver = ctx->get_receiver();
+		m_session.alerts().emplace_alert<relay_message_alert>(receiver.bytes.data()
+			, ctx->get_error());
+
+		m_unacked.erase(it);
+	}
+}
+
+void relayer::send_receipts(dht::public_key const& pk)
+{
+	auto const it = m_receipts.find(pk);
+	if (it == m_receipts.end()) return;
+
+	protocol::relay_receipt_protocol p(it->second);
+	entry pl = std::move(p).to_entry();
+	m_receipts.erase(it);
+
+	api::dht_rpc_params config = get_rpc_parmas(api::RELAY);
+
+	// a lost receipt just means the message is sent again
+	m_session.transporter()->send(pk, pl
+		, [](entry const&, std::vector<std::pair<dht::node_entry, bool>> const&) {}
+		, config.invoke_branch, config.invoke_window
+		, config.invoke_limit, 1);
+}
+
+void relayer::start_timer()
+{
+	if (m_timer_active) return;
+	m_timer_active = true;
+
+	m_timer.expires_after(milliseconds(200));
+	m_timer.async_wait(std::bind(&relayer::on_timer, this, _1));
+}
+
+void relayer::on_timer(ip2::error_code const& ec)
+{
+	if (ec) return;
+	m_timer_active = false;
+
+	while (!m_receipts.empty())
+		send_receipts(m_receipts.begin()->first);
+
+	time_point const now = aux::time_now();
+	for (auto it = m_unacked.begin(); it != m_unacked.end();)
+	{
+		unacked_message& um = it->second;
+		if (um.next_send > now)
+		{
+			++it;
+			continue;
+		}
+
+		if (um.sends < relay_send_limit)
+		{
+			send_tracked(it->first);
+			++it;
+			continue;
+		}
+
+		um.ctx->set_error(api::RELAY_NOT_ACKNOWLEDGED);
+		um.ctx->done();
+
+		// post 'relay_message_alert'
+		m_session.alerts().emplace_alert<relay_message_alert>(um.receiver.bytes.data()
+			, um.ctx->get_error());
+
+		it = m_unacked.erase(it);
+	}
+
+	if (!m_unacked.empty() || !m_receipts.empty()) start_timer();
+}
+
 void relayer::send_message_callback(entry const& payload
 	, std::vector<std::pair<dht::node_entry, bool>> const& nodes
 	, std::shared_ptr<relay_context> ctx)
@@ -27,6 +27,85 @@ namespace ip2::blockchain {
         }
     }
 
+    const transaction &block::tx() const {
+        static const transaction empty_tx;
+        if (m_txs.empty())
+            return empty_tx;
+
+        return m_txs.front();
+    }
+
+    bool block::verify_tx_merkle_root() const {
+        if (m_version != block_version2)
+            return true;
+
+        return m_tx_merkle_root == calculate_tx_merkle_root(m_txs);
+    }
+
+    sha1_hash block::calculate_tx_merkle_root(const std::vector<transaction> &txs) {
+        if (txs.empty())
+            return sha1_hash();
+
+        std::vector<sha1_hash> level;
+        level.reserve(txs.size());
+        for (auto const& tx: txs) {
+            level.push_back(tx.sha1());
+        }
+
+        while (level.size() > 1) {
+            std::vector<sha1_hash> parents;
+            parents.reserve((level.size() + 1) / 2);
+            for (std::size_t i = 0; i < level.size(); i += 2) {
+                auto const& left = level[i];
+                // odd node is paired with itself
+                auto const& right = (i + 1 < level.size()) ? level[i + 1] : level[i];
+                hasher h(left);
+                h.update(right);
+                parents.push_back(h.final());
+            }
+            level = std::move(parents);
+        }
+
+        return level.front();
+    }
+
+    std::string block::get_txs_encode() const {
+        std::string encode;
+        if (m_txs.empty())
+            return encode;
+
+        if (m_version == block_version2) {
+            entry::list_type lst;
+            for (auto const& tx: m_txs) {
+                lst.push_back(tx.get_entry());
+            }
+            bencode(std::back_inserter(encode), entry(lst));
+        } else {
+            encode = m_txs.front().get_encode();
+        }
+
+        return encode;
+    }
+
+    std::vector<transaction> block::txs_from_encode(block_version version, const std::string &encode) {
+        std::vector<transaction> txs;
+        if (encode.empty())
+            return txs;
+
+        if (version == block_version2) {
+            entry e = bdecode(encode);
+            if (e.type() == entry::list_t) {
+                for (auto const& tx_entry: e.list()) {
+                    txs.emplace_back(tx_entry);
+                }
+            }
+        } else {
+            txs.emplace_back(encode);
+        }
+
+        return txs;
+    }
+
     entry block::get_entry() const {
         auto e = get_entry_without_signature();
         // signature
@@ -100,9 +179,18 @@ namespace ip2::blockchain {
         lst.push_back(m_multiplex_hash.to_string());
         // miner
         lst.push_back(std::string(m_miner.bytes.begin(), m_miner.bytes.end()));
-        if (!m_tx.empty()) {
+        if (m_version == block_version2) {
+            // tx merkle root
+            lst.push_back(m_tx_merkle_root.to_string());
+            // txs
+            entry::list_type tx_list;
+            for (auto const& tx: m_txs) {
+                tx_list.push_back(tx.get_entry());
+            }
+            lst.push_back(tx_list);
+        } else if (!m_txs.empty()) {
             // tx
-            lst.push_back(m_tx.get_entry());
+            lst.push_back(m_txs.front().get_entry());
         }
 
         return lst;
@@ -163,21 +251,56 @@ namespace ip2::blockchain {
             // miner
             m_miner = dht::public_key(lst[9].string().data());
             // tx
-            m_tx = transaction(lst[10]);
+            m_txs.emplace_back(lst[10]);
             // signature
             m_signature = dht::signature(lst[11].string().data());
         }
+
+        if (lst.size() == 13) {
+            // chain id
+            auto chain_id = lst[0].string();
+            m_chain_id = aux::bytes(chain_id.begin(), chain_id.end());
+            // version
+            int version = aux::intFromLittleEndianString(lst[1].string());
+            m_version = static_cast<block_version>(version);
+            // timestamp
+            m_timestamp = aux::int64FromLittleEndianString(lst[2].string());
+            // block number
+            m_block_number = aux::int64FromLittleEndianString(lst[3].string());
+            // previous block hash
+            m_previous_block_hash = sha1_hash(lst[4].string().data());
+            // base target
+            m_base_target = aux::uint64FromLittleEndianString(lst[5].string());
+            // cumulative difficulty
+            m_cumulative_difficulty = aux::uint64FromLittleEndianString(lst[6].string());
+            // generation signature
+            m_generation_signature = sha1_hash(lst[7].string().data());
+            // multiplex hash
+            m_multiplex_hash = sha1_hash(lst[8].string().data());
+            // miner
+            m_miner = dht::public_key(lst[9].string().data());
+            // tx merkle root
+            m_tx_merkle_root = sha1_hash(lst[10].string().data());
+            // txs
+            if (lst[11].type() == entry::list_t) {
+                for (auto const& tx_entry: lst[11].list()) {
+                    m_txs.emplace_back(tx_entry);
+                }
+            }
+            // signature
+            m_signature = dht::signature(lst[12].string().data());
+        }
     }
 
     std::set<dht::public_key> block::get_block_peers() const {
         std::set<dht::public_key> peers;
         peers.insert(m_miner);
-        if (!m_tx.empty()) {
-            if (m_tx.type() == tx_type::type_transfer) {
-                peers.insert(m_tx.sender());
-                peers.insert(m_tx.receiver());
-            } else if (m_tx.type() == tx_type::type_note) {
-                peers.insert(m_tx.sender());
+        for (auto const& tx: m_txs) {
+            if (tx.type() == tx_type::type_transfer) {
+                peers.insert(tx.sender());
+                peers.insert(tx.receiver());
+            } else if (tx.type() == tx_type::type_note) {
+                peers.insert(tx.sender());
             }
         }
 
@@ -197,8 +320,14 @@ namespace ip2::blockchain {
            << aux::toHex(block.m_previous_block_hash.to_string()) << " m_base_target: " << block.m_base_target
            << " m_cumulative_difficulty: " << block.m_cumulative_difficulty << " m_generation_signature: "
            << aux::toHex(block.m_generation_signature.to_string()) << " multiplex hash: "
-           << aux::toHex(block.m_multiplex_hash.to_string()) << " m_tx: " << block.m_tx
-           << " m_miner: " << aux::toHex(block.m_miner.bytes);
+           << aux::toHex(block.m_multiplex_hash.to_string()) << " m_miner: " << aux::toHex(block.m_miner.bytes);
+        if (block.m_version == block_version2) {
+            os << " m_tx_merkle_root: " << aux::toHex(block.m_tx_merkle_root.to_string())
+               << " tx size: " << block.m_txs.size();
+        }
+        for (auto const& tx: block.m_txs) {
+            os << " m_tx: " << tx;
+        }
         return os;
     }
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ see LICENSE file.
 #include <utility>
 
 #include "ip2/blockchain/blockchain.hpp"
+#include "ip2/blockchain/chain_reader.hpp"
 #include "ip2/blockchain/consensus.hpp"
 #include "ip2/common/entry_type.hpp"
 #include "ip2/kademlia/dht_tracker.hpp"
@@ -30,9 +31,10 @@ namespace ip2::blockchain {
             }
 
             // get all chains
-            m_chains = m_repository->get_all_chains();
-            for (auto const& chain_id: m_chains) {
-                m_chain_connected[chain_id] = false;
+            for (auto const& chain_id: m_repository->get_all_chains()) {
+                auto &ctx = chain(chain_id);
+                ctx.m_followed = true;
+                ctx.m_connected = false;
             }
         } catch (std::exception &e) {
             log(LOG_ERR, "Exception init [CHAIN] %s in file[%s], func[%s], line[%d]", e.what(), __FILE__, __FUNCTION__ , __LINE__);
@@ -50,11 +52,16 @@ namespace ip2::blockchain {
             return false;
         }
 
-        for (auto const& chain_id: m_chains) {
+        for (std::size_t i = 0; i < m_chain_contexts.size(); i++) {
+            auto *ctx = m_chain_contexts[i].get();
+            if (ctx == nullptr || !ctx->m_followed)
+                continue;
+            auto const chain_id = ctx->m_chain_id;
             try {
                 if (!init_chain(chain_id)) {
                     log(LOG_ERR, "INFO: Init chain[%s] fail", aux::toHex(chain_id).c_str());
-                    m_chain_connected[chain_id] = true;
+                    ctx->m_connected = true;
+                    publish_head_block(*ctx);
                     return false;
                 }
             } catch(std::exception &e) {
@@ -80,17 +87,18 @@ namespace ip2::blockchain {
 
         m_refresh_timer.cancel();
 
-        for (auto& timer: m_chain_timers) {
-            timer.second.cancel();
+        for (auto const& ctx: m_chain_contexts) {
+            if (ctx) ctx->m_timer.cancel();
         }
 
         m_dht_tasks_timer.cancel();
 
-        for (auto const& chain_id: m_chains) {
-            m_repository->clear_acl_db(chain_id);
-            auto const &acl = m_access_list[chain_id];
-            for (auto const& item: acl) {
-                m_repository->add_peer_in_acl_db(chain_id, item.first);
+        for (auto const& ctx: m_chain_contexts) {
+            if (!ctx || !ctx->m_followed)
+                continue;
+            m_repository->clear_acl_db(ctx->m_chain_id);
+            for (auto const& item: ctx->m_access_list) {
+                m_repository->add_peer_in_acl_db(ctx->m_chain_id, item.first);
             }
         }
 
@@ -122,8 +130,8 @@ namespace ip2::blockchain {
 
 //        m_refresh_timer.cancel();
 
-        for (auto& timer: m_chain_timers) {
-            timer.second.cancel();
+        for (auto const& ctx: m_chain_contexts) {
+            if (ctx) ctx->m_timer.cancel();
         }
     }
 
@@ -154,7 +162,8 @@ namespace ip2::blockchain {
     }
 
     bool blockchain::followChain(const aux::bytes &chain_id, const std::set<dht::public_key>& peers) {
-        if (m_chains.find(chain_id) != m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx != nullptr && ctx->m_followed) {
             log(LOG_INFO, "INFO: Already followed chain[%s]", aux::toHex(chain_id).c_str());
             return true;
         }
@@ -179,14 +188,15 @@ namespace ip2::blockchain {
                 log(LOG_ERR, "INFO: Add new chain[%s] fail", aux::toHex(chain_id).c_str());
                 return false;
             }
-            m_chains.insert(chain_id);
+            chain(chain_id).m_followed = true;
 
             if (!init_chain(chain_id)) {
                 log(LOG_ERR, "INFO: Init chain[%s] fail", aux::toHex(chain_id).c_str());
                 return false;
             }
 
-            m_chain_connected[chain_id] = false;
+            chain(chain_id).m_connected = false;
+            publish_head_block(chain(chain_id));
 
             // connect chain
             connect_chain(chain_id);
@@ -198,12 +208,13 @@ namespace ip2::blockchain {
     }
 
     bool blockchain::add_new_bootstrap_peers(const aux::bytes &chain_id, const std::set<dht::public_key> &peers) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return false;
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return false;
         }
@@ -222,8 +233,10 @@ namespace ip2::blockchain {
     bool blockchain::unfollowChain(const aux::bytes &chain_id) {
         log(LOG_INFO, "INFO: Unfollow chain:%s", aux::toHex(chain_id).c_str());
 
-        if (m_chains.find(chain_id) != m_chains.end()) {
-            m_chains.erase(chain_id);
+        auto *ctx = find_chain(chain_id);
+        if (ctx != nullptr && ctx->m_followed) {
+            ctx->m_followed = false;
+            publish_head_block(*ctx);
 
             // remove chain id from db
             if (!m_repository->delete_chain(chain_id)) {
@@ -256,10 +269,7 @@ namespace ip2::blockchain {
             }
 
             // cancel
-            auto it_chain_timer = m_chain_timers.find(chain_id);
-            if (it_chain_timer != m_chain_timers.end()) {
-                it_chain_timer->second.cancel();
-            }
+            ctx->m_timer.cancel();
 //            auto it_chain_status_timer = m_chain_status_timers.find(chain_id);
 //            if (it_chain_status_timer != m_chain_status_timers.end()) {
 //                it_chain_status_timer->second.cancel();
@@ -278,7 +288,7 @@ namespace ip2::blockchain {
         if (peers.size() < blockchain_acl_max_peers) {
             if (!is_empty_chain(chain_id)) {
                 // get 8 peers from miner
-                auto blk = m_head_blocks[chain_id];
+                auto blk = chain(chain_id).m_head_block;
                 for (int i = 0; i < CHAIN_EPOCH_BLOCK_SIZE; i++) {
                     log(LOG_INFO, "INFO: chain[%s] acl block[%s]",
                         aux::toHex(chain_id).c_str(), blk.to_string().c_str());
@@ -333,12 +343,13 @@ namespace ip2::blockchain {
         } else {
             short_chain_id = chain_id;
         }
-        m_short_chain_id_table[short_chain_id] = chain_id;
+        auto &ctx = chain(chain_id);
+        m_short_chain_id_table[short_chain_id] = m_chain_handles[chain_id];
 
-        m_chain_getting_times[chain_id] = 0;
+        ctx.m_getting_times = 0;
 
         // create tx pool
-        m_tx_pools[chain_id] = tx_pool(m_repository.get());
+        ctx.m_tx_pool = tx_pool(m_repository.get());
 
         // TODO: remove in the future
         if (!m_repository->create_acl_db(chain_id)) {
@@ -350,7 +361,7 @@ namespace ip2::blockchain {
         // load head/tail/consensus block
         auto head_block = m_repository->get_head_block(chain_id);
         if (!head_block.empty()) {
-            m_head_blocks[chain_id] = head_block;
+            set_head_block(chain_id, head_block);
             log(LOG_INFO, "INFO: Head block: %s", head_block.to_string().c_str());
         }
 
@@ -360,7 +371,8 @@ namespace ip2::blockchain {
     bool blockchain::connect_chain(const aux::bytes &chain_id) {
         log(LOG_INFO, "INFO: connect chain[%s]", aux::toHex(chain_id).c_str());
 
-        if (!m_chain_connected[chain_id]) {
+        auto &ctx = chain(chain_id);
+        if (!ctx.m_connected) {
             peer_preparation(chain_id);
 
 //        get_pool_from_peer(chain_id, *m_ses.pubkey());
@@ -375,22 +387,17 @@ namespace ip2::blockchain {
 //            i->second.async_wait(std::bind(&blockchain::refresh_chain_status, self(), _1, chain_id));
 //        }
 
-            // create chain timer
-            m_chain_timers.emplace(chain_id, aux::deadline_timer(m_ioc));
             // start mining
-            auto it = m_chain_timers.find(chain_id);
-            if (it != m_chain_timers.end()) {
-                it->second.expires_after(milliseconds(150));
-                it->second.async_wait(std::bind(&blockchain::refresh_mining_timeout, self(), _1, chain_id));
-            }
+            ctx.m_timer.expires_after(milliseconds(150));
+            ctx.m_timer.async_wait(std::bind(&blockchain::refresh_mining_timeout, self(), _1, chain_id));
 
-            m_chain_connected[chain_id] = true;
+            ctx.m_connected = true;
+            publish_head_block(ctx);
         }
 
         send_online_signal(chain_id);
 
-        auto const& acl = m_access_list[chain_id];
-        for (auto const& item: acl) {
+        for (auto const& item: ctx.m_access_list) {
             // get note tx
             get_note_pool_root(chain_id, item.first, 0);
         }
@@ -531,28 +538,78 @@ namespace ip2::blockchain {
         return total_microseconds(system_clock::now().time_since_epoch());
     }
 
+    chain_context *blockchain::find_chain(const aux::bytes &chain_id) {
+        auto it = m_chain_handles.find(chain_id);
+        if (it == m_chain_handles.end())
+            return nullptr;
+
+        return m_chain_contexts[it->second].get();
+    }
+
+    chain_context &blockchain::chain(const aux::bytes &chain_id) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx != nullptr)
+            return *ctx;
+
+        chain_handle handle;
+        if (!m_free_chain_handles.empty()) {
+            handle = m_free_chain_handles.back();
+            m_free_chain_handles.pop_back();
+        } else {
+            handle = static_cast<chain_handle>(m_chain_contexts.size());
+            m_chain_contexts.emplace_back();
+        }
+
+        m_chain_contexts[handle] = std::make_unique<chain_context>(m_ioc, chain_id);
+        m_chain_handles[chain_id] = handle;
+
+        return *m_chain_contexts[handle];
+    }
+
+    chain_context *blockchain::chain_at(chain_handle handle) {
+        if (handle >= m_chain_contexts.size())
+            return nullptr;
+
+        return m_chain_contexts[handle].get();
+    }
+
+    void blockchain::remove_chain(const aux::bytes &chain_id) {
+        auto it = m_chain_handles.find(chain_id);
+        if (it == m_chain_handles.end())
+            return;
+
+        auto const handle = it->second;
+        for (auto i = m_short_chain_id_table.begin(); i != m_short_chain_id_table.end();) {
+            if (i->second == handle)
+                i = m_short_chain_id_table.erase(i);
+            else
+                ++i;
+        }
+
+        m_chain_contexts[handle].reset();
+        m_free_chain_handles.push_back(handle);
+        m_chain_handles.erase(it);
+    }
+
     void blockchain::clear_all_cache() {
-        m_chains.clear();
-        m_tx_pools.clear();
 //        m_chain_status.clear();
-        m_chain_timers.clear();
 //        m_chain_status_timers.clear();
-        m_access_list.clear();
 //        m_blocks.clear();
-        m_head_blocks.clear();
+        m_chain_contexts.clear();
+        m_free_chain_handles.clear();
+        m_chain_handles.clear();
+        m_short_chain_id_table.clear();
+        if (auto reader = m_ses.chain_reader())
+            reader->clear_head_blocks();
 //        m_gossip_peers.clear();
     }
 
     void blockchain::clear_chain_cache(const aux::bytes &chain_id) {
-//        m_chains.erase(chain_id);
-        m_tx_pools[chain_id].clear();
-        m_chain_connected.erase(chain_id);
 //        m_chain_status.erase(chain_id);
-        m_chain_timers.erase(chain_id);
 //        m_chain_status_timers.erase(chain_id);
-        m_access_list.erase(chain_id);
 //        m_blocks[chain_id].clear();
-        m_head_blocks.erase(chain_id);
+        remove_head_block(chain_id);
+        remove_chain(chain_id);
 //        m_gossip_peers[chain_id].clear();
     }
 
@@ -571,8 +628,9 @@ namespace ip2::blockchain {
         try {
             bool found = false;
             // 随机挑选一条
-            for (auto const &chain_id: m_chains) {
-                if (!m_chain_connected[chain_id]) {
+            for (auto const &ctx: m_chain_contexts) {
+                if (ctx && ctx->m_followed && !ctx->m_connected) {
+                    auto const chain_id = ctx->m_chain_id;
                     log(LOG_INFO, "INFO: Select chain:%s", aux::toHex(chain_id).c_str());
                     connect_chain(chain_id);
 
@@ -691,6 +749,11 @@ namespace ip2::blockchain {
         try {
 //            log(LOG_INFO, "INFO: 1. Chain[%s] status[%d]", aux::toHex(chain_id).c_str(), m_chain_status[chain_id]);
 
+            // the chain has been unfollowed since the timer was set
+            auto *ctx = find_chain(chain_id);
+            if (ctx == nullptr)
+                return;
+
             long refresh_time = DEFAULT_BLOCK_TIME * 1000;
 
             if (!m_pause) {
@@ -700,7 +763,7 @@ namespace ip2::blockchain {
                         dht::secret_key *sk = m_ses.serkey();
                         dht::public_key *pk = m_ses.pubkey();
 
-                        const auto &head_block = m_head_blocks[chain_id];
+                        const auto &head_block = ctx->m_head_block;
                         log(LOG_INFO, "INFO: chain id[%s] head block[%s]",
                             aux::toHex(chain_id).c_str(), head_block.to_string().c_str());
 
@@ -733,10 +796,22 @@ namespace ip2::blockchain {
 
                         std::int64_t current_time = get_total_milliseconds() / 1000; // second
                         if (current_time >= head_block.timestamp() + interval) {
-                            transaction tx = m_tx_pools[chain_id].get_best_fee_transaction();
+                            // version 2 blocks only once the chain reaches the activation height
+                            auto const version = head_block.block_number() + 1 >= BLOCK_VERSION2_ACTIVATION_HEIGHT
+                                    ? block_version::block_version2 : block_version::block_version1;
+                            std::vector<transaction> txs;
+                            if (version == block_version::block_version2) {
+                                txs = ctx->m_tx_pool.get_block_transactions(MAX_BLOCK_TX_NUM, MAX_BLOCK_TXS_ENCODE_SIZE);
+                            } else {
+                                transaction tx = ctx->m_tx_pool.get_best_fee_transaction();
 
-                            if (tx.empty()) {
-                                tx = m_tx_pools[chain_id].get_latest_note_transaction();
+                                if (tx.empty()) {
+                                    tx = ctx->m_tx_pool.get_latest_note_transaction();
+                                }
+
+                                if (!tx.empty()) {
+                                    txs.push_back(tx);
+                                }
                             }
 
 //                            auto ep = m_ses.external_udp_endpoint();
@@ -747,9 +822,9 @@ namespace ip2::blockchain {
                                 get_genesis_state(chain_id, stateRoot, stateArrays);
                                 log(LOG_INFO, "INFO chain[%s] genesis block state root[%s]",
                                     aux::toHex(chain_id).c_str(), aux::toHex(stateRoot).c_str());
-                                block b = block(chain_id, block_version::block_version1, current_time,
+                                block b = block(chain_id, version, current_time,
                                           head_block.block_number() + 1, head_block.sha1(), base_target,
-                                          cumulative_difficulty, genSig, stateRoot, tx, *pk);
+                                          cumulative_difficulty, genSig, stateRoot, txs, *pk);
 
                                 b.sign(*pk, *sk);
 
@@ -759,9 +834,9 @@ namespace ip2::blockchain {
 
                                 process_genesis_block(chain_id, b, stateArrays);
                             } else if (head_block.block_number() % CHAIN_EPOCH_BLOCK_SIZE == 0) {
-                                block b = block(chain_id, block_version::block_version1, current_time,
+                                block b = block(chain_id, version, current_time,
                                                 head_block.block_number() + 1, head_block.sha1(), base_target,
-                                                cumulative_difficulty, genSig, head_block.sha1(), tx, *pk);
+                                                cumulative_difficulty, genSig, head_block.sha1(), txs, *pk);
 
                                 b.sign(*pk, *sk);
 
@@ -771,9 +846,9 @@ namespace ip2::blockchain {
 
                                 process_block(chain_id, b);
                             } else {
-                                block b = block(chain_id, block_version::block_version1, current_time,
+                                block b = block(chain_id, version, current_time,
                                           head_block.block_number() + 1, head_block.sha1(), base_target,
-                                          cumulative_difficulty, genSig, head_block.multiplex_hash(), tx, *pk);
+                                          cumulative_difficulty, genSig, head_block.multiplex_hash(), txs, *pk);
 
                                 b.sign(*pk, *sk);
 
@@ -791,7 +866,7 @@ namespace ip2::blockchain {
                             refresh_time = (head_block.timestamp() + interval - current_time) * 1000;
                         }
                     } else {
-                        if (m_chain_getting_times[chain_id] >= blockchain_max_getting_times) {
+                        if (ctx->m_getting_times >= blockchain_max_getting_times) {
                             m_ses.alerts().emplace_alert<blockchain_fail_to_get_chain_data_alert>(chain_id);
                             return;
                         }
@@ -799,7 +874,7 @@ namespace ip2::blockchain {
                         // select peer randomly to get chain data
                         auto peer = m_repository->get_peer_from_peer_db_randomly(chain_id);
 
-                        m_chain_getting_times[chain_id]++;
+                        ctx->m_getting_times++;
 
                         if (!peer.is_all_zeros()) {
                             get_head_block_from_peer(chain_id, peer);
@@ -817,17 +892,16 @@ namespace ip2::blockchain {
             }
 
             log(LOG_INFO, "refresh time:%ld ", refresh_time);
-            auto it = m_chain_timers.find(chain_id);
-            if (it != m_chain_timers.end()) {
-                it->second.expires_after(milliseconds(refresh_time));
-                it->second.async_wait(std::bind(&blockchain::refresh_mining_timeout, self(), _1, chain_id));
+            if (ctx->m_connected) {
+                ctx->m_timer.expires_after(milliseconds(refresh_time));
+                ctx->m_timer.async_wait(std::bind(&blockchain::refresh_mining_timeout, self(), _1, chain_id));
             }
         } catch (std::exception &e) {
             log(LOG_ERR, "Exception init [CHAIN] %s in file[%s], func[%s], line[%d]", e.what(), __FILE__, __FUNCTION__ , __LINE__);
         }
     }
 
-    RESULT blockchain::verify_block(const aux::bytes &chain_id, const block &b, const block &previous_block) {
+    RESULT blockchain::verify_block(const aux::bytes &chain_id, const block &b, const block &previous_block, repository &repo) {
 
         if (b.empty()) {
             log(LOG_ERR, "INFO chain[%s] block is empty", aux::toHex(chain_id).c_str());
@@ -860,7 +934,7 @@ namespace ip2::blockchain {
         if (previous_block.block_number() % CHAIN_EPOCH_BLOCK_SIZE > 3) {
             int i = 3;
             while (i > 0) {
-                ancestor = m_repository->get_block_by_hash(chain_id, previous_hash);
+                ancestor = repo.get_block_by_hash(chain_id, previous_hash);
                 if (ancestor.empty()) {
                     log(LOG_INFO, "INFO chain[%s] 2. Cannot find block[%s] in db, previous_block[%s]",
                         aux::toHex(chain_id).c_str(), aux::toHex(previous_hash.to_string()).c_str(), previous_block.to_string().c_str());
@@ -873,7 +947,7 @@ namespace ip2::blockchain {
         }
 
         auto base_target = consensus::calculate_required_base_target(previous_block, ancestor);
-        auto act = m_repository->get_account(chain_id, b.miner());
+        auto act = repo.get_account(chain_id, b.miner());
 
         log(LOG_INFO, "INFO chain[%s] Account[%s] in db",aux::toHex(chain_id).c_str(), act.to_string().c_str());
 
@@ -914,31 +988,80 @@ namespace ip2::blockchain {
 //            return FAIL;
 //        }
 
-        std::map<dht::public_key, std::int64_t> peers_balance;
-        std::map<dht::public_key, std::int64_t> peers_nonce;
+        auto const& txs = b.txs();
+        if (b.version() == block_version2) {
+            if (b.block_number() < BLOCK_VERSION2_ACTIVATION_HEIGHT) {
+                log(LOG_ERR, "INFO chain[%s] block[%s] version 2 before activation height",
+                    aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str());
+                return FAIL;
+            }
 
-        auto const& tx = b.tx();
+            std::size_t txs_size = 0;
+            for (auto const& tx: txs) {
+                txs_size += tx.get_encode_size();
+            }
 
-        if (!tx.empty()) {
+            if (txs.size() > MAX_BLOCK_TX_NUM || txs_size > MAX_BLOCK_TXS_ENCODE_SIZE) {
+                log(LOG_ERR, "INFO chain[%s] block[%s] has too many txs:%zu",
+                    aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str(), txs.size());
+                return FAIL;
+            }
+
+            if (!b.verify_tx_merkle_root()) {
+                log(LOG_ERR, "INFO chain[%s] block[%s] tx merkle root mismatch",
+                    aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str());
+                return FAIL;
+            }
+        } else if (b.version() != block_version1) {
+            log(LOG_ERR, "INFO chain[%s] block[%s] unknown version:%d",
+                aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str(), int(b.version()));
+            return FAIL;
+        } else if (txs.size() > 1) {
+            log(LOG_ERR, "INFO chain[%s] block[%s] version 1 has more than one tx",
+                aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str());
+            return FAIL;
+        }
+
+        // apply txs one by one, a later tx may spend what an earlier tx received
+        std::map<dht::public_key, account> accounts;
+        std::set<sha1_hash> txids;
+        for (auto const& tx: txs) {
             if (b.chain_id() != tx.chain_id()) {
                 log(LOG_ERR, "INFO chain[%s] block chain id[%s] and tx chain id[%s] mismatch",
                     aux::toHex(chain_id).c_str(), aux::toHex(b.chain_id()).c_str(), aux::toHex(tx.chain_id()).c_str());
                 return FAIL;
             }
 
+            if (!txids.insert(tx.sha1()).second) {
+                log(LOG_ERR, "INFO chain[%s] block[%s] has duplicated tx[%s]",
+                    aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str(),
+                    aux::toHex(tx.sha1().to_string()).c_str());
+                return FAIL;
+            }
+
             if (!tx.verify_signature()) {
                 log(LOG_ERR, "INFO chain[%s] block tx[%s] has bad signature",
                     aux::toHex(chain_id).c_str(), aux::toHex(b.sha1().to_string()).c_str());
                 return FAIL;
             }
-        }
 
-        if (!tx.empty() && tx.type() == tx_type::type_transfer) {
-            auto sender_act = m_repository->get_account(chain_id, b.tx().sender());
-            if (sender_act.balance() < tx.cost()) {
-                log(LOG_ERR, "INFO chain[%s] sender account[%s] cannot cover cost:%" PRId64,
-                    aux::toHex(chain_id).c_str(), sender_act.to_string().c_str(), tx.cost());
-                return FAIL;
+            if (tx.type() == tx_type::type_transfer) {
+                for (auto const& peer: {tx.sender(), tx.receiver()}) {
+                    if (accounts.find(peer) == accounts.end()) {
+                        accounts[peer] = m_repository->get_account(chain_id, peer);
+                    }
+                }
+
+                auto &sender_act = accounts[tx.sender()];
+                if (sender_act.balance() < tx.cost()) {
+                    log(LOG_ERR, "INFO chain[%s] sender account[%s] cannot cover cost:%" PRId64,
+                        aux::toHex(chain_id).c_str(), sender_act.to_string().c_str(), tx.cost());
+                    return FAIL;
+                }
+
+                sender_act.subtract_balance(tx.cost());
+                sender_act.increase_nonce();
+                accounts[tx.receiver()].add_balance(tx.amount());
             }
         }
 
@@ -946,17 +1069,60 @@ namespace ip2::blockchain {
     }
 
     RESULT blockchain::process_genesis_block(const bytes &chain_id, const block &blk, const std::vector<state_array> &arrays) {
+        std::vector<sha1_hash> hashArray;
+        for (auto const& stateArray: arrays) {
+            if (!m_repository->save_state_array(chain_id, stateArray)) {
+                log(LOG_ERR, "INFO: chain:%s, save state array[%s] fail.",
+                    aux::toHex(chain_id).c_str(), stateArray.to_string().c_str());
+                return FAIL;
+            }
+            hashArray.push_back(stateArray.sha1());
+        }
+
+        return process_genesis_block(chain_id, blk, hashArray.empty() ? state_hash_array() : state_hash_array(hashArray));
+    }
+
+    bool blockchain::save_state_arrays(const bytes &chain_id, const state_hash_array &hashArray) {
+        // one state array in memory at a time, however large the epoch state is
+        for (auto const& hash: hashArray.HashArray()) {
+            auto stateArray = m_repository->get_state_array_by_hash(chain_id, hash);
+            if (stateArray.empty() || stateArray.sha1() != hash) {
+                log(LOG_ERR, "INFO: chain:%s, state array[%s] missing.",
+                    aux::toHex(chain_id).c_str(), aux::toHex(hash).c_str());
+                return false;
+            }
+
+            for (auto const& act: stateArray.StateArray()) {
+                if (!m_repository->save_account(chain_id, act)) {
+                    log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
+                        aux::toHex(chain_id).c_str(), act.to_string().c_str());
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    RESULT blockchain::process_genesis_block(const bytes &chain_id, const block &blk, const state_hash_array &hashArray) {
         log(LOG_ERR, "INFO: chain:%s process block[%s].",
             aux::toHex(chain_id).c_str(), blk.to_string().c_str());
         if (blk.empty())
             return FAIL;
 
-        auto &head_block  = m_head_blocks[chain_id];
+        if (!hashArray.empty() && hashArray.sha1() != blk.state_root()) {
+            log(LOG_ERR, "INFO: chain:%s, state hash array[%s] mismatch block state root.",
+                aux::toHex(chain_id).c_str(), aux::toHex(hashArray.sha1()).c_str());
+            return FAIL;
+        }
+
+        auto &ctx = chain(chain_id);
+        auto &head_block  = ctx.m_head_block;
         if (!head_block.empty()) {
             if (blk.previous_block_hash() == head_block.sha1()) {
                 std::set<dht::public_key> peers = blk.get_block_peers();
 
-                auto result = verify_block(chain_id, blk, head_block);
+                auto result = verify_block(chain_id, blk, head_block, *m_repository);
                 if (result != SUCCESS)
                     return result;
 
@@ -967,54 +1133,16 @@ namespace ip2::blockchain {
                     m_repository->rollback();
                     return FAIL;
                 }
-                for (auto const& stateArray: arrays) {
-                    log(LOG_ERR, "INFO: chain:%s process state array[%s].",
-                        aux::toHex(chain_id).c_str(), stateArray.to_string().c_str());
-                    for (auto const& act: stateArray.StateArray()) {
-                        if (!m_repository->save_account(chain_id, act)) {
-                            log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                                aux::toHex(chain_id).c_str(), act.to_string().c_str());
-                            m_repository->rollback();
-                            return FAIL;
-                        }
-                    }
+                if (!save_state_arrays(chain_id, hashArray)) {
+                    m_repository->rollback();
+                    return FAIL;
                 }
 
-                auto const& tx = blk.tx();
-                if (!tx.empty() && tx.type() == type_transfer) {
-                    std::map<dht::public_key, account> accounts;
-                    for (auto const& peer: peers) {
-                        accounts[peer] = m_repository->get_account(chain_id, peer);
-                    }
-
-                    accounts[blk.miner()].add_balance(tx.fee());
-                    accounts[tx.receiver()].add_balance(tx.amount());
-                    accounts[tx.sender()].subtract_balance(tx.cost());
-                    accounts[tx.sender()].increase_nonce();
-                    // add bonus to miner
-                    accounts[blk.miner()].add_balance(MINER_BONUS);
-
-                    for (auto const& item: accounts) {
-                        if (!m_repository->save_account(chain_id, item.second)) {
-                            log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                                aux::toHex(chain_id).c_str(), item.second.to_string().c_str());
-                            m_repository->rollback();
-                            return FAIL;
-                        }
-                    }
-                } else {
-                    // miner balance +=10, power++
-                    auto miner_account = m_repository->get_account(chain_id, blk.miner());
-
-                    miner_account.increase_power();
-                    miner_account.add_balance(MINER_BONUS);
-
-                    if (!m_repository->save_account(chain_id, miner_account)) {
-                        log(LOG_ERR, "INFO: chain:%s, save miner account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), miner_account.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
+                if (!m_repository->apply_block_state(blk)) {
+                    log(LOG_ERR, "INFO: chain:%s, apply block[%s] state fail.",
+                        aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                    m_repository->rollback();
+                    return FAIL;
                 }
 
                 if (!m_repository->save_main_chain_block(blk)) {
@@ -1026,13 +1154,17 @@ namespace ip2::blockchain {
 
                 m_repository->commit();
 
-                put_genesis_head_block(chain_id, blk, arrays);
+                set_state_snapshot(chain_id, hashArray);
 
-                m_head_blocks[chain_id] = blk;
+                put_genesis_head_block(chain_id, blk, hashArray);
+
+                set_head_block(chain_id, blk);
 
                 // chain changed, re-check tx pool
-                m_tx_pools[chain_id].recheck_account_txs(peers);
-                m_tx_pools[chain_id].delete_tx_from_time_pool(blk.tx());
+                ctx.m_tx_pool.recheck_account_txs(peers);
+                for (auto const& tx: blk.txs()) {
+                    ctx.m_tx_pool.delete_tx_from_time_pool(tx);
+                }
 
                 m_ses.alerts().emplace_alert<blockchain_new_head_block_alert>(blk);
             }
@@ -1046,52 +1178,16 @@ namespace ip2::blockchain {
                 m_repository->rollback();
                 return FAIL;
             }
-            for (auto const& stateArray: arrays) {
-                for (auto const& act: stateArray.StateArray()) {
-                    if (!m_repository->save_account(chain_id, act)) {
-                        log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), act.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
-                }
+            if (!save_state_arrays(chain_id, hashArray)) {
+                m_repository->rollback();
+                return FAIL;
             }
 
-            auto const& tx = blk.tx();
-            if (!tx.empty() && tx.type() == type_transfer) {
-                std::map<dht::public_key, account> accounts;
-                for (auto const& peer: peers) {
-                    accounts[peer] = m_repository->get_account(chain_id, peer);
-                }
-
-                accounts[blk.miner()].add_balance(tx.fee());
-                accounts[tx.receiver()].add_balance(tx.amount());
-                accounts[tx.sender()].subtract_balance(tx.cost());
-                accounts[tx.sender()].increase_nonce();
-                // add bonus to miner
-                accounts[blk.miner()].add_balance(MINER_BONUS);
-
-                for (auto const& item: accounts) {
-                    if (!m_repository->save_account(chain_id, item.second)) {
-                        log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), item.second.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
-                }
-            } else {
-                // miner balance +=10, power++
-                auto miner_account = m_repository->get_account(chain_id, blk.miner());
-
-                miner_account.increase_power();
-                miner_account.add_balance(MINER_BONUS);
-
-                if (!m_repository->save_account(chain_id, miner_account)) {
-                    log(LOG_ERR, "INFO: chain:%s, save miner account[%s] fail.",
-                        aux::toHex(chain_id).c_str(), miner_account.to_string().c_str());
-                    m_repository->rollback();
-                    return FAIL;
-                }
+            if (!m_repository->apply_block_state(blk)) {
+                log(LOG_ERR, "INFO: chain:%s, apply block[%s] state fail.",
+                    aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                m_repository->rollback();
+                return FAIL;
             }
 
             if (!m_repository->save_main_chain_block(blk)) {
@@ -1103,20 +1199,23 @@ namespace ip2::blockchain {
 
             m_repository->commit();
 
-            put_genesis_head_block(chain_id, blk, arrays);
+            set_state_snapshot(chain_id, hashArray);
 
-            m_head_blocks[chain_id] = blk;
+            put_genesis_head_block(chain_id, blk, hashArray);
+
+            set_head_block(chain_id, blk);
 
             // chain changed, re-check tx pool
-            m_tx_pools[chain_id].recheck_account_txs(peers);
-            m_tx_pools[chain_id].delete_tx_from_time_pool(blk.tx());
+            ctx.m_tx_pool.recheck_account_txs(peers);
+            for (auto const& tx: blk.txs()) {
+                ctx.m_tx_pool.delete_tx_from_time_pool(tx);
+            }
 
             m_ses.alerts().emplace_alert<blockchain_new_head_block_alert>(blk);
         }
 
         add_peer_into_acl(chain_id, blk.miner(), blk.timestamp());
-        auto const &tx = blk.tx();
-        if (!tx.empty()) {
+        for (auto const& tx: blk.txs()) {
             add_peer_into_acl(chain_id, tx.sender(), blk.timestamp());
         }
 
@@ -1129,75 +1228,51 @@ namespace ip2::blockchain {
         if (blk.empty())
             return FAIL;
 
-        auto &head_block  = m_head_blocks[chain_id];
+        auto &ctx = chain(chain_id);
+        auto &head_block  = ctx.m_head_block;
         if (!head_block.empty()) {
             if (blk.previous_block_hash() == head_block.sha1()) {
                 std::set<dht::public_key> peers = blk.get_block_peers();
 
-                auto result = verify_block(chain_id, blk, head_block);
+                auto result = verify_block(chain_id, blk, head_block, *m_repository);
                 if (result != SUCCESS)
                     return result;
 
-                m_repository->begin_transaction();
-
-                auto const& tx = blk.tx();
-                if (!tx.empty() && tx.type() == type_transfer) {
-                    std::map<dht::public_key, account> accounts;
-                    for (auto const& peer: peers) {
-                        accounts[peer] = m_repository->get_account(chain_id, peer);
-                    }
-
-                    accounts[blk.miner()].add_balance(tx.fee());
-                    accounts[tx.receiver()].add_balance(tx.amount());
-                    accounts[tx.sender()].subtract_balance(tx.cost());
-                    accounts[tx.sender()].increase_nonce();
-                    // add bonus to miner
-                    accounts[blk.miner()].add_balance(MINER_BONUS);
-
-                    for (auto const& item: accounts) {
-                        if (!m_repository->save_account(chain_id, item.second)) {
-                            log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                                aux::toHex(chain_id).c_str(), item.second.to_string().c_str());
-                            m_repository->rollback();
-                            return FAIL;
-                        }
-                    }
-                } else {
-                    // miner balance +=10, power++
-                    auto miner_account = m_repository->get_account(chain_id, blk.miner());
+                // nothing reaches the db unless the whole block applies
+                repository_track track(m_repository.get());
 
-                    miner_account.increase_power();
-                    miner_account.add_balance(MINER_BONUS);
-
-                    if (!m_repository->save_account(chain_id, miner_account)) {
-                        log(LOG_ERR, "INFO: chain:%s, save miner account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), miner_account.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
+                if (!track.apply_block_state(blk)) {
+                    log(LOG_ERR, "INFO: chain:%s, apply block[%s] state fail.",
+                        aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                    return FAIL;
                 }
 
-                if (!m_repository->save_main_chain_block(blk)) {
+                if (!track.save_main_chain_block(blk)) {
                     log(LOG_ERR, "INFO: chain:%s, save main chain block[%s] fail.",
                         aux::toHex(chain_id).c_str(), blk.to_string().c_str());
-                    m_repository->rollback();
                     return FAIL;
                 }
 
-                m_repository->commit();
+                if (!track.commit()) {
+                    log(LOG_ERR, "INFO: chain:%s, commit block[%s] fail.",
+                        aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                    return FAIL;
+                }
 
                 put_head_block(chain_id, blk);
 
-                m_head_blocks[chain_id] = blk;
+                set_head_block(chain_id, blk);
 
                 // chain changed, re-check tx pool
-                m_tx_pools[chain_id].recheck_account_txs(peers);
-                m_tx_pools[chain_id].delete_tx_from_time_pool(blk.tx());
+                ctx.m_tx_pool.recheck_account_txs(peers);
+                for (auto const& tx: blk.txs()) {
+                    ctx.m_tx_pool.delete_tx_from_time_pool(tx);
+                }
 
                 m_ses.alerts().emplace_alert<blockchain_new_head_block_alert>(blk);
 
                 add_peer_into_acl(chain_id, blk.miner(), blk.timestamp());
-                if (!tx.empty()) {
+                for (auto const& tx: blk.txs()) {
                     add_peer_into_acl(chain_id, tx.sender(), blk.timestamp());
                 }
             }
@@ -1262,9 +1337,8 @@ namespace ip2::blockchain {
 //                try_to_rebranch_to_best_vote(chain_id);
 
                 // 6. try to mine block
-                auto it_timer = m_chain_timers.find(chain_id);
-                if (it_timer != m_chain_timers.end()) {
-                    it_timer->second.cancel();
+                if (auto *ctx = find_chain(chain_id)) {
+                    ctx->m_timer.cancel();
                 }
             } else {
                 if (blk.block_number() % CHAIN_EPOCH_BLOCK_SIZE == 0) {
@@ -1277,46 +1351,115 @@ namespace ip2::blockchain {
     }
 
     void blockchain::state_reception_event(const bytes &chain_id, const dht::public_key &peer) {
-        auto& acl = m_access_list[chain_id];
+        auto &ctx = chain(chain_id);
+        auto& acl = ctx.m_access_list;
         auto it = acl.find(peer);
         if (it != acl.end()) {
             if (!it->second.m_genesis_block.empty() && !it->second.m_state_hash_array.empty() &&
                 it->second.m_state_hash_array.sha1() == it->second.m_genesis_block.state_root()) {
-                std::vector<state_array> arrays;
-                for (auto const& hash: it->second.m_state_hash_array.HashArray()) {
-                    auto stateArray = m_repository->get_state_array_by_hash(chain_id, hash);
-                    if (!stateArray.empty()) {
-                        arrays.push_back(stateArray);
-                    } else {
+                if (ctx.m_state_sync) {
+                    if (ctx.m_state_sync->m_peer != peer || !ctx.m_state_sync->done())
                         return;
+                    ctx.m_state_sync.reset();
+                } else {
+                    for (auto const& hash: it->second.m_state_hash_array.HashArray()) {
+                        if (!m_repository->is_state_array_in_db(chain_id, hash))
+                            return;
                     }
                 }
 
-                if ((it->second.m_head_block.cumulative_difficulty() > m_head_blocks[chain_id].cumulative_difficulty() ||
-                    (it->second.m_head_block.cumulative_difficulty() == m_head_blocks[chain_id].cumulative_difficulty() && peer > *m_ses.pubkey())) &&
-                    it->second.m_head_block.genesis_block_hash() != m_head_blocks[chain_id].genesis_block_hash()) {
+                if ((it->second.m_head_block.cumulative_difficulty() > ctx.m_head_block.cumulative_difficulty() ||
+                    (it->second.m_head_block.cumulative_difficulty() == ctx.m_head_block.cumulative_difficulty() && peer > *m_ses.pubkey())) &&
+                    it->second.m_head_block.genesis_block_hash() != ctx.m_head_block.genesis_block_hash()) {
                     clear_chain_all_state_in_cache_and_db(chain_id);
                 }
 
-                process_genesis_block(chain_id, it->second.m_genesis_block, arrays);
+                process_genesis_block(chain_id, it->second.m_genesis_block, it->second.m_state_hash_array);
 
-                if (it->second.m_head_block.cumulative_difficulty() > m_head_blocks[chain_id].cumulative_difficulty() ||
-                    (it->second.m_head_block.cumulative_difficulty() == m_head_blocks[chain_id].cumulative_difficulty() && peer > *m_ses.pubkey())) {
+                if (it->second.m_head_block.cumulative_difficulty() > ctx.m_head_block.cumulative_difficulty() ||
+                    (it->second.m_head_block.cumulative_difficulty() == ctx.m_head_block.cumulative_difficulty() && peer > *m_ses.pubkey())) {
                     try_to_rebranch(chain_id, it->second.m_head_block, false, peer);
                 }
             }
         }
     }
 
+    void blockchain::start_state_sync(const bytes &chain_id, const dht::public_key &peer, const state_hash_array &hashArray) {
+        auto &ctx = chain(chain_id);
+        if (ctx.m_state_sync && ctx.m_state_sync->m_peer == peer &&
+            ctx.m_state_sync->m_hash_array.sha1() == hashArray.sha1() && !ctx.m_state_sync->done())
+            return;
+
+        auto &sync = ctx.m_state_sync.emplace(peer, hashArray);
+        for (auto const& hash: hashArray.HashArray()) {
+            if (!m_repository->is_state_array_in_db(chain_id, hash)) {
+                sync.m_queued.push_back(hash);
+            }
+        }
+
+        log(LOG_INFO, "INFO: chain[%s] sync snapshot[%s] from peer[%s], missing state arrays[%zu]",
+            aux::toHex(chain_id).c_str(), aux::toHex(hashArray.sha1()).c_str(),
+            aux::toHex(peer.bytes).c_str(), sync.m_queued.size());
+
+        get_next_state_arrays(chain_id);
+    }
+
+    void blockchain::get_next_state_arrays(const bytes &chain_id) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_state_sync)
+            return;
+
+        auto &sync = *ctx->m_state_sync;
+        while (sync.m_getting.size() < blockchain_state_sync_window && !sync.m_queued.empty()) {
+            auto hash = sync.m_queued.front();
+            sync.m_queued.pop_front();
+            sync.m_getting[hash] = 1;
+            get_state_array(chain_id, sync.m_peer, hash);
+        }
+    }
+
+    void blockchain::state_array_missing(const bytes &chain_id, const dht::public_key &peer, const sha1_hash &hash) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx != nullptr && ctx->m_state_sync && ctx->m_state_sync->m_peer == peer) {
+            auto it_getting = ctx->m_state_sync->m_getting.find(hash);
+            if (it_getting != ctx->m_state_sync->m_getting.end() &&
+                it_getting->second < blockchain_state_array_max_getting_times) {
+                it_getting->second++;
+                get_state_array(chain_id, peer, hash);
+                return;
+            }
+            ctx->m_state_sync.reset();
+        }
+
+        request_all_state(chain_id, peer);
+    }
+
+    void blockchain::set_state_snapshot(const bytes &chain_id, const state_hash_array &hashArray) {
+        auto &snapshot = chain(chain_id).m_state_snapshot;
+        if (snapshot && snapshot->sha1() == hashArray.sha1())
+            return;
+
+        if (snapshot) {
+            std::set<sha1_hash> current(hashArray.HashArray().begin(), hashArray.HashArray().end());
+            for (auto const& hash: snapshot->HashArray()) {
+                if (current.find(hash) == current.end()) {
+                    m_repository->delete_state_array_by_hash(chain_id, hash);
+                }
+            }
+        }
+
+        snapshot = hashArray;
+    }
+
     bool blockchain::is_empty_chain(const aux::bytes &chain_id) {
         // check if head block empty
-        auto &head_block = m_head_blocks[chain_id];
+        auto &head_block = chain(chain_id).m_head_block;
 
         return head_block.empty();
     }
 
     bool blockchain::is_transaction_in_pool(const bytes &chain_id, const sha1_hash &txid) {
-        return m_tx_pools[chain_id].is_transaction_in_pool(txid);
+        return chain(chain_id).m_tx_pool.is_transaction_in_pool(txid);
     }
 
 //    bool blockchain::is_block_immutable_certainly(const aux::bytes &chain_id, const block &blk) {
@@ -1347,7 +1490,7 @@ namespace ip2::blockchain {
     }
 
     bool blockchain::clear_chain_all_state_in_cache_and_db(const aux::bytes &chain_id) {
-        m_head_blocks.erase(chain_id);
+        remove_head_block(chain_id);
         return clear_all_chain_data_in_db(chain_id);
     }
 
@@ -1463,7 +1606,8 @@ namespace ip2::blockchain {
         log(LOG_INFO, "INFO chain[%s] try to rebranch to block[%s]",
             aux::toHex(chain_id).c_str(), target.to_string().c_str());
 
-        auto const& head_block = m_head_blocks[chain_id];
+        auto &ctx = chain(chain_id);
+        auto const& head_block = ctx.m_head_block;
 
         // re-branch, try to find out fork point block
         std::vector<block> rollback_blocks;
@@ -1576,7 +1720,9 @@ namespace ip2::blockchain {
 
         std::set<dht::public_key> peers;
 
-        m_repository->begin_transaction();
+        // roll back and connect in memory, the db is only written once the
+        // whole branch verified
+        repository_track track(m_repository.get());
 
         // Rollback blocks
         for (auto &blk: rollback_blocks) {
@@ -1585,47 +1731,15 @@ namespace ip2::blockchain {
             auto block_peers = blk.get_block_peers();
             peers.insert(block_peers.begin(), block_peers.end());
 
-            auto const& tx = blk.tx();
-            if (!tx.empty() && tx.type() == type_transfer) {
-                std::map<dht::public_key, account> accounts;
-                for (auto const& block_peer: block_peers) {
-                    accounts[block_peer] = m_repository->get_account(chain_id, block_peer);
-                }
-
-                accounts[blk.miner()].subtract_balance(tx.fee());
-                accounts[tx.receiver()].subtract_balance(tx.amount());
-                accounts[tx.sender()].add_balance(tx.cost());
-                accounts[tx.sender()].decrease_nonce();
-                // subtract bonus
-                accounts[blk.miner()].subtract_balance(MINER_BONUS);
-
-                for (auto const& item: accounts) {
-                    if (!m_repository->save_account(chain_id, item.second)) {
-                        log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), item.second.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
-                }
-            } else {
-                // miner balance -=10, power--
-                auto miner_account = m_repository->get_account(chain_id, blk.miner());
-
-                miner_account.decrease_power();
-                miner_account.subtract_balance(MINER_BONUS);
-
-                if (!m_repository->save_account(chain_id, miner_account)) {
-                    log(LOG_ERR, "INFO: chain:%s, save miner account[%s] fail.",
-                        aux::toHex(chain_id).c_str(), miner_account.to_string().c_str());
-                    m_repository->rollback();
-                    return FAIL;
-                }
+            if (!track.rollback_block_state(blk)) {
+                log(LOG_ERR, "INFO: chain:%s, rollback block[%s] state fail.",
+                    aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                return FAIL;
             }
 
-            if (!m_repository->set_block_non_main_chain(chain_id, blk.sha1())) {
+            if (!track.set_block_non_main_chain(chain_id, blk.sha1())) {
                 log(LOG_ERR, "INFO: chain:%s, set block non main chain[%s] fail.",
                     aux::toHex(chain_id).c_str(), blk.to_string().c_str());
-                m_repository->rollback();
                 return FAIL;
             }
         }
@@ -1636,76 +1750,51 @@ namespace ip2::blockchain {
             auto &previous_block = connect_blocks[i - 1];
 
 //            log("INFO: try to connect block:%s", blk.to_string().c_str());
-            auto result = verify_block(chain_id, blk, previous_block);
+            auto result = verify_block(chain_id, blk, previous_block, track);
             if (result != SUCCESS) {
-                m_repository->rollback();
                 return result;
             }
 
             auto block_peers = blk.get_block_peers();
             peers.insert(block_peers.begin(), block_peers.end());
 
-            auto const& tx = blk.tx();
-            if (!tx.empty() && tx.type() == type_transfer) {
-                std::map<dht::public_key, account> accounts;
-                for (auto const& block_peer: block_peers) {
-                    accounts[block_peer] = m_repository->get_account(chain_id, block_peer);
-                }
-
-                accounts[blk.miner()].add_balance(tx.fee());
-                accounts[tx.receiver()].add_balance(tx.amount());
-                accounts[tx.sender()].subtract_balance(tx.cost());
-                accounts[tx.sender()].increase_nonce();
-                // add bonus to miner
-                accounts[blk.miner()].add_balance(MINER_BONUS);
-
-                for (auto const& item: accounts) {
-                    if (!m_repository->save_account(chain_id, item.second)) {
-                        log(LOG_ERR, "INFO: chain:%s, save account[%s] fail.",
-                            aux::toHex(chain_id).c_str(), item.second.to_string().c_str());
-                        m_repository->rollback();
-                        return FAIL;
-                    }
-                }
-            } else {
-                // miner balance +=10, power++
-                auto miner_account = m_repository->get_account(chain_id, blk.miner());
-
-                miner_account.increase_power();
-                miner_account.add_balance(MINER_BONUS);
-
-                if (!m_repository->save_account(chain_id, miner_account)) {
-                    log(LOG_ERR, "INFO: chain:%s, save miner account[%s] fail.",
-                        aux::toHex(chain_id).c_str(), miner_account.to_string().c_str());
-                    m_repository->rollback();
-                    return FAIL;
-                }
+            if (!track.apply_block_state(blk)) {
+                log(LOG_ERR, "INFO: chain:%s, apply block[%s] state fail.",
+                    aux::toHex(chain_id).c_str(), blk.to_string().c_str());
+                return FAIL;
             }
 
-            if (!m_repository->set_block_main_chain(chain_id, blk.sha1())) {
+            if (!track.set_block_main_chain(chain_id, blk.sha1())) {
                 log(LOG_ERR, "INFO: chain:%s, set block main chain[%s] fail.",
                     aux::toHex(chain_id).c_str(), blk.to_string().c_str());
-                m_repository->rollback();
                 return FAIL;
             }
         }
 
-        m_repository->commit();
+        if (!track.commit()) {
+            log(LOG_ERR, "INFO: chain:%s, commit rebranch to block[%s] fail.",
+                aux::toHex(chain_id).c_str(), target.to_string().c_str());
+            return FAIL;
+        }
 
         // after all above is success
-        m_head_blocks[chain_id] = target;
+        set_head_block(chain_id, target);
 
         // chain changed, re-check tx pool
-        m_tx_pools[chain_id].recheck_account_txs(peers);
+        ctx.m_tx_pool.recheck_account_txs(peers);
 
         for (auto &blk: rollback_blocks) {
-            // send back rollback block tx to pool
-            m_tx_pools[chain_id].add_tx(blk.tx());
+            // send back rollback block txs to pool
+            for (auto const& tx: blk.txs()) {
+                ctx.m_tx_pool.add_tx(tx);
+            }
             // notify rollback block
             m_ses.alerts().emplace_alert<blockchain_rollback_block_alert>(blk);
         }
         for (auto i = connect_blocks.size(); i > 1; i--) {
-            m_tx_pools[chain_id].delete_tx_from_time_pool(connect_blocks[i - 2].tx());
+            for (auto const& tx: connect_blocks[i - 2].txs()) {
+                ctx.m_tx_pool.delete_tx_from_time_pool(tx);
+            }
             m_ses.alerts().emplace_alert<blockchain_new_head_block_alert>(connect_blocks[i - 2]);
         }
         add_peer_into_acl(chain_id, target.miner(), target.timestamp());
@@ -1788,8 +1877,9 @@ namespace ip2::blockchain {
         log(LOG_ERR, "INFO: chain:%s, try to rebranch to peer[%s] chain.",
             aux::toHex(chain_id).c_str(), aux::toHex(peer.bytes).c_str());
 
-        auto &head_block = m_head_blocks[chain_id];
-        auto &acl = m_access_list[chain_id];
+        auto &ctx = chain(chain_id);
+        auto &head_block = ctx.m_head_block;
+        auto &acl = ctx.m_access_list;
 
         auto it = acl.find(peer);
         if (it == acl.end()) {
@@ -2232,6 +2322,39 @@ namespace ip2::blockchain {
         }
     }
 
+    state_hash_array blockchain::get_state_snapshot(const bytes &chain_id, const block &blk) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx != nullptr && ctx->m_state_snapshot && ctx->m_state_snapshot->sha1() == blk.state_root())
+            return *ctx->m_state_snapshot;
+
+        // not processed since started, build it from state db
+        sha1_hash stateRoot;
+        std::vector<state_array> stateArrays;
+        get_genesis_state(chain_id, stateRoot, stateArrays);
+
+        if (stateArrays.empty() || stateRoot != blk.state_root()) {
+            // state has moved on since epoch block, peers couldn't verify it
+            log(LOG_INFO, "INFO: chain[%s] no snapshot for state root[%s]",
+                aux::toHex(chain_id).c_str(), aux::toHex(blk.state_root()).c_str());
+            return state_hash_array();
+        }
+
+        std::vector<sha1_hash> hashArray;
+        for (auto const& stateArray: stateArrays) {
+            if (!m_repository->save_state_array(chain_id, stateArray)) {
+                log(LOG_ERR, "INFO: chain:%s, save state array[%s] fail.",
+                    aux::toHex(chain_id).c_str(), stateArray.to_string().c_str());
+                return state_hash_array();
+            }
+            hashArray.push_back(stateArray.sha1());
+        }
+
+        state_hash_array snapshot(hashArray);
+        set_state_snapshot(chain_id, snapshot);
+
+        return snapshot;
+    }
+
 //    std::string blockchain::make_salt(const aux::bytes &chain_id, std::int64_t data_type_id) {
 //        common::protocol_entry protocolEntry(chain_id, data_type_id);
 //        sha1_hash hash = hasher(protocolEntry.get_encode()).final();
@@ -2406,91 +2529,88 @@ namespace ip2::blockchain {
     }
 
     void blockchain::put_chain_all_data(const bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto &ctx = chain(chain_id);
+        if (!ctx.m_followed) {
             log(LOG_INFO, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx.m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
         }
 
         log(LOG_INFO, "Chain[%s] Put all chain data", aux::toHex(chain_id).c_str());
 
         auto now = get_total_milliseconds();
-        if (now < m_all_data_last_put_time[chain_id] + blockchain_min_put_interval) {
+        if (now < ctx.m_all_data_last_put_time + blockchain_min_put_interval) {
             log(LOG_INFO, "Chain[%s] Already put it", aux::toHex(chain_id).c_str());
             return;
         }
-        m_all_data_last_put_time[chain_id] = now;
+        ctx.m_all_data_last_put_time = now;
 
         if (!is_empty_chain(chain_id)) {
-            auto blk = m_head_blocks[chain_id];
+            auto blk = ctx.m_head_block;
             while (blk.block_number() % CHAIN_EPOCH_BLOCK_SIZE != 0) {
                 put_block(chain_id, blk);
                 blk = m_repository->get_block_by_hash(chain_id, blk.previous_block_hash());
             }
-            sha1_hash stateRoot;
-            std::vector<state_array> stateArrays;
-            get_genesis_state(chain_id, stateRoot, stateArrays);
-            put_block_with_all_state(chain_id, blk, stateArrays);
-            put_head_block_hash(chain_id, m_head_blocks[chain_id].sha1());
+            put_block_with_all_state(chain_id, blk, get_state_snapshot(chain_id, blk));
+            put_head_block_hash(chain_id, ctx.m_head_block.sha1());
         }
     }
 
     void blockchain::put_chain_all_state(const bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto &ctx = chain(chain_id);
+        if (!ctx.m_followed) {
             log(LOG_INFO, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx.m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
         }
 
         log(LOG_INFO, "Chain[%s] Put all chain state", aux::toHex(chain_id).c_str());
 
         auto now = get_total_milliseconds();
-        if (now < m_all_state_last_put_time[chain_id] + blockchain_min_put_interval) {
+        if (now < ctx.m_all_state_last_put_time + blockchain_min_put_interval) {
             log(LOG_INFO, "Chain[%s] Already put it", aux::toHex(chain_id).c_str());
             return;
         }
-        m_all_state_last_put_time[chain_id] = now;
+        ctx.m_all_state_last_put_time = now;
 
         if (!is_empty_chain(chain_id)) {
-            auto blk = m_repository->get_block_by_hash(chain_id, m_head_blocks[chain_id].genesis_block_hash());
-            sha1_hash stateRoot;
-            std::vector<state_array> stateArrays;
-            get_genesis_state(chain_id, stateRoot, stateArrays);
-            put_block_with_all_state(chain_id, blk, stateArrays);
+            auto blk = m_repository->get_block_by_hash(chain_id, ctx.m_head_block.genesis_block_hash());
+            put_block_with_all_state(chain_id, blk, get_state_snapshot(chain_id, blk));
         }
     }
 
     void blockchain::put_chain_all_blocks(const bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto &ctx = chain(chain_id);
+        if (!ctx.m_followed) {
             log(LOG_INFO, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx.m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
         }
 
         log(LOG_INFO, "Chain[%s] Put chain blocks", aux::toHex(chain_id).c_str());
 
         auto now = get_total_milliseconds();
-        if (now < m_all_blocks_last_put_time[chain_id] + blockchain_min_put_interval) {
+        if (now < ctx.m_all_blocks_last_put_time + blockchain_min_put_interval) {
             log(LOG_INFO, "Chain[%s] Already put it", aux::toHex(chain_id).c_str());
             return;
         }
-        m_all_blocks_last_put_time[chain_id] = now;
+        ctx.m_all_blocks_last_put_time = now;
 
         if (!is_empty_chain(chain_id)) {
-            auto blk = m_head_blocks[chain_id];
+            auto blk = ctx.m_head_block;
             while (blk.block_number() % CHAIN_EPOCH_BLOCK_SIZE != 0) {
                 put_block(chain_id, blk);
                 blk = m_repository->get_block_by_hash(chain_id, blk.previous_block_hash());
             }
             put_block(chain_id, blk);
 
-            put_head_block_hash(chain_id, m_head_blocks[chain_id].sha1());
+            put_head_block_hash(chain_id, ctx.m_head_block.sha1());
         }
     }
 
@@ -2517,7 +2637,7 @@ namespace ip2::blockchain {
         common::signal_entry signalEntry(common::BLOCKCHAIN_ONLINE, chain_id, get_total_milliseconds() / 1000, peer);
 
         auto e = signalEntry.get_entry();
-        auto const& acl = m_access_list[chain_id];
+        auto const& acl = chain(chain_id).m_access_list;
         for (auto const& item: acl) {
             log(LOG_INFO, "Chain[%s] Send peer[%s] online signal[%s]", aux::toHex(chain_id).c_str(),
                 aux::toHex(item.first.bytes).c_str(), e.to_string(true).c_str());
@@ -2531,7 +2651,7 @@ namespace ip2::blockchain {
             aux::toHex(peer.bytes).c_str());
         common::signal_entry signalEntry(common::BLOCKCHAIN_NEW_HEAD_BLOCK, chain_id, get_total_milliseconds() / 1000, hash, peer);
         auto e = signalEntry.get_entry();
-        auto const& acl = m_access_list[chain_id];
+        auto const& acl = chain(chain_id).m_access_list;
         for (auto const& item: acl) {
             log(LOG_INFO, "Chain[%s] Send peer[%s] new head block signal[%s]", aux::toHex(chain_id).c_str(),
                 aux::toHex(item.first.bytes).c_str(), e.to_string(true).c_str());
@@ -2546,7 +2666,7 @@ namespace ip2::blockchain {
         common::signal_entry signalEntry(common::BLOCKCHAIN_NEW_TRANSFER_TX, chain_id, get_total_milliseconds() / 1000, peer);
         auto e = signalEntry.get_entry();
         auto encode = signalEntry.get_encode();
-        auto const& acl = m_access_list[chain_id];
+        auto const& acl = chain(chain_id).m_access_list;
         std::set<dht::public_key> peers;
         for (auto const& item: acl) {
             peers.insert(item.first);
@@ -2568,7 +2688,7 @@ namespace ip2::blockchain {
         common::signal_entry signalEntry(common::BLOCKCHAIN_NEW_NOTE_TX, chain_id, get_total_milliseconds() / 1000, hash, peer);
         auto e = signalEntry.get_entry();
         auto encode = signalEntry.get_encode();
-        auto const& acl = m_access_list[chain_id];
+        auto const& acl = chain(chain_id).m_access_list;
         for (auto const& item: acl) {
             log(LOG_INFO, "Chain[%s] Send peer[%s] new note tx signal[%s]", aux::toHex(chain_id).c_str(),
                 aux::toHex(item.first.bytes).c_str(), e.to_string(true).c_str());
@@ -2590,15 +2710,16 @@ namespace ip2::blockchain {
         }
     }
 
-    void blockchain::put_genesis_head_block(const bytes &chain_id, const block &blk, const std::vector<state_array> &arrays) {
-        for (auto const& stateArray: arrays) {
+    void blockchain::put_genesis_head_block(const bytes &chain_id, const block &blk, const state_hash_array &hashArray) {
+        for (auto const& hash: hashArray.HashArray()) {
+            auto stateArray = m_repository->get_state_array_by_hash(chain_id, hash);
             if (!stateArray.empty()) {
                 m_ses.alerts().emplace_alert<blockchain_state_array_alert>(chain_id, stateArray.StateArray());
             }
         }
 
-        if (!blk.empty() && !arrays.empty()) {
-            put_block_with_all_state(chain_id, blk, arrays);
+        if (!blk.empty() && !hashArray.empty()) {
+            put_block_with_all_state(chain_id, blk, hashArray);
 
             put_head_block_hash(chain_id, blk.sha1());
 
@@ -2776,18 +2897,23 @@ namespace ip2::blockchain {
         }
     }
 
-    void blockchain::put_block_with_all_state(const bytes &chain_id, const block &blk, const std::vector<state_array> &arrays) {
-        if (!blk.empty() && !arrays.empty()) {
-
+    void blockchain::put_block_with_all_state(const bytes &chain_id, const block &blk, const state_hash_array &hashArray) {
+        if (!blk.empty()) {
             put_block(chain_id, blk);
+        }
 
-            std::vector<sha1_hash> hashArray;
-            for (auto const& stateArray: arrays) {
-                hashArray.push_back(stateArray.sha1());
-                put_state_array(chain_id, stateArray);
+        if (!blk.empty() && !hashArray.empty()) {
+            // state arrays are content addressed, the same snapshot needn't be put again so soon
+            auto now = get_total_milliseconds();
+            auto &last_put = chain(chain_id).m_snapshot_last_put_time;
+            if (last_put.first != hashArray.sha1() || now >= last_put.second + blockchain_snapshot_republish_interval) {
+                for (auto const& hash: hashArray.HashArray()) {
+                    put_state_array(chain_id, m_repository->get_state_array_by_hash(chain_id, hash));
+                }
+                last_put = std::make_pair(hashArray.sha1(), now);
             }
-            state_hash_array stateHashArray(hashArray);
-            put_state_hash_array(chain_id, stateHashArray);
+
+            put_state_hash_array(chain_id, hashArray);
         }
     }
 
@@ -2858,7 +2984,7 @@ namespace ip2::blockchain {
     }
 
     void blockchain::put_note_pool_hash_set(const bytes &chain_id) {
-        auto hash_set = m_tx_pools[chain_id].get_top_40_note_txid();
+        auto hash_set = chain(chain_id).m_tx_pool.get_top_40_note_txid();
         pool_hash_set poolHashSet(hash_set);
 
         if (!poolHashSet.empty()) {
@@ -2987,7 +3113,7 @@ namespace ip2::blockchain {
                             log(LOG_INFO, "INFO: Got head block[%s], time:%" PRId64,
                                 blk.to_string().c_str(), get_total_milliseconds());
 
-                            auto &acl = m_access_list[chain_id];
+                            auto &acl = chain(chain_id).m_access_list;
                             auto it = acl.find(peer);
                             if (it != acl.end()) {
                                 // only peer in acl is allowed
@@ -3006,12 +3132,12 @@ namespace ip2::blockchain {
                                     aux::toHex(chain_id).c_str(), blk.to_string().c_str());
                             }
 
-                            // notify ui tx from block
-                            if (!blk.tx().empty()) {
-                                m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(blk.tx());
+                            // notify ui txs from block
+                            for (auto const& tx: blk.txs()) {
+                                m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(tx);
                             }
 
-                            if (blk.cumulative_difficulty() > m_head_blocks[chain_id].cumulative_difficulty()) {
+                            if (blk.cumulative_difficulty() > chain(chain_id).m_head_block.cumulative_difficulty()) {
                                 m_ses.alerts().emplace_alert<blockchain_syncing_head_block_alert>(peer, blk);
                             }
 
@@ -3027,7 +3153,7 @@ namespace ip2::blockchain {
                             log(LOG_INFO, "INFO: Got block[%s], time:%" PRId64,
                                 blk.to_string().c_str(), get_total_milliseconds());
 
-                            auto &acl = m_access_list[chain_id];
+                            auto &acl = chain(chain_id).m_access_list;
                             auto it = acl.find(peer);
                             if (it != acl.end()) {
                                 // only peer in acl is allowed
@@ -3045,9 +3171,9 @@ namespace ip2::blockchain {
                                     aux::toHex(chain_id).c_str(), blk.to_string().c_str());
                             }
 
-                            // notify ui tx from block
-                            if (!blk.tx().empty()) {
-                                m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(blk.tx());
+                            // notify ui txs from block
+                            for (auto const& tx: blk.txs()) {
+                                m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(tx);
                             }
 
                             m_ses.alerts().emplace_alert<blockchain_syncing_block_alert>(peer, blk);
@@ -3104,7 +3230,7 @@ namespace ip2::blockchain {
                         auto const& hashSet = poolHashSet.PoolHashSet();
                         for (auto const& hash: hashSet) {
                             // get history tx
-                            if (!hash.is_all_zeros() && !m_tx_pools[chain_id].is_transaction_in_time_pool(hash)) {
+                            if (!hash.is_all_zeros() && !chain(chain_id).m_tx_pool.is_transaction_in_time_pool(hash)) {
                                 get_transaction(chain_id, peer, hash);
                             }
                         }
@@ -3122,7 +3248,7 @@ namespace ip2::blockchain {
 
                             m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(tx);
 
-                            auto &pool = m_tx_pools[chain_id];
+                            auto &pool = chain(chain_id).m_tx_pool;
 
                             if (pool.add_tx_to_time_pool(tx)) {
                                 put_note_transaction(chain_id, tx);
@@ -3140,7 +3266,7 @@ namespace ip2::blockchain {
 
                             m_ses.alerts().emplace_alert<blockchain_new_transaction_alert>(tx);
 
-                            auto &pool = m_tx_pools[chain_id];
+                            auto &pool = chain(chain_id).m_tx_pool;
                             if (pool.add_tx_to_fee_pool(tx)) {
                                 auto self_tx = pool.get_transaction_by_account(*m_ses.pubkey());
                                 auto best_tx = pool.get_best_fee_transaction();
@@ -3167,17 +3293,20 @@ namespace ip2::blockchain {
                         state_hash_array hashArray(i.value());
                         log(LOG_INFO, "INFO: Got state hash array[%s].", hashArray.to_string().c_str());
 
-                        auto& acl = m_access_list[chain_id];
+                        // salt is the state root it was got by
+                        if (hashArray.empty() || hashArray.sha1() != sha1_hash(salt.data())) {
+                            log(LOG_ERR, "INFO: chain[%s] state hash array mismatch salt[%s]",
+                                aux::toHex(chain_id).c_str(), aux::toHex(salt).c_str());
+                            break;
+                        }
+
+                        auto& acl = chain(chain_id).m_access_list;
                         auto it = acl.find(peer);
                         if (it != acl.end()) {
                             // only peer in acl is allowed
                             it->second.m_state_hash_array = hashArray;
-                        }
 
-                        for (auto const& hash: hashArray.HashArray()) {
-                            if (!m_repository->is_state_array_in_db(chain_id, hash)) {
-                                get_state_array(chain_id, peer, hash);
-                            }
+                            start_state_sync(chain_id, peer, hashArray);
                         }
 
                         state_reception_event(chain_id, peer);
@@ -3188,15 +3317,27 @@ namespace ip2::blockchain {
                         state_array stateArray(i.value());
                         log(LOG_INFO, "INFO: Got state array[%s].", stateArray.to_string().c_str());
 
-                        if (!stateArray.empty()) {
-                            m_ses.alerts().emplace_alert<blockchain_state_array_alert>(chain_id, stateArray.StateArray());
+                        sha1_hash hash(salt.data());
+                        if (stateArray.empty() || stateArray.sha1() != hash) {
+                            log(LOG_ERR, "INFO: chain[%s] state array mismatch salt[%s]",
+                                aux::toHex(chain_id).c_str(), aux::toHex(salt).c_str());
+                            state_array_missing(chain_id, peer, hash);
+                            break;
                         }
 
+                        m_ses.alerts().emplace_alert<blockchain_state_array_alert>(chain_id, stateArray.StateArray());
+
                         if (!m_repository->save_state_array(chain_id, stateArray)) {
                             log(LOG_ERR, "INFO: chain:%s, save state array[%s] fail.",
                                 aux::toHex(chain_id).c_str(), stateArray.to_string().c_str());
                         }
 
+                        auto *ctx = find_chain(chain_id);
+                        if (ctx != nullptr && ctx->m_state_sync && ctx->m_state_sync->m_peer == peer) {
+                            ctx->m_state_sync->m_getting.erase(hash);
+                            get_next_state_arrays(chain_id);
+                        }
+
                         state_reception_event(chain_id, peer);
 
                         break;
@@ -3241,11 +3382,14 @@ namespace ip2::blockchain {
                         }
                         break;
                     }
-                    case GET_ITEM_TYPE::STATE_HASH_ARRAY:
-                    case GET_ITEM_TYPE::STATE_ARRAY: {
+                    case GET_ITEM_TYPE::STATE_HASH_ARRAY: {
                         request_all_state(chain_id, peer);
                         break;
                     }
+                    case GET_ITEM_TYPE::STATE_ARRAY: {
+                        state_array_missing(chain_id, peer, sha1_hash(salt.data()));
+                        break;
+                    }
                     default: {
                         log(LOG_DEBUG, "INFO: ignored type.");
                     }
@@ -3467,17 +3611,18 @@ namespace ip2::blockchain {
 
                 auto &chain_id = tx.chain_id();
 
-                if (m_chains.find(chain_id) == m_chains.end()) {
+                auto *ctx = find_chain(chain_id);
+                if (ctx == nullptr || !ctx->m_followed) {
                     log(LOG_INFO, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
                     return false;
                 }
 
-                if (!m_chain_connected[chain_id]) {
+                if (!ctx->m_connected) {
                     log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
                     return false;
                 }
 
-                m_tx_pools[chain_id].add_tx(tx);
+                ctx->m_tx_pool.add_tx(tx);
 
                 if (tx.type() == tx_type::type_transfer) {
                     put_transfer_transaction(chain_id, tx);
@@ -3496,17 +3641,42 @@ namespace ip2::blockchain {
     }
 
     bool blockchain::is_transaction_in_fee_pool(const aux::bytes &chain_id, const sha1_hash &txid) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return false;
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return false;
         }
 
-        return m_tx_pools[chain_id].is_transaction_in_fee_pool(txid);
+        return ctx->m_tx_pool.is_transaction_in_fee_pool(txid);
+    }
+
+    void blockchain::set_head_block(const aux::bytes &chain_id, const block &blk) {
+        auto &ctx = chain(chain_id);
+        ctx.m_head_block = blk;
+        publish_head_block(ctx);
+    }
+
+    void blockchain::remove_head_block(const aux::bytes &chain_id) {
+        if (auto *ctx = find_chain(chain_id))
+            ctx->m_head_block = block();
+        if (auto reader = m_ses.chain_reader())
+            reader->remove_head_block(chain_id);
+    }
+
+    void blockchain::publish_head_block(chain_context const& ctx) {
+        auto reader = m_ses.chain_reader();
+        if (!reader)
+            return;
+
+        if (ctx.m_followed && ctx.m_connected && !ctx.m_head_block.empty())
+            reader->publish_head_block(ctx.m_chain_id, ctx.m_head_block);
+        else
+            reader->remove_head_block(ctx.m_chain_id);
     }
 
     account blockchain::getAccountInfo(const aux::bytes &chain_id, dht::public_key publicKey) {
@@ -3522,19 +3692,20 @@ namespace ip2::blockchain {
     }
 
     std::vector<block> blockchain::getTopTipBlocks(const aux::bytes &chain_id, int topNum) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return std::vector<block>();
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return std::vector<block>();
         }
 
         std::vector<block> blocks;
         if (topNum > 0) {
-            auto head_block = m_head_blocks[chain_id];
+            auto head_block = ctx->m_head_block;
             if (!head_block.empty()) {
                 blocks.push_back(head_block);
                 topNum--;
@@ -3553,17 +3724,18 @@ namespace ip2::blockchain {
     }
 
     std::int64_t blockchain::getMedianTxFee(const aux::bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return 0;
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return 0;
         }
 
-        std::vector<transaction> txs = m_tx_pools[chain_id].get_top_ten_fee_transactions();
+        std::vector<transaction> txs = ctx->m_tx_pool.get_top_ten_fee_transactions();
         auto size = txs.size();
         if (size > 0) {
             return txs[size / 2].fee();
@@ -3573,19 +3745,20 @@ namespace ip2::blockchain {
     }
 
     std::int64_t blockchain::getMiningTime(const aux::bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return -1;
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return -1;
         }
 
         dht::public_key *pk = m_ses.pubkey();
 
-        const auto &head_block = m_head_blocks[chain_id];
+        const auto &head_block = ctx->m_head_block;
 
         if (!head_block.empty()) {
             if (head_block.block_number() < 0) {
@@ -3623,18 +3796,19 @@ namespace ip2::blockchain {
     }
 
     std::set<dht::public_key> blockchain::get_access_list(const aux::bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return std::set<dht::public_key>();
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return std::set<dht::public_key>();
         }
 
         std::set<dht::public_key> peers;
-        auto& access_list = m_access_list[chain_id];
+        auto& access_list = ctx->m_access_list;
         for (auto const& item: access_list) {
             peers.insert(item.first);
         }
@@ -3643,12 +3817,13 @@ namespace ip2::blockchain {
     }
 
     std::set<dht::public_key> blockchain::get_ban_list(const aux::bytes &chain_id) {
-        if (m_chains.find(chain_id) == m_chains.end()) {
+        auto *ctx = find_chain(chain_id);
+        if (ctx == nullptr || !ctx->m_followed) {
             log(LOG_ERR, "INFO: Unfollowed chain[%s]", aux::toHex(chain_id).c_str());
             return std::set<dht::public_key>();
         }
 
-        if (!m_chain_connected[chain_id]) {
+        if (!ctx->m_connected) {
             log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
             return std::set<dht::public_key>();
         }
@@ -3782,7 +3957,7 @@ namespace ip2::blockchain {
 
 //        bool is_new = false;
         
-        auto &acl = m_access_list[chain_id];
+        auto &acl = chain(chain_id).m_access_list;
 
         log(LOG_INFO, "INFO: chain[%s] update peer[%s] time:%" PRId64,
             aux::toHex(chain_id).c_str(), aux::toHex(peer.bytes).c_str(), timestamp);
@@ -3849,7 +4024,7 @@ namespace ip2::blockchain {
     }
 
     dht::public_key blockchain::select_peer_randomly_from_acl(const bytes &chain_id) {
-        auto const &acl = m_access_list[chain_id];
+        auto const &acl = chain(chain_id).m_access_list;
         srand(get_total_microseconds());
         // note: acl may be empty, if acl size == 0, maybe crush
         if (!acl.empty()) {
@@ -3880,14 +4055,17 @@ namespace ip2::blockchain {
         try {
             common::signal_entry signalEntry(payload);
 
-            auto &chain_id = m_short_chain_id_table[signalEntry.m_short_chain_id];
-
-            if (m_chains.find(chain_id) == m_chains.end()) {
-                log(LOG_INFO, "INFO: Data from unfollowed chain chain[%s]", aux::toHex(chain_id).c_str());
+            auto it = m_short_chain_id_table.find(signalEntry.m_short_chain_id);
+            auto *ctx = it != m_short_chain_id_table.end() ? chain_at(it->second) : nullptr;
+            if (ctx == nullptr || !ctx->m_followed) {
+                log(LOG_INFO, "INFO: Data from unfollowed chain chain[%s]",
+                    aux::toHex(signalEntry.m_short_chain_id).c_str());
                 return;
             }
 
-            if (!m_chain_connected[chain_id]) {
+            auto const chain_id = ctx->m_chain_id;
+
+            if (!ctx->m_connected) {
                 log(LOG_ERR, "INFO: Unconnected chain[%s]", aux::toHex(chain_id).c_str());
                 return;
             }
@@ -3980,7 +4158,7 @@ namespace ip2::blockchain {
     void blockchain::print_acl_info(const aux::bytes &chain_id) {
         // peer list log
         // acl
-        auto &acl = m_access_list[chain_id];
+        auto &acl = chain(chain_id).m_access_list;
         for (auto const &item: acl) {
             log(LOG_INFO, "-----ACL: peer[%s], info[%s]", aux::toHex(item.first.bytes).c_str(),
                 item.second.to_string().c_str());
@@ -0,0 +1,148 @@
+/*
+Copyright (c) 2021, TaiXiang Cui
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "ip2/blockchain/chain_reader.hpp"
+
+#include "ip2/aux_/scope_end.hpp"
+
+namespace ip2::blockchain {
+
+    chain_reader::~chain_reader() {
+        for (auto db: m_idle_connections) {
+            sqlite3_close_v2(db);
+        }
+    }
+
+    sqlite3 *chain_reader::acquire() {
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            if (!m_idle_connections.empty()) {
+                auto db = m_idle_connections.back();
+                m_idle_connections.pop_back();
+                return db;
+            }
+        }
+
+        sqlite3 *db = nullptr;
+        int ok = sqlite3_open_v2(m_db_path.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (ok != SQLITE_OK) {
+            sqlite3_close_v2(db);
+            return nullptr;
+        }
+        // wait for writer checkpoint instead of failing
+        sqlite3_busy_timeout(db, 100);
+
+        return db;
+    }
+
+    void chain_reader::release(sqlite3 *db) {
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            if (m_idle_connections.size() < chain_reader_max_idle_connections) {
+                m_idle_connections.push_back(db);
+                return;
+            }
+        }
+
+        sqlite3_close_v2(db);
+    }
+
+    std::shared_ptr<const chain_reader::head_blocks> chain_reader::snapshot() const {
+        return std::atomic_load(&m_head_blocks);
+    }
+
+    void chain_reader::publish_head_block(const aux::bytes &chain_id, const block &blk) {
+        auto blocks = std::make_shared<head_blocks>(*snapshot());
+        (*blocks)[chain_id] = blk;
+        std::atomic_store(&m_head_blocks, std::shared_ptr<const head_blocks>(std::move(blocks)));
+    }
+
+    void chain_reader::remove_head_block(const aux::bytes &chain_id) {
+        auto blocks = std::make_shared<head_blocks>(*snapshot());
+        blocks->erase(chain_id);
+        std::atomic_store(&m_head_blocks, std::shared_ptr<const head_blocks>(std::move(blocks)));
+    }
+
+    void chain_reader::clear_head_blocks() {
+        std::atomic_store(&m_head_blocks, std::make_shared<const head_blocks>());
+    }
+
+    block chain_reader::get_head_block(const aux::bytes &chain_id) const {
+        auto blocks = snapshot();
+        auto it = blocks->find(chain_id);
+        if (it != blocks->end())
+            return it->second;
+
+        return block();
+    }
+
+    account chain_reader::get_account(const aux::bytes &chain_id, const dht::public_key &pubKey) {
+        auto db = acquire();
+        if (db == nullptr)
+            return account();
+        auto release_db = aux::scope_end([&]{ release(db); });
+
+        repository_impl repo(db);
+        return repo.get_account(chain_id, pubKey);
+    }
+
+    block chain_reader::get_block_by_number(const aux::bytes &chain_id, std::int64_t block_number) {
+        auto db = acquire();
+        if (db == nullptr)
+            return block();
+        auto release_db = aux::scope_end([&]{ release(db); });
+
+        repository_impl repo(db);
+        return repo.get_main_chain_block_by_number(chain_id, block_number);
+    }
+
+    block chain_reader::get_block_by_hash(const aux::bytes &chain_id, const sha1_hash &hash) {
+        auto db = acquire();
+        if (db == nullptr)
+            return block();
+        auto release_db = aux::scope_end([&]{ release(db); });
+
+        repository_impl repo(db);
+        return repo.get_block_by_hash(chain_id, hash);
+    }
+
+    std::vector<block> chain_reader::get_top_tip_blocks(const aux::bytes &chain_id, int topNum) {
+        std::vector<block> blocks;
+        if (topNum <= 0)
+            return blocks;
+
+        auto head_block = get_head_block(chain_id);
+        if (head_block.empty())
+            return blocks;
+
+        blocks.push_back(head_block);
+        topNum--;
+
+        auto previous_hash = head_block.previous_block_hash();
+        if (previous_hash.is_all_zeros() || topNum <= 0)
+            return blocks;
+
+        auto db = acquire();
+        if (db == nullptr)
+            return blocks;
+        auto release_db = aux::scope_end([&]{ release(db); });
+
+        repository_impl repo(db);
+        while (!previous_hash.is_all_zeros() && topNum > 0) {
+            auto b = repo.get_block_by_hash(chain_id, previous_hash);
+            if (b.empty())
+                break;
+
+            blocks.push_back(b);
+            previous_hash = b.previous_block_hash();
+            topNum--;
+        }
+
+        return blocks;
+    }
+}
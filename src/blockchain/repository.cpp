@@ -50,6 +50,85 @@ namespace ip2::blockchain {
         return "t" + aux::toHex(hash) + table_acl;
     }
 
+    bool repository::apply_block_state(const block &blk) {
+        auto const& chain_id = blk.chain_id();
+
+        std::map<dht::public_key, account> accounts;
+        accounts[blk.miner()] = get_account(chain_id, blk.miner());
+
+        bool has_transfer_tx = false;
+        for (auto const& tx: blk.txs()) {
+            if (tx.type() != type_transfer)
+                continue;
+
+            has_transfer_tx = true;
+            for (auto const& peer: {tx.sender(), tx.receiver()}) {
+                if (accounts.find(peer) == accounts.end()) {
+                    accounts[peer] = get_account(chain_id, peer);
+                }
+            }
+
+            accounts[blk.miner()].add_balance(tx.fee());
+            accounts[tx.receiver()].add_balance(tx.amount());
+            accounts[tx.sender()].subtract_balance(tx.cost());
+            accounts[tx.sender()].increase_nonce();
+        }
+
+        // add bonus to miner, power++ if no transfer tx
+        accounts[blk.miner()].add_balance(MINER_BONUS);
+        if (!has_transfer_tx) {
+            accounts[blk.miner()].increase_power();
+        }
+
+        for (auto const& item: accounts) {
+            if (!save_account(chain_id, item.second))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool repository::rollback_block_state(const block &blk) {
+        auto const& chain_id = blk.chain_id();
+
+        std::map<dht::public_key, account> accounts;
+        accounts[blk.miner()] = get_account(chain_id, blk.miner());
+
+        bool has_transfer_tx = false;
+        auto const& txs = blk.txs();
+        // undo in reverse order
+        for (auto it = txs.rbegin(); it != txs.rend(); ++it) {
+            auto const& tx = *it;
+            if (tx.type() != type_transfer)
+                continue;
+
+            has_transfer_tx = true;
+            for (auto const& peer: {tx.sender(), tx.receiver()}) {
+                if (accounts.find(peer) == accounts.end()) {
+                    accounts[peer] = get_account(chain_id, peer);
+                }
+            }
+
+            accounts[blk.miner()].subtract_balance(tx.fee());
+            accounts[tx.receiver()].subtract_balance(tx.amount());
+            accounts[tx.sender()].add_balance(tx.cost());
+            accounts[tx.sender()].decrease_nonce();
+        }
+
+        // subtract bonus, power-- if no transfer tx
+        accounts[blk.miner()].subtract_balance(MINER_BONUS);
+        if (!has_transfer_tx) {
+            accounts[blk.miner()].decrease_power();
+        }
+
+        for (auto const& item: accounts) {
+            if (!save_account(chain_id, item.second))
+                return false;
+        }
+
+        return true;
+    }
+
 //    bool repository::save_main_chain_block(const block &blk) {
 //        return save_block(blk, true);
 //    }
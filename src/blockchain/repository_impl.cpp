@@ -580,10 +580,10 @@ namespace ip2::blockchain {
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 9));
                 length = sqlite3_column_bytes(stmt, 9);
-                transaction tx;
+                std::vector<transaction> txs;
                 if (length > 0) {
                     std::string tx_encode(p, length);
-                    tx = transaction(tx_encode);
+                    txs = block::txs_from_encode(version, tx_encode);
                 }
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 10));
@@ -595,7 +595,7 @@ namespace ip2::blockchain {
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 12));
                 sha1_hash hash(p);
 
-                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, tx, miner, sig, hash);
+                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, txs, miner, sig, hash);
                 break;
             }
         }
@@ -640,10 +640,10 @@ namespace ip2::blockchain {
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 9));
                 length = sqlite3_column_bytes(stmt, 9);
-                transaction tx;
+                std::vector<transaction> txs;
                 if (length > 0) {
                     std::string tx_encode(p, length);
-                    tx = transaction(tx_encode);
+                    txs = block::txs_from_encode(version, tx_encode);
                 }
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 10));
@@ -652,7 +652,7 @@ namespace ip2::blockchain {
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 11));
                 dht::signature sig(p);
 
-                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, tx, miner, sig, hash);
+                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, txs, miner, sig, hash);
                 break;
             }
         }
@@ -686,10 +686,10 @@ namespace ip2::blockchain {
         sqlite3_bind_int64(stmt, 8, static_cast<std::int64_t>(blk.cumulative_difficulty()));
         sqlite3_bind_blob(stmt, 9, blk.generation_signature().data(), ip2::sha1_hash::size(), nullptr);
         sqlite3_bind_blob(stmt, 10, blk.multiplex_hash().data(), ip2::sha1_hash::size(), nullptr);
-        if (blk.tx().empty()) {
+        if (blk.txs().empty()) {
             sqlite3_bind_null(stmt, 11);
         } else {
-            std::string tx_encode = blk.tx().get_encode();
+            std::string tx_encode = blk.get_txs_encode();
             sqlite3_bind_blob(stmt, 11, tx_encode.data(), tx_encode.size(), SQLITE_TRANSIENT);
         }
         sqlite3_bind_blob(stmt, 12, blk.miner().bytes.data(), dht::public_key::len, nullptr);
@@ -728,10 +728,10 @@ namespace ip2::blockchain {
         sqlite3_bind_int64(stmt, 8, static_cast<std::int64_t>(blk.cumulative_difficulty()));
         sqlite3_bind_blob(stmt, 9, blk.generation_signature().data(), ip2::sha1_hash::size(), nullptr);
         sqlite3_bind_blob(stmt, 10, blk.multiplex_hash().data(), ip2::sha1_hash::size(), nullptr);
-        if (blk.tx().empty()) {
+        if (blk.txs().empty()) {
             sqlite3_bind_null(stmt, 11);
         } else {
-            auto tx_encode = blk.tx().get_encode();
+            auto tx_encode = blk.get_txs_encode();
             sqlite3_bind_blob(stmt, 11, tx_encode.data(), tx_encode.size(), SQLITE_TRANSIENT);
         }
         sqlite3_bind_blob(stmt, 12, blk.miner().bytes.data(), dht::public_key::len, nullptr);
@@ -802,10 +802,10 @@ namespace ip2::blockchain {
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 9));
                 length = sqlite3_column_bytes(stmt, 9);
-                transaction tx;
+                std::vector<transaction> txs;
                 if (length > 0) {
                     std::string tx_encode(p, length);
-                    tx = transaction(tx_encode);
+                    txs = block::txs_from_encode(version, tx_encode);
                 }
 
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 10));
@@ -817,7 +817,7 @@ namespace ip2::blockchain {
                 p = static_cast<const char *>(sqlite3_column_blob(stmt, 12));
                 sha1_hash hash(p);
 
-                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, tx, miner, sig, hash);
+                blk = block(chainID, version, timestamp, number, previous_hash, base_target, difficulty, generation_signature, state_root, txs, miner, sig, hash);
                 break;
             }
         }
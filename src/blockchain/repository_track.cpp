@@ -6,200 +6,440 @@ You may use, distribute and modify this code under the terms of the BSD license,
 see LICENSE file.
 */
 
+#include <algorithm>
+
 #include "ip2/blockchain/repository_track.hpp"
 
 namespace ip2::blockchain {
 
+    bool repository_track::empty() const {
+        return m_cleared_chains.empty() && m_accounts.empty() && m_deleted_accounts.empty() &&
+               m_state_arrays.empty() && m_deleted_state_arrays.empty() && m_saved_blocks.empty() &&
+               m_connected_blocks.empty() && m_discarded_blocks.empty();
+    }
+
+    void repository_track::clear() {
+        m_cleared_chains.clear();
+        m_accounts.clear();
+        m_deleted_accounts.clear();
+        m_state_arrays.clear();
+        m_deleted_state_arrays.clear();
+        m_saved_blocks.clear();
+        m_connected_blocks.clear();
+        m_discarded_blocks.clear();
+    }
+
+    const block *repository_track::find_block(const aux::bytes &chain_id, const sha1_hash &hash) const {
+        for (auto const* blocks: {&m_connected_blocks, &m_discarded_blocks, &m_saved_blocks}) {
+            auto it = std::find_if(blocks->begin(), blocks->end(), [&](const block &blk) {
+                return blk.sha1() == hash && blk.chain_id() == chain_id;
+            });
+            if (it != blocks->end())
+                return &*it;
+        }
+
+        return nullptr;
+    }
+
+    bool repository_track::is_discarded(const aux::bytes &chain_id, const sha1_hash &hash) const {
+        return std::any_of(m_discarded_blocks.begin(), m_discarded_blocks.end(), [&](const block &blk) {
+            return blk.sha1() == hash && blk.chain_id() == chain_id;
+        });
+    }
+
+    bool repository_track::flush() {
+        for (auto const& chain_id: m_cleared_chains) {
+            if (!m_repository->clear_all_state(chain_id))
+                return false;
+        }
+
+        for (auto const& key: m_deleted_accounts) {
+            if (!m_repository->delete_account(key.first, key.second))
+                return false;
+        }
+
+        for (auto const& item: m_accounts) {
+            if (!m_repository->save_account(item.first.first, item.second))
+                return false;
+        }
+
+        for (auto const& key: m_deleted_state_arrays) {
+            if (!m_repository->delete_state_array_by_hash(key.first, key.second))
+                return false;
+        }
+
+        for (auto const& item: m_state_arrays) {
+            if (!m_repository->save_state_array(item.first.first, item.second))
+                return false;
+        }
+
+        for (auto const& blk: m_saved_blocks) {
+            if (!m_repository->save_block_if_not_exist(blk))
+                return false;
+        }
+
+        for (auto const& blk: m_discarded_blocks) {
+            if (!m_repository->set_block_non_main_chain(blk.chain_id(), blk.sha1()))
+                return false;
+        }
+
+        // replace, since a connected block may not be in the repository yet
+        for (auto const& blk: m_connected_blocks) {
+            if (!m_repository->save_main_chain_block(blk))
+                return false;
+        }
+
+        return true;
+    }
+
     bool repository_track::init() {
-        return false;
+        return true;
     }
 
     bool repository_track::begin_transaction() {
-        return false;
+        // start tracking from the repository as it is now
+        clear();
+        return true;
     }
 
     bool repository_track::commit() {
-        return false;
+        if (empty())
+            return true;
+
+        if (!m_repository->begin_transaction()) {
+            clear();
+            return false;
+        }
+
+        if (!flush()) {
+            m_repository->rollback();
+            clear();
+            return false;
+        }
+
+        clear();
+        return m_repository->commit();
     }
 
     bool repository_track::rollback() {
-        return false;
+        clear();
+        return true;
     }
 
     std::set<aux::bytes> repository_track::get_all_chains() {
-        return std::set<aux::bytes>();
+        return m_repository->get_all_chains();
     }
 
     bool repository_track::add_new_chain(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->add_new_chain(chain_id);
     }
 
     bool repository_track::delete_chain(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_chain(chain_id);
     }
 
-//    bool repository_track::set_head_block_hash(const aux::bytes &chain_id, const sha256_hash &hash) {
-//        return false;
-//    }
-//
-//    bool repository_track::delete_head_block_hash(const aux::bytes &chain_id) {
-//        return false;
-//    }
-
     bool repository_track::create_state_array_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->create_state_array_db(chain_id);
     }
 
     bool repository_track::delete_state_array_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_state_array_db(chain_id);
     }
 
     state_array repository_track::get_state_array_by_hash(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return state_array(ip2::entry());
+        hash_key const key(chain_id, hash);
+        auto it = m_state_arrays.find(key);
+        if (it != m_state_arrays.end())
+            return it->second;
+
+        if (m_deleted_state_arrays.find(key) != m_deleted_state_arrays.end())
+            return state_array(ip2::entry());
+
+        return m_repository->get_state_array_by_hash(chain_id, hash);
     }
 
     bool repository_track::is_state_array_in_db(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return false;
+        hash_key const key(chain_id, hash);
+        if (m_state_arrays.find(key) != m_state_arrays.end())
+            return true;
+
+        if (m_deleted_state_arrays.find(key) != m_deleted_state_arrays.end())
+            return false;
+
+        return m_repository->is_state_array_in_db(chain_id, hash);
     }
 
     bool repository_track::save_state_array(const aux::bytes &chain_id, const state_array &stateArray) {
-        return false;
+        hash_key key(chain_id, stateArray.sha1());
+        m_deleted_state_arrays.erase(key);
+        m_state_arrays[std::move(key)] = stateArray;
+        return true;
     }
 
     bool repository_track::delete_state_array_by_hash(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return false;
+        hash_key key(chain_id, hash);
+        m_state_arrays.erase(key);
+        m_deleted_state_arrays.insert(std::move(key));
+        return true;
     }
 
     bool repository_track::create_state_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->create_state_db(chain_id);
     }
 
     bool repository_track::delete_state_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_state_db(chain_id);
     }
 
     bool repository_track::clear_all_state(const aux::bytes &chain_id) {
-        return false;
+        for (auto it = m_accounts.begin(); it != m_accounts.end();) {
+            if (it->first.first == chain_id)
+                it = m_accounts.erase(it);
+            else
+                ++it;
+        }
+        for (auto it = m_deleted_accounts.begin(); it != m_deleted_accounts.end();) {
+            if (it->first == chain_id)
+                it = m_deleted_accounts.erase(it);
+            else
+                ++it;
+        }
+
+        m_cleared_chains.insert(chain_id);
+        return true;
     }
 
     account repository_track::get_account(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return account(pubKey);
+        account_key const key(chain_id, pubKey);
+        auto it = m_accounts.find(key);
+        if (it != m_accounts.end())
+            return it->second;
+
+        if (m_deleted_accounts.find(key) != m_deleted_accounts.end() ||
+            m_cleared_chains.find(chain_id) != m_cleared_chains.end())
+            return account(pubKey);
+
+        return m_repository->get_account(chain_id, pubKey);
     }
 
     bool repository_track::is_account_existed(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return false;
+        account_key const key(chain_id, pubKey);
+        if (m_accounts.find(key) != m_accounts.end())
+            return true;
+
+        if (m_deleted_accounts.find(key) != m_deleted_accounts.end() ||
+            m_cleared_chains.find(chain_id) != m_cleared_chains.end())
+            return false;
+
+        return m_repository->is_account_existed(chain_id, pubKey);
     }
 
     bool repository_track::save_account(const aux::bytes &chain_id, const account &act) {
-        return false;
+        account_key key(chain_id, act.peer());
+        m_deleted_accounts.erase(key);
+        m_accounts[std::move(key)] = act;
+        return true;
     }
 
     bool repository_track::delete_account(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return false;
+        account_key key(chain_id, pubKey);
+        m_accounts.erase(key);
+        m_deleted_accounts.insert(std::move(key));
+        return true;
     }
 
     std::vector<account> repository_track::get_all_effective_state(const aux::bytes &chain_id) {
-        return std::vector<account>();
+        std::vector<account> accounts;
+        if (m_cleared_chains.find(chain_id) == m_cleared_chains.end()) {
+            // the repository only returns its top accounts, an account the track
+            // lowered may let one in that it didn't return. Good enough for
+            // speculative execution, the committed state is exact
+            for (auto &act: m_repository->get_all_effective_state(chain_id)) {
+                account_key const key(chain_id, act.peer());
+                if (m_accounts.find(key) == m_accounts.end() &&
+                    m_deleted_accounts.find(key) == m_deleted_accounts.end())
+                    accounts.push_back(std::move(act));
+            }
+        }
+
+        for (auto const& item: m_accounts) {
+            if (item.first.first == chain_id)
+                accounts.push_back(item.second);
+        }
+
+        // same order as the repository
+        std::sort(accounts.begin(), accounts.end(), [](const account &lhs, const account &rhs) {
+            if (lhs.balance() != rhs.balance())
+                return lhs.balance() > rhs.balance();
+            if (lhs.power() != rhs.power())
+                return lhs.power() > rhs.power();
+            if (lhs.nonce() != rhs.nonce())
+                return lhs.nonce() > rhs.nonce();
+            return rhs.peer() < lhs.peer();
+        });
+        if (accounts.size() > static_cast<std::size_t>(MAX_ACCOUNT_SIZE))
+            accounts.resize(static_cast<std::size_t>(MAX_ACCOUNT_SIZE));
+
+        return accounts;
     }
 
     dht::public_key repository_track::get_peer_from_state_db_randomly(const aux::bytes &chain_id) {
-        return dht::public_key();
+        return m_repository->get_peer_from_state_db_randomly(chain_id);
     }
 
     bool repository_track::create_block_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->create_block_db(chain_id);
     }
 
     bool repository_track::delete_block_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_block_db(chain_id);
     }
 
     block repository_track::get_head_block(const aux::bytes &chain_id) {
-        return block();
+        // the repository's head, unless the track took it off the main chain
+        block head = m_repository->get_head_block(chain_id);
+        while (!head.empty() && is_discarded(chain_id, head.sha1())) {
+            head = get_main_chain_block_by_number(chain_id, head.block_number() - 1);
+        }
+
+        for (auto const& blk: m_connected_blocks) {
+            if (blk.chain_id() == chain_id && (head.empty() || blk.block_number() > head.block_number()))
+                head = blk;
+        }
+
+        return head;
     }
 
     block repository_track::get_block_by_hash(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return block();
+        auto const* blk = find_block(chain_id, hash);
+        if (blk != nullptr)
+            return *blk;
+
+        return m_repository->get_block_by_hash(chain_id, hash);
     }
 
     bool repository_track::save_block_if_not_exist(const block &blk) {
-        return false;
+        if (find_block(blk.chain_id(), blk.sha1()) != nullptr)
+            return true;
+
+        if (!m_repository->get_block_by_hash(blk.chain_id(), blk.sha1()).empty())
+            return true;
+
+        m_saved_blocks.push_back(blk);
+        return true;
     }
 
     bool repository_track::save_main_chain_block(const block &blk) {
-        return false;
+        auto const same = [&](const block &b) {
+            return b.sha1() == blk.sha1() && b.chain_id() == blk.chain_id();
+        };
+        m_discarded_blocks.erase(std::remove_if(m_discarded_blocks.begin(), m_discarded_blocks.end(), same),
+                                 m_discarded_blocks.end());
+        m_connected_blocks.erase(std::remove_if(m_connected_blocks.begin(), m_connected_blocks.end(), same),
+                                 m_connected_blocks.end());
+
+        m_connected_blocks.push_back(blk);
+        return true;
     }
 
     bool repository_track::delete_block_by_hash(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return false;
+        return m_repository->delete_block_by_hash(chain_id, hash);
     }
 
     block repository_track::get_main_chain_block_by_number(const aux::bytes &chain_id, std::int64_t block_number) {
-        return block();
+        for (auto const& blk: m_connected_blocks) {
+            if (blk.block_number() == block_number && blk.chain_id() == chain_id)
+                return blk;
+        }
+
+        auto blk = m_repository->get_main_chain_block_by_number(chain_id, block_number);
+        if (!blk.empty() && is_discarded(chain_id, blk.sha1()))
+            return block();
+
+        return blk;
     }
 
     bool repository_track::delete_all_blocks_less_than_number(const aux::bytes &chain_id, std::int64_t block_number) {
-        return false;
+        return m_repository->delete_all_blocks_less_than_number(chain_id, block_number);
     }
 
     bool repository_track::set_block_non_main_chain(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return false;
+        if (is_discarded(chain_id, hash))
+            return true;
+
+        auto blk = get_block_by_hash(chain_id, hash);
+        // like an update that matches no row
+        if (blk.empty())
+            return true;
+
+        m_connected_blocks.erase(std::remove_if(m_connected_blocks.begin(), m_connected_blocks.end(),
+                                                [&](const block &b) {
+            return b.sha1() == hash && b.chain_id() == chain_id;
+        }), m_connected_blocks.end());
+
+        m_discarded_blocks.push_back(std::move(blk));
+        return true;
     }
 
     bool repository_track::set_block_main_chain(const aux::bytes &chain_id, const sha1_hash &hash) {
-        return false;
+        auto blk = get_block_by_hash(chain_id, hash);
+        // like an update that matches no row
+        if (blk.empty())
+            return true;
+
+        return save_main_chain_block(blk);
     }
 
     bool repository_track::set_all_block_non_main_chain(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->set_all_block_non_main_chain(chain_id);
     }
 
     bool repository_track::create_peer_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->create_peer_db(chain_id);
     }
 
     bool repository_track::delete_peer_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_peer_db(chain_id);
     }
 
     dht::public_key repository_track::get_peer_from_peer_db_randomly(const aux::bytes &chain_id) {
-        return dht::public_key();
+        return m_repository->get_peer_from_peer_db_randomly(chain_id);
     }
 
     bool repository_track::delete_peer_in_peer_db(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return false;
+        return m_repository->delete_peer_in_peer_db(chain_id, pubKey);
     }
 
     bool repository_track::add_peer_in_peer_db(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return false;
+        return m_repository->add_peer_in_peer_db(chain_id, pubKey);
     }
 
     std::string repository_track::get_test_tx_string(const aux::bytes &chain_id) {
-        return std::string();
+        return m_repository->get_test_tx_string(chain_id);
     }
 
     int repository_track::get_test_tx_size(const aux::bytes &chain_id) {
-        return 0;
+        return m_repository->get_test_tx_size(chain_id);
     }
 
     bool repository_track::create_acl_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->create_acl_db(chain_id);
     }
 
     bool repository_track::delete_acl_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->delete_acl_db(chain_id);
     }
 
     std::set<dht::public_key> repository_track::get_all_peer_in_acl_db(const aux::bytes &chain_id) {
-        return std::set<dht::public_key>();
+        return m_repository->get_all_peer_in_acl_db(chain_id);
     }
 
     bool repository_track::clear_acl_db(const aux::bytes &chain_id) {
-        return false;
+        return m_repository->clear_acl_db(chain_id);
     }
 
     bool repository_track::add_peer_in_acl_db(const aux::bytes &chain_id, const dht::public_key &pubKey) {
-        return false;
+        return m_repository->add_peer_in_acl_db(chain_id, pubKey);
     }
 
 //    bool repository_track::create_peer_db(const aux::bytes &chain_id) {
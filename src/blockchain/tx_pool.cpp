@@ -11,37 +11,120 @@ see LICENSE file.
 
 namespace ip2::blockchain {
 
+    void tx_pool::set_capacity(int max_size_by_fee, int max_size_by_timestamp) {
+        m_max_size_by_fee = max_size_by_fee;
+        m_max_size_by_timestamp = max_size_by_timestamp;
+
+        while (!m_fee_index.empty() && m_fee_index.size() > static_cast<std::size_t>(m_max_size_by_fee)) {
+            remove_min_fee_tx();
+        }
+
+        while (!m_timestamp_index.empty() && m_timestamp_index.size() > static_cast<std::size_t>(m_max_size_by_timestamp)) {
+            remove_oldest_tx();
+        }
+    }
+
+    tx_handle tx_pool::find(const sha1_hash &txid) const {
+        auto it = m_txid_index.find(txid);
+        if (it != m_txid_index.end())
+            return it->second;
+
+        return invalid_tx_handle;
+    }
+
+    tx_handle tx_pool::insert(const transaction &tx) {
+        tx_handle handle;
+        if (!m_free_slots.empty()) {
+            handle = m_free_slots.back();
+            m_free_slots.pop_back();
+            m_arena[handle] = tx;
+        } else {
+            handle = static_cast<tx_handle>(m_arena.size());
+            m_arena.push_back(tx);
+        }
+
+        m_txid_index[tx.sha1()] = handle;
+
+        return handle;
+    }
+
+    void tx_pool::erase(tx_handle handle) {
+        auto const& tx = m_arena[handle];
+        auto const& txid = tx.sha1();
+
+        if (tx.type() == tx_type::type_transfer) {
+            m_fee_index.erase(tx_entry_with_fee(txid, tx.fee()));
+            auto it = m_account_fee_index.find(tx.sender());
+            if (it != m_account_fee_index.end() && it->second == handle) {
+                m_account_fee_index.erase(it);
+            }
+        } else {
+            m_timestamp_index.erase(tx_entry_with_timestamp(txid, tx.timestamp()));
+            auto it = m_account_timestamp_index.find(tx.sender());
+            if (it != m_account_timestamp_index.end()) {
+                it->second.erase(tx_entry_with_timestamp(txid, tx.timestamp()));
+                if (it->second.empty()) {
+                    m_account_timestamp_index.erase(it);
+                }
+            }
+        }
+
+        m_txid_index.erase(txid);
+
+        // release tx memory, keep slot for reuse
+        m_arena[handle] = transaction();
+        m_free_slots.push_back(handle);
+    }
+
     transaction tx_pool::get_best_fee_transaction() const {
-        auto it = m_ordered_txs_by_fee.rbegin();
-        if (it != m_ordered_txs_by_fee.rend()) {
-            auto it_tx = m_all_txs_by_fee.find(it->txid());
-            if (it_tx != m_all_txs_by_fee.end())
-                return it_tx->second;
+        auto it = m_fee_index.rbegin();
+        if (it != m_fee_index.rend()) {
+            return m_arena[it->handle()];
         }
 
         return transaction();
     }
 
     transaction tx_pool::get_latest_note_transaction() const {
-        for (auto it = m_ordered_txs_by_timestamp.rbegin(); it != m_ordered_txs_by_timestamp.rend(); it++) {
-            auto it_tx = m_all_txs_by_timestamp.find(it->txid());
-            if (it_tx != m_all_txs_by_timestamp.end() && it_tx->second.type() == tx_type::type_note)
-                return it_tx->second;
+        auto it = m_timestamp_index.rbegin();
+        if (it != m_timestamp_index.rend()) {
+            return m_arena[it->handle()];
         }
-//        auto it = m_ordered_txs_by_timestamp.rbegin();
-//        if (it != m_ordered_txs_by_timestamp.rend()) {
-//            auto it_tx = m_all_txs_by_timestamp.find(it->txid());
-//            if (it_tx != m_all_txs_by_timestamp.end())
-//                return it_tx->second;
-//        }
 
         return transaction();
     }
 
+    std::vector<transaction> tx_pool::get_block_transactions(std::size_t max_num, std::size_t max_encode_size) const {
+        std::vector<transaction> txs;
+        std::size_t total_size = 0;
+
+        for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend() && txs.size() < max_num; ++it) {
+            auto const& tx = m_arena[it->handle()];
+            auto size = tx.get_encode_size();
+            if (total_size + size > max_encode_size)
+                continue;
+
+            total_size += size;
+            txs.push_back(tx);
+        }
+
+        for (auto it = m_timestamp_index.rbegin(); it != m_timestamp_index.rend() && txs.size() < max_num; ++it) {
+            auto const& tx = m_arena[it->handle()];
+            auto size = tx.get_encode_size();
+            if (total_size + size > max_encode_size)
+                continue;
+
+            total_size += size;
+            txs.push_back(tx);
+        }
+
+        return txs;
+    }
+
     aux::bytes tx_pool::get_hash_prefix_array_by_fee() const {
         ip2::aux::bytes hash_prefix_array;
         int count = 0;
-        for (auto it = m_ordered_txs_by_fee.rbegin(); it != m_ordered_txs_by_fee.rend(); ++it) {
+        for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend(); ++it) {
             count++;
             hash_prefix_array.push_back(it->txid()[0]);
 
@@ -53,13 +136,12 @@ namespace ip2::blockchain {
         return hash_prefix_array;
     }
 
-    std::vector<transaction> tx_pool::get_top_ten_fee_transactions() {
+    std::vector<transaction> tx_pool::get_top_ten_fee_transactions() const {
         std::vector<transaction> txs;
         int count = 0;
-        for (auto it = m_ordered_txs_by_fee.rbegin(); it != m_ordered_txs_by_fee.rend(); ++it) {
+        for (auto it = m_fee_index.rbegin(); it != m_fee_index.rend(); ++it) {
             count++;
-            auto &tx = m_all_txs_by_fee[it->txid()];
-            txs.push_back(tx);
+            txs.push_back(m_arena[it->handle()]);
 
             if (10 == count) {
                 break;
@@ -72,7 +154,7 @@ namespace ip2::blockchain {
     aux::bytes tx_pool::get_hash_prefix_array_by_timestamp() const {
         ip2::aux::bytes hash_prefix_array;
         int count = 0;
-        for (auto it = m_ordered_txs_by_timestamp.rbegin(); it != m_ordered_txs_by_timestamp.rend(); ++it) {
+        for (auto it = m_timestamp_index.rbegin(); it != m_timestamp_index.rend(); ++it) {
             count++;
             hash_prefix_array.push_back(it->txid()[0]);
 
@@ -84,13 +166,12 @@ namespace ip2::blockchain {
         return hash_prefix_array;
     }
 
-    std::vector<transaction> tx_pool::get_top_ten_timestamp_transactions() {
+    std::vector<transaction> tx_pool::get_top_ten_timestamp_transactions() const {
         std::vector<transaction> txs;
         int count = 0;
-        for (auto it = m_ordered_txs_by_timestamp.rbegin(); it != m_ordered_txs_by_timestamp.rend(); ++it) {
+        for (auto it = m_timestamp_index.rbegin(); it != m_timestamp_index.rend(); ++it) {
             count++;
-            auto &tx = m_all_txs_by_timestamp[it->txid()];
-            txs.push_back(tx);
+            txs.push_back(m_arena[it->handle()]);
 
             if (10 == count) {
                 break;
@@ -100,13 +181,12 @@ namespace ip2::blockchain {
         return txs;
     }
 
-    std::set<sha1_hash> tx_pool::get_top_40_note_txid() {
+    std::set<sha1_hash> tx_pool::get_top_40_note_txid() const {
         std::set<sha1_hash> txid_set;
         int count = 0;
-        for (auto it = m_ordered_txs_by_timestamp.rbegin(); it != m_ordered_txs_by_timestamp.rend(); ++it) {
+        for (auto it = m_timestamp_index.rbegin(); it != m_timestamp_index.rend(); ++it) {
             count++;
-            auto &tx = m_all_txs_by_timestamp[it->txid()];
-            txid_set.insert(tx.sha1());
+            txid_set.insert(it->txid());
 
             if (40 == count) {
                 break;
@@ -116,55 +196,45 @@ namespace ip2::blockchain {
         return txid_set;
     }
 
-    std::set<sha1_hash> tx_pool::get_all_note_txid() {
+    std::set<sha1_hash> tx_pool::get_all_note_txid() const {
         std::set<sha1_hash> txid_set;
-        for (auto it = m_ordered_txs_by_timestamp.rbegin(); it != m_ordered_txs_by_timestamp.rend(); ++it) {
-            auto &tx = m_all_txs_by_timestamp[it->txid()];
-            txid_set.insert(tx.sha1());
+        for (auto const& entry: m_timestamp_index) {
+            txid_set.insert(entry.txid());
         }
 
         return txid_set;
     }
 
     bool tx_pool::add_tx_to_fee_pool(const transaction &tx) {
+        // already in pool
+        if (m_txid_index.find(tx.sha1()) != m_txid_index.end())
+            return false;
+
         if (tx.fee() < get_min_allowed_fee())
             return false;
 
         // validate tx state
         auto sender_account = m_repository->get_account(tx.chain_id(), tx.sender());
-//        if (tx.type() == tx_type::type_transfer) {
-            if (sender_account.nonce() + 1 != tx.nonce() || sender_account.balance() < tx.cost())
-                return false;
-//        } else if (tx.type() == tx_type::type_note) {
-//            if (tx.timestamp() <= sender_account.note_timestamp() || sender_account.balance() < tx.cost())
-//                return false;
-//        } else {
-//            return false;
-//        }
-
-        auto it_txid = m_account_tx_by_fee.find(tx.sender());
+        if (sender_account.nonce() + 1 != tx.nonce() || sender_account.balance() < tx.cost())
+            return false;
+
+        auto it_handle = m_account_fee_index.find(tx.sender());
         // find in local
-        if (it_txid != m_account_tx_by_fee.end()) { // has in local
-            auto it_tx = m_all_txs_by_fee.find(it_txid->second);
-            if (it_tx != m_all_txs_by_fee.end()) {
-                auto old_tx = it_tx->second;
-                if (tx.fee() > old_tx.fee()) {
-                    // remove old tx
-                    m_all_txs_by_fee.erase(old_tx.sha1());
-                    m_account_tx_by_fee.erase(old_tx.sender());
-                    m_ordered_txs_by_fee.erase(tx_entry_with_fee(old_tx.sha1(), old_tx.fee()));
-                } else {
-                    return false;
-                }
+        if (it_handle != m_account_fee_index.end()) { // has in local
+            if (tx.fee() > m_arena[it_handle->second].fee()) {
+                // remove old tx
+                erase(it_handle->second);
+            } else {
+                return false;
             }
         }
 
         // insert new tx
-        m_all_txs_by_fee[tx.sha1()] = tx;
-        m_account_tx_by_fee[tx.sender()] = tx.sha1();
-        m_ordered_txs_by_fee.insert(tx_entry_with_fee(tx.sha1(), tx.fee()));
+        auto handle = insert(tx);
+        m_account_fee_index[tx.sender()] = handle;
+        m_fee_index.insert(tx_entry_with_fee(tx.sha1(), tx.fee(), handle));
 
-        if (m_all_txs_by_fee.size() > tx_pool_max_size_by_fee) {
+        if (m_fee_index.size() > static_cast<std::size_t>(m_max_size_by_fee)) {
             remove_min_fee_tx();
         }
 
@@ -172,46 +242,34 @@ namespace ip2::blockchain {
     }
 
     bool tx_pool::add_tx_to_time_pool(const transaction &tx) {
+        // already in pool
+        if (m_txid_index.find(tx.sha1()) != m_txid_index.end())
+            return false;
+
         if (tx.timestamp() <= get_oldest_allowed_timestamp())
             return false;
 
-        auto it_account_txid_set = m_account_tx_by_timestamp.find(tx.sender());
+        auto it_account = m_account_timestamp_index.find(tx.sender());
         // find in local
-        if (it_account_txid_set != m_account_tx_by_timestamp.end() &&
-            it_account_txid_set->second.size() >= time_pool_max_size_of_same_account) { // has in local
-            auto it_oldest_txid = it_account_txid_set->second.begin();
-            auto it_oldest_tx = m_all_txs_by_timestamp.find(*it_oldest_txid);
-            if (it_oldest_tx != m_all_txs_by_timestamp.end()) {
-                auto oldest_tx = it_oldest_tx->second;
-
-                // find oldest tx
-                for (auto const& txid: it_account_txid_set->second) {
-                    auto it_tx = m_all_txs_by_timestamp.find(txid);
-                    if (it_tx != m_all_txs_by_timestamp.end()) {
-                        if (it_tx->second.timestamp() < oldest_tx.timestamp()) {
-                            oldest_tx = it_tx->second;
-                        }
-                    }
-                }
-
+        if (it_account != m_account_timestamp_index.end() &&
+            it_account->second.size() >= time_pool_max_size_of_same_account) { // has in local
+            // oldest tx of this account
+            auto oldest = *it_account->second.begin();
+            if (tx.timestamp() > oldest.timestamp()) {
                 // remove oldest tx
-                if (tx.timestamp() > oldest_tx.timestamp()) {
-                    // remove oldest tx
-                    m_all_txs_by_timestamp.erase(oldest_tx.sha1());
-                    it_account_txid_set->second.erase(oldest_tx.sha1());
-                    m_ordered_txs_by_timestamp.erase(tx_entry_with_timestamp(oldest_tx.sha1(), oldest_tx.timestamp()));
-                } else {
-                    return false;
-                }
+                erase(oldest.handle());
+            } else {
+                return false;
             }
         }
 
         // insert new tx
-        m_all_txs_by_timestamp[tx.sha1()] = tx;
-        m_account_tx_by_timestamp[tx.sender()].insert(tx.sha1());
-        m_ordered_txs_by_timestamp.insert(tx_entry_with_timestamp(tx.sha1(), tx.timestamp()));
+        auto handle = insert(tx);
+        tx_entry_with_timestamp entry(tx.sha1(), tx.timestamp(), handle);
+        m_account_timestamp_index[tx.sender()].insert(entry);
+        m_timestamp_index.insert(entry);
 
-        if (m_all_txs_by_timestamp.size() > tx_pool_max_size_by_timestamp) {
+        if (m_timestamp_index.size() > static_cast<std::size_t>(m_max_size_by_timestamp)) {
             remove_oldest_tx();
         }
 
@@ -222,6 +280,10 @@ namespace ip2::blockchain {
         if (tx.empty())
             return false;
 
+        // already in pool
+        if (m_txid_index.find(tx.sha1()) != m_txid_index.end())
+            return false;
+
         if (!tx.verify_signature())
             return false;
 
@@ -234,175 +296,72 @@ namespace ip2::blockchain {
         }
     }
 
-//    bool tx_pool::rollback_block(const block &blk) {
-//        return add_tx(blk.tx());
-//        auto &tx = blk.tx();
-//        if (tx.empty())
-//            return false;
-//
-//        // validate tx state
-//        auto sender_account = m_repository->get_account(tx.chain_id(), tx.sender());
-//        if (sender_account.nonce() + 1 != tx.nonce() || sender_account.balance() < tx.cost())
-//            return false;
-//
-//
-//        auto it_txid = m_account_tx_by_fee.find(tx.sender());
-//        // find in local
-//        if (it_txid != m_account_tx_by_fee.end()) { // has in local
-//            auto it_tx = m_all_txs_by_fee.find(it_txid->second);
-//            if (it_tx != m_all_txs_by_fee.end()) {
-//                auto old_tx = it_tx->second;
-//                if (!old_tx.empty()) {
-//                    if (tx.fee() >= old_tx.fee()) {
-//                        // replace old tx with new one
-//                        m_all_txs_by_fee[tx.sha256()] = tx;
-//                        m_account_tx_by_fee[tx.sender()] = tx.sha256();
-//                        m_ordered_txs_by_fee.erase(tx_entry_with_fee(old_tx.sha256(), old_tx.fee()));
-//                        m_ordered_txs_by_fee.insert(tx_entry_with_fee(tx.sha256(), tx.fee()));
-//                    }
-//                }
-//            }
-//        } else { // insert if cannot find in local
-//            m_all_txs_by_fee[tx.sha256()] = tx;
-//            m_account_tx_by_fee[tx.sender()] = tx.sha256();
-//            m_ordered_txs_by_fee.insert(tx_entry_with_fee(tx.sha256(), tx.fee()));
-//        }
-//
-//        if (m_all_txs_by_fee.size() > tx_pool_max_size_by_fee) {
-//            remove_min_fee_tx();
-//        }
-//
-//        return true;
-//    }
-
-//    bool tx_pool::connect_block(const block &blk) {
-//        auto& tx = blk.tx();
-//        if (!tx.empty()) {
-//            if (tx.type() == tx_type::type_transfer) {
-//                return recheck_account_txs(blk.get_block_peers());
-//            } else if (tx.type() == tx_type::type_note) {
-//                delete_tx_from_time_pool(tx);
-//            } else {
-//                return false;
-//            }
-//        }
-//
-//        return true;
-//    }
-
     void tx_pool::delete_tx_from_time_pool(const transaction &tx) {
         if (tx.empty())
             return;
 
-        m_all_txs_by_timestamp.erase(tx.sha1());
-        m_ordered_txs_by_timestamp.erase(tx_entry_with_timestamp(tx.sha1(), tx.timestamp()));
-        auto it = m_account_tx_by_timestamp.find(tx.sender());
-        if (it != m_account_tx_by_timestamp.end()) {
-            it->second.erase(tx.sha1());
-            if (it->second.empty()) {
-                m_account_tx_by_timestamp.erase(it);
-            }
+        auto handle = find(tx.sha1());
+        if (handle != invalid_tx_handle && m_arena[handle].type() == tx_type::type_note) {
+            erase(handle);
         }
     }
 
     void tx_pool::remove_min_fee_tx() {
-        auto it = m_ordered_txs_by_fee.begin();
-        auto it_tx = m_all_txs_by_fee.find(it->txid());
-        if (it_tx != m_all_txs_by_fee.end()) {
-            m_all_txs_by_fee.erase(it_tx);
-            m_account_tx_by_fee.erase(it_tx->second.sender());
+        auto it = m_fee_index.begin();
+        if (it != m_fee_index.end()) {
+            erase(it->handle());
         }
-        m_ordered_txs_by_fee.erase(it);
     }
 
     void tx_pool::remove_oldest_tx() {
-        auto it = m_ordered_txs_by_timestamp.begin();
-        auto it_tx = m_all_txs_by_timestamp.find(it->txid());
-        if (it_tx != m_all_txs_by_timestamp.end()) {
-            m_all_txs_by_timestamp.erase(it_tx);
-
-            m_account_tx_by_timestamp[it_tx->second.sender()].erase(it_tx->first);
-            if (m_account_tx_by_timestamp[it_tx->second.sender()].empty()) {
-                m_account_tx_by_timestamp.erase(it_tx->second.sender());
-            }
+        auto it = m_timestamp_index.begin();
+        if (it != m_timestamp_index.end()) {
+            erase(it->handle());
         }
-        m_ordered_txs_by_timestamp.erase(it);
     }
 
     transaction tx_pool::get_transaction_by_account(const dht::public_key& pubKey) const {
-        auto it_txid = m_account_tx_by_fee.find(pubKey);
-        if (it_txid != m_account_tx_by_fee.end()) {
-            auto it_tx = m_all_txs_by_fee.find(it_txid->second);
-            if (it_tx != m_all_txs_by_fee.end()) {
-                return it_tx->second;
-            }
+        auto it_handle = m_account_fee_index.find(pubKey);
+        if (it_handle != m_account_fee_index.end()) {
+            return m_arena[it_handle->second];
         }
 
         return transaction();
     }
 
     void tx_pool::delete_transaction_by_account(const dht::public_key &pubKey) {
-        auto it_txid = m_account_tx_by_fee.find(pubKey);
-        if (it_txid != m_account_tx_by_fee.end()) {
-            auto it = m_all_txs_by_fee.find(it_txid->second);
-            if (it != m_all_txs_by_fee.end()) {
-                m_ordered_txs_by_fee.erase(tx_entry_with_fee(it->second.sha1(), it->second.fee()));
-                m_all_txs_by_fee.erase(it);
-            }
-
-            m_account_tx_by_fee.erase(it_txid);
+        auto it_handle = m_account_fee_index.find(pubKey);
+        if (it_handle != m_account_fee_index.end()) {
+            erase(it_handle->second);
         }
     }
 
     bool tx_pool::recheck_account_txs(const std::set<dht::public_key> &peers) {
         for (auto const& peer: peers) {
             recheck_account_tx(peer);
-//            auto local_tx = get_transaction_by_account(peer);
-//            if (!local_tx.empty()) {
-//                delete_transaction_by_account(peer);
-//                add_tx(local_tx);
-//            }
         }
 
         return true;
     }
 
     bool tx_pool::is_transaction_in_fee_pool(const sha1_hash &txid) const {
-        auto it = m_all_txs_by_fee.find(txid);
-        if (it != m_all_txs_by_fee.end()) {
-            return true;
-        }
-
-        return false;
+        auto handle = find(txid);
+        return handle != invalid_tx_handle && m_arena[handle].type() == tx_type::type_transfer;
     }
 
     bool tx_pool::is_transaction_in_time_pool(const sha1_hash &txid) const {
-        auto it = m_all_txs_by_timestamp.find(txid);
-        if (it != m_all_txs_by_timestamp.end()) {
-            return true;
-        }
-
-        return false;
+        auto handle = find(txid);
+        return handle != invalid_tx_handle && m_arena[handle].type() == tx_type::type_note;
     }
 
     bool tx_pool::is_transaction_in_pool(const sha1_hash &txid) const {
-        auto it = m_all_txs_by_fee.find(txid);
-        if (it != m_all_txs_by_fee.end()) {
-            return true;
-        }
-
-        it = m_all_txs_by_timestamp.find(txid);
-        if (it != m_all_txs_by_timestamp.end()) {
-            return true;
-        }
-
-        return false;
+        return find(txid) != invalid_tx_handle;
     }
 
-    std::int64_t tx_pool::get_min_allowed_fee() {
-        if (m_ordered_txs_by_fee.size() >= tx_pool_max_size_by_fee) {
-            auto it = m_ordered_txs_by_fee.begin();
-            if (it != m_ordered_txs_by_fee.end()) {
+    std::int64_t tx_pool::get_min_allowed_fee() const {
+        if (m_fee_index.size() >= static_cast<std::size_t>(m_max_size_by_fee)) {
+            auto it = m_fee_index.begin();
+            if (it != m_fee_index.end()) {
                 return it->fee();
             }
         }
@@ -410,10 +369,10 @@ namespace ip2::blockchain {
         return 0;
     }
 
-    std::int64_t tx_pool::get_oldest_allowed_timestamp() {
-        if (m_ordered_txs_by_timestamp.size() >= tx_pool_max_size_by_timestamp) {
-            auto it = m_ordered_txs_by_timestamp.begin();
-            if (it != m_ordered_txs_by_timestamp.end()) {
+    std::int64_t tx_pool::get_oldest_allowed_timestamp() const {
+        if (m_timestamp_index.size() >= static_cast<std::size_t>(m_max_size_by_timestamp)) {
+            auto it = m_timestamp_index.begin();
+            if (it != m_timestamp_index.end()) {
                 return it->timestamp();
             }
         }
@@ -422,27 +381,23 @@ namespace ip2::blockchain {
     }
 
     void tx_pool::clear() {
-        m_all_txs_by_fee.clear();
-        m_ordered_txs_by_fee.clear();
-        m_account_tx_by_fee.clear();
-        m_all_txs_by_timestamp.clear();
-        m_ordered_txs_by_timestamp.clear();
-        m_account_tx_by_timestamp.clear();
+        m_arena.clear();
+        m_free_slots.clear();
+        m_txid_index.clear();
+        m_fee_index.clear();
+        m_account_fee_index.clear();
+        m_timestamp_index.clear();
+        m_account_timestamp_index.clear();
     }
 
     void tx_pool::recheck_account_tx(const dht::public_key &pubKey) {
-        auto it_txid = m_account_tx_by_fee.find(pubKey);
-        if (it_txid != m_account_tx_by_fee.end()) {
-            auto it = m_all_txs_by_fee.find(it_txid->second);
-            if (it != m_all_txs_by_fee.end()) {
-                auto tx = it->second;
-                // validate tx state
-                auto sender_account = m_repository->get_account(tx.chain_id(), tx.sender());
-                if (sender_account.nonce() + 1 != tx.nonce() || sender_account.balance() < tx.cost()) {
-                    m_ordered_txs_by_fee.erase(tx_entry_with_fee(tx.sha1(), tx.fee()));
-                    m_all_txs_by_fee.erase(it);
-                    m_account_tx_by_fee.erase(it_txid);
-                }
+        auto it_handle = m_account_fee_index.find(pubKey);
+        if (it_handle != m_account_fee_index.end()) {
+            auto const& tx = m_arena[it_handle->second];
+            // validate tx state
+            auto sender_account = m_repository->get_account(tx.chain_id(), tx.sender());
+            if (sender_account.nonce() + 1 != tx.nonce() || sender_account.balance() < tx.cost()) {
+                erase(it_handle->second);
             }
         }
     }
@@ -450,11 +405,8 @@ namespace ip2::blockchain {
     // todo
     void tx_pool::recheck_all_transactions() {
         std::set<transaction> txs;
-        for (auto const &item: m_all_txs_by_fee) {
-            txs.insert(item.second);
-        }
-        for (auto const &item: m_all_txs_by_timestamp) {
-            txs.insert(item.second);
+        for (auto const &item: m_txid_index) {
+            txs.insert(m_arena[item.second]);
         }
 
         clear();
@@ -464,10 +416,10 @@ namespace ip2::blockchain {
         }
     }
 
-    std::set<transaction> tx_pool::get_all_transactions() {
+    std::set<transaction> tx_pool::get_all_transactions() const {
         std::set<transaction> txs;
-        for (auto const &item: m_all_txs_by_fee) {
-            txs.insert(item.second);
+        for (auto const &entry: m_fee_index) {
+            txs.insert(m_arena[entry.handle()]);
         }
 
         return txs;
@@ -15,6 +15,8 @@ see LICENSE file.
 #include "ip2/communication/communication.hpp"
 #include "ip2/kademlia/dht_tracker.hpp"
 #include "ip2/aux_/common_data.h"
+#include "ip2/assemble/protocol.hpp" // for relay_msg_mtu
+#include "ip2/bencode.hpp"
 
 using namespace std::placeholders;
 
@@ -44,6 +46,9 @@ namespace ip2 {
 //
 //            m_refresh_timer.cancel();
 
+            m_batch_timer.cancel();
+            flush_batches();
+
             clear();
 
             log(LOG_INFO, "INFO: Stop Communication...");
@@ -223,6 +228,33 @@ namespace ip2 {
 //        }
 
         void communication::on_dht_relay(dht::public_key const& peer, entry const& payload) {
+            // a batch is a list of signals (strings) and inline message
+            // wrappers (lists), a single signal is sent as is
+            if (payload.type() == entry::list_t) {
+                m_batch_peers.insert(peer);
+                for (auto const& e: payload.list()) {
+                    if (e.type() == entry::list_t) {
+                        try {
+                            message_wrapper messageWrapper(e);
+                            if (messageWrapper.empty() || messageWrapper.msg().sender() != peer) {
+                                log(LOG_ERR, "ERROR: Drop inline message from peer[%s]", aux::toHex(peer.bytes).c_str());
+                                continue;
+                            }
+                            on_message_wrapper(peer, messageWrapper);
+                        } catch (std::exception &ex) {
+                            log(LOG_ERR, "ERROR: Receive exception inline message.");
+                        }
+                    } else {
+                        on_signal(peer, e);
+                    }
+                }
+                return;
+            }
+
+            on_signal(peer, payload);
+        }
+
+        void communication::on_signal(dht::public_key const& peer, entry const& payload) {
 //            if(payload.type() != entry::dictionary_t){
 //                log(LOG_ERR, "ERROR: relay data not dict. to string: %s", payload.to_string().c_str());
 //                return;
@@ -274,6 +306,10 @@ namespace ip2 {
                         m_ses.alerts().emplace_alert<communication_peer_attention_alert>(peer, signalEntry.m_timestamp);
                         break;
                     }
+                    case common::COMMUNICATION_BATCH: {
+                        m_batch_peers.insert(peer);
+                        break;
+                    }
                     default: {
                     }
                 }
@@ -315,7 +351,7 @@ namespace ip2 {
             auto e = signalEntry.get_entry();
             log(LOG_INFO, "Send peer[%s] attention signal[%s]",
                 aux::toHex(peer.bytes).c_str(), e.to_string(true).c_str());
-            send_to(peer, e);
+            send_batched(peer, std::move(e));
         }
 
         bool communication::add_new_friend(const dht::public_key &pubkey) {
@@ -854,19 +890,7 @@ namespace ip2 {
                         case COMMUNICATION_GET_ITEM_TYPE::MESSAGE_WRAPPER: {
                             message_wrapper messageWrapper(i.value());
                             if (!messageWrapper.empty()) {
-                                log(LOG_INFO, "INFO: Got new message [%s]", messageWrapper.msg().to_string().c_str());
-
-                                m_ses.alerts().emplace_alert<communication_new_message_alert>(messageWrapper.msg());
-
-                                if (!m_message_db->save_message_if_not_exist(messageWrapper.msg())) {
-                                    log(LOG_ERR, "INFO: Save message[%s] fail.", messageWrapper.msg().to_string().c_str());
-                                }
-
-                                put_confirmation_roots(peer);
-
-                                if (times < 10 && !messageWrapper.previousHash().is_all_zeros() && !m_message_db->is_message_in_db(messageWrapper.previousHash())) {
-                                    get_message_wrapper(peer, messageWrapper.previousHash(), times + 1);
-                                }
+                                on_message_wrapper(peer, messageWrapper, times);
                             }
 
                             break;
@@ -930,6 +954,22 @@ namespace ip2 {
             }
         }
 
+        void communication::on_message_wrapper(dht::public_key const& peer, const message_wrapper &messageWrapper, int times) {
+            log(LOG_INFO, "INFO: Got new message [%s]", messageWrapper.msg().to_string().c_str());
+
+            m_ses.alerts().emplace_alert<communication_new_message_alert>(messageWrapper.msg());
+
+            if (!m_message_db->save_message_if_not_exist(messageWrapper.msg())) {
+                log(LOG_ERR, "INFO: Save message[%s] fail.", messageWrapper.msg().to_string().c_str());
+            }
+
+            put_confirmation_roots(peer);
+
+            if (times < 10 && !messageWrapper.previousHash().is_all_zeros() && !m_message_db->is_message_in_db(messageWrapper.previousHash())) {
+                get_message_wrapper(peer, messageWrapper.previousHash(), times + 1);
+            }
+        }
+
         // key is a 32-byte binary string, the public key to look up.
         // the salt is optional
 //        void communication::dht_get_mutable_item(std::array<char, 32> key
@@ -1068,12 +1108,102 @@ namespace ip2 {
                               std::bind(&communication::on_dht_relay_mutable_item, self(), _1, _2, peer));
         }
 
+        void communication::send_batched(const dht::public_key &peer, entry data) {
+            m_outbound_batches[peer].push_back(std::move(data));
+
+            if (m_batch_timer_armed) return;
+            m_batch_timer_armed = true;
+            m_batch_timer.expires_after(milliseconds(communication_batch_window));
+            m_batch_timer.async_wait(std::bind(&communication::on_batch_timeout, self(), _1));
+        }
+
+        void communication::on_batch_timeout(error_code const& e) {
+            m_batch_timer_armed = false;
+            if (e) return;
+
+            flush_batches();
+        }
+
+        void communication::flush_batches() {
+            auto send_batch = [this](dht::public_key const& peer, entry::list_type& batch) {
+                // a lone signal goes out as before, a lone inline message
+                // still needs the list around it
+                if (batch.size() == 1 && batch.front().type() != entry::list_t) {
+                    send_to(peer, batch.front());
+                } else {
+                    log(LOG_INFO, "Send peer[%s] %d payloads in one batch",
+                        aux::toHex(peer.bytes).c_str(), int(batch.size()));
+                    send_to(peer, entry(std::move(batch)));
+                }
+                batch.clear();
+            };
+
+            for (auto& outbound: m_outbound_batches) {
+                auto const& peer = outbound.first;
+
+                // older versions throw on a list payload and lose all of it,
+                // so until the peer has shown it parses them, send signals
+                // the way they did, and tell it that we parse them
+                if (m_batch_peers.find(peer) == m_batch_peers.end()) {
+                    if (m_batch_announced.insert(peer).second) {
+                        common::signal_entry signalEntry(common::COMMUNICATION_BATCH, get_current_time() / 1000);
+                        send_to(peer, signalEntry.get_entry());
+                    }
+
+                    for (auto const& data: outbound.second) {
+                        // inline messages are in the DHT too, the signal
+                        // next to them gets the peer there
+                        if (data.type() == entry::list_t) continue;
+                        send_to(peer, data);
+                    }
+                    continue;
+                }
+
+                entry::list_type batch;
+                // the "l" and "e" around the list
+                int batch_size = 2;
+                std::string buf;
+                for (auto& data: outbound.second) {
+                    buf.clear();
+                    bencode(std::back_inserter(buf), data);
+                    int const size = int(buf.size());
+
+                    // what doesn't fit in a batch of its own goes out alone
+                    // if it's a signal. An inline message that big is left
+                    // to be got from the DHT
+                    if (size + 2 > assemble::protocol::relay_msg_mtu) {
+                        if (data.type() == entry::list_t) {
+                            log(LOG_INFO, "Drop inline message of %d bytes to peer[%s]",
+                                size, aux::toHex(peer.bytes).c_str());
+                        } else {
+                            send_to(peer, data);
+                        }
+                        continue;
+                    }
+
+                    if (batch_size + size > assemble::protocol::relay_msg_mtu) {
+                        send_batch(peer, batch);
+                        batch_size = 2;
+                    }
+
+                    batch.push_back(std::move(data));
+                    batch_size += size;
+                }
+
+                if (!batch.empty()) {
+                    send_batch(peer, batch);
+                }
+            }
+
+            m_outbound_batches.clear();
+        }
+
         void communication::send_new_message_signal(const dht::public_key &peer, const sha1_hash &hash) {
             common::signal_entry signalEntry(common::COMMUNICATION_NEW_MESSAGE, get_current_time() / 1000, hash);
             auto e = signalEntry.get_entry();
             log(LOG_INFO, "Send peer[%s] new message signal[%s]",
                 aux::toHex(peer.bytes).c_str(), e.to_string(true).c_str());
-            send_to(peer, e);
+            send_batched(peer, std::move(e));
         }
 
         void communication::send_message_missing_signal(const dht::public_key &peer) {
@@ -1081,7 +1211,7 @@ namespace ip2 {
             auto e = signalEntry.get_entry();
             log(LOG_INFO, "Send peer[%s] message missing signal[%s]",
                 aux::toHex(peer.bytes).c_str(), e.to_string(true).c_str());
-            send_to(peer, e);
+            send_batched(peer, std::move(e));
         }
 
         void communication::send_put_done_signal(const dht::public_key &peer) {
@@ -1089,7 +1219,7 @@ namespace ip2 {
             auto e = signalEntry.get_entry();
             log(LOG_INFO, "Send peer[%s] message put done signal[%s]",
                 aux::toHex(peer.bytes).c_str(), e.to_string(true).c_str());
-            send_to(peer, e);
+            send_batched(peer, std::move(e));
         }
 
         void communication::send_confirmation_signal(const dht::public_key &peer, const sha1_hash &hash) {
@@ -1097,7 +1227,7 @@ namespace ip2 {
             auto e = signalEntry.get_entry();
             log(LOG_INFO, "Send peer[%s] message confirmation signal[%s]",
                 aux::toHex(peer.bytes).c_str(), e.to_string(true).c_str());
-            send_to(peer, e);
+            send_batched(peer, std::move(e));
         }
 
         void communication::get_new_message_hash(const dht::public_key &peer, std::int64_t timestamp) {
@@ -1157,6 +1287,14 @@ namespace ip2 {
             message_wrapper messageWrapper(last_message.sha1(), msg);
             put_message_wrapper(messageWrapper);
             put_new_message_hash(msg.receiver(), messageWrapper.sha1());
+
+            // small messages ride along with their signal, so an online
+            // receiver doesn't have to get the wrapper from the DHT. It's put
+            // anyway, for the receivers that are not.
+            auto encode = messageWrapper.get_encode();
+            if (int(encode.size()) <= communication_max_inline_message_size) {
+                send_batched(msg.receiver(), messageWrapper.get_entry());
+            }
             send_new_message_signal(msg.receiver(), messageWrapper.sha1());
         }
 
@@ -18,6 +18,7 @@ see LICENSE file.
 #if defined _MSC_VER && TORRENT_HAS_SSE
 #include <intrin.h>
 #include <nmmintrin.h>
+#include <immintrin.h> // for _xgetbv
 #endif
 
 #if TORRENT_HAS_SSE && defined __GNUC__
@@ -70,6 +71,26 @@ namespace {
 		TORRENT_UNUSED(type);
 		// for non-x86 and non-amd64, just return zeroes
 		std::memset(&info[0], 0, sizeof(std::uint32_t) * 4);
+#endif
+	}
+
+	// internal, for the extended feature leaves (7 and up)
+	void cpuid_count(std::uint32_t* info, int type, int sub) noexcept
+	{
+#if defined _MSC_VER
+		__cpuidex(reinterpret_cast<int*>(info), type, sub);
+
+#elif defined __GNUC__
+		if (__get_cpuid_max(0, nullptr) < std::uint32_t(type))
+		{
+			info[0] = info[1] = info[2] = info[3] = 0;
+			return;
+		}
+		__cpuid_count(std::uint32_t(type), std::uint32_t(sub), info[0], info[1], info[2], info[3]);
+#else
+		TORRENT_UNUSED(type);
+		TORRENT_UNUSED(sub);
+		std::memset(&info[0], 0, sizeof(std::uint32_t) * 4);
 #endif
 	}
 #endif
@@ -96,6 +117,51 @@ namespace {
 #endif
 	}
 
+	bool supports_avx2() noexcept
+	{
+#if TORRENT_HAS_SSE
+		std::uint32_t cpui[4] = {0};
+		cpuid(cpui, 1);
+		// the OS must save the ymm registers on context switches
+		bool const osxsave = (cpui[2] & (1 << 27)) != 0;
+		bool const avx = (cpui[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx) return false;
+
+#if defined _MSC_VER
+		std::uint64_t const xcr0 = _xgetbv(0);
+#elif defined __GNUC__
+		std::uint32_t eax, edx;
+		__asm__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		std::uint64_t const xcr0 = (std::uint64_t(edx) << 32) | eax;
+#else
+		std::uint64_t const xcr0 = 0;
+#endif
+		if ((xcr0 & 6) != 6) return false;
+
+		cpuid_count(cpui, 7, 0);
+		return (cpui[1] & (1 << 5)) != 0;
+#else
+		return false;
+#endif
+	}
+
+	bool supports_sha_ni() noexcept
+	{
+#if TORRENT_HAS_SSE
+		std::uint32_t cpui[4] = {0};
+		cpuid(cpui, 1);
+		// the SHA-NI code path also uses SSSE3 and SSE4.1 instructions
+		bool const ssse3 = (cpui[2] & (1 << 9)) != 0;
+		bool const sse41 = (cpui[2] & (1 << 19)) != 0;
+		if (!ssse3 || !sse41) return false;
+
+		cpuid_count(cpui, 7, 0);
+		return (cpui[1] & (1 << 29)) != 0;
+#else
+		return false;
+#endif
+	}
+
 	bool supports_arm_neon() noexcept
 	{
 #if TORRENT_HAS_ARM_NEON && TORRENT_HAS_AUXV
@@ -136,4 +202,6 @@ namespace {
 	bool const mmx_support = supports_mmx();
 	bool const arm_neon_support = supports_arm_neon();
 	bool const arm_crc32c_support = supports_arm_crc32c();
+	bool const avx2_support = supports_avx2();
+	bool const sha_ni_support = supports_sha_ni();
 } }
@@ -0,0 +1,304 @@
+// ignore warnings in this file
+#include "ip2/aux_/disable_warnings_push.hpp"
+
+#include "fe51.h"
+
+#if ED25519_FE51
+
+/*
+    the products of two limbs need 128 bits, the sums of five of them
+    still fit since every limb is below 2^52 and 19 < 2^5
+*/
+typedef unsigned __int128 u128;
+
+static const u64 mask51 = (u64(1) << 51) - 1;
+
+static u64 load_8(const unsigned char *in) {
+    u64 result = 0;
+    for (int i = 7; i >= 0; --i) {
+        result = (result << 8) | in[i];
+    }
+    return result;
+}
+
+static void store_8(unsigned char *out, u64 v) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (unsigned char) (v >> (8 * i));
+    }
+}
+
+/*
+    bring every limb below 2^51 (h[0] may end up slightly above)
+*/
+
+static void carry(fe51 h) {
+    h[1] += h[0] >> 51; h[0] &= mask51;
+    h[2] += h[1] >> 51; h[1] &= mask51;
+    h[3] += h[2] >> 51; h[2] &= mask51;
+    h[4] += h[3] >> 51; h[3] &= mask51;
+    h[0] += 19 * (h[4] >> 51); h[4] &= mask51;
+}
+
+
+void fe51_0(fe51 h) {
+    h[0] = 0;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+
+void fe51_1(fe51 h) {
+    h[0] = 1;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+
+/*
+    ignores the top bit, like fe_frombytes
+*/
+
+void fe51_frombytes(fe51 h, const unsigned char *s) {
+    h[0] = load_8(s) & mask51;
+    h[1] = (load_8(s + 6) >> 3) & mask51;
+    h[2] = (load_8(s + 12) >> 6) & mask51;
+    h[3] = (load_8(s + 19) >> 1) & mask51;
+    h[4] = (load_8(s + 24) >> 12) & mask51;
+}
+
+
+/*
+    the unique representative in [0, 2^255-19)
+*/
+
+void fe51_tobytes(unsigned char *s, const fe51 h) {
+    fe51 t;
+    fe51_copy(t, h);
+    carry(t);
+    carry(t);
+
+    /* t is in [0, 2^255-1] now, and t + 19 overflows 2^255 exactly when
+       t >= 2^255-19, i.e. when t has to be reduced once more */
+    t[0] += 19;
+    carry(t);
+
+    /* add 2^255 - 19, which cancels the 19 above modulo p, and drop
+       the 2^255 bit */
+    t[0] += (mask51 + 1) - 19;
+    t[1] += (mask51 + 1) - 1;
+    t[2] += (mask51 + 1) - 1;
+    t[3] += (mask51 + 1) - 1;
+    t[4] += (mask51 + 1) - 1;
+
+    t[1] += t[0] >> 51; t[0] &= mask51;
+    t[2] += t[1] >> 51; t[1] &= mask51;
+    t[3] += t[2] >> 51; t[2] &= mask51;
+    t[4] += t[3] >> 51; t[3] &= mask51;
+    t[4] &= mask51;
+
+    store_8(s, t[0] | (t[1] << 51));
+    store_8(s + 8, (t[1] >> 13) | (t[2] << 38));
+    store_8(s + 16, (t[2] >> 26) | (t[3] << 25));
+    store_8(s + 24, (t[3] >> 39) | (t[4] << 12));
+}
+
+
+void fe51_copy(fe51 h, const fe51 f) {
+    h[0] = f[0];
+    h[1] = f[1];
+    h[2] = f[2];
+    h[3] = f[3];
+    h[4] = f[4];
+}
+
+
+int fe51_isnegative(const fe51 f) {
+    unsigned char s[32];
+    fe51_tobytes(s, f);
+    return s[0] & 1;
+}
+
+
+/*
+    replace (f,g) with (g,g) if b == 1;
+    replace (f,g) with (f,g) if b == 0.
+
+    Preconditions: b in {0,1}.
+*/
+
+void fe51_cmov(fe51 f, const fe51 g, unsigned int b) {
+    u64 const mask = u64(0) - u64(b);
+    f[0] ^= mask & (f[0] ^ g[0]);
+    f[1] ^= mask & (f[1] ^ g[1]);
+    f[2] ^= mask & (f[2] ^ g[2]);
+    f[3] ^= mask & (f[3] ^ g[3]);
+    f[4] ^= mask & (f[4] ^ g[4]);
+}
+
+
+/*
+    replace (f,g) with (g,f) if b == 1;
+    replace (f,g) with (f,g) if b == 0.
+
+    Preconditions: b in {0,1}.
+*/
+
+void fe51_cswap(fe51 f, fe51 g, unsigned int b) {
+    u64 const mask = u64(0) - u64(b);
+    for (int i = 0; i < 5; ++i) {
+        u64 const x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+
+void fe51_neg(fe51 h, const fe51 f) {
+    fe51 zero;
+    fe51_0(zero);
+    fe51_sub(h, zero, f);
+}
+
+
+void fe51_add(fe51 h, const fe51 f, const fe51 g) {
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+    carry(h);
+}
+
+
+/*
+    h = f - g, computed as f + 4p - g so no limb goes negative
+*/
+
+void fe51_sub(fe51 h, const fe51 f, const fe51 g) {
+    h[0] = (f[0] + 0x1FFFFFFFFFFFB4) - g[0];
+    h[1] = (f[1] + 0x1FFFFFFFFFFFFC) - g[1];
+    h[2] = (f[2] + 0x1FFFFFFFFFFFFC) - g[2];
+    h[3] = (f[3] + 0x1FFFFFFFFFFFFC) - g[3];
+    h[4] = (f[4] + 0x1FFFFFFFFFFFFC) - g[4];
+    carry(h);
+}
+
+
+static void reduce(fe51 h, u128 r0, u128 r1, u128 r2, u128 r3, u128 r4) {
+    r1 += u64(r0 >> 51);
+    r2 += u64(r1 >> 51);
+    r3 += u64(r2 >> 51);
+    r4 += u64(r3 >> 51);
+    u64 const c = u64(r4 >> 51);
+
+    h[0] = (u64(r0) & mask51) + 19 * c;
+    h[1] = u64(r1) & mask51;
+    h[2] = u64(r2) & mask51;
+    h[3] = u64(r3) & mask51;
+    h[4] = u64(r4) & mask51;
+
+    h[1] += h[0] >> 51;
+    h[0] &= mask51;
+}
+
+
+void fe51_mul(fe51 h, const fe51 f, const fe51 g) {
+    u64 const f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    u64 const g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    u64 const g1_19 = 19 * g1;
+    u64 const g2_19 = 19 * g2;
+    u64 const g3_19 = 19 * g3;
+    u64 const g4_19 = 19 * g4;
+
+    u128 const r0 = (u128) f0 * g0 + (u128) f1 * g4_19 + (u128) f2 * g3_19
+        + (u128) f3 * g2_19 + (u128) f4 * g1_19;
+    u128 const r1 = (u128) f0 * g1 + (u128) f1 * g0 + (u128) f2 * g4_19
+        + (u128) f3 * g3_19 + (u128) f4 * g2_19;
+    u128 const r2 = (u128) f0 * g2 + (u128) f1 * g1 + (u128) f2 * g0
+        + (u128) f3 * g4_19 + (u128) f4 * g3_19;
+    u128 const r3 = (u128) f0 * g3 + (u128) f1 * g2 + (u128) f2 * g1
+        + (u128) f3 * g0 + (u128) f4 * g4_19;
+    u128 const r4 = (u128) f0 * g4 + (u128) f1 * g3 + (u128) f2 * g2
+        + (u128) f3 * g1 + (u128) f4 * g0;
+
+    reduce(h, r0, r1, r2, r3, r4);
+}
+
+
+void fe51_sq(fe51 h, const fe51 f) {
+    u64 const f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    u64 const f0_2 = 2 * f0;
+    u64 const f1_2 = 2 * f1;
+    u64 const f1_38 = 38 * f1;
+    u64 const f2_38 = 38 * f2;
+    u64 const f3_38 = 38 * f3;
+    u64 const f3_19 = 19 * f3;
+    u64 const f4_19 = 19 * f4;
+
+    u128 const r0 = (u128) f0 * f0 + (u128) f1_38 * f4 + (u128) f2_38 * f3;
+    u128 const r1 = (u128) f0_2 * f1 + (u128) f2_38 * f4 + (u128) f3_19 * f3;
+    u128 const r2 = (u128) f0_2 * f2 + (u128) f1 * f1 + (u128) f3_38 * f4;
+    u128 const r3 = (u128) f0_2 * f3 + (u128) f1_2 * f2 + (u128) f4_19 * f4;
+    u128 const r4 = (u128) f0_2 * f4 + (u128) f1_2 * f3 + (u128) f2 * f2;
+
+    reduce(h, r0, r1, r2, r3, r4);
+}
+
+
+/*
+    h = f * 121666
+*/
+
+void fe51_mul121666(fe51 h, const fe51 f) {
+    reduce(h, (u128) f[0] * 121666, (u128) f[1] * 121666, (u128) f[2] * 121666
+        , (u128) f[3] * 121666, (u128) f[4] * 121666);
+}
+
+
+static void fe51_sqn(fe51 h, const fe51 f, int n) {
+    fe51_sq(h, f);
+    for (int i = 1; i < n; ++i) {
+        fe51_sq(h, h);
+    }
+}
+
+
+/*
+    out = z^(p-2), the same addition chain as fe_invert
+*/
+
+void fe51_invert(fe51 out, const fe51 z) {
+    fe51 t0;
+    fe51 t1;
+    fe51 t2;
+    fe51 t3;
+
+    fe51_sq(t0, z);
+    fe51_sqn(t1, t0, 2);
+    fe51_mul(t1, z, t1);
+    fe51_mul(t0, t0, t1);
+    fe51_sq(t2, t0);
+    fe51_mul(t1, t1, t2);
+    fe51_sqn(t2, t1, 5);
+    fe51_mul(t1, t2, t1);
+    fe51_sqn(t2, t1, 10);
+    fe51_mul(t2, t2, t1);
+    fe51_sqn(t3, t2, 20);
+    fe51_mul(t2, t3, t2);
+    fe51_sqn(t2, t2, 10);
+    fe51_mul(t1, t2, t1);
+    fe51_sqn(t2, t1, 50);
+    fe51_mul(t2, t2, t1);
+    fe51_sqn(t3, t2, 100);
+    fe51_mul(t2, t3, t2);
+    fe51_sqn(t2, t2, 50);
+    fe51_mul(t1, t2, t1);
+    fe51_sqn(t1, t1, 5);
+    fe51_mul(out, t1, t0);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef FE51_H
+#define FE51_H
+
+#include "fixedint.h"
+
+/*
+    fe51 is a field element of \Z/(2^255-19) in five 64 bit limbs.
+    An element t, entries t[0]...t[4], represents the integer
+    t[0]+2^51 t[1]+2^102 t[2]+2^153 t[3]+2^204 t[4].
+    Limbs are kept below 2^52 between operations.
+
+    It needs a 128 bit integer type for the products. Where there is
+    none, ED25519_FE51 is 0 and only the 32 bit fe code is used.
+*/
+
+#if defined __SIZEOF_INT128__
+#define ED25519_FE51 1
+#else
+#define ED25519_FE51 0
+#endif
+
+#if ED25519_FE51
+
+typedef u64 fe51[5];
+
+void fe51_0(fe51 h);
+void fe51_1(fe51 h);
+
+void fe51_frombytes(fe51 h, const unsigned char *s);
+void fe51_tobytes(unsigned char *s, const fe51 h);
+
+void fe51_copy(fe51 h, const fe51 f);
+int fe51_isnegative(const fe51 f);
+void fe51_cmov(fe51 f, const fe51 g, unsigned int b);
+void fe51_cswap(fe51 f, fe51 g, unsigned int b);
+
+void fe51_neg(fe51 h, const fe51 f);
+void fe51_add(fe51 h, const fe51 f, const fe51 g);
+void fe51_sub(fe51 h, const fe51 f, const fe51 g);
+void fe51_mul(fe51 h, const fe51 f, const fe51 g);
+void fe51_sq(fe51 h, const fe51 f);
+void fe51_mul121666(fe51 h, const fe51 f);
+void fe51_invert(fe51 out, const fe51 z);
+
+#endif
+
+#endif
@@ -379,6 +379,10 @@ static void select(ge_precomp *t, int pos, signed char b) {
     cmov(t, &minust, bnegative);
 }
 
+const ge_precomp *ge_base_multiples(int pos) {
+    return base[pos];
+}
+
 /*
 h = a * B
 where a = a[0]+256*a[1]+...+256^31 a[31]
@@ -62,6 +62,9 @@ void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q);
 void ge_msub(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q);
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a);
 
+/* the 8 precomputed multiples of B for window pos, see ge_scalarmult_base */
+const ge_precomp *ge_base_multiples(int pos);
+
 void ge_p1p1_to_p2(ge_p2 *r, const ge_p1p1 *p);
 void ge_p1p1_to_p3(ge_p3 *r, const ge_p1p1 *p);
 void ge_p2_0(ge_p2 *h);
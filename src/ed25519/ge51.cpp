@@ -0,0 +1,275 @@
+// ignore warnings in this file
+#include "ip2/aux_/disable_warnings_push.hpp"
+
+#include "ge51.h"
+
+#if ED25519_FE51
+
+#include "ge.h"
+
+/*
+    the ge_p2, ge_p3, ge_p1p1 and ge_precomp representations of ge.h,
+    on fe51 field elements
+*/
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+} ge51_p2;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p3;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p1p1;
+
+typedef struct {
+  fe51 yplusx;
+  fe51 yminusx;
+  fe51 xy2d;
+} ge51_precomp;
+
+namespace {
+
+/*
+    the precomputed multiples of B from precomp_data.h, converted once on
+    first use. Function local statics are initialized thread safely.
+*/
+
+struct base_table {
+    base_table() {
+        unsigned char s[32];
+        for (int pos = 0; pos < 32; ++pos) {
+            const ge_precomp *row = ge_base_multiples(pos);
+            for (int j = 0; j < 8; ++j) {
+                fe_tobytes(s, row[j].yplusx);
+                fe51_frombytes(multiples[pos][j].yplusx, s);
+                fe_tobytes(s, row[j].yminusx);
+                fe51_frombytes(multiples[pos][j].yminusx, s);
+                fe_tobytes(s, row[j].xy2d);
+                fe51_frombytes(multiples[pos][j].xy2d, s);
+            }
+        }
+    }
+
+    ge51_precomp multiples[32][8];
+};
+
+const base_table& base51() {
+    static const base_table table;
+    return table;
+}
+
+}
+
+
+/*
+r = p + q
+*/
+
+static void ge51_madd(ge51_p1p1 *r, const ge51_p3 *p, const ge51_precomp *q) {
+    fe51 t0;
+    fe51_add(r->X, p->Y, p->X);
+    fe51_sub(r->Y, p->Y, p->X);
+    fe51_mul(r->Z, r->X, q->yplusx);
+    fe51_mul(r->Y, r->Y, q->yminusx);
+    fe51_mul(r->T, q->xy2d, p->T);
+    fe51_add(t0, p->Z, p->Z);
+    fe51_sub(r->X, r->Z, r->Y);
+    fe51_add(r->Y, r->Z, r->Y);
+    fe51_add(r->Z, t0, r->T);
+    fe51_sub(r->T, t0, r->T);
+}
+
+
+/*
+r = p
+*/
+
+static void ge51_p1p1_to_p2(ge51_p2 *r, const ge51_p1p1 *p) {
+    fe51_mul(r->X, p->X, p->T);
+    fe51_mul(r->Y, p->Y, p->Z);
+    fe51_mul(r->Z, p->Z, p->T);
+}
+
+
+/*
+r = p
+*/
+
+static void ge51_p1p1_to_p3(ge51_p3 *r, const ge51_p1p1 *p) {
+    fe51_mul(r->X, p->X, p->T);
+    fe51_mul(r->Y, p->Y, p->Z);
+    fe51_mul(r->Z, p->Z, p->T);
+    fe51_mul(r->T, p->X, p->Y);
+}
+
+
+/*
+r = 2 * p
+*/
+
+static void ge51_p2_dbl(ge51_p1p1 *r, const ge51_p2 *p) {
+    fe51 t0;
+
+    fe51_sq(r->X, p->X);
+    fe51_sq(r->Z, p->Y);
+    fe51_sq(r->T, p->Z);
+    fe51_add(r->T, r->T, r->T);
+    fe51_add(r->Y, p->X, p->Y);
+    fe51_sq(t0, r->Y);
+    fe51_add(r->Y, r->Z, r->X);
+    fe51_sub(r->Z, r->Z, r->X);
+    fe51_sub(r->X, t0, r->Y);
+    fe51_sub(r->T, r->T, r->Z);
+}
+
+
+static void ge51_p3_0(ge51_p3 *h) {
+    fe51_0(h->X);
+    fe51_1(h->Y);
+    fe51_1(h->Z);
+    fe51_0(h->T);
+}
+
+
+/*
+r = 2 * p
+*/
+
+static void ge51_p3_dbl(ge51_p1p1 *r, const ge51_p3 *p) {
+    ge51_p2 q;
+    fe51_copy(q.X, p->X);
+    fe51_copy(q.Y, p->Y);
+    fe51_copy(q.Z, p->Z);
+    ge51_p2_dbl(r, &q);
+}
+
+
+static void ge51_p3_tobytes(unsigned char *s, const ge51_p3 *h) {
+    fe51 recip;
+    fe51 x;
+    fe51 y;
+    fe51_invert(recip, h->Z);
+    fe51_mul(x, h->X, recip);
+    fe51_mul(y, h->Y, recip);
+    fe51_tobytes(s, y);
+    s[31] ^= fe51_isnegative(x) << 7;
+}
+
+
+static unsigned char equal(signed char b, signed char c) {
+    unsigned char ub = b;
+    unsigned char uc = c;
+    unsigned char x = ub ^ uc; /* 0: yes; 1..255: no */
+    u64 y = x; /* 0: yes; 1..255: no */
+    y -= 1; /* large: yes; 0..254: no */
+    y >>= 63; /* 1: yes; 0: no */
+    return (unsigned char) y;
+}
+
+static unsigned char negative(signed char b) {
+    u64 x = b; /* 18446744073709551361..18446744073709551615: yes; 0..255: no */
+    x >>= 63; /* 1: yes; 0: no */
+    return (unsigned char) x;
+}
+
+static void cmov(ge51_precomp *t, const ge51_precomp *u, unsigned char b) {
+    fe51_cmov(t->yplusx, u->yplusx, b);
+    fe51_cmov(t->yminusx, u->yminusx, b);
+    fe51_cmov(t->xy2d, u->xy2d, b);
+}
+
+
+/*
+    every one of the 8 multiples is read, whatever b is
+*/
+
+static void select(ge51_precomp *t, const ge51_precomp *row, signed char b) {
+    using schar = signed char;
+    using uchar = unsigned char;
+    ge51_precomp minust;
+    unsigned char const bnegative = negative(b);
+    unsigned char const babs = b - schar(uchar((-bnegative) & b) << 1);
+    fe51_1(t->yplusx);
+    fe51_1(t->yminusx);
+    fe51_0(t->xy2d);
+    cmov(t, &row[0], equal(babs, 1));
+    cmov(t, &row[1], equal(babs, 2));
+    cmov(t, &row[2], equal(babs, 3));
+    cmov(t, &row[3], equal(babs, 4));
+    cmov(t, &row[4], equal(babs, 5));
+    cmov(t, &row[5], equal(babs, 6));
+    cmov(t, &row[6], equal(babs, 7));
+    cmov(t, &row[7], equal(babs, 8));
+    fe51_copy(minust.yplusx, t->yminusx);
+    fe51_copy(minust.yminusx, t->yplusx);
+    fe51_neg(minust.xy2d, t->xy2d);
+    cmov(t, &minust, bnegative);
+}
+
+
+void ge51_scalarmult_base_tobytes(unsigned char *s, const unsigned char *a) {
+    const base_table& table = base51();
+    signed char e[64];
+    signed char carry;
+    ge51_p1p1 r;
+    ge51_p2 q;
+    ge51_p3 h;
+    ge51_precomp t;
+    int i;
+
+    for (i = 0; i < 32; ++i) {
+        e[2 * i + 0] = (a[i] >> 0) & 15;
+        e[2 * i + 1] = (a[i] >> 4) & 15;
+    }
+
+    /* each e[i] is between 0 and 15 */
+    /* e[63] is between 0 and 7 */
+    carry = 0;
+
+    for (i = 0; i < 63; ++i) {
+        e[i] += carry;
+        carry = e[i] + 8;
+        carry >>= 4;
+        e[i] -= carry << 4;
+    }
+
+    e[63] += carry;
+    /* each e[i] is between -8 and 8 */
+    ge51_p3_0(&h);
+
+    for (i = 1; i < 64; i += 2) {
+        select(&t, table.multiples[i / 2], e[i]);
+        ge51_madd(&r, &h, &t);
+        ge51_p1p1_to_p3(&h, &r);
+    }
+
+    ge51_p3_dbl(&r, &h);
+    ge51_p1p1_to_p2(&q, &r);
+    ge51_p2_dbl(&r, &q);
+    ge51_p1p1_to_p2(&q, &r);
+    ge51_p2_dbl(&r, &q);
+    ge51_p1p1_to_p2(&q, &r);
+    ge51_p2_dbl(&r, &q);
+    ge51_p1p1_to_p3(&h, &r);
+
+    for (i = 0; i < 64; i += 2) {
+        select(&t, table.multiples[i / 2], e[i]);
+        ge51_madd(&r, &h, &t);
+        ge51_p1p1_to_p3(&h, &r);
+    }
+
+    ge51_p3_tobytes(s, &h);
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef GE51_H
+#define GE51_H
+
+#include "fe51.h"
+
+#if ED25519_FE51
+
+/*
+s = a * B, encoded like ge_p3_tobytes
+where a = a[0]+256*a[1]+...+256^31 a[31]
+B is the Ed25519 base point.
+
+It is ge_scalarmult_base() on fe51 field elements, with the same signed
+radix 16 windows and constant time lookups into the same precomputed
+multiples of B.
+
+Preconditions:
+  a[31] <= 127
+*/
+
+void ge51_scalarmult_base_tobytes(unsigned char *s, const unsigned char *a);
+
+#endif
+
+#endif
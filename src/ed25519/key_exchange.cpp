@@ -3,11 +3,12 @@
 
 #include "ip2/aux_/ed25519.hpp"
 #include "fe.h"
+#include "fe51.h"
 
 namespace ip2 {
 namespace aux {
 
-void ed25519_key_exchange(unsigned char *shared_secret
+void ed25519_key_exchange_ref10(unsigned char *shared_secret
 	, const unsigned char *public_key, const unsigned char *private_key) {
     unsigned char e[32];
     unsigned int i;
@@ -85,4 +86,94 @@ void ed25519_key_exchange(unsigned char *shared_secret
     fe_tobytes(shared_secret, x2);
 }
 
+#if ED25519_FE51
+
+/*
+    the same conversion and ladder as ed25519_key_exchange_ref10(), on fe51
+    field elements
+*/
+
+void ed25519_key_exchange(unsigned char *shared_secret
+	, const unsigned char *public_key, const unsigned char *private_key) {
+    unsigned char e[32];
+    unsigned int i;
+
+    fe51 x1;
+    fe51 x2;
+    fe51 z2;
+    fe51 x3;
+    fe51 z3;
+    fe51 tmp0;
+    fe51 tmp1;
+
+    int pos;
+    unsigned int swap;
+    unsigned int b;
+
+    for (i = 0; i < 32; ++i) {
+        e[i] = private_key[i];
+    }
+
+    e[0] &= 248;
+    e[31] &= 63;
+    e[31] |= 64;
+
+    fe51_frombytes(x1, public_key);
+    fe51_1(tmp1);
+    fe51_add(tmp0, x1, tmp1);
+    fe51_sub(tmp1, tmp1, x1);
+    fe51_invert(tmp1, tmp1);
+    fe51_mul(x1, tmp0, tmp1);
+
+    fe51_1(x2);
+    fe51_0(z2);
+    fe51_copy(x3, x1);
+    fe51_1(z3);
+
+    swap = 0;
+    for (pos = 254; pos >= 0; --pos) {
+        b = e[pos / 8] >> (pos & 7);
+        b &= 1;
+        swap ^= b;
+        fe51_cswap(x2, x3, swap);
+        fe51_cswap(z2, z3, swap);
+        swap = b;
+
+        fe51_sub(tmp0, x3, z3);
+        fe51_sub(tmp1, x2, z2);
+        fe51_add(x2, x2, z2);
+        fe51_add(z2, x3, z3);
+        fe51_mul(z3, tmp0, x2);
+        fe51_mul(z2, z2, tmp1);
+        fe51_sq(tmp0, tmp1);
+        fe51_sq(tmp1, x2);
+        fe51_add(x3, z3, z2);
+        fe51_sub(z2, z3, z2);
+        fe51_mul(x2, tmp1, tmp0);
+        fe51_sub(tmp1, tmp1, tmp0);
+        fe51_sq(z2, z2);
+        fe51_mul121666(z3, tmp1);
+        fe51_sq(x3, x3);
+        fe51_add(tmp0, tmp0, z3);
+        fe51_mul(z3, x1, z2);
+        fe51_mul(z2, tmp1, tmp0);
+    }
+
+    fe51_cswap(x2, x3, swap);
+    fe51_cswap(z2, z3, swap);
+
+    fe51_invert(z2, z2);
+    fe51_mul(x2, x2, z2);
+    fe51_tobytes(shared_secret, x2);
+}
+
+#else
+
+void ed25519_key_exchange(unsigned char *shared_secret
+	, const unsigned char *public_key, const unsigned char *private_key) {
+    ed25519_key_exchange_ref10(shared_secret, public_key, private_key);
+}
+
+#endif
+
 } }
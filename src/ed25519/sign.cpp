@@ -4,22 +4,32 @@
 #include "ip2/aux_/ed25519.hpp"
 #include "ip2/aux_/hasher512.hpp"
 #include "ge.h"
+#include "ge51.h"
 #include "sc.h"
 
 namespace ip2 {
 namespace aux {
 
-void ed25519_sign(unsigned char *signature, const unsigned char *message, std::ptrdiff_t message_len, const unsigned char *public_key, const unsigned char *private_key) {
+namespace {
+
+void ref10_scalarmult_base_tobytes(unsigned char *s, const unsigned char *a) {
     ge_p3 R;
+    ge_scalarmult_base(&R, a);
+    ge_p3_tobytes(s, &R);
+}
 
+/* scalarmult_base computes R = r * B into the first half of the signature */
+template <typename ScalarmultBase>
+void sign(unsigned char *signature, const unsigned char *message, std::ptrdiff_t message_len
+    , const unsigned char *public_key, const unsigned char *private_key
+    , ScalarmultBase scalarmult_base) {
     hasher512 hash;
     hash.update({reinterpret_cast<char const*>(private_key) + 32, 32});
     hash.update({reinterpret_cast<char const*>(message), message_len});
     sha512_hash r = hash.final();
 
     sc_reduce(reinterpret_cast<unsigned char*>(r.data()));
-    ge_scalarmult_base(&R, reinterpret_cast<unsigned char*>(r.data()));
-    ge_p3_tobytes(signature, &R);
+    scalarmult_base(signature, reinterpret_cast<unsigned char*>(r.data()));
 
     hash.reset();
     hash.update({reinterpret_cast<char const*>(signature), 32});
@@ -34,4 +44,18 @@ void ed25519_sign(unsigned char *signature, const unsigned char *message, std::p
         , reinterpret_cast<unsigned char*>(r.data()));
 }
 
+}
+
+void ed25519_sign(unsigned char *signature, const unsigned char *message, std::ptrdiff_t message_len, const unsigned char *public_key, const unsigned char *private_key) {
+#if ED25519_FE51
+    sign(signature, message, message_len, public_key, private_key, &ge51_scalarmult_base_tobytes);
+#else
+    sign(signature, message, message_len, public_key, private_key, &ref10_scalarmult_base_tobytes);
+#endif
+}
+
+void ed25519_sign_ref10(unsigned char *signature, const unsigned char *message, std::ptrdiff_t message_len, const unsigned char *public_key, const unsigned char *private_key) {
+    sign(signature, message, message_len, public_key, private_key, &ref10_scalarmult_base_tobytes);
+}
+
 } }
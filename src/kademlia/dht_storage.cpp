@@ -14,14 +14,17 @@ see LICENSE file.
 */
 
 #include "ip2/kademlia/dht_storage.hpp"
+#include "ip2/kademlia/item_log.hpp"
 #include "ip2/kademlia/node_entry.hpp"
 #include "ip2/kademlia/relay.hpp"
 #include "ip2/settings_pack.hpp"
 
 #include <tuple>
+#include <cstring>
 #include <algorithm>
 #include <utility>
 #include <map>
+#include <list>
 #include <set>
 #include <string>
 
@@ -98,6 +101,14 @@ namespace {
 		std::copy(buf.begin(), buf.end(), item.value.get());
 	}
 
+	// the bencoded size of a mutable item as get_mutable_items() returns it,
+	// erring on the large side
+	int mutable_item_size(int const value_size, int const salt_size)
+	{
+		// d1:k32:<pk>4:salt<n>:<salt>3:sig64:<sig>2:tsi<ts>e1:v<value>e
+		return value_size + salt_size + public_key::len + signature::len + 64;
+	}
+
 	void touch_item(dht_immutable_item& f, address const& addr)
 	{
 		f.last_seen = aux::time_now();
@@ -335,6 +346,13 @@ namespace {
 	typedef relay_table::index<time>::type relay_table_by_time;
 	typedef relay_table::index<receiver>::type relay_table_by_receiver;
 
+	// the item log is rewritten once this much of it is stale
+	constexpr std::int64_t item_log_compact_threshold = 64 * 1024 * 1024;
+
+	// how much of the log a tick reads while rewriting it, so that the
+	// rewrite is spread over many ticks
+	constexpr std::int64_t item_log_compact_step = 4 * 1024 * 1024;
+
 	class dht_default_storage final : public dht_storage_interface
 	{
 	public:
@@ -343,6 +361,14 @@ namespace {
 			: m_settings(settings)
 		{
 			m_counters.reset();
+
+			std::string const& log_path = m_settings.get_str(settings_pack::dht_item_log_path);
+			if (!log_path.empty())
+			{
+				// without the log, the items are only kept in memory
+				error_code ec;
+				m_log.open(log_path, ec);
+			}
 		}
 
 		~dht_default_storage() override = default;
@@ -363,10 +389,22 @@ namespace {
 		bool get_immutable_item(sha256_hash const& target
 			, entry& item) const override
 		{
-			auto const i = m_immutable_table.find(target);
-			if (i == m_immutable_table.end()) return false;
+			if (m_backend != nullptr)
+			{
+				return m_backend->get_immutable_item(target, item);
+			}
 
 			error_code ec;
+			auto const i = m_immutable_table.find(target);
+			if (i == m_immutable_table.end())
+			{
+				item_log::record r;
+				if (!m_log.find(target, r) || r.type != item_log::kind::immutable_item)
+					return false;
+				item["v"] = bdecode(r.value, ec);
+				return true;
+			}
+
 			item["v"] = bdecode({i->second.value.get(), i->second.size}, ec);
 			return true;
 		}
@@ -375,6 +413,12 @@ namespace {
 			, span<char const> buf
 			, address const& addr) override
 		{
+			if (m_backend != nullptr)
+			{
+				m_backend->put_immutable_item(target, buf, addr);
+				return;
+			}
+
 			TORRENT_ASSERT(!m_node_ids.empty());
 			auto i = m_immutable_table.find(target);
 			if (i == m_immutable_table.end())
@@ -386,6 +430,7 @@ namespace {
 						, m_immutable_table);
 
 					TORRENT_ASSERT(j != m_immutable_table.end());
+					m_log.append_removed(j->first);
 					m_immutable_table.erase(j);
 					m_counters.immutable_data -= 1;
 				}
@@ -395,6 +440,14 @@ namespace {
 				std::tie(i, std::ignore) = m_immutable_table.insert(
 					std::make_pair(target, std::move(to_add)));
 				m_counters.immutable_data += 1;
+
+				// an immutable item never changes, if the log already has it
+				// there's nothing to append
+				item_log::record r;
+				if (m_log.find(target, r))
+					m_log.forget(target);
+				else
+					m_log.append_immutable(target, buf);
 			}
 
 //			std::fprintf(stderr, "added immutable item (%d)\n", int(m_immutable_table.size()));
@@ -411,7 +464,14 @@ namespace {
 			}
 
 			auto const i = m_mutable_table.find(target);
-			if (i == m_mutable_table.end()) return false;
+			if (i == m_mutable_table.end())
+			{
+				item_log::record r;
+				if (!m_log.find(target, r) || r.type != item_log::kind::mutable_item)
+					return false;
+				ts = r.ts;
+				return true;
+			}
 
 			ts = i->second.ts;
 			return true;
@@ -427,7 +487,23 @@ namespace {
 			}
 
 			auto const i = m_mutable_table.find(target);
-			if (i == m_mutable_table.end()) return false;
+			if (i == m_mutable_table.end())
+			{
+				item_log::record r;
+				if (!m_log.find(target, r) || r.type != item_log::kind::mutable_item)
+					return false;
+
+				item["ts"] = r.ts.value;
+				if (force_fill || (timestamp(0) <= ts && ts < r.ts))
+				{
+					error_code ec;
+					item["v"] = bdecode(r.value, ec);
+					item["sig"] = r.sig.bytes;
+					item["k"] = r.pk.bytes;
+					item["salt"] = std::string(r.salt.data(), std::size_t(r.salt.size()));
+				}
+				return true;
+			}
 
 			dht_mutable_item const& f = i->second;
 			item["ts"] = f.ts.value;
@@ -450,7 +526,7 @@ namespace {
 				return m_backend->get_mutable_item_target(prefix, target);
 			}
 
-			if (m_mutable_table.empty()) return false;
+			if (m_mutable_table.empty() && m_log.num_indexed() == 0) return false;
 
 			std::vector<sha256_hash> candidates;
 
@@ -462,6 +538,18 @@ namespace {
 				candidates.push_back(it->first);
 			}
 
+			// the logged items not loaded yet. Those in memory aren't indexed
+			// by the log anymore
+			std::vector<sha256_hash> logged;
+			m_log.targets_with_prefix(prefix, 12, logged);
+			item_log::record rec;
+			for (auto const& t : logged)
+			{
+				if (t == prefix) continue;
+				if (m_log.find(t, rec) && rec.type == item_log::kind::mutable_item)
+					candidates.push_back(t);
+			}
+
 			if (candidates.empty()) return false;
 
 			// randomly select a item target
@@ -472,6 +560,78 @@ namespace {
 			return true;
 		}
 
+		bool get_mutable_items(sha256_hash const& prefix
+			, int const prefix_len
+			, sha256_hash const* after
+			, int const max_bytes
+			, entry::list_type& items) const override
+		{
+			if (m_backend != nullptr)
+			{
+				return m_backend->get_mutable_items(prefix, prefix_len, after
+					, max_bytes, items);
+			}
+
+			auto const matches = [&](sha256_hash const& t)
+			{
+				return std::memcmp(t.data(), prefix.data(), std::size_t(prefix_len)) == 0;
+			};
+			auto const skipped = [&](sha256_hash const& t)
+			{
+				return after != nullptr && !(*after < t);
+			};
+
+			// the items only the log has are merged in, in target order
+			std::vector<sha256_hash> logged;
+			m_log.targets_with_prefix(prefix, prefix_len, logged);
+			auto log_it = logged.begin();
+			while (log_it != logged.end() && skipped(*log_it)) ++log_it;
+
+			auto mem_it = m_mutable_table.lower_bound(prefix);
+			while (mem_it != m_mutable_table.end() && skipped(mem_it->first)) ++mem_it;
+
+			int bytes = 0;
+			auto const add = [&](span<char const> value, span<char const> salt
+				, timestamp const ts, signature const& sig, public_key const& pk)
+			{
+				int const size = mutable_item_size(int(value.size()), int(salt.size()));
+				if (!items.empty() && bytes + size > max_bytes) return false;
+				bytes += size;
+
+				entry item;
+				error_code ec;
+				item["ts"] = ts.value;
+				item["v"] = bdecode(value, ec);
+				item["sig"] = sig.bytes;
+				item["k"] = pk.bytes;
+				item["salt"] = std::string(salt.data(), std::size_t(salt.size()));
+				items.push_back(std::move(item));
+				return true;
+			};
+
+			item_log::record r;
+			for (;;)
+			{
+				bool const mem_left = mem_it != m_mutable_table.end() && matches(mem_it->first);
+				bool const log_left = log_it != logged.end();
+				if (!mem_left && !log_left) return false;
+
+				if (mem_left && (!log_left || mem_it->first < *log_it))
+				{
+					dht_mutable_item const& f = mem_it->second;
+					if (!add({f.value.get(), f.size}, f.salt, f.ts, f.sig, f.key))
+						return true;
+					++mem_it;
+					continue;
+				}
+
+				if (m_log.find(*log_it, r) && r.type == item_log::kind::mutable_item
+					&& !add(r.value, r.salt, r.ts, r.sig, r.pk))
+					return true;
+				++log_it;
+			}
+		}
+
 		void put_mutable_item(sha256_hash const& target
 			, span<char const> buf
 			, signature const& sig
@@ -498,15 +658,37 @@ namespace {
 						, m_mutable_table);
 
 					TORRENT_ASSERT(j != m_mutable_table.end());
+					m_log.append_removed(j->first);
 					m_mutable_table.erase(j);
 					m_counters.mutable_data -= 1;
 				}
+
+				// the log may have an older version, a put with a lower
+				// timestamp mustn't replace it
+				item_log::record r;
+				bool const logged = m_log.find(target, r)
+					&& r.type == item_log::kind::mutable_item
+					&& ts < r.ts;
+
 				dht_mutable_item to_add;
-				set_value(to_add, buf);
-				to_add.ts = ts;
-				to_add.salt = {salt.begin(), salt.end()};
-				to_add.sig = sig;
-				to_add.key = pk;
+				if (logged)
+				{
+					set_value(to_add, r.value);
+					to_add.ts = r.ts;
+					to_add.salt = {r.salt.begin(), r.salt.end()};
+					to_add.sig = r.sig;
+					to_add.key = r.pk;
+				}
+				else
+				{
+					set_value(to_add, buf);
+					to_add.ts = ts;
+					to_add.salt = {salt.begin(), salt.end()};
+					to_add.sig = sig;
+					to_add.key = pk;
+					m_log.append_mutable(target, buf, sig, ts, pk, salt);
+				}
+				m_log.forget(target);
 
 				std::tie(i, std::ignore) = m_mutable_table.insert(
 					std::make_pair(target, std::move(to_add)));
@@ -522,6 +704,7 @@ namespace {
 					set_value(item, buf);
 					item.ts = ts;
 					item.sig = sig;
+					m_log.append_mutable(target, buf, sig, ts, item.key, item.salt);
 				}
 			}
 
@@ -537,8 +720,74 @@ namespace {
 			}
 
 			auto i = m_mutable_table.find(target);
-			if (i == m_mutable_table.end()) return;
-			m_mutable_table.erase(i);
+			item_log::record r;
+			if (i == m_mutable_table.end() && !m_log.find(target, r)) return;
+
+			m_log.append_removed(target);
+			m_log.forget(target);
+			if (i != m_mutable_table.end()) m_mutable_table.erase(i);
+		}
+
+		void put_origin_item(sha256_hash const& target
+			, span<char const> buf
+			, signature const& sig
+			, timestamp const ts
+			, public_key const& pk
+			, span<char const> salt) override
+		{
+			if (m_backend != nullptr)
+			{
+				m_backend->put_origin_item(target, buf, sig, ts, pk, salt);
+				return;
+			}
+
+			auto const i = m_origin_table.find(target);
+			if (i != m_origin_table.end() && ts < i->second.item.ts) return;
+
+			origin_item& o = touch_origin_item(target);
+			set_value(o.item, buf);
+			o.item.ts = ts;
+			o.item.salt = {salt.begin(), salt.end()};
+			o.item.sig = sig;
+			o.item.key = pk;
+			o.segment = false;
+		}
+
+		void put_origin_item(sha256_hash const& target
+			, span<char const> buf) override
+		{
+			if (m_backend != nullptr)
+			{
+				m_backend->put_origin_item(target, buf);
+				return;
+			}
+
+			origin_item& o = touch_origin_item(target);
+			set_value(o.item, buf);
+			o.segment = true;
+		}
+
+		bool get_origin_item(sha256_hash const& target
+			, entry& item) const override
+		{
+			if (m_backend != nullptr)
+			{
+				return m_backend->get_origin_item(target, item);
+			}
+
+			auto const i = m_origin_table.find(target);
+			if (i == m_origin_table.end()) return false;
+
+			dht_mutable_item const& f = i->second.item;
+			error_code ec;
+			item["v"] = bdecode({f.value.get(), f.size}, ec);
+			if (i->second.segment) return true;
+
+			item["ts"] = f.ts.value;
+			item["sig"] = f.sig.bytes;
+			item["k"] = f.key.bytes;
+			item["salt"] = f.salt;
+			return true;
 		}
 
 		void relay_referred(node_id const& peer
@@ -703,6 +952,7 @@ namespace {
 							++i;
 							continue;
 						}
+						m_log.append_removed(i->first);
 						i = m_immutable_table.erase(i);
 						m_counters.immutable_data -= 1;
 					}
@@ -719,6 +969,7 @@ namespace {
 							++i;
 							continue;
 						}
+						m_log.append_removed(i->first);
 						i = m_mutable_table.erase(i);
 						m_counters.mutable_data -= 1;
 					}
@@ -742,6 +993,11 @@ namespace {
 					i = decltype(i)(time_index.erase(std::next(i).base()));
 				}
 			}
+
+			if (m_log.is_compacting())
+				compact_log_step();
+			else if (m_log.stale_bytes() >= item_log_compact_threshold)
+				start_compact_log();
 		}
 
 		dht_storage_counters counters() const override
@@ -752,6 +1008,10 @@ namespace {
 		void close() override
 		{
 			if (m_backend != nullptr) m_backend->close();
+
+			// the log is read lazily, it's left for the next start as it
+			// is. A rewrite that's not done is dropped
+			m_log.close();
 		}
 
 	private:
@@ -762,10 +1022,95 @@ namespace {
 		std::vector<node_id> m_node_ids;
 		std::map<node_id, dht_immutable_item> m_immutable_table;
 		std::map<node_id, dht_mutable_item> m_mutable_table;
+		// items published by this node, when there's no backend. The
+		// targets are kept in the order they were last put, the front one
+		// is dropped first
+		struct origin_item
+		{
+			dht_mutable_item item;
+			std::list<node_id>::iterator lru;
+			bool segment = false;
+		};
+		std::map<node_id, origin_item> m_origin_table;
+		std::list<node_id> m_origin_lru;
 		std::map<node_id, relays_bucket> m_relays_table;
 
 		relay_table m_relay_entries_table;
 
+		// stored items, so they survive a restart. Items are in the memory
+		// tables once they're put again, the log only indexes the others
+		item_log m_log;
+
+		// the items still only in the log are kept, as many of each kind as
+		// the memory tables may hold
+		int m_compact_immutable = 0;
+		int m_compact_mutable = 0;
+
+		void start_compact_log()
+		{
+			m_compact_immutable = 0;
+			m_compact_mutable = 0;
+			error_code ec;
+			m_log.start_compact(ec);
+			if (!ec) compact_log_step();
+		}
+
+		void compact_log_step()
+		{
+			int const max_items = m_settings.get_int(settings_pack::dht_max_dht_items);
+			auto const keep_indexed = [&](item_log::record const& r)
+			{
+				int& n = r.type == item_log::kind::immutable_item
+					? m_compact_immutable : m_compact_mutable;
+				return n++ < max_items;
+			};
+
+			auto const write_live = [this](item_log& out)
+			{
+				for (auto const& i : m_immutable_table)
+					out.append_immutable(i.first, {i.second.value.get(), i.second.size});
+				for (auto const& i : m_mutable_table)
+				{
+					dht_mutable_item const& f = i.second;
+					out.append_mutable(i.first, {f.value.get(), f.size}
+						, f.sig, f.ts, f.key, f.salt);
+				}
+			};
+
+			error_code ec;
+			if (!m_log.compact_step(keep_indexed, write_live, item_log_compact_step, ec))
+				return;
+
+			// the reopened log indexes everything, the items in memory are
+			// served from there
+			for (auto const& i : m_immutable_table) m_log.forget(i.first);
+			for (auto const& i : m_mutable_table) m_log.forget(i.first);
+		}
+
+		// returns the origin item for target, moved to the back of the put
+		// order. When it's a new one and the table is full, the least
+		// recently put item is dropped first
+		origin_item& touch_origin_item(sha256_hash const& target)
+		{
+			auto i = m_origin_table.find(target);
+			if (i != m_origin_table.end())
+			{
+				m_origin_lru.splice(m_origin_lru.end(), m_origin_lru, i->second.lru);
+				return i->second;
+			}
+
+			if (int(m_origin_table.size()) >= m_settings.get_int(settings_pack::dht_max_dht_items)
+				&& !m_origin_lru.empty())
+			{
+				m_origin_table.erase(m_origin_lru.front());
+				m_origin_lru.pop_front();
+			}
+
+			origin_item& o = m_origin_table[target];
+			o.lru = m_origin_lru.insert(m_origin_lru.end(), target);
+			return o;
+		}
+
 		void remove_least_important_relay_entry()
 		{
 			if (m_relay_entries_table.size() == 0) return;
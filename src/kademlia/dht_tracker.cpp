@@ -47,6 +47,9 @@ namespace ip2::dht {
 	auto const key_refresh
 		= duration_cast<time_duration>(minutes(5));
 
+	// max saved nodes pinged at once when restarting with a saved routing table
+	constexpr int max_revalidate_nodes = 128;
+
 	void add_dht_counters(node const& dht, counters& c)
 	{
 		auto const [nodes, replacements, allocated_observers, invoked_requests]
@@ -66,6 +69,16 @@ namespace ip2::dht {
 		return r;
 	}
 
+	std::vector<node_entry> save_nodes(node const& dht)
+	{
+		std::vector<node_entry> ret;
+
+		dht.m_table.for_each_node([&ret](node_entry const& e)
+		{ ret.push_back(e); });
+
+		return ret;
+	}
+
 	} // anonymous namespace
 
 	// class that puts the networking and the kademlia node in a single
@@ -91,8 +104,8 @@ namespace ip2::dht {
 		, m_settings(settings)
 		, m_running(false)
 		, m_host_resolver(ios)
-		, m_send_quota(settings.get_int(settings_pack::dht_upload_rate_limit))
-		, m_last_tick(aux::time_now())
+		, m_shaper(aux::time_now())
+		, m_shaper_timer(ios)
 		, m_ioc(ios)
 		, m_account_manager(std::move(account_manager))
 		, m_bs_nodes_storage(bs_nodes_storage)
@@ -100,6 +113,7 @@ namespace ip2::dht {
 	{
 		m_blocker.set_block_timer(m_settings.get_int(settings_pack::dht_block_timeout));
 		m_blocker.set_rate_limit(m_settings.get_int(settings_pack::dht_block_ratelimit));
+		m_blocker.set_relay_rate_limit(m_settings.get_int(settings_pack::dht_relay_block_ratelimit));
 	}
 
 	void dht_tracker::install_bootstrap_nodes()
@@ -180,10 +194,20 @@ namespace ip2::dht {
 			n.second.connection_timer.expires_after(seconds(1));
 			n.second.connection_timer.async_wait(
 				std::bind(&dht_tracker::connection_timeout, self(), n.first, _1));
-			if (aux::is_v6(n.first.get_local_endpoint()))
-				n.second.dht.bootstrap(concat(m_state.nodes6, m_state.nodes), f);
-			else
-				n.second.dht.bootstrap(concat(m_state.nodes, m_state.nodes6), f);
+			std::vector<node_entry> const nodes = aux::is_v6(n.first.get_local_endpoint())
+				? concat(m_state.nodes6, m_state.nodes)
+				: concat(m_state.nodes, m_state.nodes6);
+
+			// re-validate saved nodes in parallel, every reply puts the node
+			// back into the routing table within one round trip
+			int burst = 0;
+			for (auto const& e : nodes)
+			{
+				if (burst++ >= max_revalidate_nodes) break;
+				n.second.dht.add_node(e);
+			}
+
+			n.second.dht.bootstrap(nodes, f);
 		}
 
 		ADD_OUTSTANDING_ASYNC("dht_tracker::refresh_timeout");
@@ -193,6 +217,49 @@ namespace ip2::dht {
 		m_state.clear();
 	}
 
+	std::vector<node_entry> dht_tracker::routing_table_nodes() const
+	{
+		std::vector<node_entry> nodes;
+		for (auto const& n : m_nodes)
+		{
+			auto const saved = save_nodes(n.second.dht);
+			nodes.insert(nodes.end(), saved.begin(), saved.end());
+		}
+		return nodes;
+	}
+
+	void dht_tracker::save_routing_table()
+	{
+		std::vector<node_entry> nodes = routing_table_nodes();
+		if (nodes.empty()) nodes = m_last_good_nodes;
+		else m_last_good_nodes = nodes;
+
+		// the tables of the reopened sockets fill up from nothing, that's
+		// not a loss of nodes
+		m_live_nodes = 0;
+
+		// confirmed nodes with lowest rtt first
+		std::stable_sort(nodes.begin(), nodes.end()
+			, [](node_entry const& lhs, node_entry const& rhs)
+			{
+				return std::make_tuple(!lhs.confirmed(), lhs.rtt)
+					< std::make_tuple(!rhs.confirmed(), rhs.rtt);
+			});
+
+#ifndef TORRENT_DISABLE_LOGGING
+		m_log->log(dht_logger::tracker, "save routing table, nodes: %d"
+			, int(nodes.size()));
+#endif
+
+		m_state.nodes.clear();
+		m_state.nodes6.clear();
+		for (auto const& e : nodes)
+		{
+			if (aux::is_v6(e.ep())) m_state.nodes6.push_back(e);
+			else m_state.nodes.push_back(e);
+		}
+	}
+
 	void dht_tracker::stop()
 	{
 		m_running = false;
@@ -200,6 +267,8 @@ namespace ip2::dht {
 		for (auto& n : m_nodes)
 			n.second.connection_timer.cancel();
 		m_refresh_timer.cancel();
+		m_shaper_timer.cancel();
+		m_shaper.clear();
 		m_host_resolver.cancel();
 	}
 
@@ -254,9 +323,22 @@ namespace ip2::dht {
 		for (auto& n : m_nodes)
 			n.second.dht.tick();
 
+		// when the routing tables start losing nodes, remember what's left
+		// in case they empty out. Copying them on every tick is too costly
+		int live_nodes = 0;
+		for (auto const& n : m_nodes)
+			live_nodes += std::get<0>(n.second.dht.size());
+		if (live_nodes < m_live_nodes)
+		{
+			std::vector<node_entry> nodes = routing_table_nodes();
+			if (!nodes.empty()) m_last_good_nodes = std::move(nodes);
+		}
+		m_live_nodes = live_nodes;
+
 		// periodically update the DOS blocker's settings from the dht_settings
 		m_blocker.set_block_timer(m_settings.get_int(settings_pack::dht_block_timeout));
 		m_blocker.set_rate_limit(m_settings.get_int(settings_pack::dht_block_ratelimit));
+		m_blocker.set_relay_rate_limit(m_settings.get_int(settings_pack::dht_relay_block_ratelimit));
 
 		m_refresh_timer.expires_after(seconds(5));
 		ADD_OUTSTANDING_ASYNC("dht_tracker::refresh_timeout");
@@ -370,6 +452,49 @@ namespace ip2::dht {
 		}
 	}
 
+	struct get_items_ctx
+	{
+		explicit get_items_ctx(int traversals) : active_traversals(traversals) {}
+		int active_traversals;
+		// whether any traversal heard of more items than it got
+		bool more = false;
+		// the latest timestamp passed on, by target
+		std::map<sha256_hash, timestamp> seen;
+	};
+
+	void get_items_callback(item const& it, bool const authoritative
+		, bool const more
+		, std::shared_ptr<get_items_ctx> ctx
+		, std::function<void(item const&, bool, bool)> f)
+	{
+		if (authoritative)
+		{
+			if (more) ctx->more = true;
+			if (--ctx->active_traversals == 0) f(it, true, ctx->more);
+			return;
+		}
+
+		// every node's traversal may find the same items
+		sha256_hash const target = item_target_id(it.salt(), it.pk());
+		auto const i = ctx->seen.find(target);
+		if (i != ctx->seen.end() && it.ts() <= i->second) return;
+		ctx->seen[target] = it.ts();
+		f(it, false, false);
+	}
+
+	void get_segment_callback(item const& it, bool
+		, std::shared_ptr<get_immutable_item_ctx> ctx
+		, std::function<void(item const&, bool)> f)
+	{
+		TORRENT_ASSERT(!it.is_mutable());
+		--ctx->active_traversals;
+		if (!ctx->item_posted && (!it.empty() || ctx->active_traversals == 0))
+		{
+			ctx->item_posted = true;
+			f(it, true);
+		}
+	}
+
 	struct put_item_ctx
 	{
 		explicit put_item_ctx(int traversals)
@@ -412,12 +537,17 @@ namespace ip2::dht {
 		, std::shared_ptr<put_item_ctx> ctx
 		, std::function<void(item const&, int)> cb
 		, bool referrable
+		, bool origin
 		, std::shared_ptr<dht_tracker> tracker_ptr)
 	{
 		ctx->response_count += responses;
 		if (--ctx->active_traversals == 0)
 		{
 			cb(it, ctx->response_count);
+			if (origin)
+			{
+				tracker_ptr->store_origin_item(it);
+			}
 			if (referrable)
 			{
 				tracker_ptr->store_mutable_item(it);
@@ -537,6 +667,16 @@ namespace ip2::dht {
 				, std::bind(&get_mutable_item_callback, _1, _2, ctx, cb));
 	}
 
+	void dht_tracker::get_items(sha256_hash const& prefix, int const prefix_len
+		, std::function<void(item const&, bool, bool)> cb
+		, sha256_hash const* after)
+	{
+		auto ctx = std::make_shared<get_items_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.get_items(prefix, prefix_len, after
+				, std::bind(&get_items_callback, _1, _2, _3, ctx, cb));
+	}
+
 	void dht_tracker::put_item(entry const& data
 		, std::function<void(int)> cb
 		, public_key const& to)
@@ -634,6 +774,7 @@ namespace ip2::dht {
 				, std::bind(&put_mutable_item_callback_with_storage, _1, _2
 					, ctx, cb
 					, !m_settings.get_bool(settings_pack::dht_non_referrable)
+					, false
 					, self()));
 	}
 
@@ -648,6 +789,95 @@ namespace ip2::dht {
 		put_item(self, data, cb, alpha, invoke_window, invoke_limit, salt);
 	}
 
+	void dht_tracker::put_index(entry const& data
+		, std::function<void(item const&, int)> cb
+		, std::int8_t alpha
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit
+		, std::string salt)
+	{
+		public_key const key(m_public_key.data());
+		auto ctx = std::make_shared<put_item_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.put_item(key, salt, data
+				, alpha, invoke_window, invoke_limit
+				, std::bind(&put_mutable_item_callback_with_storage, _1, _2
+					, ctx, cb
+					, !m_settings.get_bool(settings_pack::dht_non_referrable)
+					, true
+					, self()));
+	}
+
+	void dht_tracker::get_item_from_origin(public_key const& key
+		, std::function<void(item const&, bool)> cb
+		, std::string salt
+		, std::int64_t timestamp)
+	{
+		auto ctx = std::make_shared<get_mutable_item_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.get_item_from_origin(key, salt, timestamp
+				, std::bind(&get_mutable_item_callback, _1, _2, ctx, cb));
+	}
+
+	void dht_tracker::get_segment(sha1_hash const& seg_hash
+		, std::function<void(item const&, bool)> cb
+		, std::int8_t alpha
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit)
+	{
+		// a segment never changes, a local copy is as good as any
+		bool const found = get_local_immutable_item(segment_target_id(seg_hash)
+			, [&cb](item const& it) { cb(it, true); });
+		if (found)
+		{
+			return;
+		}
+
+		// or one this node published
+		entry e;
+		if (m_storage.get_origin_item(segment_target_id(seg_hash), e)
+			&& e.find_key("k") == nullptr)
+		{
+			item it;
+			it.assign(e["v"]);
+			cb(it, true);
+			return;
+		}
+
+		auto ctx = std::make_shared<get_immutable_item_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.get_segment(seg_hash, alpha, invoke_window, invoke_limit
+				, std::bind(&get_segment_callback, _1, _2, ctx, cb));
+	}
+
+	void dht_tracker::get_segment_from_origin(public_key const& origin
+		, sha1_hash const& seg_hash
+		, std::function<void(item const&, bool)> cb)
+	{
+		auto ctx = std::make_shared<get_immutable_item_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.get_segment_from_origin(origin, seg_hash
+				, std::bind(&get_segment_callback, _1, _2, ctx, cb));
+	}
+
+	void dht_tracker::put_segment(entry const& data
+		, std::function<void(item const&, int)> cb
+		, std::int8_t alpha
+		, std::int8_t invoke_window
+		, std::int8_t invoke_limit)
+	{
+		// kept apart from the items stored for others, so we can keep
+		// serving it after those are evicted
+		std::string flat_data;
+		bencode(std::back_inserter(flat_data), data);
+		m_storage.put_origin_item(segment_target_id(data.string()), flat_data);
+
+		auto ctx = std::make_shared<put_item_ctx>(int(m_nodes.size()));
+		for (auto& n : m_nodes)
+			n.second.dht.put_segment(data, alpha, invoke_window, invoke_limit
+				, std::bind(&put_mutable_item_callback, _1, _2, ctx, cb));
+	}
+
 	void dht_tracker::store_mutable_item(item const& it)
 	{
 		if (!it.is_mutable()) return;
@@ -659,6 +889,17 @@ namespace ip2::dht {
 			, it.ts(), it.pk(), it.salt(), address());
 	}
 
+	void dht_tracker::store_origin_item(item const& it)
+	{
+		if (!it.is_mutable()) return;
+
+		std::string flat_data;
+		bencode(std::back_inserter(flat_data), it.value());
+		sha256_hash const target = item_target_id(it.salt(), it.pk());
+		m_storage.put_origin_item(target, flat_data, it.sig()
+			, it.ts(), it.pk(), it.salt());
+	}
+
 	// relay protocol
 	void dht_tracker::send(public_key const& to
 		, entry const& payload
@@ -888,7 +1129,10 @@ namespace ip2::dht {
 			}
 		}
 
-		if (!m_blocker.incoming(ep.address(), clock_type::now(), m_log))
+		// a source banned for queries is dropped without decoding its packet.
+		// One only banned for relays can still send queries, that takes
+		// decoding to tell
+		if (m_blocker.is_blocked(ep.address(), dos_class::query, clock_type::now()))
 		{
 			m_counters.inc_stats_counter(counters::dht_messages_in_dropped);
 			return true;
@@ -906,6 +1150,10 @@ namespace ip2::dht {
 			m_log->log_packet(dht_logger::incoming_message, buf, ep);
 #endif
 
+			// garbage costs decoding as much as a query does, it's charged
+			// the same so a flood of it gets the source blocked
+			m_blocker.incoming(ep.address(), dos_class::query, clock_type::now(), m_log);
+
 			// maybe decryption error
 			// incoming_decryption_error(s, ep, pk);
 
@@ -918,10 +1166,22 @@ namespace ip2::dht {
 #ifndef TORRENT_DISABLE_LOGGING
 			m_log->log_packet(dht_logger::incoming_message, buf, ep);
 #endif
+			m_blocker.incoming(ep.address(), dos_class::query, clock_type::now(), m_log);
+
 			// it's not a good idea to send a response to an invalid messages
 			return false;
 		}
 
+		// relays (hops) have a budget of their own, the packet has to be
+		// decoded to tell them apart
+		dos_class const dc = m_msg.dict_find_string_value("y") == "h"
+			? dos_class::relay : dos_class::query;
+		if (!m_blocker.incoming(ep.address(), dc, clock_type::now(), m_log))
+		{
+			m_counters.inc_stats_counter(counters::dht_messages_in_dropped);
+			return true;
+		}
+
 #ifndef TORRENT_DISABLE_LOGGING
 		m_log->log_packet(dht_logger::incoming_message, buf, ep);
 #endif
@@ -963,20 +1223,6 @@ namespace ip2::dht {
 		return ret;
 	}
 
-namespace {
-
-	std::vector<node_entry> save_nodes(node const& dht)
-	{
-		std::vector<node_entry> ret;
-
-		dht.m_table.for_each_node([&ret](node_entry const& e)
-		{ ret.push_back(e); });
-
-		return ret;
-	}
-
-} // anonymous namespace
-
 	dht_state dht_tracker::state() const
 	{
 		dht_state ret;
@@ -1003,42 +1249,36 @@ namespace {
 			n.second.dht.add_router_node(node);
 	}
 
-	bool dht_tracker::has_quota()
+	void dht_tracker::update_shaper_rate()
 	{
-		time_point const now = clock_type::now();
-		time_duration const delta = now - m_last_tick;
-		m_last_tick = now;
-
-		std::int64_t const limit = m_settings.get_int(settings_pack::dht_upload_rate_limit);
+		m_shaper.set_rate(m_settings.get_bool(settings_pack::dht_egress_shaping)
+			? m_settings.get_int(settings_pack::dht_upload_rate_limit) : 0);
+	}
 
-		// allow 3 seconds worth of burst
-		std::int64_t const max_accrue = std::min(3 * limit, std::int64_t(std::numeric_limits<int>::max()));
+	bool dht_tracker::has_quota()
+	{
+		update_shaper_rate();
+		return m_shaper.has_quota(clock_type::now());
+	}
 
-		if (delta >= seconds(3)
-			|| delta >= microseconds(std::numeric_limits<int>::max() / limit))
-		{
-			m_send_quota = aux::numeric_cast<int>(max_accrue);
-			return true;
-		}
+	void dht_tracker::drain_shaper(error_code const& e)
+	{
+		COMPLETE_ASYNC("dht_tracker::drain_shaper");
+		m_shaper_timer_armed = false;
+		if (e || !m_running) return;
 
-		int const add = aux::numeric_cast<int>(limit * total_microseconds(delta) / 1000000);
+		update_shaper_rate();
+		time_duration const d = m_shaper.drain(clock_type::now());
+		if (d == time_duration::zero()) return;
 
-		if (max_accrue - m_send_quota < add)
-		{
-			m_send_quota = aux::numeric_cast<int>(max_accrue);
-			return true;
-		}
-		else
-		{
-			// add any new quota we've accrued since last time
-			m_send_quota += add;
-		}
-		TORRENT_ASSERT(m_send_quota <= max_accrue);
-		return m_send_quota > 0;
+		ADD_OUTSTANDING_ASYNC("dht_tracker::drain_shaper");
+		m_shaper_timer_armed = true;
+		m_shaper_timer.expires_after(d);
+		m_shaper_timer.async_wait(std::bind(&dht_tracker::drain_shaper, self(), _1));
 	}
 
 	bool dht_tracker::send_packet(aux::listen_socket_handle const& s, entry& e
-		, udp::endpoint const& addr, sha256_hash const& pk)
+		, udp::endpoint const& addr, sha256_hash const& pk, egress_class const tc)
 	{
 		TORRENT_ASSERT(m_nodes.find(s) != m_nodes.end());
 
@@ -1054,11 +1294,50 @@ namespace {
 		m_send_buf.clear();
 		bencode(std::back_inserter(m_send_buf), e);
 
-		// update the quota. We won't prevent the packet to be sent if we exceed
-		// the quota, we'll just (potentially) block the next incoming request.
+		// relay payloads are end-to-end encrypted, they won't compress
+		aux::udp_send_flags_t flags{};
+		entry const* q = e.find_key("q");
+		if (q && q->type() == entry::string_t && q->string() == "relay")
+			flags |= aux::udp_socket::dont_compress;
+
+		// requests and responses are never held back, they just use up the
+		// budget the other classes are paced to
+		update_shaper_rate();
+		int const size = int(m_send_buf.size());
+		switch (m_shaper.admit(tc, size, clock_type::now()))
+		{
+			case egress_shaper::admission::send_now:
+				return send_buffer(s, addr, pk, m_send_buf, flags);
+
+			case egress_shaper::admission::queue:
+				m_shaper.enqueue(tc, size
+					, [this, s, addr, pk, buf = m_send_buf, flags]
+					{ send_buffer(s, addr, pk, buf, flags); });
+				m_counters.inc_stats_counter(counters::dht_messages_out_delayed);
+				if (!m_shaper_timer_armed)
+				{
+					ADD_OUTSTANDING_ASYNC("dht_tracker::drain_shaper");
+					m_shaper_timer_armed = true;
+					m_shaper_timer.expires_after(milliseconds(10));
+					m_shaper_timer.async_wait(std::bind(&dht_tracker::drain_shaper, self(), _1));
+				}
+				return true;
 
-		m_send_quota -= int(m_send_buf.size());
+			case egress_shaper::admission::drop:
+				break;
+		}
 
+		m_counters.inc_stats_counter(counters::dht_messages_out_dropped);
+#ifndef TORRENT_DISABLE_LOGGING
+		m_log->log_packet(dht_logger::outgoing_message, m_send_buf, addr);
+#endif
+		return false;
+	}
+
+	bool dht_tracker::send_buffer(aux::listen_socket_handle const& s
+		, udp::endpoint const& addr, sha256_hash const& pk
+		, span<char const> const buf, aux::udp_send_flags_t const flags)
+	{
 		error_code ec;
 		if (s.get_local_endpoint().protocol().family() != addr.protocol().family())
 		{
@@ -1070,31 +1349,31 @@ namespace {
 					{ return v.first.get_local_endpoint().protocol().family() == addr.protocol().family(); });
 
 			if (n != m_nodes.end())
-				m_send_fun(n->first, addr, pk, m_send_buf, ec, {});
+				m_send_fun(n->first, addr, pk, buf, ec, flags);
 			else
 				ec = boost::asio::error::address_family_not_supported;
 		}
 		else
 		{
-			m_send_fun(s, addr, pk, m_send_buf, ec, {});
+			m_send_fun(s, addr, pk, buf, ec, flags);
 		}
 
 		if (ec)
 		{
 			m_counters.inc_stats_counter(counters::dht_messages_out_dropped);
 #ifndef TORRENT_DISABLE_LOGGING
-			m_log->log_packet(dht_logger::outgoing_message, m_send_buf, addr);
+			m_log->log_packet(dht_logger::outgoing_message, buf, addr);
 #endif
 			return false;
 		}
 
-		m_counters.inc_stats_counter(counters::dht_bytes_out, int(m_send_buf.size()));
+		m_counters.inc_stats_counter(counters::dht_bytes_out, int(buf.size()));
 		// account for IP and UDP overhead
 		m_counters.inc_stats_counter(counters::sent_ip_overhead_bytes
 			, aux::is_v6(addr) ? 48 : 28);
 		m_counters.inc_stats_counter(counters::dht_messages_out);
 #ifndef TORRENT_DISABLE_LOGGING
-		m_log->log_packet(dht_logger::outgoing_message, m_send_buf, addr);
+		m_log->log_packet(dht_logger::outgoing_message, buf, addr);
 #endif
 		return true;
 	}
@@ -9,6 +9,9 @@ see LICENSE file.
 */
 
 #include "ip2/kademlia/dos_blocker.hpp"
+#include "ip2/aux_/random.hpp"
+
+#include <algorithm>
 
 #ifndef TORRENT_DISABLE_LOGGING
 #include "ip2/aux_/socket_io.hpp" // for print_address
@@ -17,76 +20,163 @@ see LICENSE file.
 
 namespace ip2::dht {
 
+	namespace {
+
+		// the limit is averaged over this long, to allow for bursts
+		constexpr seconds window_length(10);
+
+		std::uint64_t mix(std::uint64_t h)
+		{
+			h ^= h >> 30;
+			h *= 0xbf58476d1ce4e5b9ULL;
+			h ^= h >> 27;
+			h *= 0x94d049bb133111ebULL;
+			h ^= h >> 31;
+			return h;
+		}
+
+		std::uint64_t read_word(std::uint8_t const* p)
+		{
+			std::uint64_t ret = 0;
+			for (int i = 0; i < 8; ++i) ret = (ret << 8) | p[i];
+			return ret;
+		}
+	}
+
 	dos_blocker::dos_blocker()
-		: m_message_rate_limit(5)
-		, m_block_timeout(5 * 60)
+		: m_block_timeout(5 * 60)
 	{
-		for (auto& e : m_ban_nodes)
+		aux::random_bytes({reinterpret_cast<char*>(&m_seed), sizeof(m_seed)});
+		for (auto& c : m_classes)
 		{
-			e.count = 0;
-			e.limit = min_time();
+			c.current.resize(sketch_rows * sketch_width);
+			c.previous.resize(sketch_rows * sketch_width);
+			c.window_start = time_point();
+			c.rate_limit = 5;
+			c.last_purge = time_point();
 		}
 	}
 
-	bool dos_blocker::incoming(address const& addr, time_point const now, dht_logger* logger)
+	std::uint64_t dos_blocker::hash(address const& addr) const
+	{
+		if (addr.is_v4())
+			return mix(m_seed ^ addr.to_v4().to_uint());
+
+		auto const b = addr.to_v6().to_bytes();
+		return mix(mix(m_seed ^ read_word(b.data())) ^ read_word(b.data() + 8));
+	}
+
+	void dos_blocker::advance(counters& c, time_point const now) const
+	{
+		if (now - c.window_start < window_length) return;
+
+		if (now - c.window_start < window_length * 2)
+		{
+			c.previous.swap(c.current);
+			c.window_start += window_length;
+		}
+		else
+		{
+			// silent for more than a window, nothing to carry over
+			std::fill(c.previous.begin(), c.previous.end(), std::uint16_t(0));
+			c.window_start = now;
+		}
+		std::fill(c.current.begin(), c.current.end(), std::uint16_t(0));
+	}
+
+	bool dos_blocker::incoming(address const& addr, dos_class const dc
+		, time_point const now, dht_logger* logger)
 	{
 		TORRENT_UNUSED(logger);
-		node_ban_entry* match = nullptr;
-		node_ban_entry* min = m_ban_nodes;
-		for (node_ban_entry* i = m_ban_nodes; i < m_ban_nodes + num_ban_nodes; ++i)
+		counters& c = m_classes[int(dc)];
+		std::uint64_t const h = hash(addr);
+
+		auto const blocked = c.blocked.find(h);
+		if (blocked != c.blocked.end())
 		{
-			if (i->src == addr)
+			if (now < blocked->second) return false;
+			c.blocked.erase(blocked);
+		}
+
+		advance(c, now);
+
+		// double hashing, the counter of a row is h1 + row * h2
+		std::uint32_t const h1 = std::uint32_t(h);
+		std::uint32_t const h2 = std::uint32_t(h >> 32) | 1;
+		int idx[sketch_rows];
+		std::uint16_t cur = 0xffff;
+		std::uint16_t prev = 0xffff;
+		for (int row = 0; row < sketch_rows; ++row)
+		{
+			idx[row] = row * sketch_width
+				+ int((h1 + std::uint32_t(row) * h2) % sketch_width);
+			cur = std::min(cur, c.current[std::size_t(idx[row])]);
+			prev = std::min(prev, c.previous[std::size_t(idx[row])]);
+		}
+
+		// conservative update: only raise the counters that are at the
+		// source's count, the others are inflated by collisions already
+		if (cur < 0xffff)
+		{
+			++cur;
+			for (int const i : idx)
 			{
-				match = i;
-				break;
+				auto& v = c.current[std::size_t(i)];
+				v = std::max(v, cur);
 			}
-			if (i->count < min->count) min = i;
-			else if (i->count == min->count
-				&& i->limit < min->limit) min = i;
 		}
 
-		if (match)
-		{
-			++match->count;
+		// the previous window counts for the part of it still within the
+		// last window_length
+		std::int64_t const elapsed = std::max(std::int64_t(0)
+			, std::int64_t(total_milliseconds(now - c.window_start)));
+		std::int64_t const window_ms = total_milliseconds(window_length);
+		std::int64_t const count = cur
+			+ prev * std::max(std::int64_t(0), window_ms - elapsed) / window_ms;
+
+		std::int64_t const limit = std::int64_t(c.rate_limit) * total_seconds(window_length);
+		if (count < limit) return true;
 
-			if (match->count >= m_message_rate_limit * 10)
+		if (int(c.blocked.size()) >= max_blocked && now - c.last_purge >= seconds(1))
+		{
+			c.last_purge = now;
+			for (auto i = c.blocked.begin(); i != c.blocked.end();)
 			{
-				if (now < match->limit)
-				{
-					if (match->count == m_message_rate_limit * 10)
-					{
-#ifndef TORRENT_DISABLE_LOGGING
-						if (logger != nullptr
-							&& logger->should_log(dht_logger::tracker, aux::LOG_WARNING))
-						{
-							logger->log(dht_logger::tracker, "BANNING PEER [ ip: %s time: %d ms count: %d ]"
-								, aux::print_address(addr).c_str()
-								, int(total_milliseconds((now - match->limit) + seconds(10)))
-								, match->count);
-						}
-#else
-						TORRENT_UNUSED(logger);
-#endif // TORRENT_DISABLE_LOGGING
-						// we've received too many messages in less than 10 seconds
-						// from this node. Ignore it until it's silent for 5 minutes
-						match->limit = now + seconds(m_block_timeout);
-					}
-
-					return false;
-				}
-
-				// the messages we received from this peer took more than 10
-				// seconds. Reset the counter and the timer
-				match->count = 0;
-				match->limit = now + seconds(10);
+				if (i->second <= now) i = c.blocked.erase(i);
+				else ++i;
 			}
 		}
-		else
+
+		if (int(c.blocked.size()) < max_blocked)
 		{
-			min->count = 1;
-			min->limit = now + seconds(10);
-			min->src = addr;
+#ifndef TORRENT_DISABLE_LOGGING
+			if (logger != nullptr
+				&& logger->should_log(dht_logger::tracker, aux::LOG_WARNING))
+			{
+				logger->log(dht_logger::tracker, "BANNING PEER [ ip: %s class: %d count: %d ]"
+					, aux::print_address(addr).c_str(), int(dc), int(count));
+			}
+#endif // TORRENT_DISABLE_LOGGING
+			// we've received too many messages in the last 10 seconds from
+			// this node. Ignore it for the block timeout
+			c.blocked[h] = now + seconds(m_block_timeout);
 		}
-		return true;
+
+		return false;
+	}
+
+	bool dos_blocker::is_blocked(address const& addr, dos_class const dc
+		, time_point const now) const
+	{
+		counters const& c = m_classes[int(dc)];
+		auto const blocked = c.blocked.find(hash(addr));
+		return blocked != c.blocked.end() && now < blocked->second;
+	}
+
+	int dos_blocker::num_blocked() const
+	{
+		int ret = 0;
+		for (auto const& c : m_classes) ret += int(c.blocked.size());
+		return ret;
 	}
 }
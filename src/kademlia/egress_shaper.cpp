@@ -0,0 +1,147 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "ip2/kademlia/egress_shaper.hpp"
+
+#include <algorithm>
+
+namespace ip2::dht {
+
+	namespace {
+
+		// the bucket holds at most one second worth of tokens, and requests and
+		// responses can't put it more than one second in debt
+		std::int64_t burst(int const rate) { return rate; }
+
+		// packets queued longer than this would likely time out before they
+		// arrive anyway
+		std::int64_t max_queued(int const rate)
+		{
+			return std::max(std::int64_t(2) * rate, std::int64_t(16 * 1024));
+		}
+
+		bool shaped(egress_class const tc)
+		{
+			return tc != egress_class::request && tc != egress_class::response;
+		}
+	}
+
+	egress_shaper::egress_shaper(time_point const now)
+		: m_last_refill(now)
+	{}
+
+	void egress_shaper::set_rate(int const rate)
+	{
+		m_rate = std::max(0, rate);
+		m_tokens = std::min(m_tokens, burst(m_rate));
+	}
+
+	void egress_shaper::refill(time_point const now)
+	{
+		time_duration const delta = now - m_last_refill;
+		m_last_refill = now;
+		if (m_rate == 0 || delta <= time_duration::zero()) return;
+
+		// a second is enough to fill the bucket from empty, don't let a long
+		// delta overflow the multiplication
+		if (delta >= seconds(2))
+		{
+			m_tokens = burst(m_rate);
+			return;
+		}
+
+		m_tokens = std::min(burst(m_rate)
+			, m_tokens + m_rate * total_microseconds(delta) / 1000000);
+	}
+
+	bool egress_shaper::has_quota(time_point const now)
+	{
+		if (m_rate == 0) return true;
+		refill(now);
+		return m_tokens > 0;
+	}
+
+	egress_shaper::admission egress_shaper::admit(egress_class const tc
+		, int const bytes, time_point const now)
+	{
+		if (m_rate == 0) return admission::send_now;
+		refill(now);
+
+		if (!shaped(tc))
+		{
+			m_tokens = std::max(-burst(m_rate), m_tokens - bytes);
+			return admission::send_now;
+		}
+
+		// don't overtake packets of the same or a higher priority class that
+		// are waiting for tokens
+		bool waiting = false;
+		for (int i = 0; i <= int(tc); ++i)
+			waiting |= !m_queues[i].packets.empty();
+
+		if (!waiting && m_tokens > 0)
+		{
+			m_tokens -= bytes;
+			return admission::send_now;
+		}
+
+		if (m_queues[int(tc)].bytes + bytes > max_queued(m_rate))
+			return admission::drop;
+
+		return admission::queue;
+	}
+
+	void egress_shaper::enqueue(egress_class const tc, int const bytes, send_fun f)
+	{
+		class_queue& q = m_queues[int(tc)];
+		q.packets.push_back({bytes, std::move(f)});
+		q.bytes += bytes;
+	}
+
+	time_duration egress_shaper::drain(time_point const now)
+	{
+		refill(now);
+
+		for (auto& q : m_queues)
+		{
+			while (!q.packets.empty() && (m_rate == 0 || m_tokens > 0))
+			{
+				packet p = std::move(q.packets.front());
+				q.packets.pop_front();
+				q.bytes -= p.bytes;
+				m_tokens -= p.bytes;
+				p.send();
+			}
+			if (!q.packets.empty()) break;
+		}
+
+		bool const empty = std::all_of(m_queues.begin(), m_queues.end()
+			, [](class_queue const& q) { return q.packets.empty(); });
+		if (empty) return time_duration::zero();
+
+		// until the bucket has tokens again, but don't spin
+		std::int64_t const us = (1 - m_tokens) * 1000000 / m_rate;
+		return std::max(duration_cast<time_duration>(microseconds(us))
+			, duration_cast<time_duration>(milliseconds(10)));
+	}
+
+	int egress_shaper::queued_bytes(egress_class const tc) const
+	{
+		return m_queues[int(tc)].bytes;
+	}
+
+	void egress_shaper::clear()
+	{
+		for (auto& q : m_queues)
+		{
+			q.packets.clear();
+			q.bytes = 0;
+		}
+	}
+}
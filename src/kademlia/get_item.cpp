@@ -48,7 +48,11 @@ void get_item::got_data(bdecode_node const& v,
 		// If m_data isn't empty, we should have post alert.
 		if (!m_data.empty()) return;
 
-		sha256_hash incoming_target = item_target_id(v.data_section());
+		sha256_hash incoming_target;
+		if (!m_segment)
+			incoming_target = item_target_id(v.data_section());
+		else if (v.type() == bdecode_node::string_t)
+			incoming_target = segment_target_id({v.string_ptr(), v.string_length()});
 		if (incoming_target != target()) return;
 
 		m_data.assign(v);
@@ -127,13 +131,72 @@ get_item::get_item(
 {
 }
 
+get_item::get_item(
+	node& dht_node
+	, sha256_hash const& prefix
+	, int const prefix_len
+	, sha256_hash const* after
+	, items_callback icallback
+	, nodes_callback ncallback)
+	: find_data(dht_node, prefix, std::move(ncallback))
+	, m_immutable(false)
+	, m_prefix_len(prefix_len)
+	, m_has_after(after != nullptr)
+	, m_items_callback(std::move(icallback))
+{
+	TORRENT_ASSERT(prefix_len > 0 && prefix_len <= 32);
+	if (after != nullptr) m_after = *after;
+}
+
+void get_item::got_items(bdecode_node const& items, bool const more)
+{
+	if (!m_items_callback || m_prefix_len == 0) return;
+
+	if (more) m_more = true;
+
+	for (int i = 0; i < items.list_size(); ++i)
+	{
+		bdecode_node const e = items.list_at(i);
+		if (e.type() != bdecode_node::dict_t) continue;
+
+		bdecode_node const k = e.dict_find_string("k");
+		bdecode_node const s = e.dict_find_string("sig");
+		bdecode_node const q = e.dict_find_int("ts");
+		bdecode_node const v = e.dict_find("v");
+		if (!k || k.string_length() != public_key::len
+			|| !s || s.string_length() != signature::len
+			|| !q || !v)
+			continue;
+
+		public_key const pk(k.string_ptr());
+		signature const sig(s.string_ptr());
+		timestamp const ts(q.int_value());
+		std::string const salt(e.dict_find_string_value("salt"));
+
+		// a node may send items that don't match, or ones we already have
+		sha256_hash const t = item_target_id(salt, pk);
+		if (std::memcmp(t.data(), target().data(), std::size_t(m_prefix_len)) != 0)
+			continue;
+		if (m_has_after && !(m_after < t)) continue;
+
+		auto const seen = m_prefix_items.find(t);
+		if (seen != m_prefix_items.end() && ts <= seen->second) continue;
+
+		item data(pk, salt);
+		if (!data.assign(v, salt, ts, pk, sig)) continue;
+
+		m_prefix_items[t] = ts;
+		m_items_callback(data, false, false);
+	}
+}
+
 void get_item::start()
 {
 	// if the user didn't add seed-nodes manually, grab k (bucket size)
 	// nodes from routing table.
 	if (m_results.empty() && !m_direct_invoking)
 	{
-		if (!m_immutable)
+		if (!m_immutable && m_prefix_len == 0)
 		{
 			// fill aux endpoints
 			std::vector<node_entry> aux_nodes;
@@ -193,11 +256,31 @@ bool get_item::invoke(observer_ptr o)
 	entry& a = e["a"];
 
 	e["q"] = "get";
+
+	if (m_prefix_len > 0)
+	{
+		// the prefix is sent as it is, trailing zeros are part of it
+		a["target"] = target().to_string().substr(0, std::size_t(m_prefix_len));
+		a["mutable"] = 1;
+		a["prefix"] = 1;
+		a["distance"] = traversal_algorithm::allow_distance();
+		if (m_has_after) a["after"] = m_after.to_string();
+
+		m_node.stats_counters().inc_stats_counter(counters::dht_get_out);
+		return m_node.m_rpc.invoke(e, o->target_ep(), o);
+	}
+
 	std::string raw = target().to_string();
 	std::string trim = trim_tailing_zeros(raw);
 	a["target"] = trim_tailing_zeros(target().to_string());
 	a["mutable"] = m_immutable ? 0 : 1;
 
+	if (m_segment)
+	{
+		a["seg"] = 1;
+		a["distance"] = traversal_algorithm::allow_distance();
+	}
+
 	if (!m_immutable)
 	{
 		a["distance"] = traversal_algorithm::allow_distance();
@@ -214,6 +297,12 @@ bool get_item::invoke(observer_ptr o)
 
 void get_item::done()
 {
+	if (m_prefix_len > 0)
+	{
+		if (m_items_callback) m_items_callback(item(), true, m_more);
+		return find_data::done();
+	}
+
 	// no data_callback for immutable item put
 	if (!m_data_callback) return find_data::done();
 
@@ -282,6 +371,13 @@ void get_item_observer::reply(msg const& m, node_id const& from)
 		static_cast<get_item*>(algorithm())->got_data(v, pk, ts, sig);
 	}
 
+	bdecode_node const items = r.dict_find_list("items");
+	if (items)
+	{
+		static_cast<get_item*>(algorithm())->got_items(items
+			, r.dict_find_int_value("more") != 0);
+	}
+
 	find_data_observer::reply(m, from);
 }
 
@@ -107,6 +107,19 @@ sha256_hash item_target_id(public_key const& pk)
 	return target;
 }
 
+sha256_hash segment_target_id(sha1_hash const& h)
+{
+	sha256_hash target;
+	std::memcpy(&target[0], h.data(), h.size());
+
+	return target;
+}
+
+sha256_hash segment_target_id(span<char const> v)
+{
+	return segment_target_id(hasher(v).final());
+}
+
 bool verify_mutable_item(
 	span<char const> v
 	, span<char const> salt
@@ -0,0 +1,410 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "ip2/kademlia/item_log.hpp"
+#include "ip2/aux_/io_bytes.hpp"
+#include "ip2/error_code.hpp"
+
+#include "ip2/aux_/disable_warnings_push.hpp"
+#include <boost/crc.hpp>
+#include "ip2/aux_/disable_warnings_pop.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+
+#if TORRENT_HAVE_MMAP && !defined TORRENT_WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ip2::dht {
+
+	namespace {
+
+		char const log_magic[8] = {'i', 'p', '2', 'i', 'l', 'o', 'g', '1'};
+
+		constexpr int record_header_size = 8;
+		constexpr int mutable_fields_size = 8 + 32 + 64 + 2;
+
+		// nothing a storage node keeps comes close to this, a larger length
+		// means the file is corrupt
+		constexpr std::uint32_t max_body_size = 1024 * 1024;
+
+		std::uint32_t checksum(char const* p, std::size_t const len)
+		{
+			boost::crc_32_type crc;
+			crc.process_bytes(p, len);
+			return crc.checksum();
+		}
+
+		template <typename OutIt>
+		void write_bytes(char const* p, std::size_t const len, OutIt& out)
+		{
+			out = std::copy(p, p + len, out);
+		}
+	}
+
+	item_log::~item_log()
+	{
+		close();
+	}
+
+	void item_log::open(std::string const& path, error_code& ec)
+	{
+		close();
+		m_path = path;
+
+		m_file = std::fopen(path.c_str(), "ab+");
+		if (m_file == nullptr)
+		{
+			ec.assign(errno, generic_category());
+			return;
+		}
+
+		map_file(ec);
+		if (ec)
+		{
+			close();
+			return;
+		}
+
+		if (m_size == 0)
+		{
+			std::fwrite(log_magic, 1, sizeof(log_magic), m_file);
+			std::fflush(m_file);
+			return;
+		}
+
+		if (m_size < std::int64_t(sizeof(log_magic))
+			|| std::memcmp(m_data, log_magic, sizeof(log_magic)) != 0)
+		{
+			ec = error_code(boost::system::errc::illegal_byte_sequence, generic_category());
+			close();
+			return;
+		}
+
+		// index the latest record of every target. Only the header and the
+		// kind and target are looked at. The checksum of an item is checked
+		// when it's read, a bad record is stepped over by its length. A
+		// length that's off leaves nothing to go by, the rest is cut off
+		std::int64_t offset = sizeof(log_magic);
+		while (offset + record_header_size <= m_size)
+		{
+			char const* ptr = m_data + offset;
+			std::uint32_t const len = aux::read_uint32(ptr);
+			std::uint32_t const crc = aux::read_uint32(ptr);
+			if (len < 33 || len > max_body_size
+				|| offset + record_header_size + len > m_size)
+				break;
+
+			auto const type = kind(std::uint8_t(ptr[0]));
+			sha256_hash const target(ptr + 1);
+			if (type == kind::removed)
+			{
+				// a removal has nothing to check later, and a bad one would
+				// drop a good item
+				if (checksum(ptr, len) == crc)
+					m_index.erase(target);
+			}
+			else if (type == kind::immutable_item || type == kind::mutable_item)
+			{
+				m_index[target] = offset;
+			}
+
+			offset += record_header_size + len;
+		}
+
+		m_stale = offset - std::int64_t(sizeof(log_magic));
+		for (auto const& i : m_index)
+		{
+			char const* ptr = m_data + i.second;
+			m_stale -= record_header_size + aux::read_uint32(ptr);
+		}
+
+		if (offset < m_size)
+		{
+			// a torn or corrupt record, cut it off before appending to the log
+			std::fclose(m_file);
+			m_file = nullptr;
+			unmap_file();
+			std::error_code err;
+			std::filesystem::resize_file(path, std::uintmax_t(offset), err);
+			if (err) ec.assign(err.value(), generic_category());
+			if (!ec) m_file = std::fopen(path.c_str(), "ab+");
+			if (m_file == nullptr)
+			{
+				if (!ec) ec.assign(errno, generic_category());
+				m_index.clear();
+				return;
+			}
+			map_file(ec);
+		}
+	}
+
+	void item_log::close()
+	{
+		abort_compact();
+		if (m_file != nullptr)
+		{
+			std::fclose(m_file);
+			m_file = nullptr;
+		}
+		unmap_file();
+		m_index.clear();
+		m_stale = 0;
+	}
+
+	void item_log::map_file(error_code& ec)
+	{
+		std::fflush(m_file);
+		std::error_code err;
+		std::uintmax_t const size = std::filesystem::file_size(m_path, err);
+		if (err)
+		{
+			ec.assign(err.value(), generic_category());
+			return;
+		}
+		m_size = std::int64_t(size);
+		if (m_size == 0) return;
+
+#if TORRENT_HAVE_MMAP && !defined TORRENT_WINDOWS
+		void* const p = ::mmap(nullptr, std::size_t(m_size), PROT_READ, MAP_SHARED
+			, ::fileno(m_file), 0);
+		if (p == MAP_FAILED)
+		{
+			ec.assign(errno, generic_category());
+			m_size = 0;
+			return;
+		}
+		m_data = static_cast<char const*>(p);
+#else
+		m_buffer.resize(std::size_t(m_size));
+		std::FILE* f = std::fopen(m_path.c_str(), "rb");
+		if (f == nullptr
+			|| std::fread(m_buffer.data(), 1, m_buffer.size(), f) != m_buffer.size())
+		{
+			ec.assign(errno, generic_category());
+			if (f != nullptr) std::fclose(f);
+			m_buffer.clear();
+			m_size = 0;
+			return;
+		}
+		std::fclose(f);
+		m_data = m_buffer.data();
+#endif
+	}
+
+	void item_log::unmap_file()
+	{
+#if TORRENT_HAVE_MMAP && !defined TORRENT_WINDOWS
+		if (m_data != nullptr)
+			::munmap(const_cast<char*>(m_data), std::size_t(m_size));
+#else
+		m_buffer.clear();
+		m_buffer.shrink_to_fit();
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	bool item_log::parse(std::int64_t const offset, record& r) const
+	{
+		char const* ptr = m_data + offset;
+		std::uint32_t const len = aux::read_uint32(ptr);
+		std::uint32_t const crc = aux::read_uint32(ptr);
+		if (checksum(ptr, len) != crc) return false;
+		char const* const end = ptr + len;
+
+		r.type = kind(std::uint8_t(*ptr++));
+		r.target.assign(ptr);
+		ptr += 32;
+		r.salt = {};
+
+		if (r.type == kind::mutable_item)
+		{
+			if (end - ptr < mutable_fields_size) return false;
+			r.ts = timestamp(aux::read_int64(ptr));
+			r.pk = public_key(ptr);
+			ptr += 32;
+			r.sig = signature(ptr);
+			ptr += 64;
+			int const salt_len = aux::read_uint16(ptr);
+			if (end - ptr < salt_len) return false;
+			r.salt = {ptr, salt_len};
+			ptr += salt_len;
+		}
+
+		r.value = {ptr, end - ptr};
+		return true;
+	}
+
+	bool item_log::find(sha256_hash const& target, record& r) const
+	{
+		auto const i = m_index.find(target);
+		if (i == m_index.end()) return false;
+		return parse(i->second, r);
+	}
+
+	void item_log::targets_with_prefix(sha256_hash const& prefix, int const prefix_len
+		, std::vector<sha256_hash>& out) const
+	{
+		for (auto i = m_index.lower_bound(prefix); i != m_index.end()
+			&& std::memcmp(i->first.data(), prefix.data(), std::size_t(prefix_len)) == 0; ++i)
+		{
+			out.push_back(i->first);
+		}
+	}
+
+	void item_log::forget(sha256_hash const& target)
+	{
+		m_index.erase(target);
+	}
+
+	void item_log::append(std::vector<char> const& body)
+	{
+		if (m_file == nullptr) return;
+
+		char header[record_header_size];
+		char* ptr = header;
+		aux::write_uint32(body.size(), ptr);
+		aux::write_uint32(checksum(body.data(), body.size()), ptr);
+
+		std::fwrite(header, 1, sizeof(header), m_file);
+		std::fwrite(body.data(), 1, body.size(), m_file);
+		std::fflush(m_file);
+		m_stale += std::int64_t(sizeof(header) + body.size());
+	}
+
+	void item_log::append_immutable(sha256_hash const& target, span<char const> value)
+	{
+		std::vector<char> body;
+		body.reserve(std::size_t(33 + value.size()));
+		auto out = std::back_inserter(body);
+		aux::write_uint8(std::uint8_t(kind::immutable_item), out);
+		write_bytes(target.data(), target.size(), out);
+		write_bytes(value.data(), std::size_t(value.size()), out);
+		append(body);
+	}
+
+	void item_log::append_mutable(sha256_hash const& target, span<char const> value
+		, signature const& sig, timestamp const ts, public_key const& pk
+		, span<char const> salt)
+	{
+		std::vector<char> body;
+		body.reserve(std::size_t(33 + mutable_fields_size + salt.size() + value.size()));
+		auto out = std::back_inserter(body);
+		aux::write_uint8(std::uint8_t(kind::mutable_item), out);
+		write_bytes(target.data(), target.size(), out);
+		aux::write_int64(ts.value, out);
+		write_bytes(pk.bytes.data(), pk.bytes.size(), out);
+		write_bytes(sig.bytes.data(), sig.bytes.size(), out);
+		aux::write_uint16(salt.size(), out);
+		write_bytes(salt.data(), std::size_t(salt.size()), out);
+		write_bytes(value.data(), std::size_t(value.size()), out);
+		append(body);
+	}
+
+	void item_log::append_removed(sha256_hash const& target)
+	{
+		std::vector<char> body;
+		auto out = std::back_inserter(body);
+		aux::write_uint8(std::uint8_t(kind::removed), out);
+		write_bytes(target.data(), target.size(), out);
+		append(body);
+
+		// the new log may have copied the item already
+		if (m_compact) m_compact->append(body);
+	}
+
+	void item_log::start_compact(error_code& ec)
+	{
+		abort_compact();
+
+		std::string const tmp_path = m_path + ".tmp";
+		std::error_code ignore;
+		std::filesystem::remove(tmp_path, ignore);
+
+		auto out = std::make_unique<item_log>();
+		out->open(tmp_path, ec);
+		if (ec) return;
+
+		m_compact = std::move(out);
+		m_compact_next = sha256_hash();
+	}
+
+	bool item_log::compact_step(std::function<bool(record const&)> const& keep_indexed
+		, std::function<void(item_log&)> const& write_live
+		, std::int64_t const max_bytes, error_code& ec)
+	{
+		if (!m_compact) return false;
+
+		// the index only loses targets while we're at it. Those removed
+		// are removed from the new log too, by append_removed()
+		std::int64_t read = 0;
+		record r;
+		auto i = m_index.lower_bound(m_compact_next);
+		for (; i != m_index.end() && read < max_bytes; ++i)
+		{
+			char const* ptr = m_data + i->second;
+			read += record_header_size + aux::read_uint32(ptr);
+
+			if (!parse(i->second, r) || !keep_indexed(r)) continue;
+			if (r.type == kind::immutable_item)
+				m_compact->append_immutable(r.target, r.value);
+			else
+				m_compact->append_mutable(r.target, r.value, r.sig, r.ts, r.pk, r.salt);
+		}
+
+		if (i != m_index.end())
+		{
+			m_compact_next = i->first;
+			return false;
+		}
+
+		write_live(*m_compact);
+		m_compact.reset();
+
+		std::string const path = m_path;
+		std::string const tmp_path = path + ".tmp";
+		close();
+		std::error_code err;
+		std::filesystem::rename(tmp_path, path, err);
+		if (err)
+		{
+			ec.assign(err.value(), generic_category());
+			// keep using the log as it was
+			error_code ignore;
+			open(path, ignore);
+			std::filesystem::remove(tmp_path, err);
+			return true;
+		}
+		open(path, ec);
+		return true;
+	}
+
+	void item_log::abort_compact()
+	{
+		if (!m_compact) return;
+		m_compact.reset();
+		std::error_code ignore;
+		std::filesystem::remove(m_path + ".tmp", ignore);
+	}
+
+	void item_log::compact(std::function<bool(record const&)> const& keep_indexed
+		, std::function<void(item_log&)> const& write_live, error_code& ec)
+	{
+		start_compact(ec);
+		if (ec) return;
+		compact_step(keep_indexed, write_live, std::numeric_limits<std::int64_t>::max(), ec);
+	}
+}
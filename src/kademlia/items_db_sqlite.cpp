@@ -17,6 +17,9 @@ see LICENSE file.
 #include <ip2/bdecode.hpp>
 #include "ip2/hex.hpp" // to_hex
 
+#include <ctime>
+#include <cstring>
+
 namespace ip2 { namespace dht {
 
 items_db_sqlite::items_db_sqlite(settings_interface const& settings
@@ -54,6 +57,34 @@ void items_db_sqlite::init()
 			return;
 		}
 
+		ok = sqlite3_exec(db, create_origin_items_table.c_str(), nullptr, nullptr, &zErrMsg);
+		if (ok != SQLITE_OK)
+		{
+			sqlite3_free(zErrMsg);
+#ifndef TORRENT_DISABLE_LOGGING
+			if (m_observer->should_log(dht_logger::items_db, aux::LOG_ERR))
+			{
+				m_observer->log(dht_logger::items_db, "create table error: %d, %s"
+					, ok, create_origin_items_table.c_str());
+			}
+#endif
+			return;
+		}
+
+		ok = sqlite3_exec(db, create_immutable_items_table.c_str(), nullptr, nullptr, &zErrMsg);
+		if (ok != SQLITE_OK)
+		{
+			sqlite3_free(zErrMsg);
+#ifndef TORRENT_DISABLE_LOGGING
+			if (m_observer->should_log(dht_logger::items_db, aux::LOG_ERR))
+			{
+				m_observer->log(dht_logger::items_db, "create table error: %d, %s"
+					, ok, create_immutable_items_table.c_str());
+			}
+#endif
+			return;
+		}
+
 		// create index
 		ok = sqlite3_exec(db, create_ts_index.c_str(), nullptr, nullptr, &zErrMsg);
 		if (ok != SQLITE_OK)
@@ -70,6 +101,21 @@ void items_db_sqlite::init()
 			return;
 		}
 
+		ok = sqlite3_exec(db, create_origin_ts_index.c_str(), nullptr, nullptr, &zErrMsg);
+		if (ok != SQLITE_OK)
+		{
+			sqlite3_free(zErrMsg);
+#ifndef TORRENT_DISABLE_LOGGING
+			if (m_observer->should_log(dht_logger::items_db, aux::LOG_ERR))
+			{
+				m_observer->log(dht_logger::items_db, "create index error: %d, %s"
+					, ok, create_origin_ts_index.c_str());
+			}
+#endif
+
+			return;
+		}
+
 #ifndef TORRENT_DISABLE_LOGGING
 		if (m_observer->should_log(dht_logger::items_db, aux::LOG_INFO))
 		{
@@ -116,6 +162,16 @@ void items_db_sqlite::prepare_statements()
 			return;
 		}
 
+		ok = sqlite3_prepare_v2(db, select_items_from_target.c_str(), -1
+			, &m_select_items_from_target_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(select_items_from_target);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
 		ok = sqlite3_prepare_v2(db, insert_or_replace_items.c_str(), -1
 			, &m_insert_or_replace_items_stmt, nullptr);
 		if (ok != SQLITE_OK)
@@ -155,6 +211,66 @@ void items_db_sqlite::prepare_statements()
 
 			return;
 		}
+
+		ok = sqlite3_prepare_v2(db, select_origin_item_by_target.c_str(), -1
+			, &m_select_origin_item_by_target_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(select_origin_item_by_target);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
+		ok = sqlite3_prepare_v2(db, insert_or_replace_origin_items.c_str(), -1
+			, &m_insert_or_replace_origin_items_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(insert_or_replace_origin_items);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
+		ok = sqlite3_prepare_v2(db, delete_origin_items.c_str(), -1
+			, &m_delete_origin_items_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(delete_origin_items);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
+		ok = sqlite3_prepare_v2(db, select_immutable_item_by_target.c_str(), -1
+			, &m_select_immutable_item_by_target_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(select_immutable_item_by_target);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
+		ok = sqlite3_prepare_v2(db, insert_or_replace_immutable_items.c_str(), -1
+			, &m_insert_or_replace_immutable_items_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(insert_or_replace_immutable_items);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
+
+		ok = sqlite3_prepare_v2(db, delete_immutable_items.c_str(), -1
+			, &m_delete_immutable_items_stmt, nullptr);
+		if (ok != SQLITE_OK)
+		{
+			error.append(delete_immutable_items);
+			sql_error(ok, error.c_str());
+
+			return;
+		}
 	}
 	else
 	{
@@ -167,6 +283,91 @@ void items_db_sqlite::prepare_statements()
 	}
 }
 
+bool items_db_sqlite::get_immutable_item(sha256_hash const& target
+	, entry& item) const
+{
+	sqlite3* db = m_observer->get_items_database();
+
+	if (db == NULL || m_select_immutable_item_by_target_stmt == NULL) return false;
+
+	sqlite3_reset(m_select_immutable_item_by_target_stmt);
+
+	sqlite3_bind_text(m_select_immutable_item_by_target_stmt, 1
+		, target.data(), 32, nullptr);
+
+	time_point const start = aux::time_now();
+	int ok = sqlite3_step(m_select_immutable_item_by_target_stmt);
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+	if (ok != SQLITE_ROW) return false;
+
+	sql_time_cost(cost, "select immutable item by target");
+
+	const char* item_ptr = static_cast<const char*>(static_cast<const void*>(
+		sqlite3_column_text(m_select_immutable_item_by_target_stmt, 0)));
+	auto const length = sqlite3_column_bytes(m_select_immutable_item_by_target_stmt, 0);
+
+	error_code ec;
+	entry v = bdecode({item_ptr, length}, ec);
+
+	// move to the end
+	sqlite3_step(m_select_immutable_item_by_target_stmt);
+
+	if (ec.value() != 0)
+	{
+		sql_error(ec.value(), "get immutable item bdecoding error");
+		return false;
+	}
+
+	item["v"] = std::move(v);
+	return true;
+}
+
+void items_db_sqlite::put_immutable_item(sha256_hash const& target
+	, span<char const> buf
+	, address const& addr)
+{
+	sqlite3* db = m_observer->get_items_database();
+
+	if (db == NULL || m_insert_or_replace_immutable_items_stmt == NULL)
+	{
+#ifndef TORRENT_DISABLE_LOGGING
+		if (m_observer->should_log(dht_logger::items_db, aux::LOG_ERR))
+		{
+			m_observer->log(dht_logger::items_db, "put immutable item: sqlite databse is invalid");
+		}
+#endif
+		return;
+	}
+
+	// the value was verified against the target by the caller, it's
+	// stored as it came in
+	sqlite3_reset(m_insert_or_replace_immutable_items_stmt);
+
+	sqlite3_bind_text(m_insert_or_replace_immutable_items_stmt, 1
+		, target.data(), 32, nullptr);
+	sqlite3_bind_int(m_insert_or_replace_immutable_items_stmt, 2
+		, aux::numeric_cast<int>(std::time(nullptr)));
+	sqlite3_bind_text(m_insert_or_replace_immutable_items_stmt, 3
+		, buf.data(), int(buf.size()), SQLITE_STATIC);
+
+	time_point const start = aux::time_now();
+	int ok = sqlite3_step(m_insert_or_replace_immutable_items_stmt);
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+	if (ok == SQLITE_DONE)
+	{
+		sql_time_cost(cost, "put immutable item");
+	}
+	else
+	{
+		std::string err_msg("insert or update immutable item error:");
+		err_msg.append(aux::to_hex(target));
+		sql_error(ok, err_msg.c_str());
+	}
+
+	// the bound buffer belongs to the caller
+	sqlite3_reset(m_insert_or_replace_immutable_items_stmt);
+}
+
 bool items_db_sqlite::get_mutable_item_timestamp(sha256_hash const& target
 	, timestamp& ts) const
 {
@@ -311,6 +512,67 @@ bool items_db_sqlite::get_mutable_item_target(sha256_hash const& prefix
 	return false;
 }
 
+bool items_db_sqlite::get_mutable_items(sha256_hash const& prefix
+	, int const prefix_len
+	, sha256_hash const* after
+	, int const max_bytes
+	, entry::list_type& items) const
+{
+	sqlite3* db = m_observer->get_items_database();
+
+	if (db == NULL || m_select_items_from_target_stmt == NULL) return false;
+
+	sqlite3_reset(m_select_items_from_target_stmt);
+
+	sha256_hash const& start = (after != nullptr && prefix < *after) ? *after : prefix;
+	sqlite3_bind_text(m_select_items_from_target_stmt, 1
+		, start.data(), 32, nullptr);
+
+	time_point const start_time = aux::time_now();
+	bool more = false;
+	int bytes = 0;
+	while (sqlite3_step(m_select_items_from_target_stmt) == SQLITE_ROW)
+	{
+		auto const target_length = sqlite3_column_bytes(m_select_items_from_target_stmt, 0);
+		const char* target_ptr = static_cast<const char*>(static_cast<const void*>(
+			sqlite3_column_text(m_select_items_from_target_stmt, 0)));
+		if (target_length != 32) continue;
+
+		sha256_hash const target(target_ptr);
+		if (std::memcmp(target.data(), prefix.data(), std::size_t(prefix_len)) != 0)
+			break;
+		if (after != nullptr && !(*after < target)) continue;
+
+		const char* item_ptr = static_cast<const char*>(static_cast<const void*>(
+			sqlite3_column_text(m_select_items_from_target_stmt, 1)));
+		auto const length = sqlite3_column_bytes(m_select_items_from_target_stmt, 1);
+
+		if (!items.empty() && bytes + length > max_bytes)
+		{
+			more = true;
+			break;
+		}
+
+		error_code ec;
+		entry e = bdecode({item_ptr, length}, ec);
+		if (ec.value() != 0)
+		{
+			sql_error(ec.value(), "get items bdecoding error");
+			continue;
+		}
+
+		bytes += length;
+		items.push_back(std::move(e));
+	}
+
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start_time));
+	sql_time_cost(cost, "select items from target");
+
+	sqlite3_reset(m_select_items_from_target_stmt);
+
+	return more;
+}
+
 void items_db_sqlite::put_mutable_item(sha256_hash const& target
 	, span<char const> buf
 	, signature const& sig
@@ -385,6 +647,177 @@ void items_db_sqlite::remove_mutable_item(sha256_hash const& target)
 {
 }
 
+void items_db_sqlite::put_origin_item(sha256_hash const& target
+	, span<char const> buf
+	, signature const& sig
+	, timestamp ts
+	, public_key const& pk
+	, span<char const> salt)
+{
+	error_code ec;
+	entry value = bdecode(buf, ec);
+	if (ec.value() != 0)
+	{
+		std::string err_msg("put origin item bdecoding error:");
+		err_msg.append(buf.data(), buf.size());
+		sql_error(ec.value(), err_msg.c_str());
+
+		return;
+	}
+
+	entry e;
+	e["k"] = pk.bytes;
+	e["salt"] = salt;
+	e["ts"] = ts.value;
+	e["v"] = value;
+	e["sig"] = sig.bytes;
+	put_origin_entry(target, e);
+}
+
+void items_db_sqlite::put_origin_item(sha256_hash const& target
+	, span<char const> buf)
+{
+	error_code ec;
+	entry value = bdecode(buf, ec);
+	if (ec.value() != 0)
+	{
+		std::string err_msg("put origin segment bdecoding error:");
+		err_msg.append(buf.data(), buf.size());
+		sql_error(ec.value(), err_msg.c_str());
+
+		return;
+	}
+
+	entry e;
+	e["v"] = value;
+	put_origin_entry(target, e);
+}
+
+void items_db_sqlite::put_origin_entry(sha256_hash const& target, entry const& e)
+{
+	sqlite3* db = m_observer->get_items_database();
+
+	if (db != NULL && m_insert_or_replace_origin_items_stmt != NULL)
+	{
+		std::string item;
+		bencode(std::back_inserter(item), e);
+
+		sqlite3_reset(m_insert_or_replace_origin_items_stmt);
+
+		sqlite3_bind_text(m_insert_or_replace_origin_items_stmt, 1
+			, target.data(), 32, nullptr);
+		sqlite3_bind_int(m_insert_or_replace_origin_items_stmt, 2
+			, aux::numeric_cast<int>(std::time(nullptr)));
+		sqlite3_bind_text(m_insert_or_replace_origin_items_stmt, 3
+			, item.data(), int(item.size()), SQLITE_STATIC);
+
+		time_point const start = aux::time_now();
+		int ok = sqlite3_step(m_insert_or_replace_origin_items_stmt);
+		int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+		if (ok == SQLITE_DONE)
+		{
+			sql_time_cost(cost, "put origin item");
+		}
+		else
+		{
+			std::string err_msg("insert or update origin item error:");
+			err_msg.append(e.to_string(true));
+			sql_error(ok, err_msg.c_str());
+		}
+
+		// the bound item is about to go out of scope
+		sqlite3_reset(m_insert_or_replace_origin_items_stmt);
+	}
+	else
+	{
+#ifndef TORRENT_DISABLE_LOGGING
+		if (m_observer->should_log(dht_logger::items_db, aux::LOG_ERR))
+		{
+			m_observer->log(dht_logger::items_db, "put origin item: sqlite databse is invalid");
+		}
+#endif
+	}
+}
+
+bool items_db_sqlite::get_origin_item(sha256_hash const& target
+	, entry& item) const
+{
+	sqlite3* db = m_observer->get_items_database();
+
+	if (db == NULL || m_select_origin_item_by_target_stmt == NULL) return false;
+
+	sqlite3_reset(m_select_origin_item_by_target_stmt);
+
+	sqlite3_bind_text(m_select_origin_item_by_target_stmt, 1
+		, target.data(), 32, nullptr);
+
+	time_point const start = aux::time_now();
+	int ok = sqlite3_step(m_select_origin_item_by_target_stmt);
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+	if (ok != SQLITE_ROW) return false;
+
+	sql_time_cost(cost, "select origin item by target");
+
+	const char* item_ptr = static_cast<const char*>(static_cast<const void*>(
+		sqlite3_column_text(m_select_origin_item_by_target_stmt, 2)));
+	auto const length = sqlite3_column_bytes(m_select_origin_item_by_target_stmt, 2);
+
+	error_code ec;
+	entry e = bdecode({item_ptr, length}, ec);
+
+	// move to the end
+	sqlite3_step(m_select_origin_item_by_target_stmt);
+
+	if (ec.value() != 0)
+	{
+		sql_error(ec.value(), "get origin item bdecoding error");
+		return false;
+	}
+
+	item = std::move(e);
+	return true;
+}
+
+void items_db_sqlite::trim_origin_items()
+{
+	if (m_delete_origin_items_stmt == NULL) return;
+
+	sqlite3_reset(m_delete_origin_items_stmt);
+	sqlite3_bind_int(m_delete_origin_items_stmt, 1, origin_items_max_count);
+
+	time_point const start = aux::time_now();
+	int ok = sqlite3_step(m_delete_origin_items_stmt);
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+	if (ok == SQLITE_DONE)
+	{
+		sql_time_cost(cost, "delete origin items:");
+	}
+	else
+	{
+		sql_error(ok, delete_origin_items.c_str());
+	}
+}
+
+void items_db_sqlite::trim_immutable_items()
+{
+	if (m_delete_immutable_items_stmt == NULL) return;
+
+	sqlite3_reset(m_delete_immutable_items_stmt);
+	sqlite3_bind_int(m_delete_immutable_items_stmt, 1, immutable_items_max_count);
+
+	time_point const start = aux::time_now();
+	int ok = sqlite3_step(m_delete_immutable_items_stmt);
+	int const cost = aux::numeric_cast<int>(total_microseconds(aux::time_now() - start));
+	if (ok == SQLITE_DONE)
+	{
+		sql_time_cost(cost, "delete immutable items:");
+	}
+	else
+	{
+		sql_error(ok, delete_immutable_items.c_str());
+	}
+}
+
 void items_db_sqlite::tick()
 {
 	time_point const now = aux::time_now();
@@ -392,6 +825,9 @@ void items_db_sqlite::tick()
 	if (m_last_refresh + seconds(refresh_period) > now) return;
 	m_last_refresh = now;
 
+	trim_origin_items();
+	trim_immutable_items();
+
 	int max = m_settings.get_int(settings_pack::dht_items_db_max_count);
 	int count = 0;
 
@@ -499,10 +935,17 @@ void items_db_sqlite::close()
 {
 	if (m_select_ts_by_target_stmt != NULL) sqlite3_finalize(m_select_ts_by_target_stmt);
 	if (m_select_item_by_target_stmt != NULL) sqlite3_finalize(m_select_item_by_target_stmt);
+	if (m_select_items_from_target_stmt != NULL) sqlite3_finalize(m_select_items_from_target_stmt);
 	if (m_insert_or_replace_items_stmt != NULL) sqlite3_finalize(m_insert_or_replace_items_stmt);
 	if (m_items_count_stmt != NULL) sqlite3_finalize(m_items_count_stmt);
 	if (m_delete_items_stmt != NULL) sqlite3_finalize(m_delete_items_stmt);
 	if (m_select_ts_threshold_stmt != NULL) sqlite3_finalize(m_select_ts_threshold_stmt);
+	if (m_select_origin_item_by_target_stmt != NULL) sqlite3_finalize(m_select_origin_item_by_target_stmt);
+	if (m_insert_or_replace_origin_items_stmt != NULL) sqlite3_finalize(m_insert_or_replace_origin_items_stmt);
+	if (m_delete_origin_items_stmt != NULL) sqlite3_finalize(m_delete_origin_items_stmt);
+	if (m_select_immutable_item_by_target_stmt != NULL) sqlite3_finalize(m_select_immutable_item_by_target_stmt);
+	if (m_insert_or_replace_immutable_items_stmt != NULL) sqlite3_finalize(m_insert_or_replace_immutable_items_stmt);
+	if (m_delete_immutable_items_stmt != NULL) sqlite3_finalize(m_delete_immutable_items_stmt);
 }
 
 void items_db_sqlite::sql_error(int err_code, const char* err_str) const
@@ -53,6 +53,7 @@ see LICENSE file.
 #include "ip2/kademlia/keep.hpp"
 #include "ip2/kademlia/msg.hpp"
 #include <ip2/kademlia/put_data.hpp>
+#include <ip2/kademlia/put_lookup.hpp>
 #include <ip2/kademlia/relay.hpp>
 #include <ip2/kademlia/version.hpp>
 
@@ -66,6 +67,19 @@ namespace {
 // the write tokens we generate are 4 bytes
 constexpr int write_token_size = 4;
 
+// min interval between two republishes of the same origin item
+constexpr seconds origin_republish_interval(300);
+
+// the largest DHT message that fits in one datagram. The receiver reads into
+// a 1500 byte buffer, and the session puts our public key, a compression
+// flag byte and up to one AES block of padding around the message
+constexpr int udp_message_budget = 1500 - 32 - 1 - 16;
+
+// what a prefix get response adds around its nodes and items: the
+// transaction id, our node id, the requester's address, the version and
+// the "more" flag
+constexpr int prefix_get_envelope = 128;
+
 void nop() {}
 
 // generate an error response message
@@ -291,10 +305,11 @@ void node::bootstrap(std::vector<node_entry> const& nodes
 
 	std::vector<node_entry> bs_nodes(nodes.begin(), nodes.end());
 
-	if (nodes.size() == 0)
-	{
-		prepare_bootstrap_nodes(bs_nodes, target, true);
-	}
+	// the nodes passed in may be a routing table saved before a network
+	// change, all of them gone by now. The routers and the learned bootstrap
+	// nodes are always added too, the traversal only falls back to the
+	// routers when it's short of nodes, not when they don't answer
+	prepare_bootstrap_nodes(bs_nodes, target, true);
 
 	for (auto const& n : bs_nodes)
 	{
@@ -351,7 +366,7 @@ void node::incoming_decryption_error(aux::listen_socket_handle const& s
 
 	entry& a = e["a"];
 
-	m_sock_man->send_packet(m_sock, e, ep, pk);
+	m_sock_man->send_packet(m_sock, e, ep, pk, egress_class::response);
 }
 
 void node::handle_decryption_error(msg const& m)
@@ -477,7 +492,7 @@ void node::incoming(aux::listen_socket_handle const& s, msg const& m, node_id co
 					= incoming_request(m, e, from, &to, &to_ep, push_candidate);
 			if (need_response)
 			{
-				m_sock_man->send_packet(m_sock, e, m.addr, from);
+				m_sock_man->send_packet(m_sock, e, m.addr, from, egress_class::response);
 			}
 			if (need_push)
 			{
@@ -573,9 +588,11 @@ void node::incoming(aux::listen_socket_handle const& s, msg const& m, node_id co
 
 			bool need_relay = incoming_relay(m, resp, payload, &to,
 					&to_ep, sender, from, decrypted_payload);
-			if (to != m_id)
+			// relays addressed to us are acknowledged when they come straight
+			// from the sender, which waits for that before traversing
+			if (to != m_id || sender == from)
 			{
-				m_sock_man->send_packet(m_sock, resp, m.addr, from);
+				m_sock_man->send_packet(m_sock, resp, m.addr, from, egress_class::response);
 			}
 
 			if (need_relay)
@@ -744,6 +761,25 @@ void node::get_item(public_key const& pk, std::string const& salt
 	ta->start();
 }
 
+void node::get_items(sha256_hash const& prefix, int const prefix_len
+	, sha256_hash const* after
+	, std::function<void(item const&, bool, bool)> f)
+{
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		m_observer->log(dht_logger::node, "starting prefix get for [ prefix: %s, len: %d ]"
+			, aux::to_hex(prefix).c_str(), prefix_len);
+	}
+#endif
+
+	auto ta = std::make_shared<dht::get_item>(*this, prefix, prefix_len, after
+		, std::move(f), find_data::nodes_callback());
+	// TODO: removed
+	ta->set_fixed_distance(256);
+	ta->start();
+}
+
 namespace {
 
 void put(std::vector<std::pair<node_entry, std::string>> const& nodes
@@ -949,6 +985,24 @@ void node::put_item(public_key const& pk
 	*/
 }
 
+void node::start_put(std::shared_ptr<put_data> const& ta
+	, std::int8_t invoke_window
+	, std::int8_t invoke_limit)
+{
+	if (!m_settings.get_bool(settings_pack::dht_two_phase_put))
+	{
+		ta->start();
+		return;
+	}
+
+	auto lookup = std::make_shared<dht::put_lookup>(*this, ta);
+	lookup->set_invoke_window(invoke_window);
+	lookup->set_invoke_limit(invoke_limit);
+	// TODO: removed
+	lookup->set_fixed_distance(256);
+	lookup->start();
+}
+
 void node::put_item(public_key const& pk
 	, std::string const& salt
 	, entry const& data
@@ -981,7 +1035,144 @@ void node::put_item(public_key const& pk
 	// TODO: removed
 	put_ta->set_fixed_distance(256);
 
-	put_ta->start();
+	start_put(put_ta, invoke_window, invoke_limit);
+}
+
+void node::get_segment(sha1_hash const& seg_hash
+	, std::int8_t alpha
+	, std::int8_t invoke_window
+	, std::int8_t invoke_limit
+	, std::function<void(item const&, bool)> f)
+{
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		m_observer->log(dht_logger::node, "start getting segment [h:%s, beta:%d, limit:%d]"
+			, aux::to_hex(seg_hash).c_str(), invoke_window, invoke_limit);
+	}
+#endif
+
+	auto ta = std::make_shared<dht::get_item>(*this, segment_target_id(seg_hash)
+		, std::move(f), find_data::nodes_callback());
+	ta->set_segment(true);
+	ta->set_invoke_window(invoke_window);
+	ta->set_invoke_limit(invoke_limit);
+	// TODO: removed
+	ta->set_fixed_distance(256);
+	ta->start();
+}
+
+void node::put_segment(entry const& data
+	, std::int8_t alpha
+	, std::int8_t invoke_window
+	, std::int8_t invoke_limit
+	, std::function<void(item const&, int)> f)
+{
+	TORRENT_ASSERT(data.type() == entry::string_t);
+	sha256_hash const target = segment_target_id(data.string());
+
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		m_observer->log(dht_logger::node
+			, "starting put segment [target:%s, invoke_window:%d, invoke-limit:%d]"
+			, aux::to_hex(target).c_str(), invoke_window, invoke_limit);
+	}
+#endif
+
+	// no signature, the target is the hash of the value
+	item i;
+	i.assign(data);
+
+	auto put_ta = std::make_shared<dht::put_data>(*this, target, f);
+	put_ta->set_data(std::move(i));
+	put_ta->set_segment(true);
+	put_ta->set_invoke_window(invoke_window);
+	put_ta->set_invoke_limit(invoke_limit);
+	// TODO: removed
+	put_ta->set_fixed_distance(256);
+
+	start_put(put_ta, invoke_window, invoke_limit);
+}
+
+std::vector<node_entry> node::origin_endpoints(public_key const& origin)
+{
+	node_id const id = item_target_id(origin);
+	std::vector<node_entry> eps;
+
+	udp::endpoint ep;
+	if (m_peer_endpoints.find(id, ep, aux::time_now()))
+		eps.emplace_back(id, ep);
+
+	node_entry const* ne = m_table.find_node(id);
+	if (ne != nullptr && ne->id == id
+		&& (eps.empty() || ne->ep() != eps.front().ep()))
+	{
+		eps.emplace_back(id, ne->ep());
+	}
+
+	return eps;
+}
+
+void node::get_segment_from_origin(public_key const& origin
+	, sha1_hash const& seg_hash
+	, std::function<void(item const&, bool)> f)
+{
+	std::vector<node_entry> const eps = origin_endpoints(origin);
+	if (eps.empty())
+	{
+		f(item(), true);
+		return;
+	}
+
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		m_observer->log(dht_logger::node, "start getting segment from origin [h:%s, eps:%d]"
+			, aux::to_hex(seg_hash).c_str(), int(eps.size()));
+	}
+#endif
+
+	auto ta = std::make_shared<dht::get_item>(*this, segment_target_id(seg_hash)
+		, std::move(f), find_data::nodes_callback());
+	ta->set_segment(true);
+	ta->set_direct_endpoints(eps);
+	ta->set_invoke_window(std::int8_t(eps.size()));
+	ta->set_invoke_limit(std::int8_t(eps.size()));
+	ta->start();
+}
+
+void node::get_item_from_origin(public_key const& origin
+	, std::string const& salt
+	, std::int64_t timestamp
+	, std::function<void(item const&, bool)> f)
+{
+	std::vector<node_entry> const eps = origin_endpoints(origin);
+	if (eps.empty())
+	{
+		f(item(origin, salt), true);
+		return;
+	}
+
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		char hex_key[65];
+		char hex_salt[129]; // 64*2 + 1
+		aux::to_hex(origin.bytes, hex_key);
+		aux::to_hex(salt, hex_salt);
+		m_observer->log(dht_logger::node, "start getting from origin [k:%s, s:%s, eps:%d]"
+			, hex_key, hex_salt, int(eps.size()));
+	}
+#endif
+
+	auto ta = std::make_shared<dht::get_item>(*this, origin, salt, std::move(f)
+		, find_data::nodes_callback());
+	ta->set_timestamp(timestamp);
+	ta->set_direct_endpoints(eps);
+	ta->set_invoke_window(std::int8_t(eps.size()));
+	ta->set_invoke_limit(std::int8_t(eps.size()));
+	ta->start();
 }
 
 void node::send(public_key const& to
@@ -1097,6 +1288,11 @@ void node::send(public_key const& to
 	auto ta = std::make_shared<dht::relay>(*this, dest, payload
 			, aux_nodes_entry, hmac, cb);
 
+	// we talked to the receiver lately, try its endpoint first
+	udp::endpoint direct_ep;
+	if (m_peer_endpoints.find(dest, direct_ep, aux::time_now()))
+		ta->set_direct_endpoint(direct_ep);
+
 	// encypt payload
 	std::string encypt_err;
 	bool result = encrypt(to, encoding_payload, ta->encrypted_payload(), encypt_err);
@@ -1299,6 +1495,83 @@ void node::send_single_refresh(udp::endpoint const& ep, int const bucket
 	m_rpc.invoke(e, ep, o);
 }
 
+bool node::get_origin_item(sha256_hash const& target, timestamp const ts
+	, entry& reply)
+{
+	entry e;
+	if (!m_storage.get_origin_item(target, e)) return false;
+
+	if (e.find_key("k") == nullptr)
+	{
+		// a segment, it's only asked for without a timestamp
+		if (ts.value != 0) return false;
+		reply["v"] = e["v"];
+	}
+	else
+	{
+		timestamp const origin_ts(e["ts"].integer());
+		reply["ts"] = origin_ts.value;
+		if (ts < origin_ts)
+		{
+			reply["k"] = e["k"];
+			reply["salt"] = e["salt"];
+			reply["v"] = e["v"];
+			reply["sig"] = e["sig"];
+		}
+	}
+
+	m_counters.inc_stats_counter(counters::dht_origin_item_served);
+	republish_origin_item(target, e);
+	return true;
+}
+
+void node::republish_origin_item(sha256_hash const& target, entry const& e)
+{
+	time_point const now = aux::time_now();
+	auto const it = m_origin_republished.find(target);
+	if (it != m_origin_republished.end()
+		&& it->second + origin_republish_interval > now)
+	{
+		return;
+	}
+	m_origin_republished[target] = now;
+
+#ifndef TORRENT_DISABLE_LOGGING
+	if (m_observer != nullptr && m_observer->should_log(dht_logger::node, aux::LOG_INFO))
+	{
+		m_observer->log(dht_logger::node, "republish origin item [ hash: %s ]"
+			, aux::to_hex(target).c_str());
+	}
+#endif
+
+	auto put_ta = std::make_shared<dht::put_data>(*this, target
+		, [](item const&, int) {});
+
+	if (e.find_key("k") == nullptr)
+	{
+		item i;
+		i.assign(e["v"]);
+		put_ta->set_data(std::move(i));
+		put_ta->set_segment(true);
+	}
+	else
+	{
+		std::string const& salt = e["salt"].string();
+		std::string const& k = e["k"].string();
+		std::string const& sig = e["sig"].string();
+		if (k.size() != public_key::len || sig.size() != signature::len) return;
+
+		item i;
+		i.assign(e["v"], salt, timestamp(e["ts"].integer())
+			, public_key(k.data()), signature(sig.data()));
+		put_ta->set_data(std::move(i));
+	}
+	// TODO: removed
+	put_ta->set_fixed_distance(256);
+
+	put_ta->start();
+}
+
 time_duration node::connection_timeout()
 {
 	time_duration d = m_rpc.tick();
@@ -1352,6 +1625,15 @@ time_duration node::connection_timeout()
 
 	m_storage.tick();
 	m_incoming_table.tick();
+	m_peer_endpoints.tick(now);
+
+	for (auto i = m_origin_republished.begin(); i != m_origin_republished.end();)
+	{
+		if (i->second + origin_republish_interval < now)
+			i = m_origin_republished.erase(i);
+		else
+			++i;
+	}
 	m_bs_nodes_learner.tick();
 
 	return d;
@@ -1539,13 +1821,14 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 			{"salt", bdecode_node::string_t, 0, key_desc_t::optional},
 			{"want", bdecode_node::list_t, 0, key_desc_t::optional},
 			{"distance", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"seg", bdecode_node::int_t, 0, key_desc_t::optional},
 		};
 
 		// attempt to parse the message
 		// also reject the message if it has any non-fatal encoding errors
 		// because put messages contain a signed value they must have correct bencoding
 		// otherwise the value will not round-trip without breaking the signature
-		bdecode_node msg_keys[9];
+		bdecode_node msg_keys[10];
 		if (!verify_message(arg_ent, msg_desc, msg_keys, error_string)
 			|| arg_ent.has_soft_error(error_string))
 		{
@@ -1560,6 +1843,18 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 		// is this a mutable put?
 		bool const mutable_put = (msg_keys[2] && msg_keys[3] && msg_keys[4]);
 
+		// is this a blob segment put? segments are immutable and named by
+		// the SHA-1 of their (string) value
+		bool const segment_put = !mutable_put
+			&& msg_keys[9] && msg_keys[9].int_value() != 0;
+		if (segment_put && msg_keys[1].type() != bdecode_node::string_t)
+		{
+			m_counters.inc_stats_counter(counters::dht_invalid_put);
+			incoming_error(e, "segment is not a string");
+			m_incoming_table.incoming_endpoint(id, m.addr, non_referrable);
+			return std::make_tuple(need_response, need_push);
+		}
+
 		// public key (only set if it's a mutable put)
 		char const* pub_key = nullptr;
 		if (msg_keys[3]) pub_key = msg_keys[3].string_ptr();
@@ -1591,6 +1886,8 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 
 		sha256_hash const target = pub_key
 			? item_target_id(salt, public_key(pub_key))
+			: segment_put
+			? segment_target_id({msg_keys[1].string_ptr(), msg_keys[1].string_length()})
 			: item_target_id(buf);
 
 //		std::fprintf(stderr, "%s PUT target: %s salt: %s key: %s\n"
@@ -1614,7 +1911,21 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 		if (!mutable_put)
 		{
 			m_storage.put_immutable_item(target, buf, m.addr.address());
-			need_response = false;
+
+			if (segment_put)
+			{
+				// the segment putter counts responses and walks on to
+				// closer nodes, the same way as for mutable items
+				if (msg_keys[8])
+				{
+					min_distance_exp = msg_keys[8].int_value();
+				}
+				write_nodes_entries(target, msg_keys[7], reply, min_distance_exp);
+			}
+			else
+			{
+				need_response = false;
+			}
 		}
 		else
 		{
@@ -1726,12 +2037,16 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 			{"mutable", bdecode_node::int_t, 0, key_desc_t::optional},
 			{"want", bdecode_node::list_t, 0, key_desc_t::optional},
 			{"distance", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"seg", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"nv", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"prefix", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"after", bdecode_node::string_t, 32, key_desc_t::optional},
 		};
 
 		// k is not used for now
 
 		// attempt to parse the message
-		bdecode_node msg_keys[5];
+		bdecode_node msg_keys[9];
 		if (!verify_message(arg_ent, msg_desc, msg_keys, error_string))
 		{
 			m_counters.inc_stats_counter(counters::dht_invalid_get);
@@ -1760,10 +2075,11 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 
 		reply["token"] = generate_token(m.addr, target);
 
-		// always return nodes as well as peers for mutable item
+		// always return nodes as well as peers for mutable item and segment
 		bool const get_mutable = msg_keys[2] && msg_keys[2].int_value() != 0;
+		bool const get_segment = msg_keys[5] && msg_keys[5].int_value() != 0;
 		int min_distance_exp = -1;
-		if (get_mutable)
+		if (get_mutable || get_segment)
 		{
 			if (msg_keys[4])
 			{
@@ -1772,21 +2088,63 @@ std::tuple<bool, bool> node::incoming_request(msg const& m, entry& e
 			write_nodes_entries(target, msg_keys[3], reply, min_distance_exp);
 		}
 
+		// a lookup for a put only wants the nodes
+		if (msg_keys[6] && msg_keys[6].int_value() != 0)
+		{
+			return std::make_tuple(need_response, need_push);
+		}
+
+		// a prefix get wants all the mutable items whose targets start with
+		// the target as it was sent, as many as fit. "after" is the last
+		// target the requester got from the previous response
+		if (msg_keys[7] && msg_keys[7].int_value() != 0)
+		{
+			if (target_str.empty())
+			{
+				m_counters.inc_stats_counter(counters::dht_invalid_get);
+				incoming_error(e, "empty prefix");
+				return std::make_tuple(need_response, need_push);
+			}
+
+			sha256_hash after;
+			if (msg_keys[8]) after.assign(msg_keys[8].string_ptr());
+
+			// the items get whatever room the nodes and the token leave
+			std::string buf;
+			bencode(std::back_inserter(buf), reply);
+			int const max_bytes = udp_message_budget - prefix_get_envelope
+				- int(buf.size());
+
+			entry::list_type& items = reply["items"].list();
+			if (m_storage.get_mutable_items(target, int(target_str.size())
+				, msg_keys[8] ? &after : nullptr, max_bytes, items))
+			{
+				reply["more"] = 1;
+			}
+			return std::make_tuple(need_response, need_push);
+		}
+
 		// if the get has a timestamp it must be for a mutable item
 		// so don't bother searching the immutable table
 		if (!msg_keys[0])
 		{
 			if (!m_storage.get_immutable_item(target, reply)) // ok, check for a mutable one
 			{
-				m_storage.get_mutable_item(target, timestamp(0)
-					, true, reply);
+				if (!m_storage.get_mutable_item(target, timestamp(0)
+					, true, reply))
+				{
+					get_origin_item(target, timestamp(0), reply);
+				}
 			}
 		}
 		else
 		{
-			m_storage.get_mutable_item(target
+			if (!m_storage.get_mutable_item(target
 				, timestamp(msg_keys[0].int_value()), false
-				, reply);
+				, reply))
+			{
+				get_origin_item(target, timestamp(msg_keys[0].int_value()), reply);
+			}
 		}
 	}
 	else if (query == "keep")
@@ -1858,7 +2216,7 @@ void node::push(node_id const& to, udp::endpoint const& to_ep, msg const& m, nod
 #endif
 
 	// discard target node's response
-	m_rpc.invoke(e, to_ep, o, true);
+	m_rpc.invoke(e, to_ep, o, true, egress_class::push);
 }
 
 void node::push(node_id const& to, udp::endpoint const& to_ep, entry& re)
@@ -1878,7 +2236,7 @@ void node::push(node_id const& to, udp::endpoint const& to_ep, entry& re)
 #endif
 
 	// discard target node's response
-	m_rpc.invoke(e, to_ep, o, true);
+	m_rpc.invoke(e, to_ep, o, true, egress_class::push);
 }
 
 void node::incoming_push_ourself(msg const& m, node_id const& from)
@@ -2099,11 +2457,13 @@ bool node::incoming_relay(msg const& m, entry& e, entry& payload
 			{"rn6", bdecode_node::none_t, 0, key_desc_t::optional},
 			{"hmac", bdecode_node::string_t, relay_hmac::len, 0},
 			{"t", bdecode_node::string_t, public_key::len, key_desc_t::optional},
+			// the sender acknowledges relays addressed to it
+			{"ack", bdecode_node::int_t, 0, key_desc_t::optional},
 		};
 
 		// attempt to parse the message
 		// also reject the message if it has any non-fatal encoding errors
-		bdecode_node msg_keys[8];
+		bdecode_node msg_keys[9];
 		if (!verify_message(arg_ent, msg_desc, msg_keys, error_string)
 			|| arg_ent.has_soft_error(error_string))
 		{
@@ -2236,6 +2596,12 @@ bool node::incoming_relay(msg const& m, entry& e, entry& payload
 			{
 				m_relay_pkt_deduplicater.add(hmac_str);
 			}
+
+			// the sender itself sent this and answers relays sent straight
+			// to it. Replays were dropped above, they can't move its endpoint
+			bool const acks = msg_keys[8] && msg_keys[8].int_value() != 0;
+			if (sender == from && acks)
+				m_peer_endpoints.seen(sender, m.addr, aux::time_now());
 		}
 		else
 		{
@@ -2308,7 +2674,7 @@ void node::relay(node_id const& to, udp::endpoint const& to_ep
 #endif
 
 	// discard target node's response
-	m_rpc.invoke(e, to_ep, o, true);
+	m_rpc.invoke(e, to_ep, o, true, egress_class::relay_forward);
 }
 
 void node::handle_referred_relays(node_id const& peer, node_entry const& ne)
@@ -0,0 +1,72 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "ip2/kademlia/peer_endpoints.hpp"
+
+#include <algorithm>
+
+namespace ip2::dht {
+
+	peer_endpoints::peer_endpoints(time_duration const lifetime)
+		: m_lifetime(lifetime)
+	{}
+
+	void peer_endpoints::seen(node_id const& id, udp::endpoint const& ep
+		, time_point const now)
+	{
+		auto const i = m_endpoints.find(id);
+		if (i != m_endpoints.end())
+		{
+			i->second = {ep, now};
+			return;
+		}
+
+		if (int(m_endpoints.size()) >= max_size)
+		{
+			tick(now);
+			if (int(m_endpoints.size()) >= max_size)
+			{
+				// make room by dropping the peer we heard from least recently
+				auto const oldest = std::min_element(m_endpoints.begin(), m_endpoints.end()
+					, [](auto const& lhs, auto const& rhs)
+					{ return lhs.second.last_seen < rhs.second.last_seen; });
+				m_endpoints.erase(oldest);
+			}
+		}
+
+		m_endpoints.insert({id, {ep, now}});
+	}
+
+	bool peer_endpoints::find(node_id const& id, udp::endpoint& ep
+		, time_point const now) const
+	{
+		auto const i = m_endpoints.find(id);
+		if (i == m_endpoints.end() || i->second.last_seen + m_lifetime < now)
+			return false;
+
+		ep = i->second.ep;
+		return true;
+	}
+
+	void peer_endpoints::erase(node_id const& id)
+	{
+		m_endpoints.erase(id);
+	}
+
+	void peer_endpoints::tick(time_point const now)
+	{
+		for (auto i = m_endpoints.begin(); i != m_endpoints.end();)
+		{
+			if (i->second.last_seen + m_lifetime < now)
+				i = m_endpoints.erase(i);
+			else
+				++i;
+		}
+	}
+}
@@ -16,8 +16,13 @@ see LICENSE file.
 #include <ip2/kademlia/node.hpp>
 #include <ip2/aux_/io_bytes.hpp>
 #include <ip2/aux_/random.hpp>
+#include <ip2/bencode.hpp>
 #include <ip2/performance_counters.hpp>
 
+#include <cinttypes> // for PRId64 et.al.
+#include <iterator>
+#include <vector>
+
 namespace ip2 { namespace dht {
 
 void put_data_observer::reply(msg const& m, node_id const& from)
@@ -54,6 +59,9 @@ void put_data::start()
 		set_fixed_distance(256);
 	}
 
+	m_encoded_value.clear();
+	bencode(std::back_inserter(m_encoded_value), m_data.value());
+
 	// if the user didn't add seed-nodes manually, grab k (bucket size)
 	// nodes from routing table.
 	if (m_results.empty() && !m_direct_invoking)
@@ -84,8 +92,14 @@ void put_data::done()
 #ifndef TORRENT_DISABLE_LOGGING
 	get_node().observer()->log(dht_logger::traversal, "[%u] %s DONE, response %d, timeout %d"
 		, id(), name(), num_responses(), num_timeouts());
+	get_node().observer()->log(dht_logger::traversal, "[%u] %s bytes sent %" PRId64
+		", bytes per store %" PRId64
+		, id(), name(), m_bytes_sent
+		, num_responses() > 0 ? m_bytes_sent / num_responses() : m_bytes_sent);
 #endif
 
+	m_node.stats_counters().inc_stats_counter(counters::dht_put_stored, num_responses());
+
 	m_put_callback(m_data, num_responses());
 	traversal_algorithm::done();
 }
@@ -98,7 +112,7 @@ bool put_data::invoke(observer_ptr o)
 	e["y"] = "q";
 	e["q"] = "put";
 	entry& a = e["a"];
-	a["v"] = m_data.value();
+	a["v"] = m_encoded_value;
 	a["token"] = ip2_token;
 	if (m_data.is_mutable())
 	{
@@ -111,10 +125,30 @@ bool put_data::invoke(observer_ptr o)
 			a["salt"] = m_data.salt();
 		}
 	}
+	else if (m_segment)
+	{
+		a["seg"] = 1;
+		a["distance"] = traversal_algorithm::allow_distance();
+	}
 
 	m_node.stats_counters().inc_stats_counter(counters::dht_put_out);
 
-	return m_node.m_rpc.invoke(e, o->target_ep(), o, m_discard_response);
+	if (!m_node.m_rpc.invoke(e, o->target_ep(), o, m_discard_response
+		, egress_class::bulk))
+		return false;
+
+	// e is the message as it was sent now. Every put of this traversal is
+	// the same size give or take a few bytes, measure the first one.
+	if (m_message_size == 0)
+	{
+		std::vector<char> buf;
+		bencode(std::back_inserter(buf), e);
+		m_message_size = int(buf.size());
+	}
+
+	m_bytes_sent += m_message_size;
+	m_node.stats_counters().inc_stats_counter(counters::dht_put_bytes_out, m_message_size);
+	return true;
 }
 
 observer_ptr put_data::new_observer(udp::endpoint const& ep
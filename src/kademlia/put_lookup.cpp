@@ -0,0 +1,105 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include <ip2/kademlia/put_lookup.hpp>
+#include <ip2/kademlia/dht_observer.hpp>
+#include <ip2/kademlia/node.hpp>
+#include <ip2/bencode.hpp>
+#include <ip2/performance_counters.hpp>
+
+#include <iterator>
+#include <vector>
+
+namespace ip2 { namespace dht {
+
+namespace {
+
+	void store_on_closest(std::vector<std::pair<node_entry, std::string>> const& nodes
+		, std::shared_ptr<put_data> const& ta)
+	{
+		// nobody answered the lookup, fall back to a one phase put
+		if (nodes.empty())
+		{
+			ta->start();
+			return;
+		}
+
+		std::vector<node_entry> eps;
+		eps.reserve(nodes.size());
+		for (auto const& n : nodes)
+		{
+			eps.push_back(n.first);
+		}
+
+		// a window as wide as the nodes keeps the router nodes out
+		ta->set_invoke_window(std::int8_t(eps.size()));
+		ta->set_direct_endpoints(eps);
+		ta->set_parallel_invoking(true);
+		ta->start();
+	}
+}
+
+put_lookup::put_lookup(node& dht_node, std::shared_ptr<put_data> put)
+	: find_data(dht_node, put->target()
+		, std::bind(&store_on_closest, std::placeholders::_1, put))
+	, m_put(std::move(put))
+{}
+
+char const* put_lookup::name() const { return "put_lookup"; }
+
+bool put_lookup::invoke(observer_ptr o)
+{
+	if (m_done) return false;
+
+	entry e;
+	e["y"] = "q";
+	e["q"] = "get";
+	entry& a = e["a"];
+	a["target"] = target().to_string();
+	a["distance"] = traversal_algorithm::allow_distance();
+	// we only want the nodes, not the value
+	a["nv"] = 1;
+
+	item const& data = m_put->data();
+	if (m_put->segment())
+	{
+		a["seg"] = 1;
+	}
+	else
+	{
+		a["mutable"] = 1;
+		// nodes only send an item newer than this one
+		a["ts"] = data.ts().value;
+	}
+
+	m_node.stats_counters().inc_stats_counter(counters::dht_get_out);
+
+	if (!m_node.m_rpc.invoke(e, o->target_ep(), o))
+		return false;
+
+	if (m_message_size == 0)
+	{
+		std::vector<char> buf;
+		bencode(std::back_inserter(buf), e);
+		m_message_size = int(buf.size());
+	}
+
+	m_bytes_sent += m_message_size;
+	m_node.stats_counters().inc_stats_counter(counters::dht_put_bytes_out, m_message_size);
+	return true;
+}
+
+void put_lookup::done()
+{
+	// the put reports the bytes of both phases
+	m_put->add_lookup_bytes(m_bytes_sent);
+	find_data::done();
+}
+
+} } // namespace ip2::dht
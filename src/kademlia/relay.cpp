@@ -17,10 +17,14 @@ see LICENSE file.
 #include <ip2/aux_/socket_io.hpp>
 #include <ip2/aux_/io_bytes.hpp>
 #include <ip2/aux_/random.hpp>
+#include <ip2/aux_/time.hpp>
 #include <ip2/performance_counters.hpp>
+#include <ip2/bencode.hpp>
 #include <ip2/hasher.hpp>
 #include <ip2/hex.hpp>
 
+#include <iterator>
+
 namespace ip2 { namespace dht {
 
 relay_hmac gen_relay_hmac(span<char const> payload
@@ -62,6 +66,33 @@ void relay_observer::reply(msg const& m, node_id const& from)
     done();
 }
 
+void direct_relay_observer::reply(msg const& m, node_id const& from)
+{
+	if (flags & flag_done) return;
+	flags |= flag_done;
+
+	bdecode_node const r = m.message.dict_find_dict("r");
+	bdecode_node const hit_ent = r ? r.dict_find_int("hit") : bdecode_node();
+	bool const hit = hit_ent && hit_ent.int_value() != 0;
+	m_relay->on_direct_reply(from, m.addr, hit);
+}
+
+void direct_relay_observer::short_timeout()
+{
+	// a peer we just heard from answers quickly, don't keep the traversal
+	// waiting for the full timeout
+	if (flags & flag_short_timeout) return;
+	flags |= flag_short_timeout;
+	m_relay->on_direct_failed();
+}
+
+void direct_relay_observer::timeout()
+{
+	if (flags & flag_done) return;
+	flags |= flag_done;
+	m_relay->on_direct_failed();
+}
+
 relay::relay(node& dht_node
 	, node_id const& to
 	, entry payload
@@ -86,6 +117,20 @@ void relay::start()
 		set_fixed_distance(256);
 	}
 
+	m_encoded_payload.clear();
+	bencode(std::back_inserter(m_encoded_payload), m_encrypted_payload);
+	m_encoded_aux_nodes.clear();
+	if (m_aux_nodes.type() != entry::data_type::undefined_t)
+	{
+		bencode(std::back_inserter(m_encoded_aux_nodes), m_aux_nodes);
+	}
+
+	if (m_has_direct_ep && !m_direct_done)
+	{
+		invoke_direct();
+		return;
+	}
+
 	// if the user didn't add seed-nodes manually, grab k (bucket size)
 	// nodes from routing table.
 	if (m_results.empty() && !m_direct_invoking)
@@ -142,31 +187,111 @@ void relay::done()
 	traversal_algorithm::done();
 }
 
-bool relay::invoke(observer_ptr o)
+void relay::set_direct_endpoint(udp::endpoint const& ep)
 {
-	if (m_done) return false;
+	m_direct_ep = ep;
+	m_has_direct_ep = true;
+}
 
+void relay::invoke_direct()
+{
+#ifndef TORRENT_DISABLE_LOGGING
+	get_node().observer()->log(dht_logger::traversal, "[%u] relay directly to %s"
+		, id(), aux::print_endpoint(m_direct_ep).c_str());
+#endif
+
+	auto algo = std::make_shared<traversal_algorithm>(m_node, m_to);
+	auto o = m_node.m_rpc.allocate_observer<direct_relay_observer>(std::move(algo)
+		, m_direct_ep, m_to, std::static_pointer_cast<relay>(self()));
+	if (!o)
+	{
+		on_direct_failed();
+		return;
+	}
+#if TORRENT_USE_ASSERTS
+	o->m_in_constructor = false;
+#endif
+
+	entry e = relay_message();
+	if (!m_node.m_rpc.invoke(e, m_direct_ep, o, false, egress_class::bulk))
+		on_direct_failed();
+}
+
+void relay::on_direct_reply(node_id const& nid, udp::endpoint const& ep, bool const hit)
+{
+	if (m_done) return;
+
+	// the endpoint may belong to somebody else by now
+	if (!hit || nid != m_to)
+	{
+		on_direct_failed();
+		return;
+	}
+
+	// nothing authenticates the reply, it's one hit like any other. The
+	// receiver has the message already, the traversal still runs until
+	// the hit limit is reached. A late reply joins the running traversal
+	on_put_success(nid, ep, hit);
+	if (m_direct_done) return;
+	m_direct_done = true;
+	start();
+}
+
+void relay::on_direct_failed()
+{
+	if (m_done || m_direct_done) return;
+	m_direct_done = true;
+
+#ifndef TORRENT_DISABLE_LOGGING
+	get_node().observer()->log(dht_logger::traversal
+		, "[%u] no direct reply from %s, traversing"
+		, id(), aux::print_endpoint(m_direct_ep).c_str());
+#endif
+
+	m_node.m_peer_endpoints.erase(m_to);
+	start();
+}
+
+entry relay::relay_message() const
+{
 	entry e;
 	e["y"] = "h"; // hop
 	e["q"] = "relay";
 	entry& a = e["a"];
-	a["pl"] = m_encrypted_payload; // payload
+	a["pl"] = m_encoded_payload; // payload
 	// a["f"] = m_node.nid().to_string(); // from
 	a["t"] = m_to.to_string(); // to
 	a["dis"] = traversal_algorithm::allow_distance();
-	if (m_aux_nodes.type() != entry::data_type::undefined_t)
+	if (!m_encoded_aux_nodes.empty())
 	{
 		// relay nodes
-		a[m_node.protocol_relay_nodes_key()] = m_aux_nodes;
+		a[m_node.protocol_relay_nodes_key()] = m_encoded_aux_nodes;
 	}
 	a["hmac"] = m_hmac.bytes;
+	// we acknowledge relays addressed to us, older nodes don't, so the
+	// receiver only relays straight to nodes that say so
+	a["ack"] = 1;
+
+	return e;
+}
 
-	return m_node.m_rpc.invoke(e, o->target_ep(), o, m_discard_response);
+bool relay::invoke(observer_ptr o)
+{
+	if (m_done) return false;
+
+	entry e = relay_message();
+	return m_node.m_rpc.invoke(e, o->target_ep(), o, m_discard_response
+		, egress_class::bulk);
 }
 
 void relay::on_put_success(node_id const& nid, udp::endpoint const& ep, bool hit)
 {
 	if (hit) ++m_hits;
+
+	// the receiver answered itself, next time try it directly
+	if (hit && nid == m_to)
+		m_node.m_peer_endpoints.seen(nid, ep, aux::time_now());
+
 	m_success_nodes.push_back(std::make_pair(node_entry(nid, ep), hit));
 }
 
@@ -118,6 +118,7 @@ namespace {
 	std::size_t const observer_storage_size = std::max(
 	{sizeof(find_data_observer)
 	, sizeof(relay_observer)
+	, sizeof(direct_relay_observer)
 	, sizeof(keep_observer)
 	, sizeof(put_data_observer)
 	, sizeof(get_item_observer)
@@ -417,7 +418,7 @@ time_duration rpc_manager::tick()
 }
 
 bool rpc_manager::invoke(entry& e, udp::endpoint const& target_addr
-	, observer_ptr o, bool discard_response)
+	, observer_ptr o, bool discard_response, egress_class const tc)
 {
 	INVARIANT_CHECK;
 
@@ -459,7 +460,7 @@ bool rpc_manager::invoke(entry& e, udp::endpoint const& target_addr
 	}
 #endif
 
-	if (m_sock_man->send_packet(m_sock, e, target_addr, o->id()))
+	if (m_sock_man->send_packet(m_sock, e, target_addr, o->id(), tc))
 	{
 		if (!discard_response)
 		{
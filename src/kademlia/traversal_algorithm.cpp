@@ -731,6 +731,37 @@ bool traversal_algorithm::add_requests()
 		return true;
 	}
 
+	// Invoke all the direct endpoints at once and wait for the responses.
+	if (m_parallel_invoking && m_direct_invoking)
+	{
+		int outstanding = 0;
+		for (auto i = m_results.begin(), end(m_results.end()); i != end; ++i)
+		{
+			observer* o = i->get();
+			if (o->flags & observer::flag_queried)
+			{
+				if (!(o->flags & (observer::flag_alive | observer::flag_failed)))
+					++outstanding;
+				continue;
+			}
+
+			o->flags |= observer::flag_queried;
+			if (invoke(*i))
+			{
+				TORRENT_ASSERT(m_invoke_count < std::numeric_limits<std::int8_t>::max());
+				++m_invoke_count;
+				++outstanding;
+			}
+			else
+			{
+				o->flags |= observer::flag_failed;
+				++m_invoke_failed;
+			}
+		}
+
+		return outstanding == 0;
+	}
+
 	// the following logic is based on 'alpha == 1'.
 	TORRENT_ASSERT(m_branch_factor == 1);
 
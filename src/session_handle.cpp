@@ -146,6 +146,39 @@ namespace ip2 {
 		return r;
 	}
 
+	template<typename Ret, typename Fun, typename... Args>
+	void session_handle::async_call_ret(std::function<void(Ret)> handler, Ret failed
+		, Fun f, Args&&... a) const
+	{
+		std::shared_ptr<session_impl> s = m_impl.lock();
+		if (!s) aux::throw_ex<system_error>(errors::invalid_session_handle);
+		dispatch(s->get_context(), [=, h = std::move(handler)]() mutable
+		{
+			Ret r = failed;
+#ifndef BOOST_NO_EXCEPTIONS
+			try {
+#endif
+				r = (s.get()->*f)(std::forward<Args>(a)...);
+#ifndef BOOST_NO_EXCEPTIONS
+			} catch (system_error const& e) {
+				s->alerts().emplace_alert<session_error_alert>(e.code(), e.what());
+			} catch (std::exception const& e) {
+				s->alerts().emplace_alert<session_error_alert>(error_code(), e.what());
+			} catch (...) {
+				s->alerts().emplace_alert<session_error_alert>(error_code(), "unknown error");
+			}
+#endif
+			if (h) h(std::move(r));
+		});
+	}
+
+	std::shared_ptr<blockchain::chain_reader> session_handle::read_only_path() const
+	{
+		std::shared_ptr<session_impl> s = m_impl.lock();
+		if (!s) aux::throw_ex<system_error>(errors::invalid_session_handle);
+		return s->chain_reader();
+	}
+
 	session_params session_handle::session_state(save_state_flags_t const flags) const
 	{
 		return sync_call_ret<session_params>(&session_impl::session_state, flags);
@@ -199,6 +232,12 @@ namespace ip2 {
 		async_call(&session_impl::dht_get_mutable_item, key, salt);
 	}
 
+	void session_handle::dht_get_items(sha256_hash const& prefix, int const prefix_len
+		, sha256_hash const& after)
+	{
+		async_call(&session_impl::dht_get_items, prefix, prefix_len, after);
+	}
+
 	// TODO: 3 expose the timestamp, public_key, secret_key and signature
 	// types to the client
 	sha256_hash session_handle::dht_put_item(entry data)
@@ -384,6 +423,9 @@ namespace ip2 {
 	// get account info
     blockchain::account session_handle::get_account_info(std::vector<char> chain_id, dht::public_key pub_key)
 	{
+		if (auto reader = read_only_path())
+			return reader->get_account(chain_id, pub_key);
+
 		blockchain::account act;
 		sync_call(&session_impl::get_account_info, chain_id, pub_key, &act);
 		return act;
@@ -392,6 +434,9 @@ namespace ip2 {
 	// get top and tip blocks
     std::vector<blockchain::block> session_handle::get_top_tip_block(std::vector<char> chain_id, int num)
 	{
+		if (auto reader = read_only_path())
+			return reader->get_top_tip_blocks(chain_id, num);
+
 		std::vector<blockchain::block> blks;
 		sync_call(&session_impl::get_top_tip_block, chain_id, num, &blks);
 		return blks;
@@ -442,12 +487,18 @@ namespace ip2 {
 	// get block by number
     blockchain::block session_handle::get_block_by_number(std::vector<char> chain_id, std::int64_t block_number)
 	{
+		if (auto reader = read_only_path())
+			return reader->get_block_by_number(chain_id, block_number);
+
 		return sync_call_ret<blockchain::block>(&session_impl::get_block_by_number, chain_id, block_number);
 	}
 
 	// get block by hash
     blockchain::block session_handle::get_block_by_hash(std::vector<char> chain_id, const sha1_hash& block_hash)
 	{
+		if (auto reader = read_only_path())
+			return reader->get_block_by_hash(chain_id, block_hash);
+
 		return sync_call_ret<blockchain::block>(&session_impl::get_block_by_hash, chain_id, block_hash);
 	}
 
@@ -535,6 +586,14 @@ namespace ip2 {
 			, data, uri);
 	}
 
+	ip2::api::error_code session_handle::put_data_into_swarm(
+			ip2::api::shared_blob const& blob
+			, std::array<char, 20> const& uri)
+	{
+		return sync_call_ret<ip2::api::error_code>(&session_impl::put_shared_blob_into_swarm
+			, blob, uri);
+	}
+
 	ip2::api::error_code session_handle::relay_data_uri(
 			std::array<char, 32> const& receiver
 			, std::array<char, 20> const& uri
@@ -561,6 +620,79 @@ namespace ip2 {
 			, receiver, message);
 	}
 
+	void session_handle::async_put_data_into_swarm(
+			std::vector<char> const& data
+			, std::array<char, 20> const& uri
+			, std::function<void(ip2::api::error_code)> handler)
+	{
+		async_call_ret<ip2::api::error_code>(std::move(handler), ip2::api::ABORT_ERROR
+			, &session_impl::put_data_into_swarm, data, uri);
+	}
+
+	void session_handle::async_put_data_into_swarm(
+			ip2::api::shared_blob const& blob
+			, std::array<char, 20> const& uri
+			, std::function<void(ip2::api::error_code)> handler)
+	{
+		async_call_ret<ip2::api::error_code>(std::move(handler), ip2::api::ABORT_ERROR
+			, &session_impl::put_shared_blob_into_swarm, blob, uri);
+	}
+
+	void session_handle::async_get_data_from_swarm(
+			std::array<char, 32> const& sender
+			, std::array<char, 20> const& uri
+			, std::int64_t timestamp
+			, std::function<void(ip2::api::error_code)> handler)
+	{
+		async_call_ret<ip2::api::error_code>(std::move(handler), ip2::api::ABORT_ERROR
+			, &session_impl::get_data_from_swarm, sender, uri, timestamp);
+	}
+
+	void session_handle::async_relay_message(
+			std::array<char, 32> const& receiver
+			, std::vector<char> const& message
+			, std::function<void(ip2::api::error_code)> handler)
+	{
+		async_call_ret<ip2::api::error_code>(std::move(handler), ip2::api::ABORT_ERROR
+			, &session_impl::relay_message, receiver, message);
+	}
+
+	void session_handle::async_submit_transaction(blockchain::transaction const& tx
+			, std::function<void(bool)> handler)
+	{
+		async_call_ret<bool>(std::move(handler), false
+			, &session_impl::submit_transaction, tx);
+	}
+
+	void session_handle::async_add_new_message(communication::message const& msg
+			, std::function<void(bool)> handler)
+	{
+		async_call_ret<bool>(std::move(handler), false
+			, &session_impl::add_new_message, msg);
+	}
+
+	void session_handle::async_get_account_info(std::vector<char> chain_id
+			, dht::public_key const& pub_key
+			, std::function<void(blockchain::account)> handler)
+	{
+		async_call_ret<blockchain::account>(std::move(handler), blockchain::account()
+			, &session_impl::query_account_info, chain_id, pub_key);
+	}
+
+	void session_handle::async_submit_transactions(std::vector<blockchain::transaction> txs
+			, std::function<void(std::vector<bool>)> handler)
+	{
+		async_call_ret<std::vector<bool>>(std::move(handler), std::vector<bool>(txs.size(), false)
+			, &session_impl::submit_transactions, std::move(txs));
+	}
+
+	void session_handle::async_add_new_messages(std::vector<communication::message> msgs
+			, std::function<void(std::vector<bool>)> handler)
+	{
+		async_call_ret<std::vector<bool>>(std::move(handler), std::vector<bool>(msgs.size(), false)
+			, &session_impl::add_new_messages, std::move(msgs));
+	}
+
 	void session_handle::set_ip_filter(ip_filter f)
 	{
 		std::shared_ptr<ip_filter> copy = std::make_shared<ip_filter>(std::move(f));
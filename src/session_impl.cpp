@@ -599,6 +599,8 @@ void apply_deprecated_dht_settings(settings_pack& sett, bdecode_node const& s)
             if(0 == num_dht_nodes) {
                 int max_time = m_settings.get_int(settings_pack::max_time_peers_zero);
                 if(m_session_time - m_dht_nodes_non_zero >= max_time) {
+                    // recover from the last good routing table
+                    if (m_dht) m_dht->save_routing_table();
                     reopen_listen_sockets(false);
                     m_dht_nodes_non_zero = m_session_time;
                 }
@@ -944,6 +946,8 @@ void apply_deprecated_dht_settings(settings_pack& sett, bdecode_node const& s)
 			delete m_kvdb;
 		}
 
+		std::atomic_store(&m_chain_reader, std::shared_ptr<blockchain::chain_reader>());
+
 		if (m_sqldb) {
 			sqlite3_close_v2(m_sqldb);
 			m_sqldb = nullptr;
@@ -1413,8 +1417,11 @@ namespace {
 				session_log("reconnect listen socket");
 			}
 #endif
+        // network changed, rebind sockets but keep the routing table, the
+        // restarted dht pings the saved nodes and bootstraps from them
+        if (m_dht) m_dht->save_routing_table();
         reopen_listen_sockets(false);
-        //TODO: modify the tick
+        m_dht_nodes_non_zero = m_session_time;
     }
 
 	void session_impl::reopen_listen_sockets(bool const map_ports)
@@ -1683,7 +1690,8 @@ namespace {
 					reset_refer_switch();
 					m_dht->stop();
 					m_dht->new_socket(m_listening_sockets.back());
-					//TODO: get and add nodes from former node's routing table
+					// nodes from former routing table, if saved, are
+					// re-validated in start()
 					for (auto const& n : m_dht_router_nodes)
 					{
 						m_dht->add_router_node(n);
@@ -1941,7 +1949,8 @@ namespace {
 		m_raw_send_udp_packet.clear();
 
 #ifdef TORRENT_ENABLE_UDP_COMPRESS
-		bool c_result = compress_udp_packet(p, m_raw_send_udp_packet);
+		bool c_result = compress_udp_packet(p, m_raw_send_udp_packet
+			, !(flags & udp_socket::dont_compress));
 		if(!c_result){
 #ifndef TORRENT_DISABLE_LOGGING
 			if (should_log())
@@ -2003,42 +2012,84 @@ namespace {
 	}
 
 #ifdef TORRENT_ENABLE_UDP_COMPRESS
-	bool session_impl::compress_udp_packet(span<char const> p, std::string& out)
-	{
-		//compress
-		size_t input_size = p.size();	
-		size_t output_length = snappy_max_compressed_length(input_size);
-		char* c_p = (char*)malloc(output_length);
-		size_t c_p_size = output_length;	
-		snappy_status ss = snappy_compress(p.data(), input_size, c_p, &c_p_size);
-		if(ss == SNAPPY_OK) {
-			out.insert(0, c_p, c_p_size);
-		} else {
-			free(c_p);
-			return false;
+	namespace {
+
+		// the first byte of every packet (before encryption) says how the
+		// rest of it is encoded
+		enum udp_packet_encoding : char
+		{
+			udp_packet_raw = 0,
+			udp_packet_snappy = 1
+		};
+
+		// below this, snappy's framing eats whatever it could save
+		constexpr std::size_t udp_compress_min_size = 64;
+
+		// no valid DHT message is larger than this, don't let a packet
+		// claim an uncompressed size we'd have to allocate
+		constexpr std::size_t udp_uncompress_max_size = 64 * 1024;
+	}
+
+	// out is one of the session's packet buffers, which keep their capacity
+	// between packets. The packet is compressed straight into it, and sent
+	// uncompressed whenever compression doesn't make it smaller
+	bool session_impl::compress_udp_packet(span<char const> p, std::string& out
+		, bool const try_compress)
+	{
+		std::size_t const input_size = std::size_t(p.size());
+
+		if (try_compress && input_size >= udp_compress_min_size)
+		{
+			std::size_t c_size = snappy_max_compressed_length(input_size);
+			out.resize(1 + c_size);
+			out[0] = udp_packet_snappy;
+			if (snappy_compress(p.data(), input_size, &out[1], &c_size) != SNAPPY_OK)
+				return false;
+
+			if (c_size < input_size)
+			{
+				out.resize(1 + c_size);
+				m_stats_counters.inc_stats_counter(counters::udp_compressed_packets);
+				m_stats_counters.inc_stats_counter(counters::udp_compress_saved_bytes
+					, std::int64_t(input_size - c_size));
+				return true;
+			}
 		}
-		free(c_p);
+
+		out.resize(1);
+		out[0] = udp_packet_raw;
+		out.append(p.data(), input_size);
 		return true;
 	}
 
 	bool session_impl::uncompress_udp_packet(const std::string& in, std::string& out)
 	{
-		//compress
-		size_t input_size = in.size();	
-		size_t output_length;
-		if(snappy_uncompressed_length(in.c_str(), input_size, &output_length) != SNAPPY_OK) {
-			return false;
-		};
-		char* ucd_p = (char*)malloc(output_length);
-		snappy_status ss = snappy_uncompress(in.c_str(), input_size, ucd_p, &output_length);
-		if(ss == SNAPPY_OK) {
-			out.insert(0, ucd_p, output_length);
-		} else {
-			free(ucd_p);
-			return false;
+		if (in.empty()) return false;
+
+		char const* const data = in.data() + 1;
+		std::size_t const input_size = in.size() - 1;
+
+		switch (in[0])
+		{
+			case udp_packet_raw:
+				out.assign(data, input_size);
+				return true;
+			case udp_packet_snappy:
+			{
+				std::size_t output_length;
+				if (snappy_uncompressed_length(data, input_size, &output_length) != SNAPPY_OK
+					|| output_length > udp_uncompress_max_size)
+					return false;
+
+				out.resize(output_length);
+				if (snappy_uncompress(data, input_size, &out[0], &output_length) != SNAPPY_OK)
+					return false;
+				out.resize(output_length);
+				return true;
+			}
+			default:
+				return false;
 		}
-		free(ucd_p);
-		return true;
 	}
 #endif
 
@@ -2842,6 +2893,9 @@ namespace {
 
 		sqlite3_exec(m_sqldb, "pragma journal_mode = WAL;", NULL, NULL, NULL);
 		sqlite3_exec(m_sqldb, "pragma synchronous = normal;", NULL, NULL, NULL);
+
+		// readers use their own connections, WAL lets them run concurrently with network thread writes
+		std::atomic_store(&m_chain_reader, std::make_shared<blockchain::chain_reader>(sqldb_path));
     }
 
 	void session_impl::update_dht_bootstrap_nodes()
@@ -3160,9 +3214,13 @@ namespace {
 
 		// TODO: refactor, move the storage to dht_tracker
 		m_dht_storage = m_dht_storage_constructor(m_settings);
-		m_items_db = std::make_shared<dht::items_db_sqlite>(
-			m_settings, static_cast<dht::dht_observer*>(this));
-		m_dht_storage->set_backend(m_items_db);
+		// with an item log the storage keeps the items itself
+		if (m_settings.get_str(settings_pack::dht_item_log_path).empty())
+		{
+			m_items_db = std::make_shared<dht::items_db_sqlite>(
+				m_settings, static_cast<dht::dht_observer*>(this));
+			m_dht_storage->set_backend(m_items_db);
+		}
 		m_bs_nodes_storage = std::make_unique<dht::bs_nodes_db_sqlite>(
 			m_settings, static_cast<dht::dht_observer*>(this));
 
@@ -3396,6 +3454,15 @@ namespace {
 			return false;
 	}	
 
+	std::vector<bool> session_impl::add_new_messages(const std::vector<communication::message>& msgs)
+	{
+		std::vector<bool> ret;
+		ret.reserve(msgs.size());
+		for (auto const& msg : msgs)
+			ret.push_back(add_new_message(msg));
+		return ret;
+	}
+
 	void session_impl::create_chain_id(const aux::bytes &type, std::string community_name, std::vector<char>* id)
 	{
 		if(m_blockchain)
@@ -3445,6 +3512,14 @@ namespace {
 		return false;
 	}
 
+	std::vector<bool> session_impl::submit_transactions(const std::vector<blockchain::transaction>& txs) {
+		std::vector<bool> ret;
+		ret.reserve(txs.size());
+		for (auto const& tx : txs)
+			ret.push_back(submit_transaction(tx));
+		return ret;
+	}
+
 	bool session_impl::get_account_info(const aux::bytes &chain_id, dht::public_key pub_key, blockchain::account * act) {
 		if(m_blockchain) {
 			*act =  m_blockchain->getAccountInfo(chain_id, pub_key);
@@ -3453,6 +3528,12 @@ namespace {
 		return false;
 	}
 
+	blockchain::account session_impl::query_account_info(const aux::bytes &chain_id, dht::public_key pub_key) {
+		if(m_blockchain)
+			return m_blockchain->getAccountInfo(chain_id, pub_key);
+		return blockchain::account();
+	}
+
 	bool session_impl::get_top_tip_block(const aux::bytes &chain_id, int num, std::vector<blockchain::block> * blks) {
 		if(m_blockchain) {
 			*blks = m_blockchain->getTopTipBlocks(chain_id, num);
@@ -3586,6 +3667,19 @@ namespace {
 		return ip2::api::ABORT_ERROR;
 	}
 
+	ip2::api::error_code session_impl::put_shared_blob_into_swarm(
+		ip2::api::shared_blob const& blob
+		, std::array<char, 20> const& uri)
+	{
+		if (m_assembler)
+		{
+			aux::uri blob_uri(uri.data());
+			return m_assembler->put(blob.buf(), blob_uri);
+		}
+
+		return ip2::api::ABORT_ERROR;
+	}
+
 	ip2::api::error_code session_impl::relay_data_uri(
 		std::array<char, 32> const& receiver
 		, std::array<char, 20> const& uri
@@ -3840,6 +3934,32 @@ namespace {
 			, this, _1, _2), std::move(salt));
 	}
 
+	// callback for dht_get_items, the empty item at the end posts a
+	// dht_get_items_alert instead
+	void session_impl::get_items_callback(sha256_hash const& prefix
+		, int const prefix_len, dht::item const& i
+		, bool const authoritative, bool const more)
+	{
+		if (authoritative)
+		{
+			if (m_alerts.should_post<dht_get_items_alert>())
+				m_alerts.emplace_alert<dht_get_items_alert>(prefix, prefix_len, more);
+			return;
+		}
+		if (i.empty()) return;
+		get_mutable_callback(i, false);
+	}
+
+	void session_impl::dht_get_items(sha256_hash const& prefix
+		, int const prefix_len, sha256_hash const& after)
+	{
+		if (!m_dht) return;
+		if (prefix_len <= 0 || prefix_len > int(prefix.size())) return;
+		m_dht->get_items(prefix, prefix_len, std::bind(&session_impl::get_items_callback
+			, this, prefix, prefix_len, _1, _2, _3)
+			, after.is_all_zeros() ? nullptr : &after);
+	}
+
 	namespace {
 
 		void on_dht_put_immutable_item(aux::alert_manager& alerts, sha256_hash target, int num)
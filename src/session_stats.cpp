@@ -54,6 +54,12 @@ namespace {
 		METRIC(net, recv_ip_overhead_bytes)
 		METRIC(net, recv_tracker_bytes)
 
+		// with UDP compression enabled, the number of packets sent snappy
+		// compressed and the bytes that saved. Packets that don't get smaller
+		// are sent as they are
+		METRIC(net, udp_compressed_packets)
+		METRIC(net, udp_compress_saved_bytes)
+
 		// the number of sockets currently waiting for upload and download
 		// bandwidth from the rate limiter.
 		METRIC(net, limiter_up_queue)
@@ -117,6 +123,10 @@ namespace {
 		// sent
 		METRIC(dht, dht_messages_out_dropped)
 
+		// the number of outgoing DHT packets queued by egress shaping, to be
+		// sent once the upload budget allows
+		METRIC(dht, dht_messages_out_delayed)
+
 		// the total number of bytes sent and received by the DHT
 		METRIC(dht, dht_bytes_in)
 		METRIC(dht, dht_bytes_out)
@@ -139,6 +149,16 @@ namespace {
 		METRIC(dht, dht_sample_infohashes_out)
 		METRIC(dht, dht_invoked_requests)
 
+		// the number of incoming gets answered from the items published
+		// by this node rather than from the stored items
+		METRIC(dht, dht_origin_item_served)
+
+		// the bytes sent by put traversals, lookups included, and the
+		// number of nodes that acknowledged storing the item. Their ratio
+		// is the cost of one successful store.
+		METRIC(dht, dht_put_bytes_out)
+		METRIC(dht, dht_put_stored)
+
 		// the number of failed incoming DHT requests by kind of request
 		METRIC(dht, dht_invalid_announce)
 		METRIC(dht, dht_invalid_get_peers)
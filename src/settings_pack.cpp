@@ -114,7 +114,8 @@ namespace ip2 {
         SET(db_dir, ".ip2_DB", &session_impl::update_db_dir),
         SET(dump_dir, ".ip2_DUMP", nullptr),
         SET(account_seed, "", &session_impl::update_account_seed),
-		SET(dht_bootstrap_nodes, "dht.libtorrent.org:25401", &session_impl::update_dht_bootstrap_nodes)
+		SET(dht_bootstrap_nodes, "dht.libtorrent.org:25401", &session_impl::update_dht_bootstrap_nodes),
+		SET(dht_item_log_path, "", nullptr)
 	}});
 
 	CONSTEXPR_SETTINGS
@@ -195,9 +196,12 @@ namespace ip2 {
 		SET(dht_ignore_dark_internet, true, nullptr),
 		SET(dht_read_only, false, nullptr),
 		SET(dht_non_referrable, true, nullptr),
+		SET(dht_two_phase_put, false, nullptr),
+		SET(dht_egress_shaping, false, nullptr),
 		SET(auto_relay, false, &session_impl::update_auto_relay),
 		SET(enable_communication, false, nullptr),
 		SET(enable_blockchain, false, nullptr),
+		SET(relay_receipts, false, nullptr),
 	}});
 
 	CONSTEXPR_SETTINGS
@@ -373,6 +377,7 @@ namespace ip2 {
 		SET(log_level, aux::LOG_LEVEL::LOG_DEBUG, &session_impl::update_log_level),
 		SET(transport_invoking_interval, 50, nullptr),
 		SET(transport_invoking_queue_max_size, 10000, nullptr),
+		SET(dht_relay_block_ratelimit, 100, nullptr),
 	}});
 
 #undef SET
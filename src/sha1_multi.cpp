@@ -0,0 +1,380 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "ip2/config.hpp"
+#include "ip2/aux_/sha1_multi.hpp"
+#include "ip2/aux_/cpuid.hpp"
+#include "ip2/assert.hpp"
+#include "ip2/hasher.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if TORRENT_HAS_SSE && (defined __GNUC__ || defined _MSC_VER)
+#define TORRENT_HAS_SHA1_MULTI_X86 1
+#include "ip2/aux_/disable_warnings_push.hpp"
+#include <immintrin.h>
+#include "ip2/aux_/disable_warnings_pop.hpp"
+#else
+#define TORRENT_HAS_SHA1_MULTI_X86 0
+#endif
+
+// GCC and clang only let us use the intrinsics of instruction sets that are
+// enabled for the function, MSVC always does
+#if TORRENT_HAS_SHA1_MULTI_X86 && defined __GNUC__
+#define TORRENT_TARGET(x) __attribute__((target(x)))
+#else
+#define TORRENT_TARGET(x)
+#endif
+
+namespace ip2::aux {
+
+namespace {
+
+	std::uint32_t const sha1_init[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+	// the number of 64 byte blocks of a message of ``len`` bytes, once padded
+	std::size_t num_blocks(std::size_t const len)
+	{
+		return (len + 8) / 64 + 1;
+	}
+
+	// copies block ``b`` of the padded message into ``out``
+	void padded_block(span<char const> msg, std::size_t const b, std::uint8_t* out)
+	{
+		std::size_t const len = std::size_t(msg.size());
+		std::size_t const begin = b * 64;
+		if (begin + 64 <= len)
+		{
+			std::memcpy(out, msg.data() + begin, 64);
+			return;
+		}
+
+		std::memset(out, 0, 64);
+		if (begin < len) std::memcpy(out, msg.data() + begin, len - begin);
+		if (begin <= len) out[len - begin] = 0x80;
+		if (b == num_blocks(len) - 1)
+		{
+			std::uint64_t const bits = std::uint64_t(len) * 8;
+			for (int i = 0; i < 8; ++i)
+				out[63 - i] = std::uint8_t(bits >> (8 * i));
+		}
+	}
+
+	sha1_hash to_digest(std::uint32_t const* state)
+	{
+		char digest[20];
+		for (int i = 0; i < 5; ++i)
+		{
+			digest[i * 4] = char(state[i] >> 24);
+			digest[i * 4 + 1] = char(state[i] >> 16);
+			digest[i * 4 + 2] = char(state[i] >> 8);
+			digest[i * 4 + 3] = char(state[i]);
+		}
+		return sha1_hash(digest);
+	}
+
+	void sha1_multi_scalar(span<span<char const> const> msgs, span<sha1_hash> out)
+	{
+		for (std::ptrdiff_t i = 0; i < msgs.size(); ++i)
+			out[i] = hasher(msgs[i]).final();
+	}
+
+#if TORRENT_HAS_SHA1_MULTI_X86
+
+	TORRENT_TARGET("avx2")
+	inline __m256i rotl(__m256i const x, int const n)
+	{
+		return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+	}
+
+	TORRENT_TARGET("avx2")
+	inline void sha1_avx2_round(__m256i* w, int const t, __m256i const f, __m256i const k
+		, __m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i& e)
+	{
+		if (t >= 16)
+		{
+			w[t & 15] = rotl(_mm256_xor_si256(
+				_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15])
+				, _mm256_xor_si256(w[(t - 14) & 15], w[t & 15])), 1);
+		}
+		__m256i const tmp = _mm256_add_epi32(_mm256_add_epi32(rotl(a, 5), f)
+			, _mm256_add_epi32(_mm256_add_epi32(e, k), w[t & 15]));
+		e = d;
+		d = c;
+		c = rotl(b, 30);
+		b = a;
+		a = tmp;
+	}
+
+	// runs one block of each of the 8 lanes through the compression
+	// function. ``blocks`` holds the 8 blocks back to back. Only the lanes
+	// set in ``active`` are updated.
+	TORRENT_TARGET("avx2")
+	void sha1_avx2_block(__m256i* state, std::uint8_t const* blocks, __m256i const active)
+	{
+		__m256i const bswap = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+			, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		__m256i const lanes = _mm256_setr_epi32(0, 64, 128, 192, 256, 320, 384, 448);
+
+		// word t of every lane, transposed into one register
+		__m256i w[16];
+		for (int t = 0; t < 16; ++t)
+		{
+			w[t] = _mm256_shuffle_epi8(_mm256_i32gather_epi32(
+				reinterpret_cast<int const*>(blocks + t * 4), lanes, 1), bswap);
+		}
+
+		__m256i a = state[0];
+		__m256i b = state[1];
+		__m256i c = state[2];
+		__m256i d = state[3];
+		__m256i e = state[4];
+
+		__m256i const k0 = _mm256_set1_epi32(0x5a827999);
+		for (int t = 0; t < 20; ++t)
+		{
+			// (b & c) | (~b & d)
+			sha1_avx2_round(w, t, _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)))
+				, k0, a, b, c, d, e);
+		}
+		__m256i const k1 = _mm256_set1_epi32(0x6ed9eba1);
+		for (int t = 20; t < 40; ++t)
+			sha1_avx2_round(w, t, _mm256_xor_si256(_mm256_xor_si256(b, c), d), k1, a, b, c, d, e);
+		__m256i const k2 = _mm256_set1_epi32(int(0x8f1bbcdc));
+		for (int t = 40; t < 60; ++t)
+		{
+			// (b & c) | (b & d) | (c & d)
+			sha1_avx2_round(w, t, _mm256_or_si256(_mm256_and_si256(b, c)
+				, _mm256_and_si256(d, _mm256_or_si256(b, c))), k2, a, b, c, d, e);
+		}
+		__m256i const k3 = _mm256_set1_epi32(int(0xca62c1d6));
+		for (int t = 60; t < 80; ++t)
+			sha1_avx2_round(w, t, _mm256_xor_si256(_mm256_xor_si256(b, c), d), k3, a, b, c, d, e);
+
+		state[0] = _mm256_blendv_epi8(state[0], _mm256_add_epi32(state[0], a), active);
+		state[1] = _mm256_blendv_epi8(state[1], _mm256_add_epi32(state[1], b), active);
+		state[2] = _mm256_blendv_epi8(state[2], _mm256_add_epi32(state[2], c), active);
+		state[3] = _mm256_blendv_epi8(state[3], _mm256_add_epi32(state[3], d), active);
+		state[4] = _mm256_blendv_epi8(state[4], _mm256_add_epi32(state[4], e), active);
+	}
+
+	TORRENT_TARGET("avx2")
+	void sha1_multi_avx2(span<span<char const> const> msgs, span<sha1_hash> out)
+	{
+		constexpr int num_lanes = 8;
+
+		alignas(32) std::uint8_t blocks[num_lanes * 64] = {};
+		alignas(32) std::uint32_t digests[5][num_lanes];
+
+		for (std::ptrdiff_t first = 0; first < msgs.size(); first += num_lanes)
+		{
+			int const n = int(std::min(std::ptrdiff_t(num_lanes), msgs.size() - first));
+
+			std::size_t lane_blocks[num_lanes] = {};
+			std::size_t max_blocks = 0;
+			for (int i = 0; i < n; ++i)
+			{
+				lane_blocks[i] = num_blocks(std::size_t(msgs[first + i].size()));
+				max_blocks = std::max(max_blocks, lane_blocks[i]);
+			}
+
+			__m256i state[5];
+			for (int i = 0; i < 5; ++i)
+				state[i] = _mm256_set1_epi32(int(sha1_init[i]));
+
+			for (std::size_t b = 0; b < max_blocks; ++b)
+			{
+				alignas(32) std::int32_t mask[num_lanes] = {};
+				for (int i = 0; i < n; ++i)
+				{
+					if (b >= lane_blocks[i]) continue;
+					padded_block(msgs[first + i], b, blocks + i * 64);
+					mask[i] = -1;
+				}
+				sha1_avx2_block(state, blocks
+					, _mm256_load_si256(reinterpret_cast<__m256i const*>(mask)));
+			}
+
+			for (int i = 0; i < 5; ++i)
+				_mm256_store_si256(reinterpret_cast<__m256i*>(digests[i]), state[i]);
+
+			for (int i = 0; i < n; ++i)
+			{
+				std::uint32_t const s[5] = { digests[0][i], digests[1][i]
+					, digests[2][i], digests[3][i], digests[4][i] };
+				out[first + i] = to_digest(s);
+			}
+		}
+	}
+
+	// 4 rounds of the SHA extensions code. ``cur`` holds the schedule words
+	// of this group, the other three registers are advanced for the groups
+	// to come.
+#define TORRENT_SHA1_ROUNDS(e_cur, e_next, cur, next, after, prep, func) \
+	e_cur = _mm_sha1nexte_epu32(e_cur, cur); \
+	e_next = abcd; \
+	next = _mm_sha1msg2_epu32(next, cur); \
+	abcd = _mm_sha1rnds4_epu32(abcd, e_cur, func); \
+	prep = _mm_sha1msg1_epu32(prep, cur); \
+	after = _mm_xor_si128(after, cur)
+
+	TORRENT_TARGET("sha,sse4.1,ssse3")
+	void sha1_shani_blocks(std::uint32_t* state, std::uint8_t const* data, std::size_t n)
+	{
+		__m128i const bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+		__m128i abcd = _mm_shuffle_epi32(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(state)), 0x1b);
+		__m128i e0 = _mm_set_epi32(int(state[4]), 0, 0, 0);
+		__m128i e1;
+
+		for (; n > 0; --n, data += 64)
+		{
+			__m128i const abcd_save = abcd;
+			__m128i const e0_save = e0;
+
+			__m128i m0 = _mm_shuffle_epi8(
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(data)), bswap);
+			__m128i m1 = _mm_shuffle_epi8(
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + 16)), bswap);
+			__m128i m2 = _mm_shuffle_epi8(
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + 32)), bswap);
+			__m128i m3 = _mm_shuffle_epi8(
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + 48)), bswap);
+
+			// rounds 0-11, before the schedule is in full swing
+			e0 = _mm_add_epi32(e0, m0);
+			e1 = abcd;
+			abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+			e1 = _mm_sha1nexte_epu32(e1, m1);
+			e0 = abcd;
+			abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+			m0 = _mm_sha1msg1_epu32(m0, m1);
+
+			e0 = _mm_sha1nexte_epu32(e0, m2);
+			e1 = abcd;
+			abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+			m1 = _mm_sha1msg1_epu32(m1, m2);
+			m0 = _mm_xor_si128(m0, m2);
+
+			// rounds 12-75
+			TORRENT_SHA1_ROUNDS(e1, e0, m3, m0, m1, m2, 0);
+			TORRENT_SHA1_ROUNDS(e0, e1, m0, m1, m2, m3, 0);
+			TORRENT_SHA1_ROUNDS(e1, e0, m1, m2, m3, m0, 1);
+			TORRENT_SHA1_ROUNDS(e0, e1, m2, m3, m0, m1, 1);
+			TORRENT_SHA1_ROUNDS(e1, e0, m3, m0, m1, m2, 1);
+			TORRENT_SHA1_ROUNDS(e0, e1, m0, m1, m2, m3, 1);
+			TORRENT_SHA1_ROUNDS(e1, e0, m1, m2, m3, m0, 1);
+			TORRENT_SHA1_ROUNDS(e0, e1, m2, m3, m0, m1, 2);
+			TORRENT_SHA1_ROUNDS(e1, e0, m3, m0, m1, m2, 2);
+			TORRENT_SHA1_ROUNDS(e0, e1, m0, m1, m2, m3, 2);
+			TORRENT_SHA1_ROUNDS(e1, e0, m1, m2, m3, m0, 2);
+			TORRENT_SHA1_ROUNDS(e0, e1, m2, m3, m0, m1, 2);
+			TORRENT_SHA1_ROUNDS(e1, e0, m3, m0, m1, m2, 3);
+			TORRENT_SHA1_ROUNDS(e0, e1, m0, m1, m2, m3, 3);
+			TORRENT_SHA1_ROUNDS(e1, e0, m1, m2, m3, m0, 3);
+			TORRENT_SHA1_ROUNDS(e0, e1, m2, m3, m0, m1, 3);
+
+			// rounds 76-79
+			e1 = _mm_sha1nexte_epu32(e1, m3);
+			e0 = abcd;
+			abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+			e0 = _mm_sha1nexte_epu32(e0, e0_save);
+			abcd = _mm_add_epi32(abcd, abcd_save);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+		state[4] = std::uint32_t(_mm_extract_epi32(e0, 3));
+	}
+
+#undef TORRENT_SHA1_ROUNDS
+
+	void sha1_multi_shani(span<span<char const> const> msgs, span<sha1_hash> out)
+	{
+		std::uint8_t tail[128];
+		for (std::ptrdiff_t i = 0; i < msgs.size(); ++i)
+		{
+			span<char const> const m = msgs[i];
+			std::size_t const len = std::size_t(m.size());
+			std::size_t const blocks = num_blocks(len);
+
+			std::uint32_t state[5];
+			std::copy(std::begin(sha1_init), std::end(sha1_init), state);
+
+			// the whole blocks straight from the message, the padded ones
+			// (one or two) from a copy
+			std::size_t const whole = len / 64;
+			sha1_shani_blocks(state, reinterpret_cast<std::uint8_t const*>(m.data()), whole);
+			for (std::size_t b = whole; b < blocks; ++b)
+				padded_block(m, b, tail + (b - whole) * 64);
+			sha1_shani_blocks(state, tail, blocks - whole);
+
+			out[i] = to_digest(state);
+		}
+	}
+
+#endif // TORRENT_HAS_SHA1_MULTI_X86
+
+} // anonymous namespace
+
+	sha1_multi_impl sha1_multi_best()
+	{
+		if (sha1_multi_supported(sha1_multi_impl::sha_ni)) return sha1_multi_impl::sha_ni;
+		if (sha1_multi_supported(sha1_multi_impl::avx2)) return sha1_multi_impl::avx2;
+		return sha1_multi_impl::scalar;
+	}
+
+	bool sha1_multi_supported(sha1_multi_impl const impl)
+	{
+		switch (impl)
+		{
+			case sha1_multi_impl::scalar: return true;
+#if TORRENT_HAS_SHA1_MULTI_X86
+			case sha1_multi_impl::avx2: return aux::avx2_support;
+			case sha1_multi_impl::sha_ni: return aux::sha_ni_support;
+#else
+			case sha1_multi_impl::avx2: return false;
+			case sha1_multi_impl::sha_ni: return false;
+#endif
+		}
+		return false;
+	}
+
+	void sha1_multi(span<span<char const> const> msgs
+		, span<sha1_hash> out, sha1_multi_impl const impl)
+	{
+		TORRENT_ASSERT(out.size() >= msgs.size());
+
+		if (!sha1_multi_supported(impl))
+		{
+			sha1_multi_scalar(msgs, out);
+			return;
+		}
+
+		switch (impl)
+		{
+#if TORRENT_HAS_SHA1_MULTI_X86
+			case sha1_multi_impl::avx2:
+				sha1_multi_avx2(msgs, out);
+				return;
+			case sha1_multi_impl::sha_ni:
+				sha1_multi_shani(msgs, out);
+				return;
+#endif
+			default:
+				sha1_multi_scalar(msgs, out);
+				return;
+		}
+	}
+}
@@ -11,6 +11,7 @@ see LICENSE file.
 
 #include "ip2/aux_/session_interface.hpp"
 #ifndef TORRENT_DISABLE_LOGGING
+#include "ip2/hasher.hpp"
 #include "ip2/hex.hpp" // to_hex
 #endif
 #include "ip2/error_code.hpp"
@@ -140,7 +141,7 @@ api::error_code transporter::get(dht::public_key const& key
 	return api::NO_ERROR;
 }
 
-api::error_code transporter::put(entry const& data
+api::error_code transporter::put(entry data
 	, std::string salt
 	, std::function<void(dht::item const&, int)> cb
 	, std::int8_t invoke_branch
@@ -162,24 +163,152 @@ api::error_code transporter::put(entry const& data
 		, hex_salt, invoke_window, invoke_limit, (int)m_rpc_queue.size());
 #endif
 
-	std::shared_ptr<put_ctx> ctx = std::make_shared<put_ctx>(data, salt
+	std::shared_ptr<put_ctx> ctx = std::make_shared<put_ctx>(std::move(data), salt
 		, invoke_branch, invoke_window, invoke_limit);
 	std::function<void(dht::item const&, int responses)> callback
 		= std::bind(&transporter::put_callback, this, _1, _2, ctx, cb);
 
-	void (dht_tracker::*put)(entry const& data
-		, std::function<void(dht::item const&, int)> cb
-		, std::int8_t alpha, std::int8_t invoke_window, std::int8_t invoke_limit
-		, std::string salt) = &dht_tracker::put_item;
-
-	rpc_method method = std::bind(put, m_session.dht()->self()
-		, ctx->m_data, std::move(callback)
+	// the callback holds ctx, so data referenced here outlives the method
+	rpc_method method = std::bind(&dht_tracker::put_index, m_session.dht()->self()
+		, std::cref(ctx->m_data), std::move(callback)
 		, invoke_branch, invoke_window, invoke_limit, ctx->m_salt);
 	m_rpc_queue.push(rpc(std::move(method)));
 
 	return api::NO_ERROR;
 }
 
+api::error_code transporter::get_segment(sha1_hash const& seg_hash
+	, std::function<void(dht::item const&, bool)> cb
+	, std::int8_t invoke_branch
+	, std::int8_t invoke_window
+	, std::int8_t invoke_limit)
+{
+	if (!m_running) return api::TRANSPORT_STOPPED;
+	if (m_rpc_queue.size() >= (long)m_settings.get_int(
+		settings_pack::transport_invoking_queue_max_size))
+	{
+		return api::TRANSPORT_BUFFER_FULL;
+	}
+
+#ifndef TORRENT_DISABLE_LOGGING
+	log(aux::LOG_INFO, "enqueue get segment req [h:%s, window:%d, limit:%d, qs:%d]"
+		, aux::to_hex(seg_hash).c_str(), invoke_window, invoke_limit
+		, (int)m_rpc_queue.size());
+#endif
+
+	std::shared_ptr<get_ctx> ctx = std::make_shared<get_ctx>(dht::public_key()
+		, seg_hash.to_string(), 0, invoke_branch, invoke_window, invoke_limit);
+	std::function<void(dht::item const&, bool)> callback
+		= std::bind(&transporter::get_callback, this, _1, _2, ctx, cb);
+
+	rpc_method method = std::bind(&dht_tracker::get_segment, m_session.dht()->self()
+		, seg_hash, std::move(callback)
+		, invoke_branch, invoke_window, invoke_limit);
+	m_rpc_queue.push(rpc(std::move(method)));
+
+	return api::NO_ERROR;
+}
+
+api::error_code transporter::get_from_origin(dht::public_key const& key
+	, std::string salt
+	, std::int64_t timestamp
+	, std::function<void(dht::item const&, bool)> cb)
+{
+	if (!m_running) return api::TRANSPORT_STOPPED;
+	if (m_rpc_queue.size() >= (long)m_settings.get_int(
+		settings_pack::transport_invoking_queue_max_size))
+	{
+		return api::TRANSPORT_BUFFER_FULL;
+	}
+
+#ifndef TORRENT_DISABLE_LOGGING
+	char hex_key[65];
+	char hex_salt[129]; // 64*2 + 1
+	aux::to_hex(key.bytes, hex_key);
+	aux::to_hex(salt, hex_salt);
+	log(aux::LOG_INFO, "enqueue get from origin req for [k:%s, s:%s, qs:%d]"
+		, hex_key, hex_salt, (int)m_rpc_queue.size());
+#endif
+
+	std::shared_ptr<get_ctx> ctx = std::make_shared<get_ctx>(key, salt, timestamp
+		, 1, 1, 1);
+	std::function<void(dht::item const&, bool)> callback
+		= std::bind(&transporter::get_callback, this, _1, _2, ctx, cb);
+
+	rpc_method method = std::bind(&dht_tracker::get_item_from_origin
+		, m_session.dht()->self(), ctx->m_pubkey, std::move(callback)
+		, ctx->m_salt, ctx->m_timestamp);
+	m_rpc_queue.push(rpc(std::move(method)));
+
+	return api::NO_ERROR;
+}
+
+api::error_code transporter::get_segment_from_origin(dht::public_key const& origin
+	, sha1_hash const& seg_hash
+	, std::function<void(dht::item const&, bool)> cb)
+{
+	if (!m_running) return api::TRANSPORT_STOPPED;
+	if (m_rpc_queue.size() >= (long)m_settings.get_int(
+		settings_pack::transport_invoking_queue_max_size))
+	{
+		return api::TRANSPORT_BUFFER_FULL;
+	}
+
+#ifndef TORRENT_DISABLE_LOGGING
+	log(aux::LOG_INFO, "enqueue get segment from origin req [h:%s, qs:%d]"
+		, aux::to_hex(seg_hash).c_str(), (int)m_rpc_queue.size());
+#endif
+
+	std::shared_ptr<get_ctx> ctx = std::make_shared<get_ctx>(origin
+		, seg_hash.to_string(), 0, 1, 1, 1);
+	std::function<void(dht::item const&, bool)> callback
+		= std::bind(&transporter::get_callback, this, _1, _2, ctx, cb);
+
+	rpc_method method = std::bind(&dht_tracker::get_segment_from_origin
+		, m_session.dht()->self(), origin, seg_hash, std::move(callback));
+	m_rpc_queue.push(rpc(std::move(method)));
+
+	return api::NO_ERROR;
+}
+
+api::error_code transporter::put_segment(entry data
+	, std::function<void(dht::item const&, int)> cb
+	, std::int8_t invoke_branch
+	, std::int8_t invoke_window
+	, std::int8_t invoke_limit)
+{
+	TORRENT_ASSERT(data.type() == entry::string_t);
+
+	if (!m_running) return api::TRANSPORT_STOPPED;
+	if (m_rpc_queue.size() >= (long)m_settings.get_int(
+		settings_pack::transport_invoking_queue_max_size))
+	{
+		return api::TRANSPORT_BUFFER_FULL;
+	}
+
+	sha1_hash const seg_hash = hasher(data.string()).final();
+
+#ifndef TORRENT_DISABLE_LOGGING
+	log(aux::LOG_INFO
+		, "enqueue put segment req [h:%s, window:%d, limit:%d, qs:%d]"
+		, aux::to_hex(seg_hash).c_str(), invoke_window, invoke_limit
+		, (int)m_rpc_queue.size());
+#endif
+
+	std::shared_ptr<put_ctx> ctx = std::make_shared<put_ctx>(std::move(data)
+		, seg_hash.to_string(), invoke_branch, invoke_window, invoke_limit);
+	std::function<void(dht::item const&, int responses)> callback
+		= std::bind(&transporter::put_callback, this, _1, _2, ctx, cb);
+
+	// the callback holds ctx, so data referenced here outlives the method
+	rpc_method method = std::bind(&dht_tracker::put_segment, m_session.dht()->self()
+		, std::cref(ctx->m_data), std::move(callback)
+		, invoke_branch, invoke_window, invoke_limit);
+	m_rpc_queue.push(rpc(std::move(method)));
+
+	return api::NO_ERROR;
+}
+
 api::error_code transporter::send(dht::public_key const& to
 	, entry const& payload
 	, std::function<void(entry const& payload
@@ -0,0 +1,170 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "test.hpp"
+#include "ip2/time.hpp"
+#include "ip2/kademlia/egress_shaper.hpp"
+
+#include <vector>
+
+using namespace lt;
+
+#ifndef TORRENT_DISABLE_DHT
+using namespace lt::dht;
+
+namespace {
+
+using admission = egress_shaper::admission;
+
+// admits a packet, queueing it if needed, and records the order packets are
+// actually sent in
+void send(egress_shaper& s, egress_class const tc, int const bytes
+	, time_point const now, std::vector<int>& sent, int const id)
+{
+	switch (s.admit(tc, bytes, now))
+	{
+		case admission::send_now: sent.push_back(id); break;
+		case admission::queue: s.enqueue(tc, bytes, [&sent, id] { sent.push_back(id); }); break;
+		case admission::drop: break;
+	}
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(unlimited)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		TEST_CHECK(s.admit(egress_class::relay_forward, 1000, now) == admission::send_now);
+	}
+	TEST_CHECK(s.has_quota(now));
+	TEST_CHECK(s.drain(now) == time_duration::zero());
+}
+
+TORRENT_TEST(requests_never_held_back)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+	s.set_rate(1000);
+	now += seconds(1);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		TEST_CHECK(s.admit(egress_class::request, 1000, now) == admission::send_now);
+		TEST_CHECK(s.admit(egress_class::response, 1000, now) == admission::send_now);
+	}
+	TEST_CHECK(!s.has_quota(now));
+
+	// the budget is used up, pushes have to wait
+	TEST_CHECK(s.admit(egress_class::push, 100, now) == admission::queue);
+}
+
+TORRENT_TEST(strict_priority)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+	s.set_rate(1000);
+	now += seconds(1);
+
+	std::vector<int> sent;
+
+	// uses up the bucket
+	send(s, egress_class::request, 1000, now, sent, 0);
+
+	send(s, egress_class::relay_forward, 500, now, sent, 1);
+	send(s, egress_class::push, 500, now, sent, 2);
+	send(s, egress_class::bulk, 500, now, sent, 3);
+	send(s, egress_class::bulk, 500, now, sent, 4);
+	TEST_EQUAL(int(sent.size()), 1);
+	TEST_EQUAL(s.queued_bytes(egress_class::bulk), 1000);
+
+	// a few tokens buy one packet, the highest priority one
+	now += milliseconds(300);
+	TEST_CHECK(s.drain(now) > time_duration::zero());
+	TEST_CHECK((sent == std::vector<int>{0, 3}));
+
+	for (int i = 0; i < 10; ++i)
+	{
+		now += seconds(1);
+		if (s.drain(now) == time_duration::zero()) break;
+	}
+	TEST_CHECK((sent == std::vector<int>{0, 3, 4, 2, 1}));
+}
+
+TORRENT_TEST(no_overtaking)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+	s.set_rate(1000);
+	now += seconds(1);
+
+	std::vector<int> sent;
+	send(s, egress_class::request, 1000, now, sent, 0);
+	send(s, egress_class::push, 100, now, sent, 1);
+
+	// there are tokens again, but a push is still queued
+	now += milliseconds(200);
+	TEST_CHECK(s.admit(egress_class::push, 100, now) == admission::queue);
+	TEST_CHECK(s.admit(egress_class::relay_forward, 100, now) == admission::queue);
+
+	// a higher priority class may go first
+	send(s, egress_class::bulk, 100, now, sent, 2);
+	TEST_CHECK((sent == std::vector<int>{0, 2}));
+}
+
+TORRENT_TEST(queue_limit)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+	s.set_rate(1000);
+	now += seconds(1);
+
+	std::vector<int> sent;
+	send(s, egress_class::request, 1000, now, sent, 0);
+
+	int queued = 0;
+	for (int i = 0; i < 100; ++i)
+	{
+		if (s.admit(egress_class::relay_forward, 1000, now) != admission::queue) break;
+		s.enqueue(egress_class::relay_forward, 1000, [] {});
+		++queued;
+	}
+	TEST_CHECK(queued > 0);
+	TEST_CHECK(queued < 100);
+	TEST_CHECK(s.admit(egress_class::relay_forward, 1000, now) == admission::drop);
+
+	// other classes have queues of their own
+	TEST_CHECK(s.admit(egress_class::push, 1000, now) == admission::queue);
+
+	s.clear();
+	TEST_EQUAL(s.queued_bytes(egress_class::relay_forward), 0);
+}
+
+TORRENT_TEST(rate_int_max)
+{
+	time_point now = clock_type::now();
+	egress_shaper s(now);
+	s.set_rate(std::numeric_limits<int>::max());
+
+	now += hours(10);
+	TEST_CHECK(s.has_quota(now));
+	now += milliseconds(1500);
+	TEST_CHECK(s.has_quota(now));
+}
+
+#else
+TORRENT_TEST(dht)
+{
+	// dummy dht test
+	TEST_CHECK(true);
+}
+#endif
@@ -0,0 +1,337 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "test.hpp"
+#include "ip2/kademlia/item_log.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace lt;
+
+#ifndef TORRENT_DISABLE_DHT
+using namespace lt::dht;
+
+namespace {
+
+char const* const log_path = "test_item_log.dat";
+
+sha256_hash make_target(char const c)
+{
+	sha256_hash ret;
+	ret[0] = std::uint8_t(c);
+	ret[31] = 0xab;
+	return ret;
+}
+
+span<char const> str(char const* s)
+{
+	return {s, std::ptrdiff_t(std::strlen(s))};
+}
+
+std::string value_of(item_log::record const& r)
+{
+	return std::string(r.value.data(), std::size_t(r.value.size()));
+}
+
+void remove_log()
+{
+	std::error_code ec;
+	std::filesystem::remove(log_path, ec);
+	std::filesystem::remove(std::string(log_path) + ".tmp", ec);
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(reopen)
+{
+	remove_log();
+
+	public_key pk;
+	pk.bytes.fill(0x11);
+	signature sig;
+	sig.bytes.fill(0x22);
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		TEST_CHECK(!ec);
+		TEST_EQUAL(log.num_indexed(), 0);
+
+		log.append_immutable(make_target('a'), str("5:hello"));
+		log.append_mutable(make_target('b'), str("1:x"), sig, timestamp(1), pk, str("salt"));
+		log.append_mutable(make_target('b'), str("1:y"), sig, timestamp(2), pk, str("salt"));
+		log.append_immutable(make_target('c'), str("3:bye"));
+		log.append_removed(make_target('c'));
+
+		// records appended are not indexed until the log is opened again
+		item_log::record r;
+		TEST_CHECK(!log.find(make_target('a'), r));
+	}
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(log.num_indexed(), 2);
+
+	item_log::record r;
+	TEST_CHECK(log.find(make_target('a'), r));
+	TEST_CHECK(r.type == item_log::kind::immutable_item);
+	TEST_EQUAL(value_of(r), "5:hello");
+
+	// the latest version of a mutable item wins
+	TEST_CHECK(log.find(make_target('b'), r));
+	TEST_CHECK(r.type == item_log::kind::mutable_item);
+	TEST_EQUAL(value_of(r), "1:y");
+	TEST_CHECK(r.ts == timestamp(2));
+	TEST_CHECK(r.pk == pk);
+	TEST_CHECK(r.sig == sig);
+	TEST_EQUAL(std::string(r.salt.data(), std::size_t(r.salt.size())), "salt");
+
+	TEST_CHECK(!log.find(make_target('c'), r));
+
+	log.forget(make_target('a'));
+	TEST_CHECK(!log.find(make_target('a'), r));
+
+	log.close();
+	remove_log();
+}
+
+TORRENT_TEST(torn_tail)
+{
+	remove_log();
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		TEST_CHECK(!ec);
+		log.append_immutable(make_target('a'), str("1:a"));
+		log.append_immutable(make_target('b'), str("1:b"));
+	}
+
+	// cut the last record short, as if we crashed while writing it
+	auto const size = std::filesystem::file_size(log_path);
+	std::filesystem::resize_file(log_path, size - 2);
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		TEST_CHECK(!ec);
+		TEST_EQUAL(log.num_indexed(), 1);
+
+		item_log::record r;
+		TEST_CHECK(log.find(make_target('a'), r));
+		TEST_CHECK(!log.find(make_target('b'), r));
+
+		// appending after the torn record was cut off works
+		log.append_immutable(make_target('c'), str("1:c"));
+	}
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(log.num_indexed(), 2);
+
+	item_log::record r;
+	TEST_CHECK(log.find(make_target('c'), r));
+	TEST_EQUAL(value_of(r), "1:c");
+
+	log.close();
+	remove_log();
+}
+
+TORRENT_TEST(bad_record)
+{
+	remove_log();
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		TEST_CHECK(!ec);
+		log.append_immutable(make_target('a'), str("1:a"));
+		log.append_immutable(make_target('b'), str("1:b"));
+		log.append_immutable(make_target('c'), str("1:c"));
+	}
+
+	// flip the last byte of b's value
+	{
+		std::FILE* f = std::fopen(log_path, "rb+");
+		TEST_CHECK(f != nullptr);
+		std::fseek(f, 8 + 2 * (8 + 33 + 3) - 1, SEEK_SET);
+		std::fputc('x', f);
+		std::fclose(f);
+	}
+	auto const size = std::filesystem::file_size(log_path);
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(!ec);
+
+	// the bad record is stepped over, not cut off with what follows it
+	item_log::record r;
+	TEST_CHECK(log.find(make_target('a'), r));
+	TEST_CHECK(!log.find(make_target('b'), r));
+	TEST_CHECK(log.find(make_target('c'), r));
+	TEST_EQUAL(value_of(r), "1:c");
+	TEST_EQUAL(std::filesystem::file_size(log_path), size);
+
+	log.close();
+	remove_log();
+}
+
+TORRENT_TEST(not_a_log)
+{
+	remove_log();
+
+	std::FILE* f = std::fopen(log_path, "wb");
+	TEST_CHECK(f != nullptr);
+	std::fputs("garbage garbage", f);
+	std::fclose(f);
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(ec);
+	TEST_CHECK(!log.is_open());
+
+	remove_log();
+}
+
+TORRENT_TEST(compact)
+{
+	remove_log();
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		for (char c = 'a'; c <= 'j'; ++c)
+		{
+			log.append_immutable(make_target(c), str("3:old"));
+			log.append_immutable(make_target(c), str("3:new"));
+		}
+	}
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(log.num_indexed(), 10);
+	auto const before = std::filesystem::file_size(log_path);
+
+	// keep 3 of the indexed items and add one the storage has in memory
+	int kept = 0;
+	log.compact([&](item_log::record const&) { return kept++ < 3; }
+		, [](item_log& out) { out.append_immutable(make_target('z'), str("4:live")); }
+		, ec);
+	TEST_CHECK(!ec);
+	TEST_CHECK(log.is_open());
+	TEST_EQUAL(log.num_indexed(), 4);
+	TEST_CHECK(std::filesystem::file_size(log_path) < before);
+	TEST_CHECK(!std::filesystem::exists(std::string(log_path) + ".tmp"));
+
+	item_log::record r;
+	TEST_CHECK(log.find(make_target('a'), r));
+	TEST_EQUAL(value_of(r), "3:new");
+	TEST_CHECK(log.find(make_target('z'), r));
+	TEST_EQUAL(value_of(r), "4:live");
+	TEST_CHECK(!log.find(make_target('j'), r));
+
+	std::vector<sha256_hash> targets;
+	log.targets_with_prefix(make_target('a'), 1, targets);
+	TEST_EQUAL(targets.size(), 1);
+
+	log.close();
+	remove_log();
+}
+
+TORRENT_TEST(compact_in_steps)
+{
+	remove_log();
+
+	{
+		item_log log;
+		error_code ec;
+		log.open(log_path, ec);
+		for (char c = 'a'; c <= 'j'; ++c)
+		{
+			log.append_immutable(make_target(c), str("3:old"));
+			log.append_immutable(make_target(c), str("3:new"));
+		}
+	}
+
+	item_log log;
+	error_code ec;
+	log.open(log_path, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(log.num_indexed(), 10);
+	TEST_EQUAL(log.stale_bytes(), 10 * (8 + 33 + 5));
+
+	log.start_compact(ec);
+	TEST_CHECK(!ec);
+	TEST_CHECK(log.is_compacting());
+
+	auto const keep_all = [](item_log::record const&) { return true; };
+	auto const write_live = [](item_log& out)
+	{ out.append_immutable(make_target('z'), str("4:live")); };
+
+	// one record per step
+	TEST_CHECK(!log.compact_step(keep_all, write_live, 1, ec));
+	TEST_CHECK(!log.compact_step(keep_all, write_live, 1, ec));
+
+	// removed after it was copied, and before
+	log.append_removed(make_target('a'));
+	log.forget(make_target('a'));
+	log.append_removed(make_target('h'));
+	log.forget(make_target('h'));
+
+	int steps = 0;
+	while (!log.compact_step(keep_all, write_live, 1, ec)) ++steps;
+	TEST_EQUAL(steps, 6);
+	TEST_CHECK(!ec);
+	TEST_CHECK(!log.is_compacting());
+	TEST_CHECK(!std::filesystem::exists(std::string(log_path) + ".tmp"));
+	TEST_EQUAL(log.num_indexed(), 9);
+	// a's copy and the two removals
+	TEST_EQUAL(log.stale_bytes(), (8 + 33 + 5) + 2 * (8 + 33));
+
+	item_log::record r;
+	TEST_CHECK(!log.find(make_target('a'), r));
+	TEST_CHECK(!log.find(make_target('h'), r));
+	TEST_CHECK(log.find(make_target('b'), r));
+	TEST_EQUAL(value_of(r), "3:new");
+	TEST_CHECK(log.find(make_target('z'), r));
+	TEST_EQUAL(value_of(r), "4:live");
+
+	// closing drops a compaction that's not done
+	log.start_compact(ec);
+	TEST_CHECK(std::filesystem::exists(std::string(log_path) + ".tmp"));
+	log.close();
+	TEST_CHECK(!std::filesystem::exists(std::string(log_path) + ".tmp"));
+
+	remove_log();
+}
+
+#else
+TORRENT_TEST(dht)
+{
+	// dummy dht test
+	TEST_CHECK(true);
+}
+#endif
@@ -0,0 +1,100 @@
+/*
+
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "test.hpp"
+#include "ip2/time.hpp"
+#include "ip2/address.hpp"
+#include "ip2/kademlia/peer_endpoints.hpp"
+
+using namespace lt;
+
+#ifndef TORRENT_DISABLE_DHT
+using namespace lt::dht;
+
+namespace {
+
+node_id make_id(int const i)
+{
+	node_id ret;
+	ret[0] = std::uint8_t(i >> 8);
+	ret[1] = std::uint8_t(i);
+	return ret;
+}
+
+udp::endpoint make_ep(int const port)
+{
+	return udp::endpoint(make_address_v4("10.0.0.1"), std::uint16_t(port));
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(seen_and_expired)
+{
+	time_point now = clock_type::now();
+	peer_endpoints pe(seconds(60));
+
+	udp::endpoint ep;
+	TEST_CHECK(!pe.find(make_id(1), ep, now));
+
+	pe.seen(make_id(1), make_ep(1000), now);
+	TEST_CHECK(pe.find(make_id(1), ep, now));
+	TEST_CHECK(ep == make_ep(1000));
+
+	// the latest endpoint wins
+	now += seconds(30);
+	pe.seen(make_id(1), make_ep(2000), now);
+	TEST_CHECK(pe.find(make_id(1), ep, now + seconds(50)));
+	TEST_CHECK(ep == make_ep(2000));
+
+	now += seconds(61);
+	TEST_CHECK(!pe.find(make_id(1), ep, now));
+	TEST_EQUAL(pe.size(), 1);
+	pe.tick(now);
+	TEST_EQUAL(pe.size(), 0);
+}
+
+TORRENT_TEST(erase)
+{
+	time_point const now = clock_type::now();
+	peer_endpoints pe;
+
+	pe.seen(make_id(1), make_ep(1000), now);
+	pe.erase(make_id(1));
+
+	udp::endpoint ep;
+	TEST_CHECK(!pe.find(make_id(1), ep, now));
+}
+
+TORRENT_TEST(bounded)
+{
+	time_point now = clock_type::now();
+	peer_endpoints pe;
+
+	for (int i = 0; i < peer_endpoints::max_size + 10; ++i)
+	{
+		pe.seen(make_id(i), make_ep(1000 + i), now);
+		now += milliseconds(1);
+	}
+	TEST_EQUAL(pe.size(), peer_endpoints::max_size);
+
+	// the peers heard from least recently made room
+	udp::endpoint ep;
+	TEST_CHECK(!pe.find(make_id(0), ep, now));
+	TEST_CHECK(!pe.find(make_id(9), ep, now));
+	TEST_CHECK(pe.find(make_id(10), ep, now));
+	TEST_CHECK(pe.find(make_id(peer_endpoints::max_size + 9), ep, now));
+}
+
+#else
+TORRENT_TEST(dht)
+{
+	// dummy dht test
+	TEST_CHECK(true);
+}
+#endif
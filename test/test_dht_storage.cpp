@@ -313,6 +313,96 @@ TORRENT_TEST(mutable_item_limit)
 	TEST_EQUAL(cnt.mutable_data, 42);
 }
 
+TORRENT_TEST(mutable_items_by_prefix)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_dht_items, 100);
+	std::unique_ptr<dht_storage_interface> s(create_default_dht_storage(sett));
+
+	public_key pk;
+	signature sig;
+	std::vector<sha256_hash> targets;
+	for (int i = 0; i < 10; ++i)
+	{
+		// 5 items under each of two prefixes, put out of order
+		sha256_hash t;
+		t[0] = std::uint8_t(i % 2 == 0 ? 0x10 : 0x20);
+		t[1] = std::uint8_t(9 - i);
+		s->put_mutable_item(t, {"3:abc", 5}, sig, timestamp(1), pk
+			, {"salt", 4}, addr("124.31.75.21"));
+		if (i % 2 == 0) targets.push_back(t);
+	}
+	std::sort(targets.begin(), targets.end());
+
+	sha256_hash prefix;
+	prefix[0] = 0x10;
+
+	entry::list_type items;
+	TEST_CHECK(!s->get_mutable_items(prefix, 1, nullptr, 10000, items));
+	TEST_EQUAL(items.size(), 5);
+	for (auto const& i : items)
+	{
+		TEST_EQUAL(i["v"].string(), "abc");
+		TEST_EQUAL(i["salt"].string(), "salt");
+		TEST_EQUAL(i["ts"].integer(), 1);
+	}
+
+	// a small budget still returns one item, and says there are more
+	items.clear();
+	TEST_CHECK(s->get_mutable_items(prefix, 1, nullptr, 1, items));
+	TEST_EQUAL(items.size(), 1);
+
+	// paging with after picks up where the last page stopped
+	items.clear();
+	TEST_CHECK(!s->get_mutable_items(prefix, 1, &targets[2], 10000, items));
+	TEST_EQUAL(items.size(), 2);
+
+	prefix[0] = 0x30;
+	items.clear();
+	TEST_CHECK(!s->get_mutable_items(prefix, 1, nullptr, 10000, items));
+	TEST_CHECK(items.empty());
+}
+
+TORRENT_TEST(origin_item_limit)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_dht_items, 2);
+	std::unique_ptr<dht_storage_interface> s(create_default_dht_storage(sett));
+
+	public_key pk;
+	signature sig;
+	sha256_hash const index = rand_hash();
+	sha256_hash const seg1 = rand_hash();
+	sha256_hash const seg2 = rand_hash();
+
+	s->put_origin_item(index, {"3:abc", 5}, sig, timestamp(1), pk, {"salt", 4});
+	s->put_origin_item(seg1, {"3:def", 5});
+
+	// putting the index again keeps it, the least recently put is dropped
+	s->put_origin_item(index, {"3:ghi", 5}, sig, timestamp(2), pk, {"salt", 4});
+	s->put_origin_item(seg2, {"3:jkl", 5});
+
+	entry e;
+	TEST_CHECK(!s->get_origin_item(seg1, e));
+
+	TEST_CHECK(s->get_origin_item(index, e));
+	TEST_EQUAL(e["v"].string(), "ghi");
+	TEST_EQUAL(e["ts"].integer(), 2);
+	TEST_EQUAL(e["salt"].string(), "salt");
+
+	// a segment has only a value
+	entry seg;
+	TEST_CHECK(s->get_origin_item(seg2, seg));
+	TEST_EQUAL(seg["v"].string(), "jkl");
+	TEST_CHECK(seg.find_key("k") == nullptr);
+
+	// an older index doesn't replace the newer one
+	s->put_origin_item(index, {"3:old", 5}, sig, timestamp(1), pk, {"salt", 4});
+	entry e2;
+	TEST_CHECK(s->get_origin_item(index, e2));
+	TEST_EQUAL(e2["v"].string(), "ghi");
+}
+
 TORRENT_TEST(get_peers_dist)
 {
 	// test that get_peers returns reasonably disjoint sets of peers with each call
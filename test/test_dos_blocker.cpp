@@ -14,9 +14,20 @@ see LICENSE file.
 #include "ip2/time.hpp"
 #include "ip2/kademlia/dos_blocker.hpp"
 #include "ip2/kademlia/dht_observer.hpp"
+#include "ip2/kademlia/dht_tracker.hpp"
+#include "ip2/kademlia/dht_storage.hpp"
+#include "ip2/kademlia/bs_nodes_storage.hpp"
+#include "ip2/aux_/session_settings.hpp"
+#include "ip2/performance_counters.hpp"
+#include "ip2/bencode.hpp"
+#include "ip2/entry.hpp"
 #include "ip2/error_code.hpp"
 #include "ip2/aux_/socket_io.hpp" // for print_endpoint
+#include <algorithm>
 #include <cstdarg>
+#include <iterator>
+#include <memory>
+#include <vector>
 
 using namespace lt;
 
@@ -80,3 +91,262 @@ TORRENT_TEST(dos_blocker)
 #endif
 #endif
 }
+
+#ifndef TORRENT_DISABLE_DHT
+namespace {
+
+lt::address source(int const i)
+{
+	return lt::address_v4(std::uint32_t(0x0a000000 + i));
+}
+
+int const num_sources = 10000;
+
+} // anonymous namespace
+
+TORRENT_TEST(dos_blocker_flood)
+{
+	using namespace lt::dht;
+
+	dos_blocker b;
+	b.set_rate_limit(5);
+
+	// every source sends 100 packets within a second, way over 5 per second
+	std::vector<int> passed(num_sources, 0);
+	time_point now = clock_type::now();
+	for (int round = 0; round < 100; ++round)
+	{
+		for (int i = 0; i < num_sources; ++i)
+		{
+			if (b.incoming(source(i), now, nullptr)) ++passed[std::size_t(i)];
+			now += microseconds(1);
+		}
+	}
+
+	// no source got more than its 10 second budget through, and none of
+	// them is let through now
+	int blocked = 0;
+	for (int i = 0; i < num_sources; ++i)
+	{
+		TEST_CHECK(passed[std::size_t(i)] <= 50);
+		if (!b.incoming(source(i), now, nullptr)) ++blocked;
+	}
+	TEST_EQUAL(blocked, num_sources);
+	TEST_CHECK(b.num_blocked() > 0);
+}
+
+TORRENT_TEST(dos_blocker_spammer_among_many)
+{
+	using namespace lt::dht;
+
+	dos_blocker b;
+	b.set_rate_limit(5);
+
+	address const spammer = make_address_v4("192.168.1.1");
+
+	// every source sends one packet a second, the spammer 100
+	std::vector<bool> dropped(num_sources, false);
+	bool spammer_blocked = false;
+	time_point now = clock_type::now();
+	for (int second = 0; second < 10; ++second)
+	{
+		for (int i = 0; i < num_sources; ++i)
+		{
+			if (!b.incoming(source(i), now, nullptr)) dropped[std::size_t(i)] = true;
+			if (i % 100 == 0 && !b.incoming(spammer, now, nullptr))
+				spammer_blocked = true;
+			now += microseconds(100);
+		}
+	}
+
+	TEST_CHECK(spammer_blocked);
+	TEST_CHECK(!b.incoming(spammer, now, nullptr));
+
+	// hash collisions make a source look busier than it is, but only rarely
+	int const false_positives = int(std::count(dropped.begin(), dropped.end(), true));
+	TEST_CHECK(false_positives < num_sources / 100);
+}
+
+TORRENT_TEST(dos_blocker_relay_budget)
+{
+	using namespace lt::dht;
+
+	dos_blocker b;
+	b.set_rate_limit(5);
+	b.set_relay_rate_limit(5);
+
+	address const relayer = make_address_v4("10.20.30.40");
+
+	time_point now = clock_type::now();
+	for (int i = 0; i < 100; ++i)
+	{
+		b.incoming(relayer, dos_class::relay, now, nullptr);
+		now += milliseconds(1);
+	}
+
+	// relays are blocked, other queries from the same node are not
+	TEST_CHECK(!b.incoming(relayer, dos_class::relay, now, nullptr));
+	TEST_CHECK(b.incoming(relayer, dos_class::query, now, nullptr));
+
+	// the block runs out
+	b.set_block_timer(1);
+	address const other = make_address_v4("10.20.30.41");
+	for (int i = 0; i < 100; ++i)
+	{
+		b.incoming(other, dos_class::relay, now, nullptr);
+		now += milliseconds(1);
+	}
+	TEST_CHECK(!b.incoming(other, dos_class::relay, now, nullptr));
+	now += seconds(30);
+	TEST_CHECK(b.incoming(other, dos_class::relay, now, nullptr));
+}
+
+namespace {
+
+struct tracker_observer : lt::dht::dht_observer
+{
+	void set_external_address(aux::listen_socket_handle const&, address const&
+		, address const&) override {}
+	int get_listen_port(aux::transport, aux::listen_socket_handle const&) override
+	{ return 6881; }
+	void get_peers(sha256_hash const&) override {}
+	void outgoing_get_peers(sha256_hash const&, sha256_hash const&
+		, udp::endpoint const&) override {}
+	void announce(sha256_hash const&, address const&, int) override {}
+	bool on_dht_request(string_view, dht::msg const&, entry&) override
+	{ return false; }
+	void on_dht_item(dht::item&) override {}
+	std::int64_t get_time() override { return 0; }
+	void on_dht_relay(dht::public_key const&, entry const&) override {}
+	sqlite3* get_items_database() override { return nullptr; }
+
+#ifndef TORRENT_DISABLE_LOGGING
+	bool should_log(module_t) const override { return false; }
+	bool should_log(module_t, aux::LOG_LEVEL) const override { return false; }
+	void log(module_t, char const*, ...) override {}
+	void log_packet(message_direction_t, span<char const>
+		, udp::endpoint const&) override {}
+#endif
+};
+
+struct no_bs_nodes : lt::dht::bs_nodes_storage_interface
+{
+	bool put(std::vector<dht::bs_node_entry> const&) override { return true; }
+	bool get(std::vector<dht::bs_node_entry>&, int, int) const override
+	{ return false; }
+	std::size_t size() override { return 0; }
+	std::size_t tick() override { return 0; }
+	void close() override {}
+};
+
+std::vector<char> encode(entry const& e)
+{
+	std::vector<char> buf;
+	bencode(std::back_inserter(buf), e);
+	return buf;
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(dos_blocker_tracker_relay_budget)
+{
+	using namespace lt::dht;
+
+	io_context ios;
+	tracker_observer observer;
+	no_bs_nodes bs_nodes;
+	counters cnt;
+	aux::session_settings sett;
+	sett.set_int(settings_pack::dht_block_ratelimit, 5);
+	sett.set_int(settings_pack::dht_relay_block_ratelimit, 100);
+	auto storage = dht_default_storage_constructor(sett);
+
+	auto dht = std::make_shared<dht_tracker>(&observer, ios
+		, dht_tracker::send_fun_t(), sett, cnt, *storage, dht_state()
+		, nullptr, bs_nodes, ".");
+
+	// a relay, as relay::relay_message() sends it
+	entry relay;
+	relay["y"] = "h";
+	relay["q"] = "relay";
+	relay["a"]["pl"] = std::string(64, 'p');
+	relay["a"]["t"] = std::string(32, 't');
+	relay["a"]["hmac"] = std::string(4, 'h');
+	std::vector<char> const relay_buf = encode(relay);
+
+	entry ping;
+	ping["y"] = "q";
+	ping["q"] = "ping";
+	ping["t"] = "aa";
+	ping["a"]["id"] = std::string(32, 'i');
+	std::vector<char> const ping_buf = encode(ping);
+
+	udp::endpoint const relayer(make_address_v4("10.20.30.40"), 6881);
+	udp::endpoint const pinger(make_address_v4("10.20.30.41"), 6881);
+	aux::listen_socket_handle const s;
+
+	// 200 relays are within the relay budget of 1000 per 10 seconds, but
+	// over the query budget of 50
+	for (int i = 0; i < 200; ++i)
+		dht->incoming_packet(s, relayer, relay_buf, sha256_hash());
+	TEST_EQUAL(cnt[counters::dht_messages_in_dropped], 0);
+
+	// the same number of pings gets the pinger banned, its relays are
+	// dropped too, without being decoded
+	for (int i = 0; i < 200; ++i)
+		dht->incoming_packet(s, pinger, ping_buf, sha256_hash());
+	std::int64_t const dropped = cnt[counters::dht_messages_in_dropped];
+	TEST_CHECK(dropped >= 150);
+	dht->incoming_packet(s, pinger, relay_buf, sha256_hash());
+	TEST_EQUAL(cnt[counters::dht_messages_in_dropped], dropped + 1);
+
+	// the relayer can still send queries
+	dht->incoming_packet(s, relayer, ping_buf, sha256_hash());
+	TEST_EQUAL(cnt[counters::dht_messages_in_dropped], dropped + 1);
+}
+
+TORRENT_TEST(dos_blocker_tracker_garbage_flood)
+{
+	using namespace lt::dht;
+
+	io_context ios;
+	tracker_observer observer;
+	no_bs_nodes bs_nodes;
+	counters cnt;
+	aux::session_settings sett;
+	sett.set_int(settings_pack::dht_block_ratelimit, 5);
+	auto storage = dht_default_storage_constructor(sett);
+
+	auto dht = std::make_shared<dht_tracker>(&observer, ios
+		, dht_tracker::send_fun_t(), sett, cnt, *storage, dht_state()
+		, nullptr, bs_nodes, ".");
+
+	// looks like a dict on the outside, but doesn't decode
+	std::string const garbage = "d" + std::string(40, 'x') + "e";
+
+	entry ping;
+	ping["y"] = "q";
+	ping["q"] = "ping";
+	ping["t"] = "aa";
+	ping["a"]["id"] = std::string(32, 'i');
+	std::vector<char> const ping_buf = encode(ping);
+
+	udp::endpoint const flooder(make_address_v4("10.20.30.42"), 6881);
+	udp::endpoint const pinger(make_address_v4("10.20.30.43"), 6881);
+	aux::listen_socket_handle const s;
+
+	// every garbage packet is dropped, and charged to its source
+	for (int i = 0; i < 200; ++i)
+		dht->incoming_packet(s, flooder, garbage, sha256_hash());
+	std::int64_t const dropped = cnt[counters::dht_messages_in_dropped];
+	TEST_EQUAL(dropped, 200);
+
+	// the flooder is banned, its queries are dropped too
+	dht->incoming_packet(s, flooder, ping_buf, sha256_hash());
+	TEST_EQUAL(cnt[counters::dht_messages_in_dropped], dropped + 1);
+
+	// others are not
+	dht->incoming_packet(s, pinger, ping_buf, sha256_hash());
+	TEST_EQUAL(cnt[counters::dht_messages_in_dropped], dropped + 1);
+}
+#endif
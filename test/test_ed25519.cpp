@@ -15,6 +15,8 @@ see LICENSE file.
 #include <memory>
 
 #include "ip2/kademlia/ed25519.hpp"
+#include "ip2/aux_/ed25519.hpp"
+#include "ip2/aux_/random.hpp"
 #include "ip2/hex.hpp"
 
 using namespace lt;
@@ -252,6 +254,37 @@ TORRENT_TEST(key_exchange)
 	TEST_EQUAL(aux::to_hex(secretA), aux::to_hex(secretB));
 }
 
+// the 64 bit field arithmetic must produce exactly what the ref10 code does
+TORRENT_TEST(ref10_equivalence)
+{
+	for (int i = 0; i < 64; ++i)
+	{
+		auto const [pk1, sk1] = ed25519_create_keypair(ed25519_create_seed());
+		auto const [pk2, sk2] = ed25519_create_keypair(ed25519_create_seed());
+
+		std::vector<char> msg(std::size_t(i * 7));
+		aux::random_bytes(msg);
+
+		auto const* pk = reinterpret_cast<unsigned char const*>(pk1.bytes.data());
+		auto const* sk = reinterpret_cast<unsigned char const*>(sk1.bytes.data());
+		auto const* m = reinterpret_cast<unsigned char const*>(msg.data());
+
+		std::array<unsigned char, 64> sig;
+		std::array<unsigned char, 64> sig_ref10;
+		aux::ed25519_sign(sig.data(), m, std::ptrdiff_t(msg.size()), pk, sk);
+		aux::ed25519_sign_ref10(sig_ref10.data(), m, std::ptrdiff_t(msg.size()), pk, sk);
+		TEST_CHECK(sig == sig_ref10);
+
+		std::array<unsigned char, 32> secret;
+		std::array<unsigned char, 32> secret_ref10;
+		aux::ed25519_key_exchange(secret.data()
+			, reinterpret_cast<unsigned char const*>(pk2.bytes.data()), sk);
+		aux::ed25519_key_exchange_ref10(secret_ref10.data()
+			, reinterpret_cast<unsigned char const*>(pk2.bytes.data()), sk);
+		TEST_CHECK(secret == secret_ref10);
+	}
+}
+
 #else
 TORRENT_TEST(empty)
 {
@@ -12,10 +12,13 @@ see LICENSE file.
 
 #include "ip2/hasher.hpp"
 #include "ip2/hex.hpp"
+#include "ip2/aux_/sha1_multi.hpp"
 
 #include "test.hpp"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 using namespace lt;
 
@@ -121,3 +124,31 @@ TORRENT_TEST(hasher256)
 	}
 }
 
+
+TORRENT_TEST(sha1_multi)
+{
+	// lengths around the padding boundaries, and a full blob segment
+	std::vector<std::string> messages;
+	for (int len : {0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 128, 950, 1000})
+	{
+		std::string m(std::size_t(len), '\0');
+		for (int i = 0; i < len; ++i) m[std::size_t(i)] = char(i * 7 + len);
+		messages.push_back(std::move(m));
+	}
+
+	std::vector<span<char const>> msgs(messages.begin(), messages.end());
+	for (auto const impl : { aux::sha1_multi_impl::scalar
+		, aux::sha1_multi_impl::avx2, aux::sha1_multi_impl::sha_ni })
+	{
+		std::vector<sha1_hash> out(msgs.size());
+		aux::sha1_multi(msgs, out, impl);
+		for (std::size_t i = 0; i < msgs.size(); ++i)
+			TEST_EQUAL(out[i], hasher(msgs[i]).final());
+	}
+
+	// fewer messages than lanes, and none at all
+	std::vector<sha1_hash> out(1);
+	aux::sha1_multi(span<span<char const> const>(msgs).first(1), out);
+	TEST_EQUAL(out[0], hasher(msgs[0]).final());
+	aux::sha1_multi({}, out);
+}
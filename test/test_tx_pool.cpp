@@ -0,0 +1,58 @@
+/*
+
+Copyright (c) 2021, TaiXiang Cui
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+#include "test.hpp"
+#include "ip2/blockchain/tx_pool.hpp"
+#include "ip2/kademlia/ed25519.hpp"
+
+#include <array>
+#include <tuple>
+
+using namespace lt;
+using namespace lt::blockchain;
+
+namespace {
+
+transaction make_note_tx(std::int64_t const timestamp)
+{
+	std::array<char, 32> seed;
+	seed.fill('s');
+	dht::public_key pk;
+	dht::secret_key sk;
+	std::tie(pk, sk) = dht::ed25519_create_keypair(seed);
+
+	aux::bytes chain_id{'c', 'h', 'a', 'i', 'n'};
+	aux::bytes payload{'n', 'o', 't', 'e'};
+	auto tx = transaction::create_note_transaction(chain_id, tx_version1, timestamp, pk, payload);
+	tx.sign(pk, sk);
+	return tx;
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(duplicate_note_tx)
+{
+	tx_pool pool(nullptr);
+
+	auto const tx = make_note_tx(100);
+	TEST_CHECK(pool.add_tx_to_time_pool(tx));
+	TEST_EQUAL(pool.size(), 1);
+	TEST_EQUAL(pool.arena_size(), 1);
+
+	// a tx that arrives again is not taken, nor gossiped again
+	TEST_CHECK(!pool.add_tx_to_time_pool(tx));
+	TEST_EQUAL(pool.size(), 1);
+	TEST_EQUAL(pool.arena_size(), 1);
+	TEST_CHECK(pool.find(tx.sha1()) != invalid_tx_handle);
+
+	pool.delete_tx_from_time_pool(tx);
+	TEST_EQUAL(pool.size(), 0);
+	TEST_EQUAL(pool.arena_size(), 0);
+	TEST_CHECK(!pool.is_transaction_in_time_pool(tx.sha1()));
+}
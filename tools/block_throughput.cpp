@@ -0,0 +1,200 @@
+/*
+Copyright (c) 2021, TaiXiang Cui
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+// simulate a local chain of several nodes in one process: nodes mine in turn,
+// every block is encoded, decoded, verified and applied on every node, senders
+// keep their tx pools full. Reports confirmed txs per block and sustained tx/s
+// for version 1 (one tx) and version 2 (tx batch) blocks.
+
+#include "ip2/blockchain/block.hpp"
+#include "ip2/blockchain/constants.hpp"
+#include "ip2/blockchain/repository_impl.hpp"
+#include "ip2/blockchain/tx_pool.hpp"
+#include "ip2/kademlia/ed25519.hpp"
+#include "ip2/time.hpp"
+
+#include <sqlite3.h>
+
+#include <cinttypes> // for PRId64 et.al.
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace ip2;
+using namespace ip2::blockchain;
+
+namespace {
+
+struct key_pair
+{
+	dht::public_key pk;
+	dht::secret_key sk;
+};
+
+struct sim_node
+{
+	sim_node()
+	{
+		sqlite3_open(":memory:", &db);
+		repo = std::make_unique<repository_impl>(db);
+		pool = tx_pool(repo.get());
+	}
+
+	~sim_node() { sqlite3_close(db); }
+
+	sim_node(sim_node const&) = delete;
+	sim_node& operator=(sim_node const&) = delete;
+
+	sqlite3* db = nullptr;
+	std::unique_ptr<repository_impl> repo;
+	tx_pool pool;
+	block head;
+};
+
+transaction make_transfer(aux::bytes chain_id, key_pair const& sender
+	, dht::public_key const& receiver, std::int64_t nonce, std::int64_t fee)
+{
+	aux::bytes payload;
+	auto tx = transaction::create_transfer_transaction(chain_id, tx_version1
+		, total_seconds(clock_type::now().time_since_epoch()), sender.pk, receiver
+		, nonce, 1, fee, payload);
+	tx.sign(sender.pk, sender.sk);
+	return tx;
+}
+
+void run(block_version version, int const num_nodes, int const num_accounts, int const rounds)
+{
+	aux::bytes chain_id = aux::asBytes("bench");
+
+	std::vector<key_pair> keys(static_cast<std::size_t>(num_accounts));
+	for (auto& k : keys)
+		std::tie(k.pk, k.sk) = dht::ed25519_create_keypair(dht::ed25519_create_seed());
+
+	std::vector<std::unique_ptr<sim_node>> nodes;
+	for (int i = 0; i < num_nodes; ++i)
+	{
+		auto n = std::make_unique<sim_node>();
+		n->repo->init();
+		n->repo->create_state_db(chain_id);
+		n->repo->create_block_db(chain_id);
+		for (auto const& k : keys)
+			n->repo->save_account(chain_id, account(k.pk, GENESIS_BLOCK_BALANCE, 0, 1));
+		nodes.push_back(std::move(n));
+	}
+
+	// every account always has its next tx pending in every pool
+	auto submit = [&](std::size_t const idx)
+	{
+		auto const& sender = keys[idx];
+		auto const nonce = nodes.front()->repo->get_account(chain_id, sender.pk).nonce() + 1;
+		auto const& receiver = keys[(idx + 1) % keys.size()].pk;
+		auto tx = make_transfer(chain_id, sender, receiver, nonce, std::int64_t(1 + idx % 7));
+		for (auto& n : nodes) n->pool.add_tx(tx);
+	};
+	for (std::size_t i = 0; i < keys.size(); ++i) submit(i);
+
+	std::int64_t confirmed = 0;
+	std::int64_t block_bytes = 0;
+	auto const start = clock_type::now();
+
+	for (int r = 0; r < rounds; ++r)
+	{
+		auto& miner = *nodes[std::size_t(r % num_nodes)];
+		auto const& miner_key = keys[std::size_t(r % num_accounts)];
+
+		std::vector<transaction> txs;
+		if (version == block_version2)
+		{
+			txs = miner.pool.get_block_transactions(MAX_BLOCK_TX_NUM, MAX_BLOCK_TXS_ENCODE_SIZE);
+		}
+		else
+		{
+			auto tx = miner.pool.get_best_fee_transaction();
+			if (!tx.empty()) txs.push_back(tx);
+		}
+
+		block b(chain_id, version, r + 1, miner.head.block_number() + 1, miner.head.sha1()
+			, GENESIS_BASE_TARGET, 0, sha1_hash(), sha1_hash(), txs, miner_key.pk);
+		b.sign(miner_key.pk, miner_key.sk);
+
+		// the block as it travels on the wire
+		std::string const encode = b.get_encode();
+		block_bytes += std::int64_t(encode.size());
+
+		for (auto& n : nodes)
+		{
+			block received(encode);
+			if (!received.verify_signature() || !received.verify_tx_merkle_root())
+			{
+				std::fprintf(stderr, "block verification failed\n");
+				std::exit(1);
+			}
+			for (auto const& tx : received.txs())
+			{
+				if (!tx.verify_signature())
+				{
+					std::fprintf(stderr, "tx verification failed\n");
+					std::exit(1);
+				}
+			}
+
+			n->repo->begin_transaction();
+			if (!n->repo->apply_block_state(received) || !n->repo->save_main_chain_block(received))
+			{
+				n->repo->rollback();
+				std::fprintf(stderr, "apply block failed\n");
+				std::exit(1);
+			}
+			n->repo->commit();
+
+			n->head = received;
+			n->pool.recheck_account_txs(received.get_block_peers());
+		}
+
+		confirmed += std::int64_t(txs.size());
+		for (auto const& tx : txs)
+		{
+			for (std::size_t i = 0; i < keys.size(); ++i)
+			{
+				if (keys[i].pk == tx.sender()) submit(i);
+			}
+		}
+	}
+
+	auto const elapsed = total_microseconds(clock_type::now() - start);
+	double const tx_per_block = double(confirmed) / rounds;
+
+	std::printf("block version %d: nodes: %d accounts: %d blocks: %d confirmed txs: %" PRId64 "\n"
+		, version == block_version2 ? 2 : 1, num_nodes, num_accounts, rounds, confirmed);
+	std::printf("  txs/block: %.2f  avg block size: %" PRId64 " bytes\n"
+		, tx_per_block, block_bytes / rounds);
+	std::printf("  processing rate (all nodes): %.1f tx/s\n"
+		, elapsed > 0 ? double(confirmed) * 1000000.0 / double(elapsed) : 0.0);
+	std::printf("  sustained rate at %d s block time: %.4f tx/s\n"
+		, DEFAULT_BLOCK_TIME, tx_per_block / DEFAULT_BLOCK_TIME);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+	int const num_nodes = argc > 1 ? std::atoi(argv[1]) : 4;
+	int const num_accounts = argc > 2 ? std::atoi(argv[2]) : 64;
+	int const rounds = argc > 3 ? std::atoi(argv[3]) : 200;
+
+	if (num_nodes <= 0 || num_accounts <= 0 || rounds <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [nodes] [accounts] [blocks]\n", argv[0]);
+		return 1;
+	}
+
+	run(block_version1, num_nodes, num_accounts, rounds);
+	run(block_version2, num_nodes, num_accounts, rounds);
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+// sign and key exchange throughput of the ed25519 code, the default (64 bit
+// field arithmetic where available) against the portable ref10 versions.
+// Checks both produce the same signatures and shared secrets.
+
+#include "ip2/aux_/ed25519.hpp"
+#include "ip2/aux_/random.hpp"
+#include "ip2/kademlia/ed25519.hpp"
+#include "ip2/time.hpp"
+
+#include <array>
+#include <cinttypes> // for PRId64 et.al.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ip2;
+
+namespace {
+
+void report(char const* name, int const ops, time_duration const elapsed)
+{
+	std::int64_t const us = total_microseconds(elapsed);
+	std::printf("%-22s %10.0f ops/s  %8.1f us/op\n", name
+		, us > 0 ? double(ops) * 1000000.0 / double(us) : 0.0
+		, double(us) / double(ops));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+	int const rounds = argc > 1 ? std::atoi(argv[1]) : 10000;
+	int const message_size = argc > 2 ? std::atoi(argv[2]) : 128;
+
+	if (rounds <= 0 || message_size < 0)
+	{
+		std::fprintf(stderr, "usage: %s [rounds] [message-size]\n", argv[0]);
+		return 1;
+	}
+
+	auto const [pk1, sk1] = dht::ed25519_create_keypair(dht::ed25519_create_seed());
+	auto const [pk2, sk2] = dht::ed25519_create_keypair(dht::ed25519_create_seed());
+	auto const* pk = reinterpret_cast<unsigned char const*>(pk1.bytes.data());
+	auto const* sk = reinterpret_cast<unsigned char const*>(sk1.bytes.data());
+	auto const* peer = reinterpret_cast<unsigned char const*>(pk2.bytes.data());
+
+	std::vector<char> message(std::size_t(message_size), '\0');
+	aux::random_bytes(message);
+	auto const* m = reinterpret_cast<unsigned char const*>(message.data());
+	std::ptrdiff_t const len = std::ptrdiff_t(message.size());
+
+	std::printf("%d rounds, %d byte messages\n", rounds, message_size);
+
+	std::array<unsigned char, 64> sig;
+	std::array<unsigned char, 64> sig_ref10;
+
+	time_point start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+		aux::ed25519_sign_ref10(sig_ref10.data(), m, len, pk, sk);
+	report("sign (ref10)", rounds, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+		aux::ed25519_sign(sig.data(), m, len, pk, sk);
+	report("sign", rounds, clock_type::now() - start);
+
+	if (sig != sig_ref10)
+	{
+		std::fprintf(stderr, "signature mismatch\n");
+		return 1;
+	}
+
+	std::array<unsigned char, 32> secret;
+	std::array<unsigned char, 32> secret_ref10;
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+		aux::ed25519_key_exchange_ref10(secret_ref10.data(), peer, sk);
+	report("key exchange (ref10)", rounds, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+		aux::ed25519_key_exchange(secret.data(), peer, sk);
+	report("key exchange", rounds, clock_type::now() - start);
+
+	if (secret != secret_ref10)
+	{
+		std::fprintf(stderr, "shared secret mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
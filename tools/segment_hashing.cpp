@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+// hash a blob the way putter splits it into segments, once per segment with
+// a hasher and once through aux::sha1_multi for every implementation the CPU
+// supports. Reports segments/s and checks all digests agree.
+
+#include "ip2/assemble/protocol.hpp"
+#include "ip2/aux_/random.hpp"
+#include "ip2/aux_/sha1_multi.hpp"
+#include "ip2/hasher.hpp"
+#include "ip2/time.hpp"
+
+#include <cinttypes> // for PRId64 et.al.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ip2;
+
+namespace {
+
+char const* impl_name(aux::sha1_multi_impl const impl)
+{
+	switch (impl)
+	{
+		case aux::sha1_multi_impl::scalar: return "multi (scalar)";
+		case aux::sha1_multi_impl::avx2: return "multi (avx2)";
+		case aux::sha1_multi_impl::sha_ni: return "multi (sha-ni)";
+	}
+	return "";
+}
+
+void report(char const* name, std::int64_t const segments, std::int64_t const bytes
+	, time_duration const elapsed)
+{
+	std::int64_t const us = total_microseconds(elapsed);
+	std::printf("%-16s %10.0f segments/s  %8.1f MB/s\n", name
+		, us > 0 ? double(segments) * 1000000.0 / double(us) : 0.0
+		, us > 0 ? double(bytes) / double(us) : 0.0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+	int const blob_size = argc > 1 ? std::atoi(argv[1]) : 1024 * 1024;
+	int const rounds = argc > 2 ? std::atoi(argv[2]) : 100;
+
+	if (blob_size <= 0 || rounds <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [blob-size] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<char> blob(std::size_t(blob_size), '\0');
+	aux::random_bytes(blob);
+
+	int const seg_size = assemble::protocol::blob_seg_mtu;
+	std::vector<span<char const>> segments;
+	for (int begin = 0; begin < blob_size; begin += seg_size)
+		segments.push_back(span<char const>(blob).subspan(begin, std::min(seg_size, blob_size - begin)));
+
+	std::int64_t const total = std::int64_t(segments.size()) * rounds;
+	std::int64_t const bytes = std::int64_t(blob_size) * rounds;
+	std::printf("blob: %d bytes, %d segments, %d rounds\n"
+		, blob_size, int(segments.size()), rounds);
+
+	std::vector<sha1_hash> expected(segments.size());
+	time_point start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < segments.size(); ++i)
+			expected[i] = hasher(segments[i]).final();
+	}
+	report("hasher", total, bytes, clock_type::now() - start);
+
+	std::vector<sha1_hash> digests(segments.size());
+	for (auto const impl : { aux::sha1_multi_impl::scalar
+		, aux::sha1_multi_impl::avx2, aux::sha1_multi_impl::sha_ni })
+	{
+		if (!aux::sha1_multi_supported(impl)) continue;
+
+		start = clock_type::now();
+		for (int r = 0; r < rounds; ++r)
+			aux::sha1_multi(segments, digests, impl);
+		report(impl_name(impl), total, bytes, clock_type::now() - start);
+
+		if (digests != expected)
+		{
+			std::fprintf(stderr, "%s: digest mismatch\n", impl_name(impl));
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2022, Xianshui Sheng
+All rights reserved.
+
+You may use, distribute and modify this code under the terms of the BSD license,
+see LICENSE file.
+*/
+
+// the cost of putting a blob, per segment, the old way (a signed mutable item
+// salted with the segment hash) and as content addressed segments (named by
+// their SHA-1, no signature). Counts the CPU spent by the putter and by one
+// storing node, and the size of the put messages on the wire.
+
+#include "ip2/assemble/protocol.hpp"
+#include "ip2/aux_/random.hpp"
+#include "ip2/bencode.hpp"
+#include "ip2/entry.hpp"
+#include "ip2/hasher.hpp"
+#include "ip2/kademlia/ed25519.hpp"
+#include "ip2/kademlia/item.hpp"
+#include "ip2/kademlia/node.hpp"
+#include "ip2/time.hpp"
+
+#include <cinttypes> // for PRId64 et.al.
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+using namespace ip2;
+
+namespace {
+
+// the put message as put_data::invoke() builds it
+entry put_message(entry const& v)
+{
+	entry e;
+	e["y"] = "q";
+	e["q"] = "put";
+	e["t"] = "aa";
+	entry& a = e["a"];
+	a["v"] = v;
+	a["token"] = dht::ip2_token;
+	a["distance"] = 256;
+	return e;
+}
+
+std::int64_t encoded_size(entry const& e)
+{
+	std::vector<char> buf;
+	bencode(std::back_inserter(buf), e);
+	return std::int64_t(buf.size());
+}
+
+void report(char const* name, std::int64_t const blobs, std::int64_t const put_us
+	, std::int64_t const store_us, std::int64_t const wire_bytes)
+{
+	std::printf("%-10s put: %8.1f us/blob  store: %8.1f us/blob  wire: %8" PRId64 " bytes/blob\n"
+		, name, double(put_us) / double(blobs), double(store_us) / double(blobs)
+		, wire_bytes);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+	int const blob_size = argc > 1 ? std::atoi(argv[1]) : 45 * 1024;
+	int const rounds = argc > 2 ? std::atoi(argv[2]) : 100;
+
+	if (blob_size <= 0 || rounds <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [blob-size] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<char> blob(std::size_t(blob_size), '\0');
+	aux::random_bytes(blob);
+
+	int const seg_size = assemble::protocol::blob_seg_mtu;
+	std::vector<span<char const>> segments;
+	for (int begin = 0; begin < blob_size; begin += seg_size)
+		segments.push_back(span<char const>(blob).subspan(begin, std::min(seg_size, blob_size - begin)));
+
+	std::printf("blob: %d bytes, %d segments, %d rounds\n"
+		, blob_size, int(segments.size()), rounds);
+
+	dht::public_key pk;
+	dht::secret_key sk;
+	std::tie(pk, sk) = dht::ed25519_create_keypair(dht::ed25519_create_seed());
+	dht::timestamp const ts(total_seconds(clock_type::now().time_since_epoch()));
+
+	// signed mutable segments: hash, encode and sign on the putter, verify
+	// the signature on the storing node
+	std::vector<std::string> values(segments.size());
+	std::vector<dht::signature> sigs(segments.size());
+	std::vector<sha1_hash> hashes(segments.size());
+	std::int64_t wire_bytes = 0;
+
+	time_point start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < segments.size(); ++i)
+		{
+			hashes[i] = hasher(segments[i]).final();
+			values[i].clear();
+			bencode(std::back_inserter(values[i])
+				, assemble::protocol::blob_seg_protocol(segments[i]).to_entry());
+			sigs[i] = dht::sign_mutable_item(values[i], hashes[i], ts, pk, sk);
+		}
+	}
+	std::int64_t const mutable_put = total_microseconds(clock_type::now() - start);
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < segments.size(); ++i)
+		{
+			if (!dht::verify_mutable_item(values[i], hashes[i], ts, pk, sigs[i]))
+			{
+				std::fprintf(stderr, "signature verification failed\n");
+				return 1;
+			}
+		}
+	}
+	std::int64_t const mutable_store = total_microseconds(clock_type::now() - start);
+
+	for (std::size_t i = 0; i < segments.size(); ++i)
+	{
+		entry e = put_message(assemble::protocol::blob_seg_protocol(segments[i]).to_entry());
+		entry& a = e["a"];
+		a["k"] = pk.bytes;
+		a["ts"] = ts.value;
+		a["sig"] = sigs[i].bytes;
+		a["salt"] = hashes[i].to_string();
+		wire_bytes += encoded_size(e);
+	}
+	report("mutable", rounds, mutable_put, mutable_store, wire_bytes);
+
+	// content addressed segments: the putter hashes each segment to name
+	// it, the storing node hashes it again to check the name
+	std::vector<sha256_hash> targets(segments.size());
+	wire_bytes = 0;
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < segments.size(); ++i)
+			targets[i] = dht::segment_target_id(hasher(segments[i]).final());
+	}
+	std::int64_t const segment_put = total_microseconds(clock_type::now() - start);
+
+	start = clock_type::now();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (std::size_t i = 0; i < segments.size(); ++i)
+		{
+			if (dht::segment_target_id(segments[i]) != targets[i])
+			{
+				std::fprintf(stderr, "segment hash mismatch\n");
+				return 1;
+			}
+		}
+	}
+	std::int64_t const segment_store = total_microseconds(clock_type::now() - start);
+
+	for (std::size_t i = 0; i < segments.size(); ++i)
+	{
+		entry e = put_message(entry(std::string(segments[i].data()
+			, std::size_t(segments[i].size()))));
+		e["a"]["seg"] = 1;
+		wire_bytes += encoded_size(e);
+	}
+	report("segment", rounds, segment_put, segment_store, wire_bytes);
+
+	return 0;
+}